@@ -0,0 +1,59 @@
+#include "BenchmarkApp.h"
+#include "glad.h"
+#include "../dependencies/glfw/include/GLFW/glfw3.h"
+#include <cstdio>
+
+BenchmarkApp::BenchmarkApp()
+    : m_outputFile("microbenchmarks.json"),
+    m_smokeTest(false),
+    m_exitCode(1) {
+}
+
+BenchmarkApp::~BenchmarkApp() {
+}
+
+bool BenchmarkApp::startup() {
+    if (!gladLoadGLLoader((GLADloadproc)aie::Application::getGLProcAddress)) {
+        printf("Failed to initialize OpenGL loader!\n");
+        return false;
+    }
+    printf("OpenGL %s, %s\n\n", (const char*)glGetString(GL_VERSION), (const char*)glGetString(GL_RENDERER));
+
+    if (m_smokeTest) {
+        m_exitCode = runSmokeTests() > 0 ? 3 : 0;
+        quit();
+        return true;
+    }
+
+    addBenchmarks();
+    m_suite.run();
+
+    if (!m_suite.writeJson(m_outputFile.c_str()))
+        return false;
+    printf("\nResults written to %s\n", m_outputFile.c_str());
+
+    m_exitCode = 0;
+    if (!m_baselineFile.empty()) {
+        if (!m_suite.compare(m_baselineFile.c_str()))
+            m_exitCode = 1;
+        else if (unsigned int regressions = m_suite.getRegressionCount()) {
+            printf("%u benchmark(s) regressed\n", regressions);
+            m_exitCode = 2;
+        }
+        // Rewritten so the file also records the comparison
+        m_suite.writeJson(m_outputFile.c_str());
+    }
+
+    // Everything has run; the loop is never entered
+    quit();
+    return true;
+}
+
+void BenchmarkApp::shutdown() {
+}
+
+void BenchmarkApp::update(float deltaTime) {
+}
+
+void BenchmarkApp::draw() {
+}
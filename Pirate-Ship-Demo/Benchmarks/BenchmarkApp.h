@@ -0,0 +1,47 @@
+#pragma once
+#include <string>
+#include "Application.h"
+#include "MicroBenchmark.h"
+
+// Hosts the engine microbenchmarks
+// The Application provides the hidden window, GL context, Input and job system the engine
+// code expects; every case runs from startup() and the application quits without entering
+// its loop. GL work runs against whatever context the machine gives, so cases that submit
+// to the driver measure the driver too.
+class BenchmarkApp : public aie::Application {
+public:
+    BenchmarkApp();
+    virtual ~BenchmarkApp();
+    virtual bool startup();
+    virtual void shutdown();
+    virtual void update(float deltaTime);
+    virtual void draw();
+
+    // Must be set before run(); a null baseline skips the comparison
+    void setFilter(const char* filter) { m_suite.setFilter(filter); }
+    void setBatchCount(unsigned int batches) { m_suite.setBatchCount(batches); }
+    void setOutputFile(const char* filename) { m_outputFile = filename; }
+    void setBaselineFile(const char* filename) { m_baselineFile = filename != nullptr ? filename : ""; }
+
+    // Runs the smoke checks instead of the timed suite
+    void setSmokeTest(bool smokeTest) { m_smokeTest = smokeTest; }
+
+    // Non-zero when the suite could not run, a case regressed against the baseline,
+    // or a smoke check failed
+    int getExitCode() const { return m_exitCode; }
+
+protected:
+
+    // Registers every case with the suite (EngineBenchmarks.cpp)
+    void addBenchmarks();
+
+    // Quick pass / fail checks of the occlusion culler, the mesh occluders and, under the
+    // null GL backend, the GL calls a mesh makes (SmokeTests.cpp); returns the number that failed
+    unsigned int runSmokeTests();
+
+    MicroBenchmark m_suite;
+    std::string m_outputFile;
+    std::string m_baselineFile;
+    bool m_smokeTest;
+    int m_exitCode;
+};
@@ -0,0 +1,222 @@
+#include "BenchmarkApp.h"
+#include "../Project3D/Mesh.h"
+#include "../Project3D/Shader.h"
+#include "../Project3D/Texture.h"
+#include "../dependencies/glfw/include/GLFW/glfw3.h"
+#include <stb_image.h>
+#include <glm/ext.hpp>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include "Gizmos.h"
+#include "Input.h"
+#include "Renderer2D.h"
+
+// Assets the cases load, relative to the bin folder
+static const char* shipModel = "../bin/pirate_ship/pirate_ship.obj";
+static const char* shipMaterial = "../bin/pirate_ship/pirate_ship.mtl";
+static const char* shipTexture = "../bin/pirate_ship/texture000.jpg";
+static const char* syntheticMaterial = "microbenchmark.mtl";
+
+// Written by the setup of the MTL parse case; colour lines only, so no texture is loaded
+static const unsigned int syntheticMaterialCount = 256;
+
+// Gizmo buffers are cleared before they fill, or later adds would be dropped cheaply
+static const unsigned int gizmoCapacity = 65536;
+static const int sphereRows = 16;
+static const int sphereColumns = 16;
+static const unsigned int sphereTriangles = sphereRows * sphereColumns * 2;
+
+// State shared between a case's setup, body and teardown
+static std::vector<unsigned char> s_encodedTexture;
+static Mesh* s_materialMesh = nullptr;
+static aie::ShaderProgram* s_shader = nullptr;
+static aie::Renderer2D* s_renderer = nullptr;
+static aie::Texture* s_spriteTextures = nullptr;
+static GLFWkeyfun s_keyCallback = nullptr;
+static GLFWcursorposfun s_cursorCallback = nullptr;
+
+static const unsigned int spriteTextureCount = 4;
+
+void BenchmarkApp::addBenchmarks() {
+    GLFWwindow* window = m_window;
+
+    // Mesh: Assimp import and material parsing
+    m_suite.add("mesh/import_obj", [](unsigned int iterations) {
+        for (unsigned int i = 0; i < iterations; i++) {
+            Mesh mesh;
+            mesh.loadFile(shipModel);
+        }
+    });
+
+    m_suite.add("mesh/parse_mtl", [](unsigned int iterations) {
+        for (unsigned int i = 0; i < iterations; i++)
+            s_materialMesh->loadMaterial(syntheticMaterial);
+    }, syntheticMaterialCount, []() {
+        std::ofstream file(syntheticMaterial);
+        for (unsigned int i = 0; i < syntheticMaterialCount; i++) {
+            file << "newmtl material" << i << "\n";
+            file << "Ns 32.000000\nKa 0.100000 0.100000 0.100000\n";
+            file << "Kd 0.640000 0.640000 0.640000\nKs 0.500000 0.500000 0.500000\n\n";
+        }
+        s_materialMesh = new Mesh();
+    }, []() {
+        delete s_materialMesh;
+        s_materialMesh = nullptr;
+        remove(syntheticMaterial);
+    });
+
+    m_suite.add("mesh/load_material_textures", [](unsigned int iterations) {
+        for (unsigned int i = 0; i < iterations; i++)
+            s_materialMesh->loadMaterial(shipMaterial);
+    }, 1, []() {
+        s_materialMesh = new Mesh();
+    }, []() {
+        delete s_materialMesh;
+        s_materialMesh = nullptr;
+    });
+
+    // Texture: JPEG decode alone, then the whole load with the GL upload
+    m_suite.add("texture/decode_jpg", [](unsigned int iterations) {
+        for (unsigned int i = 0; i < iterations; i++) {
+            int x = 0, y = 0, comp = 0;
+            unsigned char* pixels = stbi_load_from_memory(s_encodedTexture.data(), (int)s_encodedTexture.size(),
+                &x, &y, &comp, STBI_default);
+            stbi_image_free(pixels);
+        }
+    }, 1, []() {
+        std::ifstream file(shipTexture, std::ios::binary);
+        s_encodedTexture.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }, []() {
+        s_encodedTexture.clear();
+        s_encodedTexture.shrink_to_fit();
+    });
+
+    m_suite.add("texture/load_jpg", [](unsigned int iterations) {
+        for (unsigned int i = 0; i < iterations; i++) {
+            aie::Texture texture;
+            texture.load(shipTexture);
+        }
+    });
+
+    // Gizmos: how fast primitives fill the buffers, without drawing them
+    m_suite.add("gizmos/add_line", [](unsigned int iterations) {
+        aie::Gizmos::clear();
+        glm::vec4 colour(1, 1, 0, 1);
+        for (unsigned int i = 0; i < iterations; i++) {
+            if (i % gizmoCapacity == gizmoCapacity - 1)
+                aie::Gizmos::clear();
+            float offset = (float)(i & 255);
+            aie::Gizmos::addLine(glm::vec3(offset, 0, 0), glm::vec3(offset, 1, 0), colour);
+        }
+    }, 1, []() {
+        aie::Gizmos::create(gizmoCapacity, gizmoCapacity, 0, 0);
+    }, []() {
+        aie::Gizmos::destroy();
+    });
+
+    m_suite.add("gizmos/add_sphere_16x16", [](unsigned int iterations) {
+        aie::Gizmos::clear();
+        glm::vec4 colour(1, 0, 0, 1);
+        for (unsigned int i = 0; i < iterations; i++) {
+            if (i % (gizmoCapacity / sphereTriangles) == gizmoCapacity / sphereTriangles - 1)
+                aie::Gizmos::clear();
+            aie::Gizmos::addSphere(glm::vec3((float)(i & 15), 0, 0), 1.0f, sphereRows, sphereColumns, colour);
+        }
+    }, sphereTriangles, []() {
+        aie::Gizmos::create(gizmoCapacity, gizmoCapacity, 0, 0);
+    }, []() {
+        aie::Gizmos::destroy();
+    });
+
+    // Renderer2D: sprite batching, including the flushes a full batch causes
+    m_suite.add("renderer2d/draw_sprite", [](unsigned int iterations) {
+        s_renderer->begin();
+        for (unsigned int i = 0; i < iterations; i++)
+            s_renderer->drawSprite(nullptr, (float)(i & 1023), (float)((i >> 10) & 511), 8, 8);
+        s_renderer->end();
+    }, 1, []() {
+        s_renderer = new aie::Renderer2D();
+    }, []() {
+        delete s_renderer;
+        s_renderer = nullptr;
+    });
+
+    m_suite.add("renderer2d/draw_sprite_4_textures", [](unsigned int iterations) {
+        s_renderer->begin();
+        for (unsigned int i = 0; i < iterations; i++)
+            s_renderer->drawSprite(&s_spriteTextures[i % spriteTextureCount], (float)(i & 1023), (float)((i >> 10) & 511), 8, 8);
+        s_renderer->end();
+    }, 1, []() {
+        s_renderer = new aie::Renderer2D();
+        s_spriteTextures = new aie::Texture[spriteTextureCount];
+        for (unsigned int i = 0; i < spriteTextureCount; i++) {
+            unsigned char pixels[4] = { (unsigned char)(i * 64), 255, 255, 255 };
+            s_spriteTextures[i].create(1, 1, aie::Texture::RGBA, pixels);
+        }
+    }, []() {
+        delete[] s_spriteTextures;
+        s_spriteTextures = nullptr;
+        delete s_renderer;
+        s_renderer = nullptr;
+    });
+
+    // ShaderProgram: uniform upload by name (a lookup each call) against a cached location
+    auto loadShader = []() {
+        s_shader = new aie::ShaderProgram();
+        s_shader->loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/phong.vert");
+        s_shader->loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/phong.frag");
+        if (!s_shader->link())
+            printf("Failed to link the phong shader\n");
+        s_shader->bind();
+    };
+    auto destroyShader = []() {
+        delete s_shader;
+        s_shader = nullptr;
+    };
+
+    m_suite.add("shader/bind_uniform_by_name", [](unsigned int iterations) {
+        glm::mat4 matrix(1.0f);
+        for (unsigned int i = 0; i < iterations; i++) {
+            matrix[3].x = (float)i;
+            s_shader->bindUniform("ModelMatrix", matrix);
+        }
+    }, 1, loadShader, destroyShader);
+
+    m_suite.add("shader/bind_uniform_by_id", [](unsigned int iterations) {
+        glm::mat4 matrix(1.0f);
+        int location = s_shader->getUniform("ModelMatrix");
+        for (unsigned int i = 0; i < iterations; i++) {
+            matrix[3].x = (float)i;
+            s_shader->bindUniform(location, matrix);
+        }
+    }, 1, loadShader, destroyShader);
+
+    // Input: the per-frame processing with no events, and with a burst arriving through the
+    // same GLFW callbacks the window uses (taken back by swapping them out and in again)
+    m_suite.add("input/process_events_idle", [](unsigned int iterations) {
+        aie::Input* input = aie::Input::getInstance();
+        for (unsigned int i = 0; i < iterations; i++)
+            input->processEvents();
+    });
+
+    m_suite.add("input/process_events_32", [window](unsigned int iterations) {
+        aie::Input* input = aie::Input::getInstance();
+        for (unsigned int i = 0; i < iterations; i++) {
+            for (int e = 0; e < 16; e++) {
+                s_keyCallback(window, GLFW_KEY_A + e, 0, (i & 1) ? GLFW_RELEASE : GLFW_PRESS, 0);
+                s_cursorCallback(window, (double)e, (double)(i & 255));
+            }
+            input->processEvents();
+        }
+    }, 32, [window]() {
+        s_keyCallback = glfwSetKeyCallback(window, nullptr);
+        glfwSetKeyCallback(window, s_keyCallback);
+        s_cursorCallback = glfwSetCursorPosCallback(window, nullptr);
+        glfwSetCursorPosCallback(window, s_cursorCallback);
+    }, []() {
+        aie::Input::getInstance()->resetState();
+        aie::Input::getInstance()->processEvents();
+    });
+}
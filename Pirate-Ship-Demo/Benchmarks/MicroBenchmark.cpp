@@ -0,0 +1,197 @@
+#include "MicroBenchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+// Two-sided 95% critical values of Student's t for 1 to 30 degrees of freedom
+static const double tCritical[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+static double studentT95(unsigned int degreesOfFreedom) {
+    if (degreesOfFreedom == 0)
+        return 0.0;
+    if (degreesOfFreedom <= sizeof(tCritical) / sizeof(tCritical[0]))
+        return tCritical[degreesOfFreedom - 1];
+    return 1.96;
+}
+
+// Reads the number after "key": in a line written by writeJson
+static bool findNumber(const char* line, const char* key, double& value) {
+    const char* found = strstr(line, key);
+    if (found == nullptr)
+        return false;
+    value = strtod(found + strlen(key), nullptr);
+    return true;
+}
+
+MicroBenchmark::MicroBenchmark()
+    : m_batchCount(20),
+    m_minBatchTime(0.01) {
+}
+
+void MicroBenchmark::add(const char* name, const Function& function, unsigned int itemsPerIteration,
+    const Fixture& setup, const Fixture& teardown) {
+    Case benchmark = { name, function, itemsPerIteration, setup, teardown };
+    m_cases.push_back(benchmark);
+}
+
+double MicroBenchmark::timeBatch(const Function& function, unsigned int iterations) {
+    auto start = std::chrono::steady_clock::now();
+    function(iterations);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void MicroBenchmark::run() {
+    m_results.clear();
+    for (const Case& benchmark : m_cases) {
+        if (!m_filter.empty() && benchmark.name.find(m_filter) == std::string::npos)
+            continue;
+
+        if (benchmark.setup)
+            benchmark.setup();
+        runCase(benchmark);
+        if (benchmark.teardown)
+            benchmark.teardown();
+    }
+}
+
+void MicroBenchmark::runCase(const Case& benchmark) {
+    // Grow the batch until it is long enough for the clock; these batches also warm the caches
+    unsigned int iterations = 1;
+    const unsigned int maxIterations = 1u << 30;
+    for (;;) {
+        double time = timeBatch(benchmark.function, iterations);
+        if (time >= m_minBatchTime || iterations >= maxIterations)
+            break;
+        double estimate = time > 0.0 ? iterations * m_minBatchTime / time * 1.2 : iterations * 10.0;
+        iterations = (unsigned int)std::min((double)maxIterations, std::max(iterations * 2.0, estimate));
+    }
+
+    std::vector<double> samples(m_batchCount);
+    for (double& sample : samples)
+        sample = timeBatch(benchmark.function, iterations) * 1e9 / iterations;
+
+    double sum = 0.0;
+    for (double sample : samples)
+        sum += sample;
+    double mean = sum / samples.size();
+    double variance = 0.0;
+    for (double sample : samples)
+        variance += (sample - mean) * (sample - mean);
+    double stddev = std::sqrt(variance / (samples.size() - 1));
+    double halfWidth = studentT95((unsigned int)samples.size() - 1) * stddev / std::sqrt((double)samples.size());
+
+    std::sort(samples.begin(), samples.end());
+    size_t middle = samples.size() / 2;
+    double median = samples.size() % 2 ? samples[middle] : (samples[middle - 1] + samples[middle]) * 0.5;
+
+    Result result = {};
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    result.batches = (unsigned int)samples.size();
+    result.itemsPerIteration = benchmark.itemsPerIteration;
+    result.mean = mean;
+    result.stddev = stddev;
+    result.ciLow = mean - halfWidth;
+    result.ciHigh = mean + halfWidth;
+    result.median = median;
+    result.min = samples.front();
+    m_results.push_back(result);
+    print(result);
+}
+
+void MicroBenchmark::print(const Result& result) const {
+    double margin = result.mean > 0.0 ? (result.ciHigh - result.mean) / result.mean * 100.0 : 0.0;
+    printf("%-36s %14.1f ns  +/-%5.1f%%", result.name.c_str(), result.mean, margin);
+    if (result.hasBaseline) {
+        const char* verdicts[] = { "improved", "", "REGRESSED" };
+        printf("  %+7.1f%% %s", result.change * 100.0, verdicts[result.verdict + 1]);
+    }
+    printf("\n");
+}
+
+bool MicroBenchmark::compare(const char* baselineFile) {
+    FILE* file = nullptr;
+    fopen_s(&file, baselineFile, "r");
+    if (file == nullptr) {
+        printf("Failed to read benchmark baseline: %s\n", baselineFile);
+        return false;
+    }
+
+    printf("\nCompared with %s:\n", baselineFile);
+    char line[1024];
+    while (fgets(line, sizeof(line), file) != nullptr) {
+        const char* name = strstr(line, "\"name\": \"");
+        if (name == nullptr)
+            continue;
+        name += strlen("\"name\": \"");
+        const char* nameEnd = strchr(name, '"');
+        if (nameEnd == nullptr)
+            continue;
+
+        double mean = 0.0, ciLow = 0.0, ciHigh = 0.0;
+        if (!findNumber(line, "\"mean_ns\":", mean) ||
+            !findNumber(line, "\"ci95_low_ns\":", ciLow) ||
+            !findNumber(line, "\"ci95_high_ns\":", ciHigh))
+            continue;
+
+        for (Result& result : m_results) {
+            if (result.name.compare(0, std::string::npos, name, nameEnd - name) != 0)
+                continue;
+
+            // Only intervals that do not overlap count as a change, so noise is not reported
+            result.hasBaseline = true;
+            result.baselineMean = mean;
+            result.change = mean > 0.0 ? result.mean / mean - 1.0 : 0.0;
+            result.verdict = result.ciLow > ciHigh ? 1 : (result.ciHigh < ciLow ? -1 : 0);
+            print(result);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+unsigned int MicroBenchmark::getRegressionCount() const {
+    unsigned int count = 0;
+    for (const Result& result : m_results) {
+        if (result.hasBaseline && result.verdict > 0)
+            count++;
+    }
+    return count;
+}
+
+bool MicroBenchmark::writeJson(const char* filename) const {
+    FILE* file = nullptr;
+    fopen_s(&file, filename, "w");
+    if (file == nullptr) {
+        printf("Failed to write benchmark results: %s\n", filename);
+        return false;
+    }
+
+    // One case per line, which compare() relies on; names are plain identifiers so need no escaping
+    fprintf(file, "{\n  \"unit\": \"ns\",\n  \"confidence\": 0.95,\n  \"benchmarks\": [\n");
+    for (size_t i = 0; i < m_results.size(); i++) {
+        const Result& result = m_results[i];
+        double itemsPerSecond = result.mean > 0.0 ? result.itemsPerIteration * 1e9 / result.mean : 0.0;
+        fprintf(file, "    { \"name\": \"%s\", \"iterations\": %u, \"batches\": %u, \"mean_ns\": %.3f, "
+            "\"stddev_ns\": %.3f, \"ci95_low_ns\": %.3f, \"ci95_high_ns\": %.3f, \"median_ns\": %.3f, "
+            "\"min_ns\": %.3f, \"items_per_second\": %.1f",
+            result.name.c_str(), result.iterations, result.batches, result.mean, result.stddev,
+            result.ciLow, result.ciHigh, result.median, result.min, itemsPerSecond);
+        if (result.hasBaseline) {
+            const char* verdicts[] = { "improved", "unchanged", "regressed" };
+            fprintf(file, ", \"baseline_mean_ns\": %.3f, \"change\": %.4f, \"verdict\": \"%s\"",
+                result.baselineMean, result.change, verdicts[result.verdict + 1]);
+        }
+        fprintf(file, " }%s\n", i + 1 < m_results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    fclose(file);
+    return true;
+}
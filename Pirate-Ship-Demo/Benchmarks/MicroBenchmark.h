@@ -0,0 +1,84 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <vector>
+
+// Microbenchmark runner for engine hot paths
+// Each case is a function that repeats one operation a given number of times. The runner
+// grows the repeat count until a batch takes long enough to time reliably, then times a
+// number of batches and reports the mean time per operation with a 95% confidence
+// interval (Student's t over the batch means). Results are written as JSON, one case per
+// line, and can be compared with a previous run's file: a case has regressed when its
+// interval lies entirely above the baseline's.
+class MicroBenchmark {
+public:
+
+    // Runs the operation `iterations` times
+    typedef std::function<void(unsigned int iterations)> Function;
+    typedef std::function<void()> Fixture;
+
+    struct Result {
+        std::string name;
+        unsigned int iterations;    // Operations per batch
+        unsigned int batches;
+        unsigned int itemsPerIteration;
+        double mean;                // Nanoseconds per operation
+        double stddev;
+        double ciLow;               // 95% confidence interval of the mean
+        double ciHigh;
+        double median;
+        double min;
+
+        // Filled in by compare() when the baseline has the case
+        bool hasBaseline;
+        double baselineMean;
+        double change;              // Relative change of the mean, 0.1 for 10% slower
+        int verdict;                // -1 improved, 0 no significant change, 1 regressed
+    };
+
+    MicroBenchmark();
+
+    // Setup and teardown run once around the case and are not timed
+    // itemsPerIteration scales the reported throughput (e.g. lines per addSphere call)
+    void add(const char* name, const Function& function, unsigned int itemsPerIteration = 1,
+        const Fixture& setup = nullptr, const Fixture& teardown = nullptr);
+
+    // Only cases whose name contains the filter run
+    void setFilter(const char* filter) { m_filter = filter != nullptr ? filter : ""; }
+    void setBatchCount(unsigned int batches) { m_batchCount = batches < 2 ? 2 : batches; }
+    void setMinBatchTime(double seconds) { m_minBatchTime = seconds; }
+
+    void run();
+    const std::vector<Result>& getResults() const { return m_results; }
+
+    // Loads a file written by writeJson and fills in each result's comparison
+    // returns false if the file could not be read
+    bool compare(const char* baselineFile);
+
+    // Number of cases the last compare() found slower beyond the noise
+    unsigned int getRegressionCount() const;
+
+    bool writeJson(const char* filename) const;
+
+protected:
+
+    struct Case {
+        std::string name;
+        Function function;
+        unsigned int itemsPerIteration;
+        Fixture setup;
+        Fixture teardown;
+    };
+
+    // Seconds taken by one batch
+    static double timeBatch(const Function& function, unsigned int iterations);
+
+    void runCase(const Case& benchmark);
+    void print(const Result& result) const;
+
+    std::vector<Case> m_cases;
+    std::vector<Result> m_results;
+    std::string m_filter;
+    unsigned int m_batchCount;
+    double m_minBatchTime;
+};
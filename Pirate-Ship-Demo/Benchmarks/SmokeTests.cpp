@@ -0,0 +1,101 @@
+#include "BenchmarkApp.h"
+#include "../Project3D/Mesh.h"
+#include "../Project3D/OcclusionCuller.h"
+#include "../Project3D/Shader.h"
+#include <glm/ext.hpp>
+#include <cstdio>
+#include <vector>
+#include "NullGL.h"
+
+// Assets the checks load, relative to the bin folder
+static const char* shipModel = "../bin/pirate_ship/pirate_ship.obj";
+
+// Prints the outcome of one check and returns 1 if it failed, for counting
+static unsigned int check(const char* name, bool passed) {
+    printf("%s %s\n", passed ? "pass" : "FAIL", name);
+    return passed ? 0 : 1;
+}
+
+unsigned int BenchmarkApp::runSmokeTests() {
+    unsigned int failures = 0;
+
+    // OcclusionCuller: a 2x2 quad 5 units in front of the camera hides a box 20 units
+    // away behind it, but not one off to the side, one in front of it, or anything
+    // behind the camera (outside the frustum counts as not visible)
+    {
+        glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+        glm::mat4 view = glm::lookAt(glm::vec3(0), glm::vec3(0, 0, -1), glm::vec3(0, 1, 0));
+        std::vector<glm::vec3> quad = {
+            { -1, -1, -5 }, { 1, -1, -5 }, { 1, 1, -5 },
+            { -1, -1, -5 }, { 1, 1, -5 }, { -1, 1, -5 },
+        };
+        glm::vec3 halfExtent(0.5f);
+
+        OcclusionCuller culler;
+        culler.begin(projection * view);
+        culler.addOccluder(quad, glm::mat4(1.0f));
+        culler.rasterize();
+
+        failures += check("culler/box_behind_occluder_hidden",
+            !culler.isVisible(-halfExtent, halfExtent, glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -20))));
+        failures += check("culler/box_beside_occluder_visible",
+            culler.isVisible(-halfExtent, halfExtent, glm::translate(glm::mat4(1.0f), glm::vec3(10, 0, -20))));
+        failures += check("culler/box_before_occluder_visible",
+            culler.isVisible(-halfExtent, halfExtent, glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, -3))));
+        failures += check("culler/box_behind_camera_culled",
+            !culler.isVisible(-halfExtent, halfExtent, glm::translate(glm::mat4(1.0f), glm::vec3(0, 0, 20))));
+    }
+
+    // Mesh: the occluder triangles picked at load stay within the mesh's own bounds
+    Mesh ship;
+    bool loaded = ship.loadFile(shipModel);
+    failures += check("mesh/load_ship", loaded);
+    if (loaded) {
+        const std::vector<glm::vec3>& occluders = ship.getOccluderTriangles();
+        bool inside = !occluders.empty() && occluders.size() % 3 == 0;
+        glm::vec3 epsilon(1e-3f);
+        for (const glm::vec3& vertex : occluders) {
+            if (glm::any(glm::lessThan(vertex, ship.getBoundsMin() - epsilon)) ||
+                glm::any(glm::greaterThan(vertex, ship.getBoundsMax() + epsilon)))
+                inside = false;
+        }
+        failures += check("mesh/occluders_inside_bounds", inside);
+    }
+
+    // NullGL: uploading and drawing the ship with the depth pass shader makes exactly
+    // the calls expected of it, and none of them fails validation
+    if (aie::NullGL::isInstalled() && loaded) {
+        unsigned int failuresBefore = failures;
+        aie::NullGL::resetCounts();
+        ship.upload();
+        failures += check("nullgl/upload_without_errors", aie::NullGL::getErrorCount() == 0);
+
+        aie::ShaderProgram depthShader;
+        depthShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/depth.vert");
+        depthShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/depth.frag");
+        bool linked = depthShader.link();
+        failures += check("nullgl/depth_shader_links", linked);
+        depthShader.bind();
+
+        unsigned int subMeshCount = (unsigned int)ship.getSubMeshes().size();
+        aie::NullGL::resetCounts();
+        ship.drawDepth();
+        failures += check("nullgl/draw_depth_one_call_per_submesh",
+            aie::NullGL::getDrawCallCount() == subMeshCount &&
+            aie::NullGL::getCallCount("glDrawElementsBaseVertex") == subMeshCount &&
+            aie::NullGL::getCallCount("glBindVertexArray") == 2 &&
+            aie::NullGL::getErrorCount() == 0);
+
+        std::vector<bool> hidden(subMeshCount, false);
+        aie::NullGL::resetCounts();
+        ship.drawDepth(&hidden);
+        failures += check("nullgl/draw_depth_skips_hidden_submeshes",
+            aie::NullGL::getDrawCallCount() == 0 && aie::NullGL::getErrorCount() == 0);
+
+        if (failures > failuresBefore)
+            printf("last NullGL error: %s\n", aie::NullGL::getLastError());
+    }
+
+    printf("\n%u smoke check(s) failed\n", failures);
+    return failures;
+}
@@ -0,0 +1,48 @@
+#include "BenchmarkApp.h"
+#include <cstdlib>
+#include <cstring>
+
+// Command line (run from the bin folder, like the 3D application):
+//   --filter <text>      only run cases whose name contains the text
+//   --batches <count>    timed batches per case (default 20)
+//   --output <file>      where the results go (default microbenchmarks.json)
+//   --baseline <file>    compare with an earlier results file; exits with 2 on a regression
+//   --visible            show the window instead of running headless
+//   --egl                create the context through EGL
+//   --null-gl            no context: measures the engine's side of the GL cases without the driver
+//   --smoke              run the pass / fail smoke checks instead; exits with 3 if any fails
+//                        (with --null-gl this includes the GL call counts)
+int main(int argc, char* argv[]) {
+
+	auto app = new BenchmarkApp();
+
+	bool headless = true, useEGL = false, nullGL = false;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+			app->setFilter(argv[++i]);
+		else if (strcmp(argv[i], "--batches") == 0 && i + 1 < argc)
+			app->setBatchCount((unsigned int)atoi(argv[++i]));
+		else if (strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+			app->setOutputFile(argv[++i]);
+		else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc)
+			app->setBaselineFile(argv[++i]);
+		else if (strcmp(argv[i], "--visible") == 0)
+			headless = false;
+		else if (strcmp(argv[i], "--egl") == 0)
+			useEGL = true;
+		else if (strcmp(argv[i], "--null-gl") == 0)
+			nullGL = true;
+		else if (strcmp(argv[i], "--smoke") == 0)
+			app->setSmokeTest(true);
+	}
+	app->setHeadless(headless, useEGL);
+	if (nullGL)
+		app->setGLBackend(aie::Application::GL_BACKEND_NULL);
+
+	app->run("Engine Microbenchmarks", 1280, 720, false);
+
+	int exitCode = app->getExitCode();
+	delete app;
+
+	return exitCode;
+}
@@ -0,0 +1,133 @@
+#include "AmbientOcclusion.h"
+#include "glad.h"
+#include <cmath>
+
+AmbientOcclusion::AmbientOcclusion()
+    : quality(QUALITY_MEDIUM),
+    radius(2.0f),
+    intensity(1.0f),
+    m_vao(0) {
+}
+
+AmbientOcclusion::~AmbientOcclusion() {
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+}
+
+bool AmbientOcclusion::initialise() {
+    m_depthShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/fullscreen.vert");
+    m_depthShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/ssao_depth.frag");
+    m_occlusionShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/fullscreen.vert");
+    m_occlusionShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/ssao.frag");
+    m_blurShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/fullscreen.vert");
+    m_blurShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/ssao_blur.frag");
+    m_upsampleShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/fullscreen.vert");
+    m_upsampleShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/ssao_upsample.frag");
+
+    glGenVertexArrays(1, &m_vao);
+    return m_depthShader.link() && m_occlusionShader.link() &&
+        m_blurShader.link() && m_upsampleShader.link();
+}
+
+void AmbientOcclusion::drawFullscreen() const {
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+}
+
+RenderGraph::Handle AmbientOcclusion::addPasses(RenderGraph& graph, RenderGraph::Handle depth, RenderGraph::Handle normals,
+    const glm::mat4& view, float fieldOfView, float aspect, float nearPlane, float farPlane) {
+    unsigned int width = graph.getWidth(depth);
+    unsigned int height = graph.getHeight(depth);
+    unsigned int halfWidth = (width + 1) / 2;
+    unsigned int halfHeight = (height + 1) / 2;
+    glm::vec2 clipPlanes(nearPlane, farPlane);
+
+    // Linear view depth at half resolution (nearest of each 2x2 block)
+    RenderGraph::Handle linearDepth = graph.createTexture("SSAO Linear Depth", { halfWidth, halfHeight, GL_R32F, false });
+    graph.addPass("SSAO Depth", "SSAO", [this, depth, clipPlanes](RenderGraph& graph) {
+        m_depthShader.bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, graph.getTexture(depth));
+        m_depthShader.bindUniform("DepthTex", 0);
+        m_depthShader.bindUniform("ClipPlanes", clipPlanes);
+        drawFullscreen();
+    }).read(depth).writeColour(linearDepth);
+
+    // Occlusion estimate
+    const int sampleCounts[] = { 6, 10, 16 };
+    int sampleCount = sampleCounts[quality];
+    float tanHalfFovY = std::tan(fieldOfView * 0.5f);
+    glm::vec2 tanHalfFov(tanHalfFovY * aspect, tanHalfFovY);
+    float projectionScale = halfHeight * 0.5f / tanHalfFovY;
+    float sampleRadius = radius;
+    float strength = intensity;
+    RenderGraph::Handle occlusion = graph.createTexture("SSAO", { halfWidth, halfHeight, GL_R8, false });
+    RenderGraph::Builder occlusionPass = graph.addPass("SSAO", "SSAO", [this, linearDepth, normals, view,
+        tanHalfFov, projectionScale, farPlane, sampleRadius, strength, sampleCount](RenderGraph& graph) {
+        m_occlusionShader.bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, graph.getTexture(linearDepth));
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, normals != RenderGraph::INVALID_HANDLE ? graph.getTexture(normals) : 0);
+        glActiveTexture(GL_TEXTURE0);
+        m_occlusionShader.bindUniform("LinearDepthTex", 0);
+        m_occlusionShader.bindUniform("NormalTex", 1);
+        m_occlusionShader.bindUniform("UseNormalTex", normals != RenderGraph::INVALID_HANDLE ? 1 : 0);
+        m_occlusionShader.bindUniform("ViewMatrix", view);
+        m_occlusionShader.bindUniform("TanHalfFov", tanHalfFov);
+        m_occlusionShader.bindUniform("ProjectionScale", projectionScale);
+        m_occlusionShader.bindUniform("FarPlane", farPlane);
+        m_occlusionShader.bindUniform("Radius", sampleRadius);
+        m_occlusionShader.bindUniform("Intensity", strength);
+        m_occlusionShader.bindUniform("SampleCount", sampleCount);
+        drawFullscreen();
+    });
+    occlusionPass.read(linearDepth);
+    if (normals != RenderGraph::INVALID_HANDLE)
+        occlusionPass.read(normals);
+    occlusionPass.writeColour(occlusion);
+
+    // Depth-aware blur, wide enough to cover the 4x4 noise pattern
+    auto addBlur = [&](RenderGraph::Handle source, RenderGraph::Handle& target, const glm::vec2& direction) {
+        graph.addPass("SSAO Blur", "SSAO", [this, source, linearDepth, direction](RenderGraph& graph) {
+            m_blurShader.bind();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.getTexture(source));
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, graph.getTexture(linearDepth));
+            glActiveTexture(GL_TEXTURE0);
+            m_blurShader.bindUniform("OcclusionTex", 0);
+            m_blurShader.bindUniform("LinearDepthTex", 1);
+            m_blurShader.bindUniform("Direction", direction);
+            drawFullscreen();
+        }).read(source).read(linearDepth).writeColour(target);
+    };
+    RenderGraph::Handle horizontal = graph.createTexture("SSAO Blur", { halfWidth, halfHeight, GL_R8, false });
+    RenderGraph::Handle blurred = graph.createTexture("SSAO Blurred", { halfWidth, halfHeight, GL_R8, false });
+    addBlur(occlusion, horizontal, glm::vec2(1, 0));
+    addBlur(horizontal, blurred, glm::vec2(0, 1));
+
+    // Bilateral upsample guided by full resolution depth
+    RenderGraph::Handle output = graph.createTexture("Ambient Occlusion", { width, height, GL_R8, false });
+    graph.addPass("SSAO Upsample", "SSAO", [this, blurred, linearDepth, depth, clipPlanes](RenderGraph& graph) {
+        m_upsampleShader.bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, graph.getTexture(blurred));
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, graph.getTexture(linearDepth));
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, graph.getTexture(depth));
+        glActiveTexture(GL_TEXTURE0);
+        m_upsampleShader.bindUniform("OcclusionTex", 0);
+        m_upsampleShader.bindUniform("LinearDepthTex", 1);
+        m_upsampleShader.bindUniform("DepthTex", 2);
+        m_upsampleShader.bindUniform("ClipPlanes", clipPlanes);
+        drawFullscreen();
+    }).read(blurred).read(linearDepth).read(depth).writeColour(output);
+
+    return output;
+}
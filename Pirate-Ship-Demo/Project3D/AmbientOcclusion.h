@@ -0,0 +1,46 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "Shader.h"
+#include "RenderGraph.h"
+
+// Half resolution screen-space ambient occlusion
+// Depth is linearised into a half resolution buffer, occlusion is estimated there
+// from a spiral of samples rotated per pixel (interleaved gradient noise), then
+// cleaned up with a depth-aware separable blur and a bilateral upsample back to
+// full resolution. The result multiplies the ambient lighting term.
+// All intermediate targets are transient render graph textures.
+class AmbientOcclusion {
+public:
+
+    enum Quality : int {
+        QUALITY_LOW,        // 6 samples
+        QUALITY_MEDIUM,     // 10 samples
+        QUALITY_HIGH        // 16 samples
+    };
+
+    AmbientOcclusion();
+    ~AmbientOcclusion();
+
+    bool initialise();
+
+    // Adds the passes computing occlusion from a full resolution depth texture, with an
+    // optional octahedral world-space normal texture (INVALID_HANDLE rebuilds normals from depth)
+    // Returns the full resolution occlusion (R8, 1 = unoccluded)
+    RenderGraph::Handle addPasses(RenderGraph& graph, RenderGraph::Handle depth, RenderGraph::Handle normals,
+        const glm::mat4& view, float fieldOfView, float aspect, float nearPlane, float farPlane);
+
+    int quality;        // Quality preset
+    float radius;       // World space sampling radius
+    float intensity;    // Strength of the darkening
+
+protected:
+
+    // Draws a full-screen triangle with depth testing and blending off
+    void drawFullscreen() const;
+
+    aie::ShaderProgram m_depthShader;
+    aie::ShaderProgram m_occlusionShader;
+    aie::ShaderProgram m_blurShader;
+    aie::ShaderProgram m_upsampleShader;
+    unsigned int m_vao;
+};
@@ -1,6 +1,11 @@
 ﻿#include "Application3D.h"
+#include "FlightRecorder.h"
 #include "Gizmos.h"
+#include "GLStats.h"
 #include "Input.h"
+#include "JobSystem.h"
+#include "MetricsServer.h"
+#include "Profiler.h"
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 #include "../dependencies/glfw/include/GLFW/glfw3.h"
@@ -12,10 +17,59 @@ using glm::vec4;
 using glm::mat4;
 using aie::Gizmos;
 
+// Where the Record Input button saves and Play Recording loads
+static const char* inputRecordingFile = "camera_input.rec";
+
 Application3D::Application3D()
-    : m_shipTransform(1.0f),
-    m_oceanTransform(1.0f),
-    m_light{ glm::vec3(0.0f, 0.0f, 0.0f) },
+    : m_oceanEntity(EntityStore::INVALID_ENTITY),
+    m_fleetSize(1),
+    m_riggingPerShip(256),
+    m_swayRigging(true),
+    m_indirectSupported(false),
+    m_useIndirect(false),
+    m_useCommandRecording(true),
+    m_commandsRecorded(false),
+    m_depthPrepassMode(DEPTH_PREPASS_AUTO),
+    m_depthPrepassActive(false),
+    m_depthPrepassThreshold(1.25f),
+    m_sampleQueries{},
+    m_sampleQueryPrepass{},
+    m_sampleQueryPending{},
+    m_sampleQueryFrame(0),
+    m_shadedSamples{},
+    m_useOcclusionCulling(true),
+    m_culledSubMeshes(0),
+    m_clusteredSupported(false),
+    m_useClusteredLighting(true),
+    m_harbourLightCount(64),
+    m_fullscreenVao(0),
+    m_deferredSupported(false),
+    m_renderPath(RENDER_PATH_FORWARD),
+    m_frameTime(0),
+    m_shadowsSupported(false),
+    m_useShadows(true),
+    m_hdrSupported(false),
+    m_useHdr(true),
+    m_useDynamicResolution(false),
+    m_renderWidth(0),
+    m_renderHeight(0),
+    m_ambientOcclusionTexture(RenderGraph::INVALID_HANDLE),
+    m_ambientOcclusionSupported(false),
+    m_useAmbientOcclusion(true),
+    m_ambientOcclusionActive(false),
+    m_useLateLatch(true),
+    m_showLatencyOverlay(true),
+    m_cameraLatched(false),
+    m_inputTime(0),
+    m_preparedProjectionView(1.0f),
+    m_latchedProjectionView(1.0f),
+    m_clusterViewMatrix(1.0f),
+    m_useFlythrough(false),
+    m_showCameraPath(false),
+    m_flythroughTime(0),
+    m_loopInputPlayback(false),
+    m_benchmarkFrames(0),
+    m_light{ glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 0.0f) },
     m_ambientLight(0.25f, 0.25f, 0.25f),
     m_fillLightDirection(glm::vec3(1.0f, 2.0f, -2.0f)),
     m_fillLightColour(glm::vec3(2.0f, 2.0f, 2.0f)),
@@ -28,75 +82,444 @@ Application3D::~Application3D() {
 
 }
 
+void Application3D::setBenchmark(unsigned int frameCount, const char* reportFile) {
+    m_benchmarkFrames = frameCount;
+    m_benchmarkReport = reportFile;
+}
+
 bool Application3D::startup() {
+    double startupStart = glfwGetTime();
+    double phaseStart = startupStart;
+#ifdef AIE_PROFILER
+    // The phases also go into the trace, nested under the startup scope
+    unsigned long long phaseTicks = aie::Profiler::now();
+#endif
+    auto endPhase = [&](const char* name) {
+        double now = glfwGetTime();
+        m_benchmark.addStartupPhase(name, (float)((now - phaseStart) * 1000.0));
+        phaseStart = now;
+#ifdef AIE_PROFILER
+        unsigned long long ticks = aie::Profiler::now();
+        aie::Profiler::record(name, phaseTicks, ticks);
+        phaseTicks = ticks;
+#endif
+    };
+
     if (!glfwInit()) {
         printf("GLFW initialization failed!\n");
         return false;
     }
 
-    if (!gladLoadGL()) {
+    // Through the application, so the functions also load for an EGL context or the null backend
+    if (!gladLoadGLLoader((GLADloadproc)aie::Application::getGLProcAddress)) {
         printf("Failed to initialize OpenGL loader!\n");
         return false;
     }
 
-    glfwSwapInterval(1);
     setBackgroundColour(0.25f, 0.25f, 0.25f);
+    setFixedTimestep(true);
+    Camera::bindDefaultActions();
 
-    // Initialise rendering tools
+    // Flythrough circling the flagship, dropping low past the bow and climbing over the stern
+    m_cameraPath.addKey(0.0f, vec3(-22, 8, 10), vec3(0, 4, 0));
+    m_cameraPath.addKey(5.0f, vec3(-6, 4, 24), vec3(0, 5, 0));
+    m_cameraPath.addKey(10.0f, vec3(18, 10, 16), vec3(0, 4, 0));
+    m_cameraPath.addKey(15.0f, vec3(22, 6, -10), vec3(0, 5, 0));
+    m_cameraPath.addKey(20.0f, vec3(0, 16, -22), vec3(0, 3, 0));
+    m_cameraPath.setLooping(true, 5.0f);
+
+    // Initialise rendering tools (ImGui and v-sync are set up with the window)
     Gizmos::create(10000, 10000, 0, 0);
-    aie::ImGui_Init(glfwGetCurrentContext(), true);
 
+    // Parse both models on worker threads while the shaders and render targets are set up
+    aie::JobSystem* jobs = aie::JobSystem::getInstance();
+    aie::JobCounter modelsLoaded;
+    jobs->beginBatch(modelsLoaded);
+    jobs->submit([this]() { m_oceanMesh.loadFile("../bin/ocean/Ocean.obj"); }, &modelsLoaded);
+    jobs->submit([this]() { m_shipMesh.loadFile("../bin/pirate_ship/pirate_ship.obj"); }, &modelsLoaded);
+    jobs->endBatch(modelsLoaded);
+
+
+    endPhase("setup");
 
     // Load and compile shaders
     m_phongShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/phong.vert");
     m_phongShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/phong.frag");
     m_phongShader.link();
 
+    // GPU-driven path (requires OpenGL 4.6 for gl_DrawID)
+    m_indirectSupported = m_indirectBatch.initialise();
+    if (m_indirectSupported) {
+        m_indirectShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/phong_indirect.vert");
+        m_indirectShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/phong_indirect.frag");
+        m_indirectSupported = m_indirectShader.link();
+    }
+    m_useIndirect = m_indirectSupported;
+
+    // Depth-only shaders for the optional pre-pass
+    m_depthShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/depth.vert");
+    m_depthShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/depth.frag");
+    m_depthShader.link();
+    if (m_indirectSupported) {
+        m_depthIndirectShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/depth_indirect.vert");
+        m_depthIndirectShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/depth.frag");
+        m_depthIndirectShader.link();
+    }
+    glGenQueries(SAMPLE_QUERY_COUNT, m_sampleQueries);
+
+    // Clustered local lights (SSBOs require OpenGL 4.3)
+    m_clusteredSupported = GLAD_GL_VERSION_4_3 != 0;
+    if (m_clusteredSupported) {
+        m_clusteredLighting.initialise();
+        m_clusteredShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/phong.vert");
+        m_clusteredShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/phong_clustered.frag");
+        m_clusteredSupported = m_clusteredShader.link();
+    }
+    else {
+        printf("Warning: OpenGL 4.3 not available, clustered lighting disabled\n");
+    }
+    m_useClusteredLighting = m_clusteredSupported;
+
+    // Deferred path; its lighting pass reads the clustered light lists
+    if (m_clusteredSupported) {
+        m_gbufferShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/phong.vert");
+        m_gbufferShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/gbuffer.frag");
+        m_deferredLightingShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/fullscreen.vert");
+        m_deferredLightingShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/deferred.frag");
+        m_deferredSupported = m_gbufferShader.link() && m_deferredLightingShader.link();
+        if (m_deferredSupported && m_indirectSupported) {
+            m_gbufferIndirectShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/phong_indirect.vert");
+            m_gbufferIndirectShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/gbuffer_indirect.frag");
+            m_deferredSupported = m_gbufferIndirectShader.link();
+        }
+        glGenVertexArrays(1, &m_fullscreenVao);
+    }
+
+    // Sun shadow cascades, rendered in one layered pass through a geometry shader
+    m_shadowShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/shadow.vert");
+    m_shadowShader.loadShader(aie::eShaderStage::GEOMETRY, "../bin/Shaders/shadow.geom");
+    m_shadowShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/depth.frag");
+    m_shadowsSupported = m_shadowShader.link() && m_shadowMap.initialise();
+    m_useShadows = m_shadowsSupported;
+
+    // Late-latched camera correction, read by every shader that projects the scene from the camera
+    m_lateLatch.initialise();
+    m_lateLatch.bindBlock(m_phongShader);
+    m_lateLatch.bindBlock(m_depthShader);
+    if (m_clusteredSupported)
+        m_lateLatch.bindBlock(m_clusteredShader);
+    if (m_deferredSupported)
+        m_lateLatch.bindBlock(m_gbufferShader);
+    if (m_indirectSupported) {
+        m_lateLatch.bindBlock(m_indirectShader);
+        m_lateLatch.bindBlock(m_depthIndirectShader);
+        if (m_deferredSupported)
+            m_lateLatch.bindBlock(m_gbufferIndirectShader);
+    }
+
+    // HDR target and post-processing stack
+    m_hdrSupported = m_postProcess.initialise() && m_upscaler.initialise();
+    m_useHdr = m_hdrSupported;
+    m_ambientOcclusionSupported = m_ambientOcclusion.initialise();
+    m_useAmbientOcclusion = m_ambientOcclusionSupported;
+    m_gpuTimer.initialise();
+    endPhase("shaders_and_targets");
+
+
+    // Buffers can only be created on the GL thread once parsing has finished
+    jobs->wait(modelsLoaded);
+    endPhase("model_parse_wait");
 
 	// Load the ocean 3D model and material
-    m_oceanMesh.initialiseFromFile("../bin/ocean/Ocean.obj");
+    m_oceanMesh.upload();
     m_oceanMesh.loadMaterial("../bin/ocean/Ocean.obj.sxfil.mtl");
-    m_oceanTransform = glm::mat4(1.0f);
-    m_oceanTransform = glm::translate(m_oceanTransform, glm::vec3(0.0f, -0.5f, 0.0f));
-    m_oceanTransform = glm::scale(m_oceanTransform, glm::vec3(20.0f, 15.0f, 20.0f));
+    m_oceanEntity = m_entities.create();
+    m_entities.setLocalTransform(m_oceanEntity, glm::vec3(0.0f, -0.5f, 0.0f), glm::quat(1, 0, 0, 0), glm::vec3(20.0f, 15.0f, 20.0f));
+    if (m_indirectSupported)
+        m_oceanMesh.buildTextureArray();
 
 
 
     // Load the ship 3D model and material
-    m_shipMesh.initialiseFromFile("../bin/pirate_ship/pirate_ship.obj");
+    m_shipMesh.upload();
     m_shipMesh.loadMaterial("../bin/pirate_ship/pirate_ship.mtl");
-    m_shipTransform = glm::mat4(1.0f);
-    m_shipTransform = glm::scale(glm::mat4(1.0f), glm::vec3(5.0f));
-    m_shipTransform = glm::translate(m_shipTransform, glm::vec3(0.0f, 0.75f, 0.0f));
+    if (m_indirectSupported)
+        m_shipMesh.buildTextureArray();
+    endPhase("mesh_upload");
+    updateFleet();
+    rebuildSceneLights();
+    endPhase("scene");
 
     // Set up light properties
     m_light.colour = glm::vec3(5.0f, 5.0f, 5.0f);
     m_ambientLight = glm::vec3(0.5f, 0.5f, 0.5f);
     m_light.direction = glm::vec3(2, 0, 2);
 
+    m_benchmark.addStartupPhase("total", (float)((glfwGetTime() - startupStart) * 1000.0));
+
+    // Benchmarks follow the flythrough with scene time advancing a fixed step per frame,
+    // so every run renders the same frames however fast the machine is
+    if (m_benchmarkFrames > 0) {
+        setFixedTimestep(false);
+        setTargetFPS(0.0f);
+        m_useFlythrough = true;
+        m_showLatencyOverlay = false;
+        m_benchmark.setProperty("renderer", (const char*)glGetString(GL_RENDERER));
+        m_benchmark.setProperty("gl_version", (const char*)glGetString(GL_VERSION));
+        m_benchmark.setProperty("resolution", std::to_string(getWindowWidth()) + "x" + std::to_string(getWindowHeight()));
+        m_benchmark.setProperty("render_path", m_renderPath == RENDER_PATH_DEFERRED ? "deferred" : "forward");
+        m_benchmark.setProperty("submission", m_useIndirect ? "indirect" : m_useCommandRecording ? "recorded" : "direct");
+        m_benchmark.start(m_benchmarkFrames);
+    }
+
     return true;
 }
 
 
 
 void Application3D::shutdown() {
+    glDeleteQueries(SAMPLE_QUERY_COUNT, m_sampleQueries);
+    if (m_fullscreenVao) glDeleteVertexArrays(1, &m_fullscreenVao);
     aie::ImGui_Shutdown();  // Shutdown ImGui
     aie::Gizmos::destroy(); // Cleanup Gizmos
 }
 
-void Application3D::update(float deltaTime) {
-    glfwPollEvents();
+void Application3D::updateFleet() {
+    // Destroying a ship takes its lanterns, cannons and rigging with it
+    for (EntityStore::Entity ship : m_shipEntities)
+        m_entities.destroy(ship);
+    m_shipEntities.clear();
+    m_lanternEntities.clear();
+    m_cannonEntities.clear();
+    m_mastEntities.clear();
+
+    // Fittings are placed in the ship's mesh space from its bounds
+    glm::vec3 boundsMin = m_shipMesh.getBoundsMin();
+    glm::vec3 boundsMax = m_shipMesh.getBoundsMax();
+    glm::vec3 centre = (boundsMin + boundsMax) * 0.5f;
+    float deckHeight = glm::mix(boundsMin.y, boundsMax.y, 0.4f);
+    const int mastCount = 3;
+
+    // Flagship at the origin, escorts in rows behind it
+    const int shipsPerRow = 8;
+    const float spacing = 30.0f;
+    for (int i = 0; i < m_fleetSize; i++) {
+        glm::vec3 offset(0.0f);
+        if (i > 0) {
+            int row = i / shipsPerRow + 1;
+            int column = i % shipsPerRow - shipsPerRow / 2;
+            offset = glm::vec3(column * spacing, 0.0f, row * spacing);
+        }
+
+        // Ships are scaled up 5x and float 0.75 mesh units above the water
+        EntityStore::Entity ship = m_entities.create();
+        m_entities.setLocalTransform(ship, offset + glm::vec3(0.0f, 3.75f, 0.0f), glm::quat(1, 0, 0, 0), glm::vec3(5.0f));
+        m_shipEntities.push_back(ship);
+
+        // Lanterns at the bow and stern
+        for (float z : { boundsMin.z, boundsMax.z }) {
+            EntityStore::Entity lantern = m_entities.create(ship);
+            m_entities.setPosition(lantern, glm::vec3(centre.x, deckHeight, z));
+            m_lanternEntities.push_back(lantern);
+        }
+
+        // Cannons on both sides, aimed (local +Z) outwards and slightly down
+        for (float side : { -1.0f, 1.0f }) {
+            glm::vec3 forward = glm::normalize(glm::vec3(side, -0.2f, 0.0f));
+            glm::vec3 right = glm::normalize(glm::cross(glm::vec3(0, 1, 0), forward));
+            glm::mat3 basis(right, glm::cross(forward, right), forward);
+            EntityStore::Entity cannon = m_entities.create(ship);
+            m_entities.setLocalTransform(cannon, glm::vec3(side > 0 ? boundsMax.x : boundsMin.x, deckHeight, centre.z),
+                glm::quat_cast(basis), glm::vec3(1.0f));
+            m_cannonEntities.push_back(cannon);
+        }
+
+        for (int mast = 0; mast < mastCount; mast++) {
+            float z = glm::mix(boundsMin.z, boundsMax.z, (mast + 1.0f) / (mastCount + 1.0f));
+            EntityStore::Entity entity = m_entities.create(ship);
+            m_entities.setPosition(entity, glm::vec3(centre.x, deckHeight, z));
+            m_mastEntities.push_back(entity);
+        }
+
+        // Rigging, yards and crew hang below the masts four to a parent
+        std::vector<EntityStore::Entity> rigging;
+        for (int k = 0; k < m_riggingPerShip; k++) {
+            EntityStore::Entity parent = k < mastCount ? m_mastEntities[m_mastEntities.size() - mastCount + k] : rigging[(k - mastCount) / 4];
+            EntityStore::Entity entity = m_entities.create(parent);
+            m_entities.setLocalTransform(entity, glm::vec3((k % 4 - 1.5f) * 0.2f, 0.3f, 0.0f), glm::quat(1, 0, 0, 0), glm::vec3(0.95f));
+            rigging.push_back(entity);
+        }
+    }
+
+    // Ships moved, so cached shadow cascades are stale
+    m_shadowMap.invalidate();
+}
+
+void Application3D::animateRigging(float time) {
+    if (!m_swayRigging)
+        return;
+
+    for (size_t i = 0; i < m_mastEntities.size(); i++) {
+        float angle = std::sin(time * 0.8f + i * 0.37f) * 0.05f;
+        m_entities.setRotation(m_mastEntities[i], glm::angleAxis(angle, glm::vec3(0, 0, 1)));
+    }
+}
+
+unsigned int Application3D::addPointLight(const glm::vec3& position, const glm::vec3& colour, float range) {
+    ClusteredLighting::Light light;
+    light.position = position;
+    light.colour = colour;
+    light.range = range;
+    light.type = ClusteredLighting::POINT_LIGHT;
+    return m_clusteredLighting.addLight(light);
+}
+
+unsigned int Application3D::addSpotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& colour,
+    float range, float innerAngle, float outerAngle) {
+    ClusteredLighting::Light light;
+    light.position = position;
+    light.direction = direction;
+    light.colour = colour;
+    light.range = range;
+    light.type = ClusteredLighting::SPOT_LIGHT;
+    light.innerAngle = innerAngle;
+    light.outerAngle = outerAngle;
+    return m_clusteredLighting.addLight(light);
+}
+
+void Application3D::removeLight(unsigned int index) {
+    m_clusteredLighting.removeLight(index);
+}
+
+void Application3D::clearLights() {
+    m_clusteredLighting.clearLights();
+}
+
+void Application3D::rebuildSceneLights() {
+    clearLights();
+    m_lanternLights.clear();
+    m_cannonLights.clear();
+
+    // A lantern or cannon flash for every lantern and cannon entity; they are
+    // placed from the entities' world transforms in animateSceneLights
+    const glm::vec3 lanternColour(3.0f, 2.0f, 0.8f);
+    for (size_t i = 0; i < m_lanternEntities.size(); i++)
+        m_lanternLights.push_back(addPointLight(glm::vec3(0), lanternColour, 8.0f));
+    for (size_t i = 0; i < m_cannonEntities.size(); i++) {
+        m_cannonLights.push_back(addSpotLight(glm::vec3(0), glm::vec3(0, -1, 0), glm::vec3(0), 25.0f,
+            glm::radians(15.0f), glm::radians(35.0f)));
+    }
+
+    // Harbour lamps in a ring around the fleet
+    const float harbourRadius = 150.0f;
+    for (int i = 0; i < m_harbourLightCount; i++) {
+        float angle = glm::two_pi<float>() * i / m_harbourLightCount;
+        glm::vec3 position(std::cos(angle) * harbourRadius, 3.0f, std::sin(angle) * harbourRadius);
+        addPointLight(position, glm::vec3(1.5f, 1.8f, 2.5f), 20.0f);
+    }
+}
 
-    aie::ImGui_NewFrame();  // Start new ImGui frame
+void Application3D::animateSceneLights(float time) {
+    // Each cannon fires on its own staggered cycle with a short decaying flash
+    const float period = 3.0f;
+    const float flashLength = 0.25f;
+    for (size_t i = 0; i < m_lanternLights.size(); i++)
+        m_clusteredLighting.getLight(m_lanternLights[i]).position = glm::vec3(m_entities.getWorldMatrix(m_lanternEntities[i])[3]);
 
-    ImGuiIO& io = ImGui::GetIO();
-    
-    m_camera.update(deltaTime, glfwGetCurrentContext());
+    for (size_t i = 0; i < m_cannonLights.size(); i++) {
+        const glm::mat4& world = m_entities.getWorldMatrix(m_cannonEntities[i]);
+        ClusteredLighting::Light& light = m_clusteredLighting.getLight(m_cannonLights[i]);
+        light.position = glm::vec3(world[3]);
+        light.direction = glm::normalize(glm::vec3(world[2]));
+
+        float phase = std::fmod(time + i * 0.737f, period);
+        float intensity = phase < flashLength ? 1.0f - phase / flashLength : 0.0f;
+        light.colour = glm::vec3(12.0f, 7.0f, 3.0f) * intensity;
+    }
+}
+
+void Application3D::cullScene(const glm::mat4& projectionView) {
+    size_t subMeshCount = m_shipMesh.getSubMeshes().size();
+    m_shipVisibility.resize(m_shipEntities.size());
+    m_culledSubMeshes = 0;
+
+    if (!m_useOcclusionCulling) {
+        for (auto& visibility : m_shipVisibility)
+            visibility.assign(subMeshCount, true);
+        return;
+    }
+
+    // Every ship hull occludes the ships (and submeshes) behind it
+    m_occlusionCuller.begin(projectionView);
+    for (EntityStore::Entity ship : m_shipEntities)
+        m_occlusionCuller.addOccluder(m_shipMesh.getOccluderTriangles(), m_entities.getWorldMatrix(ship));
+    m_occlusionCuller.rasterize();
+
+    for (size_t i = 0; i < m_shipEntities.size(); i++) {
+        const glm::mat4& transform = m_entities.getWorldMatrix(m_shipEntities[i]);
+        std::vector<bool>& visibility = m_shipVisibility[i];
+
+        if (!m_occlusionCuller.isVisible(m_shipMesh.getBoundsMin(), m_shipMesh.getBoundsMax(), transform)) {
+            visibility.assign(subMeshCount, false);
+            m_culledSubMeshes += (unsigned int)subMeshCount;
+            continue;
+        }
+
+        visibility.resize(subMeshCount);
+        for (size_t s = 0; s < subMeshCount; s++) {
+            const Mesh::SubMesh& sub = m_shipMesh.getSubMeshes()[s];
+            visibility[s] = m_occlusionCuller.isVisible(sub.boundsMin, sub.boundsMax, transform);
+            if (!visibility[s])
+                m_culledSubMeshes++;
+        }
+    }
+}
+
+void Application3D::update(float deltaTime) {
+    // Events are polled and the ImGui frame started by the Application before update
+    m_inputTime = glfwGetTime();
+    m_benchmark.beginFrame();
+
+    // With a fixed timestep the camera moves in fixedUpdate and is only turned and placed here
+    if (m_benchmark.isRunning()) {
+        m_flythroughTime = m_benchmark.getSceneTime();
+        updateFlythrough();
+    }
+    else if (m_useFlythrough) {
+        if (!isFixedTimestep())
+            m_flythroughTime += deltaTime;
+        updateFlythrough();
+    }
+    else if (isFixedTimestep()) {
+        m_camera.look();
+        m_camera.interpolate(getInterpolationAlpha());
+    }
+    else {
+        m_camera.update(deltaTime);
+    }
+    animateRigging(getSceneTime());
 
     // Quit application if Escape key is pressed
     if (aie::Input::getInstance()->isKeyDown(aie::INPUT_KEY_ESCAPE))
         quit();
 
+#ifdef AIE_METRICS
+    // What is resident on the GPU, for the metrics endpoint
+    if (aie::MetricsServer::isRunning()) {
+        aie::MetricsServer::setGauge("aie_mesh_geometry_bytes", "GPU memory held by mesh buffers.",
+            double(m_shipMesh.getGeometryBytes() + m_oceanMesh.getGeometryBytes()));
+        aie::MetricsServer::setGauge("aie_mesh_texture_bytes", "GPU memory held by mesh textures.",
+            double(m_shipMesh.getTextureBytes() + m_oceanMesh.getTextureBytes()));
+        aie::MetricsServer::setGauge("aie_mesh_textures", "Material textures loaded.",
+            double(m_shipMesh.getTextureCount() + m_oceanMesh.getTextureCount()));
+        aie::MetricsServer::setGauge("aie_render_graph_texture_bytes", "GPU memory held by the render graph's texture pool.",
+            double(m_renderGraph.getPooledBytes()));
+        aie::MetricsServer::setGauge("aie_render_graph_textures", "Textures in the render graph's pool.",
+            double(m_renderGraph.getPooledTextureCount()));
+        aie::MetricsServer::setGauge("aie_entities", "Entities in the scene.", double(m_entities.getEntityCount()));
+    }
+#endif
+
     // Set ImGui window flags to make it movable, resizable and allow input (not functional due to a legacy version of Imgui provided in bootstrap)
     ImGuiWindowFlags window_flags = ImGuiWindowFlags_AlwaysAutoResize;
 
@@ -111,14 +534,699 @@ void Application3D::update(float deltaTime) {
     ImGui::DragFloat3("Fill Light Ambient", &m_fillLightAmbient[0], 0.1f, 0.0f, 2.0f);
     ImGui::End();
 
+    if (m_showLatencyOverlay) {
+        // Measured with GPU timestamps, so this is input to the GPU finishing, before scan-out
+        ImGui::SetNextWindowPos(ImVec2((float)getWindowWidth() - 260.0f, 10.0f));
+        ImGui::Begin("Latency", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoResize |
+            ImGuiWindowFlags_NoMove | ImGuiWindowFlags_AlwaysAutoResize);
+        ImGui::Text("Input to GPU done  %5.1f ms", m_lateLatch.getFrameStartLatency());
+        if (m_useLateLatch)
+            ImGui::Text("Latched camera     %5.1f ms", m_lateLatch.getLatchedLatency());
+        ImGui::Text("%u frames in flight", getMaxFramesInFlight());
+        ImGui::End();
+    }
+
+    ImGui::Begin("Rendering", nullptr, ImGuiWindowFlags_AlwaysAutoResize);
+    m_frameTime = glm::mix(m_frameTime, deltaTime * 1000.0f, 0.05f);
+    ImGui::Text("%.2f ms per frame (%u FPS)", m_frameTime, getFPS());
+    if (ImGui::CollapsingHeader("Frame Pacing")) {
+        // Adaptive v-sync reverts to v-sync when the driver does not support it
+        const char* presentModes[] = { "VSync", "Adaptive VSync", "Immediate" };
+        int presentMode = getPresentMode();
+        if (ImGui::Combo("Present Mode", &presentMode, presentModes, 3))
+            setPresentMode((EPresentMode)presentMode);
+
+        float targetFPS = getTargetFPS();
+        if (ImGui::SliderFloat("Target FPS", &targetFPS, 0.0f, 240.0f, targetFPS > 0.0f ? "%.0f" : "Uncapped"))
+            setTargetFPS(targetFPS);
 
-    ImGui::Render();
+        int maxFramesInFlight = (int)getMaxFramesInFlight();
+        if (ImGui::SliderInt("Max Frames In Flight", &maxFramesInFlight, 0, (int)MAX_FRAMES_IN_FLIGHT))
+            setMaxFramesInFlight((unsigned int)maxFramesInFlight);
+
+        ImGui::Text("Waited %.2f ms for the frame cap, %.2f ms for the GPU", getLimiterWaitTime(), getFenceWaitTime());
+        ImGui::Text("Input events %u, dropped %u", (unsigned int)aie::Input::getInstance()->getFrameEvents().size(),
+            aie::Input::getInstance()->getDroppedEventCount());
+    }
+    ImGui::Checkbox("Late-Latched Camera", &m_useLateLatch);
+    ImGui::SameLine();
+    ImGui::Checkbox("Latency Overlay", &m_showLatencyOverlay);
+    if (ImGui::CollapsingHeader("Simulation")) {
+        bool fixedTimestep = isFixedTimestep();
+        if (ImGui::Checkbox("Fixed Timestep", &fixedTimestep))
+            setFixedTimestep(fixedTimestep);
+        if (fixedTimestep) {
+            float tickRate = getTickRate();
+            if (ImGui::SliderFloat("Tick Rate", &tickRate, 10.0f, 240.0f, "%.0f Hz"))
+                setTickRate(tickRate);
+            int maxCatchUpSteps = (int)getMaxCatchUpSteps();
+            if (ImGui::SliderInt("Max Catch-Up Ticks", &maxCatchUpSteps, 1, 16))
+                setMaxCatchUpSteps((unsigned int)maxCatchUpSteps);
+            ImGui::Text("%u ticks this frame, alpha %.2f, simulation time %.2f s", getTicksLastFrame(),
+                getInterpolationAlpha(), getSimulationTime());
+        }
+    }
+    if (ImGui::CollapsingHeader("Camera Path")) {
+        ImGui::Checkbox("Flythrough", &m_useFlythrough);
+        ImGui::SameLine();
+        ImGui::Checkbox("Show Path", &m_showCameraPath);
+
+        // Playback replaces live input and frame times, so the camera retraces the recording exactly
+        if (isRecordingInput()) {
+            if (ImGui::Button("Stop Recording"))
+                stopInputRecording(inputRecordingFile);
+            ImGui::SameLine();
+            ImGui::Text("%u frames", getInputRecording().getFrameCount());
+        }
+        else if (isPlayingInput()) {
+            if (ImGui::Button("Stop Playback"))
+                stopInputPlayback();
+            ImGui::SameLine();
+            ImGui::Text("Frame %u / %u", getPlaybackFrame(), getInputRecording().getFrameCount());
+        }
+        else {
+            if (ImGui::Button("Record Input"))
+                startInputRecording();
+            ImGui::SameLine();
+            if (ImGui::Button("Play Recording"))
+                startInputPlayback(inputRecordingFile, m_loopInputPlayback);
+            ImGui::SameLine();
+            ImGui::Checkbox("Loop", &m_loopInputPlayback);
+        }
+    }
+    if (m_deferredSupported) {
+        const char* renderPaths[] = { "Forward", "Deferred" };
+        ImGui::Combo("Renderer", &m_renderPath, renderPaths, 2);
+    }
+    bool fleetChanged = ImGui::SliderInt("Fleet Size", &m_fleetSize, 1, 64);
+    fleetChanged |= ImGui::SliderInt("Rigging Per Ship", &m_riggingPerShip, 0, 2000);
+    if (fleetChanged) {
+        updateFleet();
+        rebuildSceneLights();
+    }
+    ImGui::Checkbox("Sway Rigging", &m_swayRigging);
+    ImGui::Text("%u entities, %u transforms updated in %.3f ms (%u threads)", m_entities.getEntityCount(),
+        m_entities.getUpdatedCount(), m_entities.getUpdateTime(), m_entities.getThreadCount());
+    if (m_indirectSupported) {
+        ImGui::Checkbox("Multi-Draw Indirect", &m_useIndirect);
+        if (m_useIndirect)
+            ImGui::Text("%u draws in %u multi-draw calls", m_indirectBatch.getDrawCount(), m_indirectBatch.getMultiDrawCount());
+    }
+    else {
+        ImGui::Text("Multi-Draw Indirect unavailable (requires OpenGL 4.6)");
+    }
+    if (!m_useIndirect) {
+        ImGui::Checkbox("Parallel Command Recording", &m_useCommandRecording);
+        if (m_commandsRecorded)
+            ImGui::Text("%u scene commands recorded by %u jobs", m_sceneQueue.getCommandCount(), m_sceneQueue.getBufferCount());
+    }
+    ImGui::Checkbox("Occlusion Culling", &m_useOcclusionCulling);
+    if (m_useOcclusionCulling)
+        ImGui::Text("%u submeshes culled, %u occluder triangles in %.2f ms (%u threads)",
+            m_culledSubMeshes, m_occlusionCuller.getOccluderTriangleCount(),
+            m_occlusionCuller.getRasterizeTime(), m_occlusionCuller.getThreadCount());
+
+    const char* prepassModes[] = { "Off", "On", "Auto" };
+    ImGui::Combo("Depth Pre-pass", &m_depthPrepassMode, prepassModes, 3);
+    if (m_depthPrepassMode == DEPTH_PREPASS_AUTO)
+        ImGui::SliderFloat("Pre-pass Overdraw Threshold", &m_depthPrepassThreshold, 1.0f, 3.0f);
+    if (m_shadedSamples[0] > 0 && m_shadedSamples[1] > 0)
+        ImGui::Text("Overdraw %.2fx (%llu shaded samples without pre-pass, %llu with)%s",
+            (float)m_shadedSamples[0] / (float)m_shadedSamples[1],
+            m_shadedSamples[0], m_shadedSamples[1], m_depthPrepassActive ? " - pre-pass on" : "");
+
+    if (m_shadowsSupported) {
+        ImGui::Checkbox("Sun Shadows", &m_useShadows);
+        float shadowDistance = m_shadowMap.getShadowDistance();
+        if (ImGui::SliderFloat("Shadow Distance", &shadowDistance, 20.0f, 500.0f)) {
+            m_shadowMap.setShadowDistance(shadowDistance);
+            m_shadowMap.invalidate();
+        }
+        if (m_useShadows)
+            ImGui::Text("%u of %u shadow cascades rendered this frame",
+                m_shadowMap.getRenderedCascadeCount(), CascadedShadowMap::CASCADE_COUNT);
+    }
+
+    if (m_hdrSupported) {
+        ImGui::Checkbox("HDR + Bloom", &m_useHdr);
+        if (m_useHdr) {
+            int bloomQuality = m_postProcess.getBloomQuality();
+            const char* bloomQualities[] = { "Off", "Low", "Medium", "High" };
+            if (ImGui::Combo("Bloom Quality", &bloomQuality, bloomQualities, 4))
+                m_postProcess.setBloomQuality(bloomQuality);
+            int bloomResolution = m_postProcess.getBloomDivisor() == 2 ? 0 : 1;
+            const char* bloomResolutions[] = { "Half", "Quarter" };
+            if (ImGui::Combo("Bloom Resolution", &bloomResolution, bloomResolutions, 2))
+                m_postProcess.setBloomDivisor(bloomResolution == 0 ? 2 : 4);
+            ImGui::SliderFloat("Bloom Threshold", &m_postProcess.bloomThreshold, 0.0f, 4.0f);
+            ImGui::SliderFloat("Bloom Intensity", &m_postProcess.bloomIntensity, 0.0f, 2.0f);
+            ImGui::SliderFloat("Exposure", &m_postProcess.exposure, 0.1f, 4.0f);
+
+            // Renders the scene below window resolution; ImGui still draws at full resolution
+            ImGui::Checkbox("Dynamic Resolution", &m_useDynamicResolution);
+            if (m_useDynamicResolution) {
+                ImGui::SliderFloat("GPU Budget (ms)", &m_dynamicResolution.targetTime, 2.0f, 33.0f);
+                ImGui::SliderFloat("Min Scale", &m_dynamicResolution.minScale, 0.25f, m_dynamicResolution.maxScale);
+                ImGui::SliderFloat("Max Scale", &m_dynamicResolution.maxScale, m_dynamicResolution.minScale, 1.0f);
+                ImGui::SliderFloat("Upscale Sharpness", &m_upscaler.sharpness, 0.0f, 1.0f);
+            }
+            ImGui::Text("Render scale %.0f%% (%ux%u)", m_dynamicResolution.getScale() * 100.0f, m_renderWidth, m_renderHeight);
+        }
+    }
+
+    if (m_ambientOcclusionSupported) {
+        ImGui::Checkbox("SSAO", &m_useAmbientOcclusion);
+        if (m_useAmbientOcclusion) {
+            const char* qualities[] = { "Low", "Medium", "High" };
+            ImGui::Combo("SSAO Quality", &m_ambientOcclusion.quality, qualities, 3);
+            ImGui::SliderFloat("SSAO Radius", &m_ambientOcclusion.radius, 0.25f, 8.0f);
+            ImGui::SliderFloat("SSAO Intensity", &m_ambientOcclusion.intensity, 0.0f, 4.0f);
+            if (!m_ambientOcclusionActive)
+                ImGui::Text("SSAO needs the deferred renderer or HDR + Bloom");
+        }
+    }
+
+    if (ImGui::CollapsingHeader("GPU Timings")) {
+        for (auto& stage : m_gpuTimer.getStages())
+            ImGui::Text("%*s%-10s %.3f ms", stage.depth * 2, "", stage.name.c_str(), stage.time);
+        ImGui::Text("Frame      %.3f ms", m_gpuTimer.getFrameTime());
+    }
+
+#ifdef AIE_GL_STATS
+    if (ImGui::CollapsingHeader("GL Calls"))
+        aie::GLStats::drawImGui();
+#endif
+
+#ifdef AIE_PROFILER
+    if (ImGui::CollapsingHeader("Profiler"))
+        aie::Profiler::drawImGui();
+#endif
+
+#ifdef AIE_FLIGHT_RECORDER
+    if (ImGui::CollapsingHeader("Flight Recorder"))
+        aie::FlightRecorder::drawImGui();
+#endif
+
+    if (ImGui::CollapsingHeader("Jobs")) {
+        aie::JobSystem* jobs = aie::JobSystem::getInstance();
+        for (unsigned int i = 0; i < jobs->getWorkerCount(); i++) {
+            const aie::JobSystem::WorkerStats& stats = jobs->getWorkerStats(i);
+            ImGui::Text("%-8s %5.1f%%  %6u jobs  %6u stolen", i == 0 ? "Main" : ("Worker " + std::to_string(i)).c_str(),
+                stats.utilisation * 100.0f, stats.jobsExecuted, stats.jobsStolen);
+        }
+    }
+
+    if (ImGui::CollapsingHeader("Render Graph")) {
+        const std::vector<unsigned int>& order = m_renderGraph.getExecutionOrder();
+        ImGui::Text("%u passes run, %u culled", (unsigned int)order.size(),
+            m_renderGraph.getPassCount() - (unsigned int)order.size());
+        ImGui::Text("%u pooled textures, %.1f MB (%.1f MB without aliasing)", m_renderGraph.getPooledTextureCount(),
+            m_renderGraph.getPooledBytes() / (1024.0f * 1024.0f), m_renderGraph.getTransientBytes() / (1024.0f * 1024.0f));
+        for (unsigned int pass : order)
+            ImGui::BulletText("%s", m_renderGraph.getPassName(pass).c_str());
+        for (unsigned int pass = 0; pass < m_renderGraph.getPassCount(); pass++) {
+            if (m_renderGraph.isPassCulled(pass))
+                ImGui::TextDisabled("  %s (culled)", m_renderGraph.getPassName(pass).c_str());
+        }
+    }
+
+    if (m_clusteredSupported) {
+        ImGui::Checkbox("Clustered Lighting", &m_useClusteredLighting);
+        if (ImGui::SliderInt("Harbour Lights", &m_harbourLightCount, 0, 1024))
+            rebuildSceneLights();
+        if (m_useClusteredLighting)
+            ImGui::Text("%u of %u lights visible, %u cluster entries, binned in %.2f ms",
+                m_clusteredLighting.getVisibleLightCount(), m_clusteredLighting.getLightCount(),
+                m_clusteredLighting.getIndexCount(), m_clusteredLighting.getBinningTime());
+    }
+    else {
+        ImGui::Text("Clustered lighting unavailable (requires OpenGL 4.3)");
+    }
+    ImGui::End();
+}
+
+
+
+void Application3D::fixedUpdate(float timeStep) {
+    if (m_useFlythrough)
+        m_flythroughTime += timeStep;
+    else
+        m_camera.move(timeStep);
+}
+
+void Application3D::resetSimulation() {
+    // Recordings start from the default camera, so they replay the same way in any session
+    m_camera = Camera();
+    m_flythroughTime = 0;
+}
+
+void Application3D::updateFlythrough() {
+    double time = m_flythroughTime;
+    if (isFixedTimestep())
+        time -= (1.0 - getInterpolationAlpha()) * getTimeStep();
+
+    vec3 position, target;
+    m_cameraPath.evaluate((float)time, position, target);
+    m_camera.setPose(position, target);
+}
+
+float Application3D::getSceneTime() const {
+    if (m_benchmark.isRunning())
+        return (float)m_benchmark.getSceneTime();
+    if (isFixedTimestep())
+        return (float)(getSimulationTime() - (1.0f - getInterpolationAlpha()) * getTimeStep());
+    return getTime();
+}
+
+void Application3D::updateDepthPrepass() {
+    // Collect results that are ready without stalling (the oldest queries)
+    for (unsigned int i = 0; i < SAMPLE_QUERY_COUNT; i++) {
+        if (!m_sampleQueryPending[i])
+            continue;
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(m_sampleQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_FALSE)
+            continue;
+        GLuint64 samples = 0;
+        glGetQueryObjectui64v(m_sampleQueries[i], GL_QUERY_RESULT, &samples);
+        m_shadedSamples[m_sampleQueryPrepass[i] ? 1 : 0] = samples;
+        m_sampleQueryPending[i] = false;
+    }
+
+    switch (m_depthPrepassMode) {
+    case DEPTH_PREPASS_OFF:     m_depthPrepassActive = false;   break;
+    case DEPTH_PREPASS_ON:      m_depthPrepassActive = true;    break;
+    case DEPTH_PREPASS_AUTO:
+    default: {
+        // Periodically probe the other mode so both measurements stay current as the view changes
+        const unsigned int probeInterval = 60;
+        if (m_shadedSamples[0] == 0 || m_sampleQueryFrame % probeInterval == 0)
+            m_depthPrepassActive = false;
+        else if (m_shadedSamples[1] == 0 || m_sampleQueryFrame % probeInterval == 1)
+            m_depthPrepassActive = true;
+        else {
+            // Samples shaded without the pre-pass relative to those with it is the overdraw it removes
+            float overdraw = (float)m_shadedSamples[0] / (float)m_shadedSamples[1];
+            m_depthPrepassActive = overdraw > m_depthPrepassThreshold;
+        }
+        break;
+    }
+    }
+}
+
+void Application3D::bindClusterUniforms(aie::ShaderProgram& shader) {
+    shader.bindUniform("ViewMatrix", m_clusterViewMatrix);
+    shader.bindUniform("ClusterGrid", glm::vec3(m_clusteredLighting.getGridSize()));
+    shader.bindUniform("ClusterScale", m_clusteredLighting.getSliceScale());
+    shader.bindUniform("ClusterBias", m_clusteredLighting.getSliceBias());
+    shader.bindUniform("ScreenSize", glm::vec2((float)m_renderWidth, (float)m_renderHeight));
+}
+
+void Application3D::renderShadows() {
+    float aspect = (float)getWindowWidth() / (float)getWindowHeight();
+    unsigned int cascadeMask = m_shadowMap.update(m_camera.getViewMatrix(), m_camera.getFieldOfView(), aspect,
+        m_camera.getNear(), m_light.direction);
+    if (cascadeMask == 0)
+        return;
+
+    m_shadowMap.beginRender(cascadeMask);
+    m_shadowShader.bind();
+    m_shadowShader.bindUniform("LightMatrices", (int)CascadedShadowMap::CASCADE_COUNT, m_shadowMap.getLightMatrices());
+    m_shadowShader.bindUniform("CascadeMask", (int)cascadeMask);
+
+    // Ships cast shadows; the ocean only receives them
+    if (m_commandsRecorded) {
+        m_shadowQueue.execute(m_shadowShader);
+    }
+    else {
+        for (EntityStore::Entity ship : m_shipEntities) {
+            m_shadowShader.bindUniform("ModelMatrix", m_entities.getWorldMatrix(ship));
+            m_shipMesh.drawDepth();
+        }
+    }
+    m_shadowMap.endRender(getWindowWidth(), getWindowHeight());
 }
 
+void Application3D::bindShadowUniforms(aie::ShaderProgram& shader) {
+    // The sampler always gets its own unit, even when unused, so it never aliases diffuseTex
+    m_shadowMap.bindTexture(SHADOW_TEXTURE_UNIT);
+    shader.bindUniform("ShadowMap", (int)SHADOW_TEXTURE_UNIT);
+    shader.bindUniform("UseShadows", m_useShadows ? 1 : 0);
+    shader.bindUniform("ShadowMatrices", (int)CascadedShadowMap::CASCADE_COUNT, m_shadowMap.getShadowMatrices());
+    shader.bindUniform("CascadeTexelSizes", m_shadowMap.getTexelSizes());
+}
+
+void Application3D::bindAmbientOcclusionUniforms(aie::ShaderProgram& shader) {
+    // Own unit for the same reason as the shadow map
+    glActiveTexture(GL_TEXTURE0 + AMBIENT_OCCLUSION_TEXTURE_UNIT);
+    glBindTexture(GL_TEXTURE_2D, m_ambientOcclusionActive ? m_renderGraph.getTexture(m_ambientOcclusionTexture) : 0);
+    glActiveTexture(GL_TEXTURE0);
+    shader.bindUniform("AmbientOcclusionTex", (int)AMBIENT_OCCLUSION_TEXTURE_UNIT);
+    shader.bindUniform("UseAmbientOcclusion", m_ambientOcclusionActive ? 1 : 0);
+}
+
+void Application3D::latchCamera() {
+    m_cameraLatched = true;
+    if (!m_useLateLatch)
+        return;
+
+    // Picks up mouse look the OS has reported since update(); the input is applied for real next frame
+    m_latchedProjectionView = m_camera.getProjectionMatrix(static_cast<float>(getWindowWidth()),
+        static_cast<float>(getWindowHeight())) * (m_useFlythrough ? m_camera.getViewMatrix() : m_camera.getLookAheadViewMatrix());
+    m_lateLatch.latch(m_preparedProjectionView, m_latchedProjectionView);
+}
+
+void Application3D::drawScene(const glm::mat4& pv, bool depthOnly) {
+    // Whichever scene pass comes first latches the camera for the rest of the frame
+    if (!m_cameraLatched)
+        latchCamera();
+
+    bool deferred = m_renderPath == RENDER_PATH_DEFERRED;
+
+    if (m_useIndirect) {
+        aie::ShaderProgram& shader = depthOnly ? m_depthIndirectShader :
+            deferred ? m_gbufferIndirectShader : m_indirectShader;
+        shader.bind();
+        shader.bindUniform("ProjectionView", pv);
+
+        if (depthOnly) {
+            m_indirectBatch.drawDepth(&shader);
+            return;
+        }
+        if (deferred) {
+            m_indirectBatch.draw(&shader);
+            return;
+        }
+
+        shader.bindUniform("LightDirection", m_light.direction);
+        shader.bindUniform("LightColour", m_light.colour);
+        shader.bindUniform("AmbientColour", m_ambientLight);
+        shader.bindUniform("cameraPosition", m_camera.getPosition());
+        shader.bindUniform("FillLightColour", m_fillLightColour);
+        shader.bindUniform("FillLightDirection", m_fillLightDirection);
+        shader.bindUniform("FillLightAmbient", m_fillLightAmbient);
+        shader.bindUniform("UseClusteredLights", m_useClusteredLighting ? 1 : 0);
+        if (m_useClusteredLighting)
+            bindClusterUniforms(shader);
+        bindShadowUniforms(shader);
+        bindAmbientOcclusionUniforms(shader);
+
+        m_indirectBatch.draw(&shader);
+        return;
+    }
+
+    if (depthOnly) {
+        m_depthShader.bind();
+        if (m_commandsRecorded) {
+            m_depthQueue.execute(m_depthShader);
+            return;
+        }
+        for (size_t i = 0; i < m_shipEntities.size(); i++) {
+            m_depthShader.bindUniform("ProjectionViewModel", m_entities.getProjectionViewModel(m_shipEntities[i]));
+            m_shipMesh.drawDepth(&m_shipVisibility[i]);
+        }
+        m_depthShader.bindUniform("ProjectionViewModel", m_entities.getProjectionViewModel(m_oceanEntity));
+        m_oceanMesh.drawDepth();
+        return;
+    }
+
+    // Bind Phong shader, with the local lights when clustered lighting is on
+    // The G-buffer shader only writes materials, lighting is applied afterwards
+    aie::ShaderProgram& shader = deferred ? m_gbufferShader :
+        m_useClusteredLighting ? m_clusteredShader : m_phongShader;
+    shader.bind();
+    shader.bindUniform("tilingFactor", 1.0f);
+    if (!deferred) {
+        shader.bindUniform("LightDirection", m_light.direction);
+        shader.bindUniform("LightColour", m_light.colour);
+        shader.bindUniform("AmbientColour", m_ambientLight);
+        shader.bindUniform("cameraPosition", m_camera.getPosition());
+
+        shader.bindUniform("FillLightColour", m_fillLightColour);
+        shader.bindUniform("FillLightDirection", m_fillLightDirection);
+        shader.bindUniform("FillLightAmbient", m_fillLightAmbient);
+        if (m_useClusteredLighting)
+            bindClusterUniforms(shader);
+        bindShadowUniforms(shader);
+        bindAmbientOcclusionUniforms(shader);
+    }
+
+    if (m_commandsRecorded) {
+        m_sceneQueue.execute(shader);
+        return;
+    }
+
+    // Draw ships
+    for (size_t i = 0; i < m_shipEntities.size(); i++) {
+        shader.bindUniform("ProjectionViewModel", m_entities.getProjectionViewModel(m_shipEntities[i]));
+        shader.bindUniform("ModelMatrix", m_entities.getWorldMatrix(m_shipEntities[i]));
+
+        m_shipMesh.draw(&shader, &m_shipVisibility[i]);
+    }
+
+    // Draw ocean
+    shader.bindUniform("tilingFactor", 5.0f);
+    shader.bindUniform("ProjectionViewModel", m_entities.getProjectionViewModel(m_oceanEntity));
+    shader.bindUniform("ModelMatrix", m_entities.getWorldMatrix(m_oceanEntity));
+    m_oceanMesh.draw(&shader);
+}
 
+void Application3D::recordScene() {
+    // Items are ships in fleet order, then the ocean last, matching the inline draws
+    unsigned int shipCount = (unsigned int)m_shipEntities.size();
+
+    // Ships cast shadows; the ocean only receives them
+    if (m_shadowsSupported) {
+        m_shadowQueue.record(shipCount, [this](RenderCommandBuffer& buffer, unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; i++) {
+                EntityStore::Entity ship = m_shipEntities[i];
+                buffer.setTransform(m_entities.getProjectionViewModel(ship), m_entities.getWorldMatrix(ship));
+                buffer.drawMeshDepth(m_shipMesh);
+            }
+        });
+    }
+
+    if (m_depthPrepassActive) {
+        m_depthQueue.record(shipCount + 1, [this, shipCount](RenderCommandBuffer& buffer, unsigned int begin, unsigned int end) {
+            for (unsigned int i = begin; i < end; i++) {
+                EntityStore::Entity entity = i < shipCount ? m_shipEntities[i] : m_oceanEntity;
+                buffer.setTransform(m_entities.getProjectionViewModel(entity), m_entities.getWorldMatrix(entity));
+                if (i < shipCount)
+                    buffer.drawMeshDepth(m_shipMesh, &m_shipVisibility[i]);
+                else
+                    buffer.drawMeshDepth(m_oceanMesh);
+            }
+        });
+    }
+
+    m_sceneQueue.record(shipCount + 1, [this, shipCount](RenderCommandBuffer& buffer, unsigned int begin, unsigned int end) {
+        for (unsigned int i = begin; i < end; i++) {
+            EntityStore::Entity entity = i < shipCount ? m_shipEntities[i] : m_oceanEntity;
+            buffer.setTransform(m_entities.getProjectionViewModel(entity), m_entities.getWorldMatrix(entity));
+            if (i < shipCount) {
+                buffer.setTilingFactor(1.0f);
+                buffer.drawMesh(m_shipMesh, &m_shipVisibility[i]);
+            }
+            else {
+                buffer.setTilingFactor(5.0f);
+                buffer.drawMesh(m_oceanMesh);
+            }
+        }
+    });
+}
+
+void Application3D::drawDeferredLighting(const glm::mat4& pv) {
+    m_deferredLightingShader.bind();
+
+    m_gbuffer.bindTextures(m_renderGraph, 0);
+    m_gbuffer.bindDepth(m_renderGraph, GBuffer::TARGET_COUNT);
+    m_deferredLightingShader.bindUniform("AlbedoSpecularPowerTex", (int)GBuffer::ALBEDO_SPECULAR_POWER);
+    m_deferredLightingShader.bindUniform("NormalTex", (int)GBuffer::NORMAL);
+    m_deferredLightingShader.bindUniform("AmbientSpecularTex", (int)GBuffer::AMBIENT_SPECULAR);
+    m_deferredLightingShader.bindUniform("DepthTex", (int)GBuffer::TARGET_COUNT);
+    m_deferredLightingShader.bindUniform("InverseProjectionView", glm::inverse(pv));
+
+    // Same light controls as the forward path
+    m_deferredLightingShader.bindUniform("LightDirection", m_light.direction);
+    m_deferredLightingShader.bindUniform("LightColour", m_light.colour);
+    m_deferredLightingShader.bindUniform("AmbientColour", m_ambientLight);
+    m_deferredLightingShader.bindUniform("cameraPosition", m_camera.getPosition());
+    m_deferredLightingShader.bindUniform("FillLightColour", m_fillLightColour);
+    m_deferredLightingShader.bindUniform("FillLightDirection", m_fillLightDirection);
+    m_deferredLightingShader.bindUniform("FillLightAmbient", m_fillLightAmbient);
+    m_deferredLightingShader.bindUniform("UseClusteredLights", m_useClusteredLighting ? 1 : 0);
+    if (m_useClusteredLighting)
+        bindClusterUniforms(m_deferredLightingShader);
+    bindShadowUniforms(m_deferredLightingShader);
+    bindAmbientOcclusionUniforms(m_deferredLightingShader);
+
+    // One full-screen triangle; cost depends on pixels and lights, not scene geometry
+    glDisable(GL_DEPTH_TEST);
+    glBindVertexArray(m_fullscreenVao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+    glEnable(GL_DEPTH_TEST);
+}
+
+void Application3D::drawDepthPrepass(const glm::mat4& pv) {
+    // Lay down depth only, then shade each visible pixel exactly once
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    drawScene(pv, true);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+}
+
+void Application3D::drawSceneColour(const glm::mat4& pv) {
+    if (m_depthPrepassActive) {
+        glDepthMask(GL_FALSE);
+        glDepthFunc(GL_EQUAL);
+    }
+
+    // Count shaded samples of the colour pass to measure overdraw
+    unsigned int query = m_sampleQueryFrame % SAMPLE_QUERY_COUNT;
+    glBeginQuery(GL_SAMPLES_PASSED, m_sampleQueries[query]);
+    drawScene(pv, false);
+    glEndQuery(GL_SAMPLES_PASSED);
+    m_sampleQueryPrepass[query] = m_depthPrepassActive;
+    m_sampleQueryPending[query] = true;
+    m_sampleQueryFrame++;
+
+    if (m_depthPrepassActive) {
+        glDepthMask(GL_TRUE);
+        glDepthFunc(GL_LESS);
+    }
+}
+
+void Application3D::buildRenderGraph(const glm::mat4& pv) {
+    RenderGraph& graph = m_renderGraph;
+    bool deferred = m_renderPath == RENDER_PATH_DEFERRED;
+    float aspect = (float)getWindowWidth() / (float)getWindowHeight();
+
+    RenderGraph::Handle backBuffer, backBufferDepth;
+    graph.importBackBuffer(getWindowWidth(), getWindowHeight(), backBuffer, backBufferDepth);
+
+    // Optional effects are declared whenever they are available and only read when enabled,
+    // so the graph culls them when they are switched off
+
+    // Far cascades are cached between frames, so the shadow map is imported rather than transient
+    RenderGraph::Handle shadowMap = RenderGraph::INVALID_HANDLE;
+    if (m_shadowsSupported) {
+        unsigned int resolution = m_shadowMap.getResolution();
+        shadowMap = graph.importTexture("Shadow Map", m_shadowMap.getTexture(), resolution, resolution);
+        graph.addPass("Shadows", "Shadows", [this](RenderGraph&) {
+            renderShadows();
+        }).write(shadowMap);
+    }
+
+    // The scene goes to HDR targets when post-processing is on, otherwise straight to the back buffer
+    RenderGraph::Handle sceneColour = backBuffer;
+    RenderGraph::Handle sceneDepth = backBufferDepth;
+    if (m_useHdr) {
+        sceneColour = graph.createTexture("Scene Colour", { m_renderWidth, m_renderHeight, GL_RGBA16F, true });
+        if (!deferred)
+            sceneDepth = graph.createTexture("Scene Depth", { m_renderWidth, m_renderHeight, GL_DEPTH24_STENCIL8, false });
+    }
+
+    // SSAO reads scene depth before shading: the G-buffer in the deferred path, the HDR
+    // target's depth after the pre-pass in the forward path (the back buffer cannot be sampled)
+    bool ambientOcclusionAvailable = m_ambientOcclusionSupported && (deferred || m_useHdr);
+    m_ambientOcclusionTexture = RenderGraph::INVALID_HANDLE;
+    auto readLightingInputs = [&](RenderGraph::Builder& pass) {
+        if (m_useShadows)
+            pass.read(shadowMap);
+        if (m_ambientOcclusionActive)
+            pass.read(m_ambientOcclusionTexture);
+    };
+
+    if (deferred) {
+        // Geometry goes to the G-buffer; blending would corrupt the packed alpha channels
+        m_gbuffer.create(graph, m_renderWidth, m_renderHeight);
+        RenderGraph::Builder geometry = graph.addPass("G-Buffer", "Scene", [this, pv](RenderGraph&) {
+            glDisable(GL_BLEND);
+            if (m_depthPrepassActive)
+                drawDepthPrepass(pv);
+            drawSceneColour(pv);
+            glEnable(GL_BLEND);
+        });
+        m_gbuffer.write(geometry);
+
+        if (ambientOcclusionAvailable)
+            m_ambientOcclusionTexture = m_ambientOcclusion.addPasses(graph, m_gbuffer.getDepth(),
+                m_gbuffer.getTarget(GBuffer::NORMAL), m_camera.getViewMatrix(), m_camera.getFieldOfView(),
+                aspect, m_camera.getNear(), m_camera.getFar());
+
+        // Pixels left at the far plane are skipped, leaving the cleared background
+        // Positions are rebuilt from depth drawn with the latched camera
+        RenderGraph::Builder lighting = graph.addPass("Deferred Lighting", "Lighting", [this](RenderGraph&) {
+            drawDeferredLighting(m_latchedProjectionView);
+        });
+        m_gbuffer.read(lighting);
+        readLightingInputs(lighting);
+        lighting.writeColour(sceneColour, RenderGraph::LOAD_CLEAR);
+
+        if (m_useHdr) {
+            // Later passes depth test against the G-buffer depth directly
+            sceneDepth = m_gbuffer.getDepth();
+        }
+        else {
+            RenderGraph::Handle gbufferDepth = m_gbuffer.getDepth();
+            unsigned int width = m_renderWidth, height = m_renderHeight;
+            graph.addPass("Depth Resolve", "Lighting", [gbufferDepth, width, height](RenderGraph& graph) {
+                unsigned int source = graph.getFramebuffer(RenderGraph::INVALID_HANDLE, gbufferDepth);
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, source);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+                glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }).read(gbufferDepth, RenderGraph::ACCESS_ATTACHMENT).writeDepth(sceneDepth, RenderGraph::LOAD_DONT_CARE);
+        }
+    }
+    else {
+        if (m_depthPrepassActive) {
+            graph.addPass("Depth Pre-pass", "Pre-pass", [this, pv](RenderGraph&) {
+                drawDepthPrepass(pv);
+            }).writeDepth(sceneDepth, RenderGraph::LOAD_CLEAR);
+        }
+
+        if (ambientOcclusionAvailable)
+            m_ambientOcclusionTexture = m_ambientOcclusion.addPasses(graph, sceneDepth, RenderGraph::INVALID_HANDLE,
+                m_camera.getViewMatrix(), m_camera.getFieldOfView(), aspect, m_camera.getNear(), m_camera.getFar());
+
+        RenderGraph::Builder scene = graph.addPass("Scene", "Scene", [this, pv](RenderGraph&) {
+            drawSceneColour(pv);
+        });
+        readLightingInputs(scene);
+        scene.writeColour(sceneColour, RenderGraph::LOAD_CLEAR);
+        scene.writeDepth(sceneDepth, m_depthPrepassActive ? RenderGraph::LOAD_KEEP : RenderGraph::LOAD_CLEAR);
+    }
+
+    // Gizmos last so they depth test against the scene in either path
+    graph.addPass("Gizmos", nullptr, [this](RenderGraph&) {
+        Gizmos::draw(m_latchedProjectionView);
+    }).writeColour(sceneColour, RenderGraph::LOAD_KEEP).writeDepth(sceneDepth, RenderGraph::LOAD_KEEP);
+
+    if (m_useHdr) {
+        if (m_renderWidth != getWindowWidth() || m_renderHeight != getWindowHeight()) {
+            // Resolve at render resolution, then upscale to the window
+            RenderGraph::Handle resolved = graph.createTexture("Resolved", { m_renderWidth, m_renderHeight, GL_RGBA8, true });
+            m_postProcess.addPasses(graph, sceneColour, resolved);
+            m_upscaler.addPass(graph, resolved, backBuffer);
+        }
+        else {
+            m_postProcess.addPasses(graph, sceneColour, backBuffer);
+        }
+    }
+}
 
 void Application3D::draw() {
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    m_gpuTimer.beginFrame();
+
+    // The scene renders at a scaled resolution when dynamic resolution is driving it
+    m_renderWidth = getWindowWidth();
+    m_renderHeight = getWindowHeight();
+    if (m_useHdr && m_useDynamicResolution) {
+        m_dynamicResolution.update(m_gpuTimer.getFrameTime());
+        m_dynamicResolution.getRenderSize(getWindowWidth(), getWindowHeight(), m_renderWidth, m_renderHeight);
+    }
+
     glEnable(GL_BLEND);
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glEnable(GL_DEPTH_TEST);
@@ -126,45 +1234,77 @@ void Application3D::draw() {
 
     Gizmos::clear();
     Gizmos::addTransform(glm::mat4(1));
+    if (m_showCameraPath)
+        m_cameraPath.draw(vec4(1.0f, 0.8f, 0.2f, 1.0f));
     glm::mat4 pv = m_camera.getProjectionMatrix(static_cast<float>(getWindowWidth()), static_cast<float>(getWindowHeight())) * m_camera.getViewMatrix();
-    Gizmos::draw(pv);
 
-    // Bind Phong shader
-    m_phongShader.bind();
-    m_phongShader.bindUniform("tilingFactor", 1.0f);
-    m_phongShader.bindUniform("LightDirection", m_light.direction);
-    m_phongShader.bindUniform("LightColour", m_light.colour);
-    m_phongShader.bindUniform("AmbientColour", m_ambientLight);
-    m_phongShader.bindUniform("cameraPosition", m_camera.getPosition());
+    // The frame is prepared with this camera; the scene passes latch a newer one
+    m_lateLatch.beginFrame(m_inputTime);
+    m_preparedProjectionView = pv;
+    m_latchedProjectionView = pv;
+    m_cameraLatched = false;
 
-    m_phongShader.bindUniform("FillLightColour", m_fillLightColour);
-    glm::vec3 dir = glm::normalize(m_fillLightDirection);
-    m_phongShader.bindUniform("FillLightDirection", m_fillLightDirection);
-    m_phongShader.bindUniform("FillLightAmbient", m_fillLightAmbient);
+    // World and ProjectionViewModel matrices for every entity, used by everything below
+    m_entities.update(pv);
 
-   
-    // Draw ship
-    glm::mat4 pvm = pv * m_shipTransform;
-    m_phongShader.bindUniform("ProjectionViewModel", pvm);
-    m_phongShader.bindUniform("ModelMatrix", m_shipTransform);
+    cullScene(pv);
+    updateDepthPrepass();
 
-    m_shipMesh.draw(&m_phongShader);
+    // Forward SSAO needs the pre-pass depth before shading
+    bool deferred = m_renderPath == RENDER_PATH_DEFERRED;
+    m_ambientOcclusionActive = m_useAmbientOcclusion && (deferred || m_useHdr);
+    if (m_ambientOcclusionActive && !deferred)
+        m_depthPrepassActive = true;
 
+    // Per-submesh draws are recorded on worker jobs while this thread bins the lights and
+    // builds the render graph; each pass waits for its own recording before replaying it
+    m_commandsRecorded = m_useCommandRecording && !m_useIndirect;
+    if (m_commandsRecorded)
+        recordScene();
 
-    // Draw ocean
-    m_phongShader.bindUniform("tilingFactor", 5.0f);
-    glm::mat4 oceanPVM = pv * m_oceanTransform;
-    m_phongShader.bindUniform("ProjectionViewModel", oceanPVM);
-    m_phongShader.bindUniform("ModelMatrix", m_oceanTransform);
-    m_oceanMesh.draw(&m_phongShader);
+    if (m_useClusteredLighting) {
+        // Bin the local lights against this frame's camera
+        animateSceneLights(getSceneTime());
+        m_clusterViewMatrix = m_camera.getViewMatrix();
+        m_clusteredLighting.update(m_clusterViewMatrix, m_camera.getFieldOfView(),
+            (float)getWindowWidth() / (float)getWindowHeight(), m_camera.getNear(), m_camera.getFar());
+        m_clusteredLighting.bind();
+    }
 
+    if (m_useIndirect) {
+        // Whole scene in one multi-draw per mesh, shared by the depth and colour passes
+        m_indirectBatch.begin();
+        for (size_t i = 0; i < m_shipEntities.size(); i++)
+            m_indirectBatch.add(m_shipMesh, m_entities.getWorldMatrix(m_shipEntities[i]), 1.0f, &m_shipVisibility[i]);
+        m_indirectBatch.add(m_oceanMesh, m_entities.getWorldMatrix(m_oceanEntity), 5.0f);
+        m_indirectBatch.end();
+    }
+
+    // Declare, cull, schedule and run this frame's passes
+    m_renderGraph.reset();
+    buildRenderGraph(pv);
+    m_renderGraph.compile();
+    m_renderGraph.execute(&m_gpuTimer);
+    m_gpuTimer.endFrame();
+    m_lateLatch.endFrame();
+
+    // Recordings for passes that were culled or skipped this frame were never waited on,
+    // and they read the scene that the next update changes
+    if (m_commandsRecorded) {
+        m_shadowQueue.wait();
+        m_depthQueue.wait();
+        m_sceneQueue.wait();
+    }
+
+    m_benchmark.endFrame(m_gpuTimer.getFrameTime());
+    if (m_benchmark.isFinished()) {
+        if (m_benchmark.writeReport(m_benchmarkReport.c_str()))
+            printf("Benchmark report written to %s\n", m_benchmarkReport.c_str());
+        quit();
+    }
 
-    // Render ImGui
-    ImGui::Render();
+    // ImGui is rendered and the frame presented by the Application after draw
     glEnable(GL_CULL_FACE);
-    glfwSwapBuffers(glfwGetCurrentContext());
-    glfwPollEvents();
-   
 }
 
 
@@ -6,6 +6,22 @@
 #include "Shader.h"
 #include "Mesh.h"
 #include "Camera.h"
+#include "IndirectBatch.h"
+#include "OcclusionCuller.h"
+#include "ClusteredLighting.h"
+#include "GBuffer.h"
+#include "CascadedShadowMap.h"
+#include "PostProcess.h"
+#include "GpuTimer.h"
+#include "DynamicResolution.h"
+#include "Upscaler.h"
+#include "AmbientOcclusion.h"
+#include "RenderGraph.h"
+#include "EntityStore.h"
+#include "RenderCommands.h"
+#include "LateLatch.h"
+#include "CameraPath.h"
+#include "Benchmark.h"
 #include "imgui_glfw3.h"
 
 class Application3D : public aie::Application {
@@ -15,24 +31,209 @@ public:
     virtual bool startup();
     virtual void shutdown();
     virtual void update(float deltaTime);
+    virtual void fixedUpdate(float timeStep);
+    virtual void resetSimulation();
     virtual void draw();
+
+    // Runs unattended along the camera path for frameCount measured frames, writes the
+    // report and quits; must be called before run()
+    void setBenchmark(unsigned int frameCount, const char* reportFile);
  
 protected:
         Camera m_camera; // Scene camera
         aie::ShaderProgram m_shader; // Basic shader program
         aie::ShaderProgram m_phongShader; // Phong shading program
         Mesh m_shipMesh;   // Mesh for the pirate ship
-        glm::mat4 m_shipTransform; // Transform for ship positioning
         Mesh m_oceanMesh;  // Mesh for the ocean
-        glm::mat4 m_oceanTransform; // Transform for ocean positioning
+
+        // Time that animation is evaluated at: between the last two simulation ticks in
+        // fixed timestep mode, so it is as smooth as the display but repeatable per tick
+        float getSceneTime() const;
+
+        // Recreates the ship entities, with their lanterns, cannons and rigging, around the flagship
+        void updateFleet();
+
+        // Sways each ship's masts, carrying all the rigging below them
+        void animateRigging(float time);
+
+        EntityStore m_entities; // Transform hierarchy of everything in the scene
+        EntityStore::Entity m_oceanEntity;
+        std::vector<EntityStore::Entity> m_shipEntities; // Flagship followed by escort ships
+        std::vector<EntityStore::Entity> m_lanternEntities; // Bow and stern lanterns of every ship
+        std::vector<EntityStore::Entity> m_cannonEntities; // Port and starboard cannons of every ship
+        std::vector<EntityStore::Entity> m_mastEntities; // Roots of each ship's rigging
+        int m_fleetSize; // Number of ships drawn
+        int m_riggingPerShip; // Rigging and crew entities below each ship's masts
+        bool m_swayRigging; // Animate the masts every frame
+
+        aie::ShaderProgram m_indirectShader; // Phong shading driven by per-draw SSBO records
+        IndirectBatch m_indirectBatch; // Multi-draw indirect submission of the whole scene
+        bool m_indirectSupported; // True if the context supports the indirect path
+        bool m_useIndirect; // Submit the scene with multi-draw indirect instead of per-submesh draws
+
+        // Records this frame's per-submesh draws for the shadow, depth and colour passes as jobs
+        void recordScene();
+
+        RenderQueue m_shadowQueue; // Ship draws into the shadow cascades
+        RenderQueue m_depthQueue; // Position-only draws for the depth pre-pass
+        RenderQueue m_sceneQueue; // Material draws for the colour or G-buffer pass
+        bool m_useCommandRecording; // Record per-submesh draws on worker jobs and replay them on the GL thread
+        bool m_commandsRecorded; // Whether this frame's passes replay recorded commands
+
+        // Depth pre-pass configuration
+        enum DepthPrepassMode : int {
+            DEPTH_PREPASS_OFF,
+            DEPTH_PREPASS_ON,
+            DEPTH_PREPASS_AUTO  // Measure overdraw and enable the pre-pass only when it pays off
+        };
+
+        // Draws the scene; depth-only uses the position-only stream and depth shaders
+        void drawScene(const glm::mat4& projectionView, bool depthOnly);
+
+        // Depth-only pass ahead of the colour pass
+        void drawDepthPrepass(const glm::mat4& projectionView);
+
+        // Colour pass, depth testing for equality after a pre-pass, with its shaded samples counted
+        void drawSceneColour(const glm::mat4& projectionView);
+
+        // Reads back finished GL_SAMPLES_PASSED queries and decides this frame's pre-pass
+        void updateDepthPrepass();
+
+        static const unsigned int SAMPLE_QUERY_COUNT = 4; // Frames of query latency before readback
+
+        aie::ShaderProgram m_depthShader; // Position-only depth shader
+        aie::ShaderProgram m_depthIndirectShader; // Position-only depth shader for the indirect path
+        int m_depthPrepassMode; // DepthPrepassMode
+        bool m_depthPrepassActive; // Whether this frame uses the pre-pass
+        float m_depthPrepassThreshold; // Overdraw ratio above which AUTO enables the pre-pass
+        unsigned int m_sampleQueries[SAMPLE_QUERY_COUNT]; // Shaded samples of each frame's colour pass
+        bool m_sampleQueryPrepass[SAMPLE_QUERY_COUNT]; // Whether that frame used the pre-pass
+        bool m_sampleQueryPending[SAMPLE_QUERY_COUNT];
+        unsigned int m_sampleQueryFrame; // Frame counter used to cycle the queries
+        unsigned long long m_shadedSamples[2]; // Last colour pass samples without [0] / with [1] the pre-pass
+
+        // Rasterizes the fleet's occluders and decides which ship submeshes to draw
+        void cullScene(const glm::mat4& projectionView);
+
+        OcclusionCuller m_occlusionCuller; // CPU software occlusion culling
+        bool m_useOcclusionCulling; // Test ship bounds against the occlusion buffer before drawing
+        std::vector<std::vector<bool>> m_shipVisibility; // Per fleet ship, per submesh visibility
+        unsigned int m_culledSubMeshes; // Submeshes rejected by culling last frame
+
+        // Local light list (clustered forward lighting); returns the light's index
+        unsigned int addPointLight(const glm::vec3& position, const glm::vec3& colour, float range);
+        unsigned int addSpotLight(const glm::vec3& position, const glm::vec3& direction, const glm::vec3& colour,
+            float range, float innerAngle, float outerAngle);
+        void removeLight(unsigned int index);
+        void clearLights();
+
+        // Rebuilds the ship lanterns, harbour lights and cannon flashes for the current fleet
+        void rebuildSceneLights();
+
+        // Animates the cannon flashes
+        void animateSceneLights(float time);
+
+        // Binds the cluster grid uniforms used by the clustered shaders
+        void bindClusterUniforms(aie::ShaderProgram& shader);
+
+        aie::ShaderProgram m_clusteredShader; // Phong shading plus the clustered local lights
+        ClusteredLighting m_clusteredLighting; // Bins local lights into froxels each frame
+        bool m_clusteredSupported; // True if the context supports SSBOs (OpenGL 4.3)
+        bool m_useClusteredLighting; // Shade with the local lights
+        int m_harbourLightCount; // Lamps placed around the harbour
+        std::vector<unsigned int> m_lanternLights; // Indices of the lantern point lights, matching m_lanternEntities
+        std::vector<unsigned int> m_cannonLights; // Indices of the cannon flash spot lights, matching m_cannonEntities
+
+        // Renderer selection
+        enum RenderPath : int {
+            RENDER_PATH_FORWARD,
+            RENDER_PATH_DEFERRED    // G-buffer pass then one full-screen lighting pass
+        };
+
+        // Shades the G-buffer into the back buffer
+        void drawDeferredLighting(const glm::mat4& projectionView);
+
+        aie::ShaderProgram m_gbufferShader; // Writes materials and normals to the G-buffer
+        aie::ShaderProgram m_gbufferIndirectShader; // G-buffer shader for the indirect path
+        aie::ShaderProgram m_deferredLightingShader; // Full-screen sun, fill and clustered light pass
+        GBuffer m_gbuffer;
+        unsigned int m_fullscreenVao; // Empty VAO for attributeless full-screen draws
+        bool m_deferredSupported; // True if the deferred path initialised
+        int m_renderPath; // RenderPath
+        float m_frameTime; // Smoothed frame time (ms) for comparing render paths
+
+        // Renders the shadow cascades that need updating
+        void renderShadows();
+
+        // Binds the shadow map and cascade uniforms used by the lit shaders
+        void bindShadowUniforms(aie::ShaderProgram& shader);
+
+        static const unsigned int SHADOW_TEXTURE_UNIT = 5; // Kept clear of material and G-buffer units
+
+        aie::ShaderProgram m_shadowShader; // Layered depth pass into every dirty cascade at once
+        CascadedShadowMap m_shadowMap; // Sun shadow cascades
+        bool m_shadowsSupported; // True if the shadow map initialised
+        bool m_useShadows; // Sun casts shadows
+
+        PostProcess m_postProcess; // HDR scene target, bloom and tone mapping
+        bool m_hdrSupported; // True if the post-processing shaders loaded
+        bool m_useHdr; // Render to the HDR target and resolve through the post stack
+        GpuTimer m_gpuTimer; // Per-stage GPU timings shown in the Rendering window
+
+        DynamicResolution m_dynamicResolution; // Picks the render scale from measured GPU time
+        Upscaler m_upscaler; // Stretches the render resolution image to the window
+        bool m_useDynamicResolution; // Scale the 3D scene resolution to hold the GPU budget
+        unsigned int m_renderWidth; // Resolution the 3D scene renders at this frame
+        unsigned int m_renderHeight;
+
+        // Binds the ambient occlusion texture used by the lit shaders
+        void bindAmbientOcclusionUniforms(aie::ShaderProgram& shader);
+
+        static const unsigned int AMBIENT_OCCLUSION_TEXTURE_UNIT = 6;
+        RenderGraph::Handle m_ambientOcclusionTexture; // This frame's occlusion result in the render graph
+
+        AmbientOcclusion m_ambientOcclusion; // Half resolution SSAO applied to the ambient term
+        bool m_ambientOcclusionSupported; // True if the SSAO shaders loaded
+        bool m_useAmbientOcclusion; // Darken ambient light in creases and contact areas
+        bool m_ambientOcclusionActive; // SSAO computed this frame (needs a depth texture before shading)
+
+        // Declares this frame's passes, from the shadow maps to the back buffer
+        void buildRenderGraph(const glm::mat4& projectionView);
+
+        RenderGraph m_renderGraph; // Orders the passes and pools their transient targets
+
+        // Samples the mouse again just before the scene is submitted and latches the new camera
+        void latchCamera();
+
+        LateLatch m_lateLatch; // Per-frame camera correction applied by the scene vertex shaders
+        bool m_useLateLatch; // Correct the scene to the camera sampled just before submission
+        bool m_showLatencyOverlay; // Show the measured input latency over the scene
+        bool m_cameraLatched; // Whether this frame's camera has been latched yet
+        double m_inputTime; // When update()'s input was polled
+        glm::mat4 m_preparedProjectionView; // Camera that culling, shadows and recording used
+        glm::mat4 m_latchedProjectionView; // Camera the scene is drawn with
+        glm::mat4 m_clusterViewMatrix; // View the local lights were binned in
+
+        // Places the camera on the flythrough at the frame's time (between ticks in fixed timestep mode)
+        void updateFlythrough();
+
+        CameraPath m_cameraPath; // Authored flythrough around the flagship
+        bool m_useFlythrough; // Drive the camera along the path instead of from input
+        bool m_showCameraPath; // Draw the path with Gizmos
+        double m_flythroughTime; // Path time at the latest tick, or frame without a fixed timestep
+        bool m_loopInputPlayback; // Restart input playback when it reaches the end
+
+        Benchmark m_benchmark; // Startup timings, and frame statistics in benchmark runs
+        unsigned int m_benchmarkFrames; // Frames a benchmark run measures, 0 for interactive runs
+        std::string m_benchmarkReport; // Where the benchmark report is written
 
         struct Light {
             glm::vec3 direction;
             glm::vec3 colour;
         };
 
-        glm::vec3 m_ambientLight; // Ambient lighting in scene
         Light m_light; // Primary light (sun)
+        glm::vec3 m_ambientLight; // Ambient lighting in scene
         glm::vec3 m_fillLightDirection; // Secondary light (fill light)
         glm::vec3 m_fillLightColour; // Fill light colour
 		glm::vec3 m_fillLightAmbient; // Fill light ambient
@@ -0,0 +1,166 @@
+#include "Benchmark.h"
+#include "GLStats.h"
+#include "../dependencies/glfw/include/GLFW/glfw3.h"
+#include <algorithm>
+#include <cmath>
+
+Benchmark::Benchmark()
+    : m_running(false),
+    m_frameCount(0),
+    m_warmupFrames(0),
+    m_timeStep(1.0f / 60.0f),
+    m_frame(0),
+    m_frameStart(0),
+    m_previousFrameStart(0) {
+}
+
+Benchmark::~Benchmark() {
+}
+
+void Benchmark::start(unsigned int frameCount, unsigned int warmupFrames, float timeStep) {
+    m_running = true;
+    m_frameCount = frameCount;
+    m_warmupFrames = warmupFrames;
+    m_timeStep = timeStep;
+    m_frame = 0;
+
+    m_cpuTimes.values.clear();
+    m_frameIntervals.values.clear();
+    m_gpuTimes.values.clear();
+    m_drawCalls.values.clear();
+    m_binds.values.clear();
+    m_redundantStateSets.values.clear();
+    m_cpuTimes.values.reserve(frameCount);
+    m_frameIntervals.values.reserve(frameCount);
+    m_gpuTimes.values.reserve(frameCount);
+    m_drawCalls.values.reserve(frameCount);
+    m_binds.values.reserve(frameCount);
+    m_redundantStateSets.values.reserve(frameCount);
+}
+
+void Benchmark::addStartupPhase(const char* name, float milliseconds) {
+    StartupPhase phase = { name, milliseconds };
+    m_startupPhases.push_back(phase);
+}
+
+void Benchmark::setProperty(const char* name, const std::string& value) {
+    for (Property& property : m_properties) {
+        if (property.name == name) {
+            property.value = value;
+            return;
+        }
+    }
+    Property property = { name, value };
+    m_properties.push_back(property);
+}
+
+void Benchmark::beginFrame() {
+    if (!m_running)
+        return;
+
+    m_previousFrameStart = m_frameStart;
+    m_frameStart = glfwGetTime();
+}
+
+void Benchmark::endFrame(float gpuTime) {
+    if (!m_running || isFinished())
+        return;
+
+    // The first measured frame still has a warm-up frame before it, so it has an interval
+    if (m_frame >= m_warmupFrames) {
+        m_cpuTimes.values.push_back((float)((glfwGetTime() - m_frameStart) * 1000.0));
+        m_frameIntervals.values.push_back((float)((m_frameStart - m_previousFrameStart) * 1000.0));
+        m_gpuTimes.values.push_back(gpuTime);
+#ifdef AIE_GL_STATS
+        // GLStats closes a frame once it is presented, after this, so these are the counts of
+        // the frame before; every run renders the same frames, so the window is only shifted
+        const aie::GLStats::Counters& counts = aie::GLStats::getLastFrame().total;
+        m_drawCalls.values.push_back((float)counts.drawCalls);
+        m_binds.values.push_back((float)(counts.programBinds + counts.vertexArrayBinds + counts.textureBinds));
+        m_redundantStateSets.values.push_back((float)counts.redundantStateSets);
+#endif
+    }
+    m_frame++;
+}
+
+void Benchmark::Samples::writeJson(FILE* file, const char* name, bool last) const {
+    std::vector<float> sorted = values;
+    std::sort(sorted.begin(), sorted.end());
+
+    double sum = 0.0;
+    for (float value : sorted)
+        sum += value;
+
+    // Nearest-rank percentiles
+    auto percentile = [&sorted](float p) {
+        if (sorted.empty())
+            return 0.0f;
+        size_t rank = (size_t)std::ceil(p / 100.0f * sorted.size());
+        return sorted[rank > 0 ? rank - 1 : 0];
+    };
+
+    fprintf(file, "    \"%s\": { \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+        name, sorted.empty() ? 0.0 : sum / sorted.size(), percentile(50.0f), percentile(95.0f), percentile(99.0f),
+        sorted.empty() ? 0.0f : sorted.back(), last ? "" : ",");
+}
+
+bool Benchmark::writeReport(const char* filename) const {
+    FILE* file = nullptr;
+    fopen_s(&file, filename, "w");
+    if (file == nullptr) {
+        printf("Failed to write benchmark report: %s\n", filename);
+        return false;
+    }
+
+    // Property values are plain identifiers and driver strings, so only quotes and backslashes are escaped
+    auto writeString = [file](const std::string& text) {
+        fputc('"', file);
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                fputc('\\', file);
+            if ((unsigned char)c >= 0x20)
+                fputc(c, file);
+        }
+        fputc('"', file);
+    };
+
+    fprintf(file, "{\n");
+    for (const Property& property : m_properties) {
+        fprintf(file, "  ");
+        writeString(property.name);
+        fprintf(file, ": ");
+        writeString(property.value);
+        fprintf(file, ",\n");
+    }
+    fprintf(file, "  \"frames\": %u,\n", (unsigned int)m_cpuTimes.values.size());
+    fprintf(file, "  \"warmup_frames\": %u,\n", m_warmupFrames);
+
+    fprintf(file, "  \"startup_ms\": {\n");
+    for (size_t i = 0; i < m_startupPhases.size(); i++) {
+        fprintf(file, "    ");
+        writeString(m_startupPhases[i].name);
+        fprintf(file, ": %.3f%s\n", m_startupPhases[i].time, i + 1 < m_startupPhases.size() ? "," : "");
+    }
+    fprintf(file, "  },\n");
+
+    fprintf(file, "  \"frame_ms\": {\n");
+    m_cpuTimes.writeJson(file, "cpu", false);
+    m_gpuTimes.writeJson(file, "gpu", false);
+    m_frameIntervals.writeJson(file, "interval", true);
+#ifdef AIE_GL_STATS
+    fprintf(file, "  },\n");
+
+    fprintf(file, "  \"counts\": {\n");
+    m_drawCalls.writeJson(file, "draw_calls", false);
+    m_binds.writeJson(file, "binds", false);
+    m_redundantStateSets.writeJson(file, "redundant_state_sets", true);
+#endif
+    fprintf(file, "  }\n");
+    fprintf(file, "}\n");
+
+    bool written = ferror(file) == 0;
+    fclose(file);
+    if (!written)
+        printf("Failed to write benchmark report: %s\n", filename);
+    return written;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Unattended performance run, for catching regressions automatically
+// After some warm-up frames it records every frame's CPU time (update and draw), frame
+// interval and GPU time, with its draw calls, binds and redundant state sets, then writes a
+// JSON report with the mean, percentiles and maximum of each. The counts come from
+// aie::GLStats, so they are left out of builds without it. Scene time advances by a fixed
+// step per frame rather than with the clock, so every run renders the same frames
+// whatever the machine.
+class Benchmark {
+public:
+
+    Benchmark();
+    ~Benchmark();
+
+    // Measures frameCount frames after warmupFrames, with timeStep seconds of scene time per frame
+    void start(unsigned int frameCount, unsigned int warmupFrames = 60, float timeStep = 1.0f / 60.0f);
+    bool isRunning() const { return m_running; }
+    bool isFinished() const { return m_running && m_frame >= m_warmupFrames + m_frameCount; }
+
+    // Time the scene is rendered at, from the frame number
+    double getSceneTime() const { return m_frame * (double)m_timeStep; }
+
+    // Startup work is timed whether or not a benchmark runs
+    void addStartupPhase(const char* name, float milliseconds);
+
+    // Bracket a frame's CPU work; gpuTime is the latest completed GPU frame time (ms)
+    void beginFrame();
+    void endFrame(float gpuTime);
+
+    // Descriptive fields written at the top of the report
+    void setProperty(const char* name, const std::string& value);
+
+    bool writeReport(const char* filename) const;
+
+protected:
+
+    struct StartupPhase {
+        std::string name;
+        float time;
+    };
+
+    struct Property {
+        std::string name;
+        std::string value;
+    };
+
+    struct Samples {
+        std::vector<float> values;
+        void writeJson(FILE* file, const char* name, bool last) const;
+    };
+
+    bool m_running;
+    unsigned int m_frameCount;
+    unsigned int m_warmupFrames;
+    float m_timeStep;
+    unsigned int m_frame; // Frames begun, warm-up included
+
+    double m_frameStart;
+    double m_previousFrameStart;
+
+    std::vector<StartupPhase> m_startupPhases;
+    std::vector<Property> m_properties;
+
+    Samples m_cpuTimes;
+    Samples m_frameIntervals;
+    Samples m_gpuTimes;
+    Samples m_drawCalls;
+    Samples m_binds;
+    Samples m_redundantStateSets;
+};
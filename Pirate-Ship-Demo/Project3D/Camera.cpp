@@ -2,8 +2,29 @@
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
+static const float moveSpeed = 5.0f;
+static const float turnSpeed = 0.1f;
+
+void Camera::bindDefaultActions() {
+    aie::Input* input = aie::Input::getInstance();
+    input->bindActionKey(CAMERA_MOVE_FORWARD, aie::INPUT_KEY_W);
+    input->bindActionKey(CAMERA_MOVE_BACK, aie::INPUT_KEY_S);
+    input->bindActionKey(CAMERA_MOVE_LEFT, aie::INPUT_KEY_A);
+    input->bindActionKey(CAMERA_MOVE_RIGHT, aie::INPUT_KEY_D);
+    input->bindActionKey(CAMERA_MOVE_UP, aie::INPUT_KEY_Z);
+    input->bindActionKey(CAMERA_MOVE_DOWN, aie::INPUT_KEY_X);
+    input->bindActionMouseButton(CAMERA_LOOK, aie::INPUT_MOUSE_BUTTON_RIGHT);
+}
+
+void Camera::update(float deltaTime) {
+    move(deltaTime);
+    look();
+    interpolate(1.0f);
+}
+
+void Camera::move(float timeStep) {
+    m_previousPosition = m_simulatedPosition;
 
-void Camera::update(float deltaTime, GLFWwindow* window) {
     float thetaR = glm::radians(m_theta);
     float phiR = glm::radians(m_phi);
 
@@ -11,35 +32,59 @@ void Camera::update(float deltaTime, GLFWwindow* window) {
     glm::vec3 right(-sin(thetaR), 0, cos(thetaR));
     glm::vec3 up(0, 1, 0);
 
-    if (glfwGetKey(window, GLFW_KEY_W))
-        m_position += forward * deltaTime * 5.0f;
-    if (glfwGetKey(window, GLFW_KEY_S))
-        m_position -= forward * deltaTime * 5.0f;
-    if (glfwGetKey(window, GLFW_KEY_A))
-        m_position -= right * deltaTime * 5.0f;
-    if (glfwGetKey(window, GLFW_KEY_D))
-        m_position += right * deltaTime * 5.0f;
-    if (glfwGetKey(window, GLFW_KEY_Z))
-        m_position += up * deltaTime * 5.0f;
-    if (glfwGetKey(window, GLFW_KEY_X))
-        m_position -= up * deltaTime * 5.0f;
+    aie::Input* input = aie::Input::getInstance();
+    if (input->isActionDown(CAMERA_MOVE_FORWARD))
+        m_simulatedPosition += forward * timeStep * moveSpeed;
+    if (input->isActionDown(CAMERA_MOVE_BACK))
+        m_simulatedPosition -= forward * timeStep * moveSpeed;
+    if (input->isActionDown(CAMERA_MOVE_LEFT))
+        m_simulatedPosition -= right * timeStep * moveSpeed;
+    if (input->isActionDown(CAMERA_MOVE_RIGHT))
+        m_simulatedPosition += right * timeStep * moveSpeed;
+    if (input->isActionDown(CAMERA_MOVE_UP))
+        m_simulatedPosition += up * timeStep * moveSpeed;
+    if (input->isActionDown(CAMERA_MOVE_DOWN))
+        m_simulatedPosition -= up * timeStep * moveSpeed;
+}
 
+void Camera::look() {
     // Mouse look (only when right-click is held)
-    static double lastX = 0, lastY = 0;
-    double x, y;
-    glfwGetCursorPos(window, &x, &y);
+    // The cursor is captured meanwhile, so turning is not stopped by the window edge
+    aie::Input* input = aie::Input::getInstance();
+    bool looking = input->isActionDown(CAMERA_LOOK);
+    input->setMouseCaptured(looking);
 
-    float turnSpeed = 0.1f;
-    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_RIGHT)) {
-        m_theta += turnSpeed * (float)(x - lastX);
-        m_phi -= turnSpeed * (float)(y - lastY);
+    if (looking) {
+        double x, y;
+        input->getMouseMotion(&x, &y);
+        m_theta += turnSpeed * (float)x;
+        m_phi -= turnSpeed * (float)y;
     }
 
-    lastX = x;
-    lastY = y;
-
     // Clamp camera tilt to prevent flipping
     m_phi = glm::clamp(m_phi, -70.0f, 70.0f);
 }
 
+glm::mat4 Camera::getLookAheadViewMatrix() const {
+    aie::Input* input = aie::Input::getInstance();
+    if (!input->isActionDown(CAMERA_LOOK))
+        return getViewMatrix();
+
+    double x, y;
+    input->getPendingMouseMotion(&x, &y);
+    return getViewMatrix(m_theta + turnSpeed * (float)x, glm::clamp(m_phi - turnSpeed * (float)y, -70.0f, 70.0f));
+}
+
+void Camera::interpolate(float alpha) {
+    m_position = glm::mix(m_previousPosition, m_simulatedPosition, alpha);
+}
+
+void Camera::setPose(const glm::vec3& position, const glm::vec3& target) {
+    m_position = m_previousPosition = m_simulatedPosition = position;
+
+    // Inverse of the forward vector in getViewMatrix
+    glm::vec3 forward = glm::normalize(target - position);
+    m_theta = glm::degrees(glm::atan(forward.z, forward.x));
+    m_phi = glm::clamp(glm::degrees(glm::asin(glm::clamp(forward.y, -1.0f, 1.0f))), -70.0f, 70.0f);
+}
 
@@ -3,29 +3,70 @@
 #include <glm/ext.hpp>
 #include "imgui_glfw3.h"
 #include "../dependencies/glfw/include/GLFW/glfw3.h"
+#include "Input.h"
+
+// Input actions the camera reads; applications number their own actions after these
+enum CameraAction : int {
+    CAMERA_MOVE_FORWARD,
+    CAMERA_MOVE_BACK,
+    CAMERA_MOVE_LEFT,
+    CAMERA_MOVE_RIGHT,
+    CAMERA_MOVE_UP,
+    CAMERA_MOVE_DOWN,
+    CAMERA_LOOK,        // Mouse look while held
+    CAMERA_ACTION_COUNT
+};
 
 class Camera {
 public:
-    Camera() : m_theta(-38), m_phi(-12), m_position(glm::vec3(-15, 8, 10)) {}
+    Camera() : m_theta(-38), m_phi(-12), m_position(glm::vec3(-15, 8, 10)),
+        m_previousPosition(m_position), m_simulatedPosition(m_position) {}
 
     // Returns the camera's view matrix
-    glm::mat4 getViewMatrix() const {
-        float thetaR = glm::radians(m_theta);
-        float phiR = glm::radians(m_phi);
-        glm::vec3 forward(cos(phiR) * cos(thetaR), sin(phiR), cos(phiR) * sin(thetaR));
-        return glm::lookAt(m_position, m_position + forward, glm::vec3(0, 1, 0));
-    }
+    glm::mat4 getViewMatrix() const { return getViewMatrix(m_theta, m_phi); }
+
+    // View matrix including mouse look the OS has reported since input was last processed,
+    // without applying it (look() applies it next frame)
+    glm::mat4 getLookAheadViewMatrix() const;
 
     // Returns projection matrix based on screen size
     glm::mat4 getProjectionMatrix(float width, float height) {
-        return glm::perspective(glm::pi<float>() * 0.25f, width / height, 0.1f, 1000.f);
+        return glm::perspective(getFieldOfView(), width / height, getNear(), getFar());
     }
 
-    void update(float deltaTime, GLFWwindow* window);
+    // Projection parameters (vertical field of view in radians, clip planes)
+    float getFieldOfView() const { return glm::pi<float>() * 0.25f; }
+    float getNear() const { return 0.1f; }
+    float getFar() const { return 1000.f; }
+
+    // WASD to move, Z/X for up/down, right mouse button to look
+    static void bindDefaultActions();
+
+    // Variable timestep: movement and mouse look in one call
+    void update(float deltaTime);
+
+    // Fixed timestep: move() integrates one tick of movement, look() applies the frame's
+    // mouse motion once per frame, and interpolate() places the rendered camera between the last two ticks
+    void move(float timeStep);
+    void look();
+    void interpolate(float alpha);
+
+    // Places the camera at position looking at target, for scripted cameras
+    void setPose(const glm::vec3& position, const glm::vec3& target);
+
     glm::vec3 getPosition() const { return m_position; }
 private:
+    glm::mat4 getViewMatrix(float theta, float phi) const {
+        float thetaR = glm::radians(theta);
+        float phiR = glm::radians(phi);
+        glm::vec3 forward(cos(phiR) * cos(thetaR), sin(phiR), cos(phiR) * sin(thetaR));
+        return glm::lookAt(m_position, m_position + forward, glm::vec3(0, 1, 0));
+    }
+
     float m_theta; // Camera rotation (horizontal)
     float m_phi; // Camera tilt (vertical)
-    glm::vec3 m_position; // Camera world position
+    glm::vec3 m_position; // Camera world position, as rendered
+    glm::vec3 m_previousPosition; // Position at the tick before the latest one
+    glm::vec3 m_simulatedPosition; // Position at the latest tick
 };
 
@@ -0,0 +1,98 @@
+#include "CameraPath.h"
+#include "Gizmos.h"
+#include <cmath>
+
+// Same basis as Gizmos::addHermiteSpline
+static glm::vec3 hermite(const glm::vec3& start, const glm::vec3& end,
+    const glm::vec3& tangentStart, const glm::vec3& tangentEnd, float s) {
+    float s2 = s * s;
+    float s3 = s2 * s;
+    float h1 = (2.0f * s3) - (3.0f * s2) + 1.0f;
+    float h2 = (-2.0f * s3) + (3.0f * s2);
+    float h3 = s3 - (2.0f * s2) + s;
+    float h4 = s3 - s2;
+    return (start * h1) + (end * h2) + (tangentStart * h3) + (tangentEnd * h4);
+}
+
+void CameraPath::addKey(float time, const glm::vec3& position, const glm::vec3& target) {
+    Key key = { time, position, target };
+    m_keys.push_back(key);
+}
+
+unsigned int CameraPath::getSegmentCount() const {
+    if (m_keys.size() < 2)
+        return 0;
+    return (unsigned int)m_keys.size() - (m_looping ? 0 : 1);
+}
+
+float CameraPath::getDuration() const {
+    if (m_keys.empty())
+        return 0.0f;
+    return m_keys.back().time - m_keys.front().time + (m_looping ? m_loopDuration : 0.0f);
+}
+
+void CameraPath::getSegment(unsigned int i, const Key*& start, const Key*& end,
+    glm::vec3& positionTangentStart, glm::vec3& positionTangentEnd,
+    glm::vec3& targetTangentStart, glm::vec3& targetTangentEnd) const {
+    unsigned int count = (unsigned int)m_keys.size();
+
+    // Neighbours wrap on a looping path and repeat the end key otherwise
+    unsigned int before = i > 0 ? i - 1 : (m_looping ? count - 1 : 0);
+    unsigned int next = (i + 1) % count;
+    unsigned int after = next + 1 < count ? next + 1 : (m_looping ? (next + 1) % count : next);
+
+    start = &m_keys[i];
+    end = &m_keys[next];
+    positionTangentStart = (end->position - m_keys[before].position) * 0.5f;
+    positionTangentEnd = (m_keys[after].position - start->position) * 0.5f;
+    targetTangentStart = (end->target - m_keys[before].target) * 0.5f;
+    targetTangentEnd = (m_keys[after].target - start->target) * 0.5f;
+}
+
+void CameraPath::evaluate(float time, glm::vec3& position, glm::vec3& target) const {
+    if (m_keys.empty())
+        return;
+    if (m_keys.size() == 1) {
+        position = m_keys[0].position;
+        target = m_keys[0].target;
+        return;
+    }
+
+    float duration = getDuration();
+    float t = time;
+    if (m_looping && duration > 0.0f) {
+        t = std::fmod(t, duration);
+        if (t < 0.0f)
+            t += duration;
+    }
+    t = glm::clamp(t + m_keys.front().time, m_keys.front().time, m_keys.front().time + duration);
+
+    // Find the segment the time falls in; paths are short, so a linear search will do
+    unsigned int segmentCount = getSegmentCount();
+    unsigned int i = 0;
+    while (i + 1 < segmentCount && t >= m_keys[i + 1].time)
+        i++;
+
+    const Key* start;
+    const Key* end;
+    glm::vec3 positionTangentStart, positionTangentEnd, targetTangentStart, targetTangentEnd;
+    getSegment(i, start, end, positionTangentStart, positionTangentEnd, targetTangentStart, targetTangentEnd);
+
+    float startTime = start->time;
+    float endTime = i + 1 < (unsigned int)m_keys.size() ? end->time : start->time + m_loopDuration;
+    float s = endTime > startTime ? glm::clamp((t - startTime) / (endTime - startTime), 0.0f, 1.0f) : 1.0f;
+
+    position = hermite(start->position, end->position, positionTangentStart, positionTangentEnd, s);
+    target = hermite(start->target, end->target, targetTangentStart, targetTangentEnd, s);
+}
+
+void CameraPath::draw(const glm::vec4& colour, unsigned int segments) const {
+    unsigned int segmentCount = getSegmentCount();
+    for (unsigned int i = 0; i < segmentCount; i++) {
+        const Key* start;
+        const Key* end;
+        glm::vec3 positionTangentStart, positionTangentEnd, targetTangentStart, targetTangentEnd;
+        getSegment(i, start, end, positionTangentStart, positionTangentEnd, targetTangentStart, targetTangentEnd);
+        aie::Gizmos::addHermiteSpline(start->position, end->position, positionTangentStart, positionTangentEnd, segments, colour);
+    }
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+// Authored camera flythrough
+// Keys give a camera position and the point it looks at, at a time in seconds. Between
+// keys both follow cubic Hermite curves evaluated with the same basis as
+// Gizmos::addHermiteSpline, so draw() traces exactly the path the camera takes. Tangents
+// are Catmull-Rom (half the vector between the neighbouring keys), so the path passes
+// smoothly through every key. The camera is a pure function of time, so the same
+// sequence of times always gives the same camera.
+class CameraPath {
+public:
+
+    CameraPath() : m_looping(false), m_loopDuration(0.0f) {}
+
+    void clear() { m_keys.clear(); }
+
+    // Keys must be added in increasing time order
+    void addKey(float time, const glm::vec3& position, const glm::vec3& target);
+
+    // A looping path returns from the last key to the first over loopDuration seconds
+    void setLooping(bool looping, float loopDuration = 0.0f) { m_looping = looping; m_loopDuration = loopDuration; }
+    bool isLooping() const { return m_looping; }
+
+    unsigned int getKeyCount() const { return (unsigned int)m_keys.size(); }
+
+    // Time from the first key to the end of the path, including the loop back if looping
+    float getDuration() const;
+
+    // Camera at time, which wraps on a looping path and is clamped otherwise
+    void evaluate(float time, glm::vec3& position, glm::vec3& target) const;
+
+    // Adds the position curve to the Gizmos
+    void draw(const glm::vec4& colour, unsigned int segments = 16) const;
+
+protected:
+
+    struct Key {
+        float time;
+        glm::vec3 position;
+        glm::vec3 target;
+    };
+
+    // Segment from key i to the next, with Catmull-Rom tangents for its unit parameter
+    void getSegment(unsigned int i, const Key*& start, const Key*& end,
+        glm::vec3& positionTangentStart, glm::vec3& positionTangentEnd,
+        glm::vec3& targetTangentStart, glm::vec3& targetTangentEnd) const;
+
+    unsigned int getSegmentCount() const;
+
+    std::vector<Key> m_keys;
+    bool m_looping;
+    float m_loopDuration;
+};
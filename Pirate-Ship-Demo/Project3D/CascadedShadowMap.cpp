@@ -0,0 +1,173 @@
+#include "CascadedShadowMap.h"
+#include "glad.h"
+#include <glm/ext.hpp>
+#include <cmath>
+#include <cstdio>
+
+CascadedShadowMap::CascadedShadowMap(unsigned int resolution, unsigned int firstCachedCascade)
+    : m_resolution(resolution),
+    m_firstCachedCascade(firstCachedCascade),
+    m_texture(0),
+    m_fbo(0),
+    m_shadowDistance(150.0f),
+    m_splitLambda(0.75f),
+    m_texelSizes(0),
+    m_cascadeRadii{},
+    m_lightDirection(0),
+    m_invalid(true),
+    m_renderedCascades(0) {
+}
+
+CascadedShadowMap::~CascadedShadowMap() {
+    if (m_fbo) glDeleteFramebuffers(1, &m_fbo);
+    if (m_texture) glDeleteTextures(1, &m_texture);
+}
+
+bool CascadedShadowMap::initialise() {
+    glGenTextures(1, &m_texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_DEPTH_COMPONENT32F, m_resolution, m_resolution, CASCADE_COUNT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+    const float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f }; // Lit outside the map
+    glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, border);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Layered attachment so the geometry shader can route triangles with gl_Layer
+    glGenFramebuffers(1, &m_fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_texture, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        printf("Shadow map framebuffer incomplete (0x%x)\n", status);
+        return false;
+    }
+    return true;
+}
+
+unsigned int CascadedShadowMap::update(const glm::mat4& view, float fieldOfView, float aspect, float nearPlane,
+    const glm::vec3& lightDirection) {
+    if (glm::length(lightDirection) < 1e-6f)
+        return 0;
+
+    glm::vec3 direction = glm::normalize(lightDirection);
+    bool lightMoved = glm::dot(direction, m_lightDirection) < 0.99999f;
+    if (lightMoved || m_invalid) {
+        m_lightDirection = direction;
+        m_invalid = false;
+        for (auto& radius : m_cascadeRadii)
+            radius = 0; // Forces a refit
+    }
+
+    glm::mat4 inverseView = glm::inverse(view);
+    float tanHalfFovY = std::tan(fieldOfView * 0.5f);
+    float tanHalfFovX = tanHalfFovY * aspect;
+
+    unsigned int mask = 0;
+    float splitNear = nearPlane;
+    for (unsigned int i = 0; i < CASCADE_COUNT; i++) {
+        // Practical split scheme: blend of logarithmic and uniform distribution
+        float t = (float)(i + 1) / CASCADE_COUNT;
+        float logSplit = nearPlane * std::pow(m_shadowDistance / nearPlane, t);
+        float uniformSplit = nearPlane + (m_shadowDistance - nearPlane) * t;
+        float splitFar = glm::mix(uniformSplit, logSplit, m_splitLambda);
+
+        // Bounding sphere of the slice; its centre lies on the view axis, equidistant from the near and far corners
+        float diagonalSlopeSq = (tanHalfFovX * tanHalfFovX + tanHalfFovY * tanHalfFovY);
+        float nearRadiusSq = splitNear * splitNear * diagonalSlopeSq;
+        float farRadiusSq = splitFar * splitFar * diagonalSlopeSq;
+        float centreDepth = glm::clamp((splitNear + splitFar) * 0.5f + (farRadiusSq - nearRadiusSq) / (2.0f * (splitFar - splitNear)),
+            splitNear, splitFar);
+        float radius = std::sqrt(std::max(
+            (splitFar - centreDepth) * (splitFar - centreDepth) + farRadiusSq,
+            (centreDepth - splitNear) * (centreDepth - splitNear) + nearRadiusSq));
+        glm::vec3 centre = glm::vec3(inverseView * glm::vec4(0, 0, -centreDepth, 1));
+
+        // Rounding the radius keeps the projection size identical frame to frame
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        if (i >= m_firstCachedCascade) {
+            // Cached cascades cover extra margin and keep their fit while the slice stays inside it
+            float cachedRadius = std::ceil(radius * 1.5f);
+            bool contained = m_cascadeRadii[i] == cachedRadius &&
+                glm::distance(centre, m_cascadeCentres[i]) + radius <= cachedRadius;
+            if (!contained) {
+                fitCascade(i, centre, cachedRadius);
+                mask |= 1 << i;
+            }
+        }
+        else {
+            fitCascade(i, centre, radius);
+            mask |= 1 << i;
+        }
+
+        splitNear = splitFar;
+    }
+
+    m_renderedCascades = 0;
+    for (unsigned int i = 0; i < CASCADE_COUNT; i++)
+        m_renderedCascades += (mask >> i) & 1;
+    return mask;
+}
+
+void CascadedShadowMap::fitCascade(unsigned int cascade, const glm::vec3& centre, float radius) {
+    m_cascadeCentres[cascade] = centre;
+    m_cascadeRadii[cascade] = radius;
+
+    glm::vec3 up = std::abs(m_lightDirection.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+    glm::mat4 lightView = glm::lookAt(centre - m_lightDirection * radius, centre, up);
+
+    // Casters in front of the near plane are clamped onto it (GL_DEPTH_CLAMP) rather than clipped
+    glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, radius * 2.0f);
+
+    // Snap the projection so world space maps to whole texels
+    glm::mat4 lightMatrix = lightProjection * lightView;
+    glm::vec4 origin = lightMatrix * glm::vec4(0, 0, 0, 1) * (m_resolution * 0.5f);
+    glm::vec4 offset = (glm::round(origin) - origin) * (2.0f / m_resolution);
+    lightProjection[3][0] += offset.x;
+    lightProjection[3][1] += offset.y;
+
+    m_lightMatrices[cascade] = lightProjection * lightView;
+    m_shadowMatrices[cascade] = glm::translate(glm::mat4(1), glm::vec3(0.5f)) *
+        glm::scale(glm::mat4(1), glm::vec3(0.5f)) * m_lightMatrices[cascade];
+    m_texelSizes[cascade] = radius * 2.0f / m_resolution;
+}
+
+void CascadedShadowMap::beginRender(unsigned int cascadeMask) {
+    glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+    glViewport(0, 0, m_resolution, m_resolution);
+
+    // Clearing a layered attachment clears every layer, so clear the dirty ones individually
+    for (unsigned int i = 0; i < CASCADE_COUNT; i++) {
+        if ((cascadeMask & (1 << i)) == 0)
+            continue;
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_texture, 0, i);
+        glClear(GL_DEPTH_BUFFER_BIT);
+    }
+    glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_texture, 0);
+
+    glEnable(GL_DEPTH_CLAMP);
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+}
+
+void CascadedShadowMap::endRender(unsigned int viewportWidth, unsigned int viewportHeight) {
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glDisable(GL_DEPTH_CLAMP);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, viewportWidth, viewportHeight);
+}
+
+void CascadedShadowMap::bindTexture(unsigned int unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_texture);
+    glActiveTexture(GL_TEXTURE0);
+}
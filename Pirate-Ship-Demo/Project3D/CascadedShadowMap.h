@@ -0,0 +1,88 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// Cascaded shadow maps for a directional light
+// The camera frustum (up to the shadow distance) is split into cascades, each fitted
+// with a bounding sphere so its size never changes as the camera turns, and snapped
+// to whole shadow map texels so edges do not shimmer as it moves. All cascades live
+// in one depth texture array and are rendered in a single layered pass.
+//
+// Cascades from firstCachedCascade onwards are fitted with extra margin and only
+// re-rendered when the camera leaves that margin, the light turns or invalidate()
+// is called because a shadow caster moved.
+class CascadedShadowMap {
+public:
+
+    static const unsigned int CASCADE_COUNT = 4;
+
+    CascadedShadowMap(unsigned int resolution = 2048, unsigned int firstCachedCascade = 2);
+    ~CascadedShadowMap();
+
+    // Creates the depth texture array and framebuffer
+    bool initialise();
+
+    // Fits the cascades to the camera and light
+    // Returns a bit mask of the cascades that must be re-rendered this frame
+    unsigned int update(const glm::mat4& view, float fieldOfView, float aspect, float nearPlane,
+        const glm::vec3& lightDirection);
+
+    // Forces every cascade to re-render, e.g. when a shadow caster moves
+    void invalidate() { m_invalid = true; }
+
+    // Binds the layered framebuffer and clears the cascades in the mask
+    void beginRender(unsigned int cascadeMask);
+
+    // Restores the default framebuffer and viewport
+    void endRender(unsigned int viewportWidth, unsigned int viewportHeight);
+
+    // Binds the shadow map (with depth comparison) to a texture unit
+    void bindTexture(unsigned int unit) const;
+
+    // Light space projection-view for rendering each cascade
+    const glm::mat4* getLightMatrices() const { return m_lightMatrices; }
+
+    // Light matrices with the [-1, 1] -> [0, 1] bias applied, for shadow lookups
+    const glm::mat4* getShadowMatrices() const { return m_shadowMatrices; }
+
+    // Size of one shadow map texel in world units, per cascade (used for normal offset bias)
+    glm::vec4 getTexelSizes() const { return m_texelSizes; }
+
+    void setShadowDistance(float distance) { m_shadowDistance = distance; }
+    float getShadowDistance() const { return m_shadowDistance; }
+
+    // Blend between uniform (0) and logarithmic (1) split distances
+    void setSplitLambda(float lambda) { m_splitLambda = lambda; }
+    float getSplitLambda() const { return m_splitLambda; }
+
+    unsigned int getResolution() const { return m_resolution; }
+    unsigned int getTexture() const { return m_texture; }   // Depth array, one layer per cascade
+
+    // Number of cascades rendered in the last update
+    unsigned int getRenderedCascadeCount() const { return m_renderedCascades; }
+
+protected:
+
+    // Builds the light matrices for a bounding sphere, snapped to the texel grid
+    void fitCascade(unsigned int cascade, const glm::vec3& centre, float radius);
+
+    unsigned int m_resolution;
+    unsigned int m_firstCachedCascade;
+
+    unsigned int m_texture;
+    unsigned int m_fbo;
+
+    float m_shadowDistance;
+    float m_splitLambda;
+
+    glm::mat4 m_lightMatrices[CASCADE_COUNT];
+    glm::mat4 m_shadowMatrices[CASCADE_COUNT];
+    glm::vec4 m_texelSizes;
+
+    // Sphere each cascade was last fitted to
+    glm::vec3 m_cascadeCentres[CASCADE_COUNT];
+    float m_cascadeRadii[CASCADE_COUNT];
+
+    glm::vec3 m_lightDirection;
+    bool m_invalid;
+    unsigned int m_renderedCascades;
+};
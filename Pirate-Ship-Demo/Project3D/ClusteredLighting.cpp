@@ -0,0 +1,289 @@
+#include "ClusteredLighting.h"
+#include "glad.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <emmintrin.h>
+
+ClusteredLighting::ClusteredLighting(unsigned int tilesX, unsigned int tilesY, unsigned int slices, unsigned int threadCount)
+    : m_tilesX(tilesX),
+    m_tilesY(tilesY),
+    m_slices(slices),
+    m_threadCount(threadCount),
+    m_projectionKey(0),
+    m_sliceScale(0),
+    m_sliceBias(0),
+    m_nearPlane(0),
+    m_farPlane(0),
+    m_tanHalfFovX(0),
+    m_tanHalfFovY(0),
+    m_lightBuffer(0),
+    m_clusterBuffer(0),
+    m_indexBuffer(0),
+    m_visibleLights(0),
+    m_binningTime(0) {
+
+    if (m_threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        m_threadCount = std::clamp(hardwareThreads > 1 ? hardwareThreads - 1 : 1u, 1u, 4u);
+    }
+
+    unsigned int clusterCount = m_tilesX * m_tilesY * m_slices;
+    m_clusterCounts.resize(clusterCount);
+    m_clusterScratch.resize((size_t)clusterCount * MAX_LIGHTS_PER_CLUSTER);
+    m_clusters.resize(clusterCount);
+}
+
+ClusteredLighting::~ClusteredLighting() {
+    if (m_lightBuffer) glDeleteBuffers(1, &m_lightBuffer);
+    if (m_clusterBuffer) glDeleteBuffers(1, &m_clusterBuffer);
+    if (m_indexBuffer) glDeleteBuffers(1, &m_indexBuffer);
+}
+
+void ClusteredLighting::initialise() {
+    glGenBuffers(1, &m_lightBuffer);
+    glGenBuffers(1, &m_clusterBuffer);
+    glGenBuffers(1, &m_indexBuffer);
+}
+
+unsigned int ClusteredLighting::addLight(const Light& light) {
+    m_lights.push_back(light);
+    return (unsigned int)m_lights.size() - 1;
+}
+
+void ClusteredLighting::removeLight(unsigned int index) {
+    if (index < m_lights.size())
+        m_lights.erase(m_lights.begin() + index);
+}
+
+void ClusteredLighting::clearLights() {
+    m_lights.clear();
+}
+
+void ClusteredLighting::updateClusterBounds(float fieldOfView, float aspect, float nearPlane, float farPlane) {
+    glm::vec4 key(fieldOfView, aspect, nearPlane, farPlane);
+    if (key == m_projectionKey)
+        return;
+    m_projectionKey = key;
+
+    m_nearPlane = nearPlane;
+    m_farPlane = farPlane;
+    m_tanHalfFovY = std::tan(fieldOfView * 0.5f);
+    m_tanHalfFovX = m_tanHalfFovY * aspect;
+
+    float logRatio = std::log(farPlane / nearPlane);
+    m_sliceScale = m_slices / logRatio;
+    m_sliceBias = -(float)m_slices * std::log(nearPlane) / logRatio;
+
+    // Padded by 3 so the last tiles of a row can be loaded four at a time
+    size_t count = (size_t)m_tilesX * m_tilesY * m_slices + 3;
+    m_boundsMinX.assign(count, FLT_MAX); m_boundsMinY.assign(count, FLT_MAX); m_boundsMinZ.assign(count, FLT_MAX);
+    m_boundsMaxX.assign(count, -FLT_MAX); m_boundsMaxY.assign(count, -FLT_MAX); m_boundsMaxZ.assign(count, -FLT_MAX);
+
+    for (unsigned int z = 0; z < m_slices; z++) {
+        float sliceNear = nearPlane * std::pow(farPlane / nearPlane, (float)z / m_slices);
+        float sliceFar = nearPlane * std::pow(farPlane / nearPlane, (float)(z + 1) / m_slices);
+
+        for (unsigned int y = 0; y < m_tilesY; y++) {
+            float ndcY0 = -1.0f + 2.0f * y / m_tilesY;
+            float ndcY1 = -1.0f + 2.0f * (y + 1) / m_tilesY;
+
+            for (unsigned int x = 0; x < m_tilesX; x++) {
+                float ndcX0 = -1.0f + 2.0f * x / m_tilesX;
+                float ndcX1 = -1.0f + 2.0f * (x + 1) / m_tilesX;
+
+                // The froxel's corners at its near and far depth bound it in view space
+                float xs[4] = { ndcX0 * sliceNear * m_tanHalfFovX, ndcX1 * sliceNear * m_tanHalfFovX,
+                    ndcX0 * sliceFar * m_tanHalfFovX, ndcX1 * sliceFar * m_tanHalfFovX };
+                float ys[4] = { ndcY0 * sliceNear * m_tanHalfFovY, ndcY1 * sliceNear * m_tanHalfFovY,
+                    ndcY0 * sliceFar * m_tanHalfFovY, ndcY1 * sliceFar * m_tanHalfFovY };
+
+                size_t index = ((size_t)z * m_tilesY + y) * m_tilesX + x;
+                m_boundsMinX[index] = *std::min_element(xs, xs + 4);
+                m_boundsMaxX[index] = *std::max_element(xs, xs + 4);
+                m_boundsMinY[index] = *std::min_element(ys, ys + 4);
+                m_boundsMaxY[index] = *std::max_element(ys, ys + 4);
+                m_boundsMinZ[index] = -sliceFar;
+                m_boundsMaxZ[index] = -sliceNear;
+            }
+        }
+    }
+}
+
+void ClusteredLighting::build(const glm::mat4& view, float fieldOfView, float aspect, float nearPlane, float farPlane) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    updateClusterBounds(fieldOfView, aspect, nearPlane, farPlane);
+
+    // Transform lights to view space and find the range of clusters each may touch
+    m_viewLights.clear();
+    m_viewLightSource.clear();
+    for (unsigned int i = 0; i < m_lights.size(); i++) {
+        const Light& light = m_lights[i];
+        glm::vec3 centre = glm::vec3(view * glm::vec4(light.position, 1.0f));
+        float depth = -centre.z;
+        float nearDepth = depth - light.range;
+        float farDepth = depth + light.range;
+        if (farDepth < m_nearPlane || nearDepth > m_farPlane)
+            continue;
+
+        ViewLight viewLight;
+        viewLight.centre = centre;
+        viewLight.radius = light.range;
+
+        auto slice = [this](float d) {
+            if (d <= m_nearPlane) return 0;
+            return std::clamp((int)std::floor(std::log(d) * m_sliceScale + m_sliceBias), 0, (int)m_slices - 1);
+        };
+        viewLight.sliceBegin = slice(nearDepth);
+        viewLight.sliceEnd = slice(farDepth);
+
+        if (nearDepth <= m_nearPlane) {
+            // Surrounds the camera, so it may cover any tile
+            viewLight.tileXBegin = 0; viewLight.tileXEnd = (int)m_tilesX - 1;
+            viewLight.tileYBegin = 0; viewLight.tileYEnd = (int)m_tilesY - 1;
+        }
+        else {
+            // Projected extents of the sphere's bounding box; for a fixed view-space
+            // coordinate the NDC is monotonic in depth, so the extremes are at either depth
+            float ndcX[4] = { (centre.x - light.range) / (nearDepth * m_tanHalfFovX), (centre.x - light.range) / (farDepth * m_tanHalfFovX),
+                (centre.x + light.range) / (nearDepth * m_tanHalfFovX), (centre.x + light.range) / (farDepth * m_tanHalfFovX) };
+            float ndcY[4] = { (centre.y - light.range) / (nearDepth * m_tanHalfFovY), (centre.y - light.range) / (farDepth * m_tanHalfFovY),
+                (centre.y + light.range) / (nearDepth * m_tanHalfFovY), (centre.y + light.range) / (farDepth * m_tanHalfFovY) };
+            float minX = *std::min_element(ndcX, ndcX + 4), maxX = *std::max_element(ndcX, ndcX + 4);
+            float minY = *std::min_element(ndcY, ndcY + 4), maxY = *std::max_element(ndcY, ndcY + 4);
+            if (maxX < -1 || minX > 1 || maxY < -1 || minY > 1)
+                continue;
+
+            viewLight.tileXBegin = std::clamp((int)std::floor((minX + 1.0f) * 0.5f * m_tilesX), 0, (int)m_tilesX - 1);
+            viewLight.tileXEnd = std::clamp((int)std::floor((maxX + 1.0f) * 0.5f * m_tilesX), 0, (int)m_tilesX - 1);
+            viewLight.tileYBegin = std::clamp((int)std::floor((minY + 1.0f) * 0.5f * m_tilesY), 0, (int)m_tilesY - 1);
+            viewLight.tileYEnd = std::clamp((int)std::floor((maxY + 1.0f) * 0.5f * m_tilesY), 0, (int)m_tilesY - 1);
+        }
+
+        m_viewLights.push_back(viewLight);
+        m_viewLightSource.push_back(i);
+    }
+    m_visibleLights = (unsigned int)m_viewLights.size();
+
+    // Bin in parallel; each thread owns a range of depth slices so no clusters are shared
+    unsigned int threadCount = std::min(m_threadCount, m_slices);
+    unsigned int slicesPerThread = (m_slices + threadCount - 1) / threadCount;
+    auto work = [this, slicesPerThread](unsigned int index) {
+        unsigned int sliceBegin = index * slicesPerThread;
+        unsigned int sliceEnd = std::min(sliceBegin + slicesPerThread, m_slices);
+        if (sliceBegin < sliceEnd)
+            binSlices(sliceBegin, sliceEnd);
+    };
+
+    aie::JobSystem::getInstance()->parallelFor(threadCount, [&work](unsigned int first, unsigned int last) {
+        for (unsigned int i = first; i < last; i++)
+            work(i);
+    }, 1);
+
+    // Compact the per-cluster lists into one index list
+    m_indices.clear();
+    for (size_t cluster = 0; cluster < m_clusters.size(); cluster++) {
+        unsigned int count = m_clusterCounts[cluster];
+        m_clusters[cluster] = glm::uvec2((unsigned int)m_indices.size(), count);
+        const unsigned int* list = &m_clusterScratch[cluster * MAX_LIGHTS_PER_CLUSTER];
+        m_indices.insert(m_indices.end(), list, list + count);
+    }
+
+    // Only visible lights are uploaded; index lists refer to this compacted list
+    m_gpuLights.resize(m_viewLights.size());
+    for (size_t i = 0; i < m_viewLights.size(); i++) {
+        const Light& light = m_lights[m_viewLightSource[i]];
+        GpuLight& gpuLight = m_gpuLights[i];
+        gpuLight.positionRange = glm::vec4(light.position, light.range);
+        gpuLight.colourType = glm::vec4(light.colour, (float)light.type);
+        gpuLight.directionCos = glm::vec4(glm::normalize(light.direction), std::cos(light.outerAngle));
+        gpuLight.spotParams = glm::vec4(std::cos(light.innerAngle), 0, 0, 0);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_binningTime = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void ClusteredLighting::binSlices(unsigned int sliceBegin, unsigned int sliceEnd) {
+    size_t first = (size_t)sliceBegin * m_tilesX * m_tilesY;
+    size_t last = (size_t)sliceEnd * m_tilesX * m_tilesY;
+    std::fill(m_clusterCounts.begin() + first, m_clusterCounts.begin() + last, 0u);
+
+    const __m128 zero = _mm_setzero_ps();
+    const __m128i laneIndex = _mm_setr_epi32(0, 1, 2, 3);
+
+    for (unsigned int l = 0; l < m_viewLights.size(); l++) {
+        const ViewLight& light = m_viewLights[l];
+        int zBegin = std::max(light.sliceBegin, (int)sliceBegin);
+        int zEnd = std::min(light.sliceEnd, (int)sliceEnd - 1);
+        if (zBegin > zEnd)
+            continue;
+
+        const __m128 cx = _mm_set1_ps(light.centre.x);
+        const __m128 cy = _mm_set1_ps(light.centre.y);
+        const __m128 cz = _mm_set1_ps(light.centre.z);
+        const __m128 radiusSq = _mm_set1_ps(light.radius * light.radius);
+
+        for (int z = zBegin; z <= zEnd; z++) {
+            for (int y = light.tileYBegin; y <= light.tileYEnd; y++) {
+                size_t row = ((size_t)z * m_tilesY + y) * m_tilesX;
+
+                // Sphere vs froxel box, four tiles along x at a time
+                for (int x = light.tileXBegin; x <= light.tileXEnd; x += 4) {
+                    size_t index = row + x;
+                    __m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_boundsMinX[index]), cx),
+                        _mm_sub_ps(cx, _mm_loadu_ps(&m_boundsMaxX[index]))), zero);
+                    __m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_boundsMinY[index]), cy),
+                        _mm_sub_ps(cy, _mm_loadu_ps(&m_boundsMaxY[index]))), zero);
+                    __m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&m_boundsMinZ[index]), cz),
+                        _mm_sub_ps(cz, _mm_loadu_ps(&m_boundsMaxZ[index]))), zero);
+                    __m128 distanceSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+                    // Mask off lanes past the light's last tile
+                    __m128i inRange = _mm_cmplt_epi32(laneIndex, _mm_set1_epi32(light.tileXEnd - x + 1));
+                    int mask = _mm_movemask_ps(_mm_and_ps(_mm_cmple_ps(distanceSq, radiusSq), _mm_castsi128_ps(inRange)));
+
+                    while (mask != 0) {
+                        int lane = 0;
+                        while ((mask & (1 << lane)) == 0)
+                            lane++;
+                        mask &= ~(1 << lane);
+
+                        size_t cluster = index + lane;
+                        unsigned int& count = m_clusterCounts[cluster];
+                        if (count < MAX_LIGHTS_PER_CLUSTER)
+                            m_clusterScratch[cluster * MAX_LIGHTS_PER_CLUSTER + count++] = l;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void ClusteredLighting::update(const glm::mat4& view, float fieldOfView, float aspect, float nearPlane, float farPlane) {
+    build(view, fieldOfView, aspect, nearPlane, farPlane);
+
+    // Orphan and refill each buffer; never upload zero bytes so the bindings stay valid
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_lightBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(m_gpuLights.size(), 1) * sizeof(GpuLight), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_gpuLights.size() * sizeof(GpuLight), m_gpuLights.data());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_clusterBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, m_clusters.size() * sizeof(glm::uvec2), m_clusters.data(), GL_STREAM_DRAW);
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_indexBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, std::max<size_t>(m_indices.size(), 1) * sizeof(unsigned int), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, m_indices.size() * sizeof(unsigned int), m_indices.data());
+
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void ClusteredLighting::bind() const {
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BINDING, m_lightBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CLUSTER_BINDING, m_clusterBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, INDEX_BINDING, m_indexBuffer);
+}
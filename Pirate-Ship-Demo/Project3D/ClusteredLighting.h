@@ -0,0 +1,136 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+// Clustered forward lighting
+// The view frustum is split into a 3D grid of froxels (screen tiles x exponential
+// depth slices). Each frame every light is binned into the clusters its range
+// touches, and the light list plus per-cluster index lists are uploaded in SSBOs,
+// so the fragment shader only loops over the lights affecting its own cluster.
+class ClusteredLighting {
+public:
+
+    enum LightType : int {
+        POINT_LIGHT,
+        SPOT_LIGHT
+    };
+
+    // A local (point or spot) light in world space
+    struct Light {
+        glm::vec3 position = glm::vec3(0);
+        float     range = 5.0f;                        // Distance at which the light reaches zero
+        glm::vec3 colour = glm::vec3(1);               // Pre-multiplied by intensity
+        LightType type = POINT_LIGHT;
+        glm::vec3 direction = glm::vec3(0, -1, 0);     // Spot lights only
+        float     innerAngle = glm::radians(20.0f);    // Spot cone (radians), full intensity inside
+        float     outerAngle = glm::radians(30.0f);    // Spot cone (radians), zero outside
+    };
+
+    // GPU layout of a light (std430, see phong_clustered.frag)
+    struct GpuLight {
+        glm::vec4 positionRange;    // xyz = position, w = range
+        glm::vec4 colourType;       // rgb = colour, w = type
+        glm::vec4 directionCos;     // xyz = direction, w = cos(outer angle)
+        glm::vec4 spotParams;       // x = cos(inner angle)
+    };
+
+    // SSBO binding points used by the clustered shaders
+    static const unsigned int LIGHT_BINDING = 1;
+    static const unsigned int CLUSTER_BINDING = 2;
+    static const unsigned int INDEX_BINDING = 3;
+
+    static const unsigned int MAX_LIGHTS_PER_CLUSTER = 128;
+
+    // The work is split into up to threadCount parallel jobs
+    // A thread count of 0 picks one based on the available hardware threads
+    ClusteredLighting(unsigned int tilesX = 16, unsigned int tilesY = 9, unsigned int slices = 24, unsigned int threadCount = 0);
+    ~ClusteredLighting();
+
+    // Creates the SSBOs
+    void initialise();
+
+    // Light list management; removing a light shifts the indices of the lights after it
+    unsigned int addLight(const Light& light);
+    void removeLight(unsigned int index);
+    void clearLights();
+    Light& getLight(unsigned int index) { return m_lights[index]; }
+    unsigned int getLightCount() const { return (unsigned int)m_lights.size(); }
+
+    // Bins all lights against the camera and uploads the result
+    // Projection parameters must match the projection used to draw
+    void update(const glm::mat4& view, float fieldOfView, float aspect, float nearPlane, float farPlane);
+
+    // Binds the SSBOs for the clustered shaders
+    void bind() const;
+
+    // Grid dimensions and depth slicing constants for the shader:
+    // slice = floor(log(viewDepth) * scale + bias)
+    glm::ivec3 getGridSize() const { return glm::ivec3(m_tilesX, m_tilesY, m_slices); }
+    float getSliceScale() const { return m_sliceScale; }
+    float getSliceBias() const { return m_sliceBias; }
+
+    // Statistics for the last update
+    unsigned int getVisibleLightCount() const { return m_visibleLights; }
+    unsigned int getIndexCount() const { return (unsigned int)m_indices.size(); }
+    float getBinningTime() const { return m_binningTime; } // milliseconds
+
+    // Builds the light / index lists on the CPU only (no GL), used by update()
+    void build(const glm::mat4& view, float fieldOfView, float aspect, float nearPlane, float farPlane);
+
+    // CPU results of the last build, for inspection / testing
+    const std::vector<glm::uvec2>& getClusters() const { return m_clusters; }  // x = offset, y = count
+    const std::vector<unsigned int>& getIndices() const { return m_indices; }
+
+protected:
+
+    // A light in view space, ready for binning
+    struct ViewLight {
+        glm::vec3 centre;   // View space
+        float     radius;
+        int       sliceBegin, sliceEnd;     // Inclusive ranges of clusters the sphere may touch
+        int       tileXBegin, tileXEnd;
+        int       tileYBegin, tileYEnd;
+    };
+
+    // Rebuilds the view space cluster bounds when the projection changes
+    void updateClusterBounds(float fieldOfView, float aspect, float nearPlane, float farPlane);
+
+    // Bins the view lights into the slices [sliceBegin, sliceEnd)
+    void binSlices(unsigned int sliceBegin, unsigned int sliceEnd);
+
+    unsigned int m_tilesX, m_tilesY, m_slices;
+    unsigned int m_threadCount;
+
+    std::vector<Light> m_lights;
+
+    // Cluster bounds in view space, structure-of-arrays (x fastest, then y, then slice)
+    std::vector<float> m_boundsMinX, m_boundsMinY, m_boundsMinZ;
+    std::vector<float> m_boundsMaxX, m_boundsMaxY, m_boundsMaxZ;
+    glm::vec4 m_projectionKey;  // Parameters the bounds were built for
+
+    float m_sliceScale;
+    float m_sliceBias;
+    float m_nearPlane;
+    float m_farPlane;
+    float m_tanHalfFovX;
+    float m_tanHalfFovY;
+
+    std::vector<ViewLight> m_viewLights;
+    std::vector<unsigned int> m_viewLightSource; // Index into m_lights of each view light
+
+    // Per-cluster scratch lists written by the binning threads
+    std::vector<unsigned int> m_clusterCounts;
+    std::vector<unsigned int> m_clusterScratch;
+
+    // Compacted results
+    std::vector<GpuLight> m_gpuLights;
+    std::vector<glm::uvec2> m_clusters;
+    std::vector<unsigned int> m_indices;
+
+    unsigned int m_lightBuffer;
+    unsigned int m_clusterBuffer;
+    unsigned int m_indexBuffer;
+
+    unsigned int m_visibleLights;
+    float m_binningTime;
+};
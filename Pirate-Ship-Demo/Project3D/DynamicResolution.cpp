@@ -0,0 +1,63 @@
+#include "DynamicResolution.h"
+#include "GpuTimer.h"
+#include <algorithm>
+#include <cmath>
+
+// Scales snap to this step so small fluctuations do not reallocate targets
+static const float SCALE_STEP = 0.05f;
+
+DynamicResolution::DynamicResolution()
+    : targetTime(16.0f),
+    minScale(0.5f),
+    maxScale(1.0f),
+    m_scale(1.0f),
+    m_smoothedTime(0),
+    m_cooldown(0) {
+}
+
+void DynamicResolution::setScale(float scale) {
+    m_scale = std::clamp(scale, minScale, maxScale);
+}
+
+bool DynamicResolution::update(float gpuFrameTime) {
+    if (gpuFrameTime <= 0)
+        return false;
+
+    m_smoothedTime = m_smoothedTime == 0 ? gpuFrameTime : m_smoothedTime * 0.9f + gpuFrameTime * 0.1f;
+
+    // Keep within limits that may have been changed from the UI
+    float previous = m_scale;
+    m_scale = std::clamp(m_scale, minScale, maxScale);
+
+    if (m_cooldown > 0) {
+        m_cooldown--;
+        return m_scale != previous;
+    }
+
+    float scale = m_scale;
+    if (m_smoothedTime > targetTime) {
+        // Over budget: drop straight to the scale expected to fit, rounded down
+        float ideal = m_scale * std::sqrt(targetTime / m_smoothedTime);
+        scale = std::floor(ideal / SCALE_STEP) * SCALE_STEP;
+    }
+    else if (m_smoothedTime < targetTime * 0.8f) {
+        // Comfortably under budget: step up gradually so we do not overshoot
+        scale = m_scale + SCALE_STEP;
+    }
+    scale = std::clamp(scale, minScale, maxScale);
+
+    if (std::abs(scale - m_scale) < SCALE_STEP * 0.5f)
+        return m_scale != previous;
+
+    // Wait for timings measured at the new scale before deciding again
+    m_scale = scale;
+    m_smoothedTime = 0;
+    m_cooldown = GpuTimer::FRAME_LATENCY + 8;
+    return true;
+}
+
+void DynamicResolution::getRenderSize(unsigned int outputWidth, unsigned int outputHeight,
+    unsigned int& renderWidth, unsigned int& renderHeight) const {
+    renderWidth = std::max(1u, (unsigned int)std::lround(outputWidth * m_scale));
+    renderHeight = std::max(1u, (unsigned int)std::lround(outputHeight * m_scale));
+}
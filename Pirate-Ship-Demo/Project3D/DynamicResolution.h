@@ -0,0 +1,33 @@
+#pragma once
+
+// Dynamic resolution controller
+// Watches the measured GPU frame time against a target budget and picks a render
+// scale between the configured limits. Pixel cost grows with the square of the
+// scale, so corrections use the square root of the time ratio. Scales are quantised
+// and changes are followed by a cooldown that covers the timer readback latency,
+// so render targets are only reallocated occasionally.
+class DynamicResolution {
+public:
+
+    DynamicResolution();
+
+    // Feeds the latest GPU frame time (ms); returns true if the render scale changed
+    bool update(float gpuFrameTime);
+
+    float getScale() const { return m_scale; }
+    void setScale(float scale);
+
+    // Render size for a given output size at the current scale
+    void getRenderSize(unsigned int outputWidth, unsigned int outputHeight,
+        unsigned int& renderWidth, unsigned int& renderHeight) const;
+
+    float targetTime;   // GPU frame budget in milliseconds
+    float minScale;     // Lowest render scale allowed
+    float maxScale;     // Highest render scale allowed
+
+protected:
+
+    float m_scale;
+    float m_smoothedTime;
+    unsigned int m_cooldown; // Frames to wait before the next change
+};
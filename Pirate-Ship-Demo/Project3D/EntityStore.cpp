@@ -0,0 +1,295 @@
+#include "EntityStore.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <xmmintrin.h>
+
+// out = a * b for column-major 4x4 matrices, with a passed as its four columns
+static inline void multiplyColumns(__m128 a0, __m128 a1, __m128 a2, __m128 a3, const float* b, float* out) {
+    for (int column = 0; column < 4; column++) {
+        const float* c = b + column * 4;
+        __m128 result = _mm_mul_ps(a0, _mm_set1_ps(c[0]));
+        result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(c[1])));
+        result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(c[2])));
+        result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(c[3])));
+        _mm_storeu_ps(out + column * 4, result);
+    }
+}
+
+// Reorders values so that values[i] becomes the old values[order[i]]
+template <typename T>
+static void permute(std::vector<T>& values, const std::vector<unsigned int>& order) {
+    std::vector<T> result;
+    result.reserve(order.size());
+    for (unsigned int index : order)
+        result.push_back(values[index]);
+    values.swap(result);
+}
+
+EntityStore::EntityStore(unsigned int threadCount)
+    : m_threadCount(threadCount),
+    m_orderDirty(false),
+    m_projectionView(1.0f),
+    m_updatedCount(0),
+    m_updateTime(0.0f) {
+    if (m_threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        m_threadCount = std::clamp(hardwareThreads > 1 ? hardwareThreads - 1 : 1u, 1u, 8u);
+    }
+}
+
+EntityStore::~EntityStore() {
+}
+
+EntityStore::Entity EntityStore::create(Entity parent) {
+    Entity entity;
+    if (!m_freeEntities.empty()) {
+        entity = m_freeEntities.back();
+        m_freeEntities.pop_back();
+    }
+    else {
+        entity = (Entity)m_denseIndex.size();
+        m_denseIndex.resize(entity + 1);
+    }
+
+    // Appending keeps depth-first order only for a new root, or a child of
+    // an entity whose subtree currently runs to the end of the arrays
+    unsigned int index = (unsigned int)m_entities.size();
+    unsigned int parentIndex = parent != INVALID_ENTITY ? m_denseIndex[parent] : NO_PARENT;
+    if (parentIndex == NO_PARENT) {
+        m_roots.push_back(index);
+    }
+    else if (!m_orderDirty) {
+        unsigned int ancestor = index > 0 ? index - 1 : NO_PARENT;
+        while (ancestor != NO_PARENT && ancestor != parentIndex)
+            ancestor = m_parentIndices[ancestor];
+        if (ancestor != parentIndex)
+            m_orderDirty = true;
+    }
+
+    m_denseIndex[entity] = index;
+    m_entities.push_back(entity);
+    m_parents.push_back(parent);
+    m_parentIndices.push_back(parentIndex);
+    m_flags.push_back(FLAG_LOCAL_DIRTY);
+    m_positions.push_back(glm::vec3(0));
+    m_rotations.push_back(glm::quat(1, 0, 0, 0));
+    m_scales.push_back(glm::vec3(1));
+    m_worldMatrices.push_back(glm::mat4(1.0f));
+    m_pvmMatrices.push_back(glm::mat4(1.0f));
+    return entity;
+}
+
+void EntityStore::destroy(Entity entity) {
+    // Descendants are found and released when the order is rebuilt
+    m_flags[m_denseIndex[entity]] |= FLAG_DESTROYED;
+    m_orderDirty = true;
+}
+
+void EntityStore::clear() {
+    m_denseIndex.clear();
+    m_freeEntities.clear();
+    m_entities.clear();
+    m_parents.clear();
+    m_parentIndices.clear();
+    m_flags.clear();
+    m_positions.clear();
+    m_rotations.clear();
+    m_scales.clear();
+    m_worldMatrices.clear();
+    m_pvmMatrices.clear();
+    m_roots.clear();
+    m_orderDirty = false;
+}
+
+bool EntityStore::isAlive(Entity entity) const {
+    if (entity >= m_denseIndex.size() || m_denseIndex[entity] == INVALID_ENTITY)
+        return false;
+
+    // Destroying an ancestor destroys the entity too
+    for (Entity ancestor = entity; ancestor != INVALID_ENTITY; ancestor = m_parents[m_denseIndex[ancestor]]) {
+        if (m_flags[m_denseIndex[ancestor]] & FLAG_DESTROYED)
+            return false;
+    }
+    return true;
+}
+
+bool EntityStore::setParent(Entity entity, Entity parent) {
+    for (Entity ancestor = parent; ancestor != INVALID_ENTITY; ancestor = m_parents[m_denseIndex[ancestor]]) {
+        if (ancestor == entity)
+            return false;
+    }
+
+    m_parents[m_denseIndex[entity]] = parent;
+    m_orderDirty = true;
+    markDirty(entity);
+    return true;
+}
+
+void EntityStore::setPosition(Entity entity, const glm::vec3& position) {
+    m_positions[m_denseIndex[entity]] = position;
+    markDirty(entity);
+}
+
+void EntityStore::setRotation(Entity entity, const glm::quat& rotation) {
+    m_rotations[m_denseIndex[entity]] = rotation;
+    markDirty(entity);
+}
+
+void EntityStore::setScale(Entity entity, const glm::vec3& scale) {
+    m_scales[m_denseIndex[entity]] = scale;
+    markDirty(entity);
+}
+
+void EntityStore::setLocalTransform(Entity entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+    unsigned int index = m_denseIndex[entity];
+    m_positions[index] = position;
+    m_rotations[index] = rotation;
+    m_scales[index] = scale;
+    m_flags[index] |= FLAG_LOCAL_DIRTY;
+}
+
+void EntityStore::rebuildOrder() {
+    unsigned int count = (unsigned int)m_entities.size();
+
+    // Child lists, keeping siblings in their current order
+    std::vector<unsigned int> firstChild(count, NO_PARENT);
+    std::vector<unsigned int> nextSibling(count, NO_PARENT);
+    for (unsigned int i = count; i-- > 0;) {
+        if (m_parents[i] == INVALID_ENTITY)
+            continue;
+        unsigned int parent = m_denseIndex[m_parents[i]];
+        nextSibling[i] = firstChild[parent];
+        firstChild[parent] = i;
+    }
+
+    // Depth-first walk from every live root; destroyed subtrees are never reached
+    std::vector<unsigned int> order;
+    std::vector<unsigned int> stack;
+    std::vector<bool> reached(count, false);
+    order.reserve(count);
+    for (unsigned int root = 0; root < count; root++) {
+        if (m_parents[root] != INVALID_ENTITY || (m_flags[root] & FLAG_DESTROYED))
+            continue;
+
+        stack.push_back(root);
+        while (!stack.empty()) {
+            unsigned int node = stack.back();
+            stack.pop_back();
+            order.push_back(node);
+            reached[node] = true;
+
+            // Pushed in reverse so the first child is visited first
+            size_t firstPushed = stack.size();
+            for (unsigned int child = firstChild[node]; child != NO_PARENT; child = nextSibling[child]) {
+                if (!(m_flags[child] & FLAG_DESTROYED))
+                    stack.push_back(child);
+            }
+            std::reverse(stack.begin() + firstPushed, stack.end());
+        }
+    }
+
+    for (unsigned int i = 0; i < count; i++) {
+        if (!reached[i]) {
+            m_denseIndex[m_entities[i]] = INVALID_ENTITY;
+            m_freeEntities.push_back(m_entities[i]);
+        }
+    }
+
+    permute(m_entities, order);
+    permute(m_parents, order);
+    permute(m_flags, order);
+    permute(m_positions, order);
+    permute(m_rotations, order);
+    permute(m_scales, order);
+    permute(m_worldMatrices, order);
+    permute(m_pvmMatrices, order);
+
+    m_roots.clear();
+    m_parentIndices.resize(order.size());
+    for (unsigned int i = 0; i < (unsigned int)order.size(); i++)
+        m_denseIndex[m_entities[i]] = i;
+    for (unsigned int i = 0; i < (unsigned int)order.size(); i++) {
+        m_parentIndices[i] = m_parents[i] != INVALID_ENTITY ? m_denseIndex[m_parents[i]] : NO_PARENT;
+        if (m_parentIndices[i] == NO_PARENT)
+            m_roots.push_back(i);
+    }
+    m_orderDirty = false;
+}
+
+void EntityStore::update(const glm::mat4& projectionView) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    if (m_orderDirty)
+        rebuildOrder();
+
+    // Every ProjectionViewModel changes with the camera, otherwise only those of moved entities
+    bool projectionViewChanged = projectionView != m_projectionView;
+    m_projectionView = projectionView;
+
+    // Split into contiguous runs of whole root subtrees of roughly equal size
+    unsigned int count = (unsigned int)m_entities.size();
+    unsigned int threadCount = std::max(1u, std::min(m_threadCount, count / MIN_ENTITIES_PER_THREAD));
+    std::vector<unsigned int> bounds(1, 0);
+    for (unsigned int root : m_roots) {
+        unsigned int target = (unsigned int)((unsigned long long)count * bounds.size() / threadCount);
+        if (bounds.size() < threadCount && root >= target && root > bounds.back())
+            bounds.push_back(root);
+    }
+    bounds.push_back(count);
+
+    unsigned int rangeCount = (unsigned int)bounds.size() - 1;
+    std::vector<unsigned int> updated(rangeCount, 0);
+    aie::JobSystem::getInstance()->parallelFor(rangeCount,
+        [this, &bounds, &updated, projectionViewChanged](unsigned int first, unsigned int last) {
+        for (unsigned int i = first; i < last; i++)
+            updated[i] = updateRange(bounds[i], bounds[i + 1], projectionViewChanged);
+    }, 1);
+
+    m_updatedCount = 0;
+    for (unsigned int rangeUpdated : updated)
+        m_updatedCount += rangeUpdated;
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_updateTime = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+unsigned int EntityStore::updateRange(unsigned int begin, unsigned int end, bool projectionViewChanged) {
+    const float* pv = &m_projectionView[0][0];
+    const __m128 pv0 = _mm_loadu_ps(pv);
+    const __m128 pv1 = _mm_loadu_ps(pv + 4);
+    const __m128 pv2 = _mm_loadu_ps(pv + 8);
+    const __m128 pv3 = _mm_loadu_ps(pv + 12);
+
+    unsigned int updated = 0;
+    for (unsigned int i = begin; i < end; i++) {
+        // Parents come first, so their flags already reflect this update
+        unsigned int parent = m_parentIndices[i];
+        bool changed = (m_flags[i] & FLAG_LOCAL_DIRTY) ||
+            (parent != NO_PARENT && (m_flags[parent] & FLAG_WORLD_CHANGED));
+        m_flags[i] = changed ? FLAG_WORLD_CHANGED : 0;
+
+        if (changed) {
+            // Local matrix: scaled rotation columns, translation in the last column
+            glm::mat3 rotation = glm::mat3_cast(m_rotations[i]);
+            const glm::vec3& scale = m_scales[i];
+            glm::mat4 local(glm::vec4(rotation[0] * scale.x, 0.0f), glm::vec4(rotation[1] * scale.y, 0.0f),
+                glm::vec4(rotation[2] * scale.z, 0.0f), glm::vec4(m_positions[i], 1.0f));
+
+            if (parent == NO_PARENT) {
+                m_worldMatrices[i] = local;
+            }
+            else {
+                const float* parentWorld = &m_worldMatrices[parent][0][0];
+                multiplyColumns(_mm_loadu_ps(parentWorld), _mm_loadu_ps(parentWorld + 4), _mm_loadu_ps(parentWorld + 8),
+                    _mm_loadu_ps(parentWorld + 12), &local[0][0], &m_worldMatrices[i][0][0]);
+            }
+            updated++;
+        }
+
+        if (changed || projectionViewChanged)
+            multiplyColumns(pv0, pv1, pv2, pv3, &m_worldMatrices[i][0][0], &m_pvmMatrices[i][0][0]);
+    }
+    return updated;
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Data-oriented store for scene entities and their transforms
+// Components live in structure-of-arrays pools indexed by a dense index. The dense
+// arrays are kept in depth-first order of the parent/child hierarchy, so a parent
+// always comes before its children and every subtree is one contiguous range.
+// Setting a local transform marks the entity dirty; update() walks the arrays once,
+// recomputing the world matrix of every dirty entity and of every entity below one,
+// and the ProjectionViewModel of every entity, with SSE. Runs of whole root subtrees
+// are updated as separate jobs, so no job ever reads a matrix another job writes.
+class EntityStore {
+public:
+
+    typedef unsigned int Entity;
+    static const Entity INVALID_ENTITY = ~0u;
+
+    // The work is split into up to threadCount parallel jobs
+    // A thread count of 0 picks one based on the available hardware threads
+    EntityStore(unsigned int threadCount = 0);
+    ~EntityStore();
+
+    // New entities have an identity local transform
+    Entity create(Entity parent = INVALID_ENTITY);
+
+    // Destroys the entity and all of its descendants
+    void destroy(Entity entity);
+    void clear();
+    bool isAlive(Entity entity) const;
+
+    // Returns false (and leaves the hierarchy alone) if it would create a cycle
+    bool setParent(Entity entity, Entity parent);
+    Entity getParent(Entity entity) const { return m_parents[m_denseIndex[entity]]; }
+
+    // Local transform, relative to the parent
+    void setPosition(Entity entity, const glm::vec3& position);
+    void setRotation(Entity entity, const glm::quat& rotation);
+    void setScale(Entity entity, const glm::vec3& scale);
+    void setLocalTransform(Entity entity, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+    const glm::vec3& getPosition(Entity entity) const { return m_positions[m_denseIndex[entity]]; }
+    const glm::quat& getRotation(Entity entity) const { return m_rotations[m_denseIndex[entity]]; }
+    const glm::vec3& getScale(Entity entity) const { return m_scales[m_denseIndex[entity]]; }
+
+    // Recomputes world matrices and the ProjectionViewModel of every entity
+    void update(const glm::mat4& projectionView);
+
+    // Valid after update()
+    const glm::mat4& getWorldMatrix(Entity entity) const { return m_worldMatrices[m_denseIndex[entity]]; }
+    const glm::mat4& getProjectionViewModel(Entity entity) const { return m_pvmMatrices[m_denseIndex[entity]]; }
+
+    // Statistics for the last update
+    unsigned int getEntityCount() const { return (unsigned int)m_entities.size(); }
+    unsigned int getUpdatedCount() const { return m_updatedCount; }     // World matrices recomputed
+    float getUpdateTime() const { return m_updateTime; }                // milliseconds
+    unsigned int getThreadCount() const { return m_threadCount; }
+
+protected:
+
+    static const unsigned int NO_PARENT = ~0u;
+
+    // Below this many entities per job the update runs as a single job
+    static const unsigned int MIN_ENTITIES_PER_THREAD = 4096;
+
+    enum Flags : unsigned char {
+        FLAG_LOCAL_DIRTY    = 1,    // Local transform set since the last update
+        FLAG_WORLD_CHANGED  = 2,    // World matrix recomputed in the current update
+        FLAG_DESTROYED      = 4     // Removed, along with its descendants, at the next update
+    };
+
+    // Restores depth-first order after the hierarchy changed, dropping destroyed entities
+    void rebuildOrder();
+
+    // Updates the dense range [begin, end), which must consist of whole root subtrees
+    unsigned int updateRange(unsigned int begin, unsigned int end, bool projectionViewChanged);
+
+    void markDirty(Entity entity) { m_flags[m_denseIndex[entity]] |= FLAG_LOCAL_DIRTY; }
+
+    unsigned int m_threadCount;
+
+    // Entity -> dense index (INVALID_ENTITY for free slots)
+    std::vector<unsigned int> m_denseIndex;
+    std::vector<Entity> m_freeEntities;
+
+    // Dense pools
+    std::vector<Entity> m_entities;
+    std::vector<Entity> m_parents;              // Parent entity, INVALID_ENTITY for roots
+    std::vector<unsigned int> m_parentIndices;  // Parent dense index, NO_PARENT for roots
+    std::vector<unsigned char> m_flags;
+    std::vector<glm::vec3> m_positions;
+    std::vector<glm::quat> m_rotations;
+    std::vector<glm::vec3> m_scales;
+    std::vector<glm::mat4> m_worldMatrices;
+    std::vector<glm::mat4> m_pvmMatrices;
+
+    std::vector<unsigned int> m_roots;          // Dense index of every root, in order
+    bool m_orderDirty;
+
+    glm::mat4 m_projectionView;
+    unsigned int m_updatedCount;
+    float m_updateTime;
+};
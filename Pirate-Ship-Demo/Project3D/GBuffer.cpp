@@ -0,0 +1,44 @@
+#include "GBuffer.h"
+#include "glad.h"
+
+GBuffer::GBuffer()
+    : m_depth(RenderGraph::INVALID_HANDLE) {
+    for (auto& target : m_targets)
+        target = RenderGraph::INVALID_HANDLE;
+}
+
+void GBuffer::create(RenderGraph& graph, unsigned int width, unsigned int height) {
+    const char* names[TARGET_COUNT] = { "G-Buffer Albedo", "G-Buffer Normal", "G-Buffer Ambient" };
+    const GLenum formats[TARGET_COUNT] = { GL_RGBA8, GL_RG16, GL_RGBA8 };
+    for (unsigned int i = 0; i < TARGET_COUNT; i++)
+        m_targets[i] = graph.createTexture(names[i], { width, height, formats[i], false });
+
+    // Same format as the default depth buffer so it can be blitted across
+    m_depth = graph.createTexture("G-Buffer Depth", { width, height, GL_DEPTH24_STENCIL8, false });
+}
+
+void GBuffer::write(RenderGraph::Builder& pass) {
+    for (auto& target : m_targets)
+        pass.writeColour(target, RenderGraph::LOAD_DONT_CARE);
+    pass.writeDepth(m_depth, RenderGraph::LOAD_CLEAR);
+}
+
+void GBuffer::read(RenderGraph::Builder& pass) const {
+    for (auto target : m_targets)
+        pass.read(target);
+    pass.read(m_depth);
+}
+
+void GBuffer::bindTextures(const RenderGraph& graph, unsigned int firstUnit) const {
+    for (unsigned int i = 0; i < TARGET_COUNT; i++) {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+        glBindTexture(GL_TEXTURE_2D, graph.getTexture(m_targets[i]));
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void GBuffer::bindDepth(const RenderGraph& graph, unsigned int unit) const {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D, graph.getTexture(m_depth));
+    glActiveTexture(GL_TEXTURE0);
+}
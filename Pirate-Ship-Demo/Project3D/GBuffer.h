@@ -0,0 +1,46 @@
+#pragma once
+#include "RenderGraph.h"
+
+// Compact G-buffer for the deferred renderer
+// Three colour targets plus depth:
+//   0 RGBA8  rgb = diffuse albedo (Kd * texture), a = specular power (log encoded)
+//   1 RG16   octahedral encoded world space normal
+//   2 RGBA8  rgb = ambient albedo (Ka * texture), a = specular intensity
+// The targets are transient render graph textures; once the lighting pass has read
+// them their memory is free for the passes that follow.
+class GBuffer {
+public:
+
+    enum Target : unsigned int {
+        ALBEDO_SPECULAR_POWER,
+        NORMAL,
+        AMBIENT_SPECULAR,
+        TARGET_COUNT
+    };
+
+    GBuffer();
+
+    // Declares this frame's targets
+    void create(RenderGraph& graph, unsigned int width, unsigned int height);
+
+    // Adds the targets as attachments of the geometry pass
+    // Colour is not cleared (the lighting pass skips pixels left at the far plane), depth is
+    void write(RenderGraph::Builder& pass);
+
+    // Adds the targets (including depth) as sampled inputs of a pass
+    void read(RenderGraph::Builder& pass) const;
+
+    // Binds the colour targets to consecutive texture units starting at firstUnit
+    void bindTextures(const RenderGraph& graph, unsigned int firstUnit) const;
+
+    // Binds the depth target to a texture unit
+    void bindDepth(const RenderGraph& graph, unsigned int unit) const;
+
+    RenderGraph::Handle getTarget(Target target) const { return m_targets[target]; }
+    RenderGraph::Handle getDepth() const { return m_depth; }
+
+protected:
+
+    RenderGraph::Handle m_targets[TARGET_COUNT];
+    RenderGraph::Handle m_depth;
+};
@@ -0,0 +1,101 @@
+#include "GpuTimer.h"
+#include "glad.h"
+#include <algorithm>
+
+GpuTimer::GpuTimer()
+    : m_maxStages(0),
+    m_frameIndex(0),
+    m_frameTime(0) {
+}
+
+GpuTimer::~GpuTimer() {
+    if (!m_queries.empty())
+        glDeleteQueries((GLsizei)m_queries.size(), m_queries.data());
+}
+
+void GpuTimer::initialise(unsigned int maxStages) {
+    m_maxStages = maxStages;
+    m_queries.resize(FRAME_LATENCY * maxStages * 2);
+    glGenQueries((GLsizei)m_queries.size(), m_queries.data());
+}
+
+unsigned int GpuTimer::findStage(const char* name) {
+    for (unsigned int i = 0; i < m_stages.size(); i++)
+        if (m_stages[i].name == name)
+            return i;
+    m_stages.push_back({ name, (int)m_open.size(), 0, 0 });
+    return (unsigned int)m_stages.size() - 1;
+}
+
+void GpuTimer::readback(Frame& frame) {
+    if (!frame.pending || frame.ranges.empty()) {
+        frame.pending = false;
+        return;
+    }
+
+    // Skip (rather than wait for) a frame the GPU has not finished yet
+    GLint available = 0;
+    glGetQueryObjectiv(frame.ranges.back().endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        frame.pending = false;
+        return;
+    }
+
+    GLuint64 first = ~0ull, last = 0;
+    for (auto& range : frame.ranges) {
+        GLuint64 start = 0, end = 0;
+        glGetQueryObjectui64v(range.startQuery, GL_QUERY_RESULT, &start);
+        glGetQueryObjectui64v(range.endQuery, GL_QUERY_RESULT, &end);
+        first = std::min(first, start);
+        last = std::max(last, end);
+
+        Stage& stage = m_stages[range.stage];
+        stage.lastTime = (float)(end - start) / 1000000.0f;
+        stage.time = stage.time == 0 ? stage.lastTime : stage.time * 0.9f + stage.lastTime * 0.1f;
+    }
+    m_frameTime = (float)(last - first) / 1000000.0f;
+    frame.pending = false;
+}
+
+void GpuTimer::beginFrame() {
+    m_frameIndex = (m_frameIndex + 1) % FRAME_LATENCY;
+
+    // The oldest frame's queries are reused now, so collect its results first
+    Frame& frame = m_frames[m_frameIndex];
+    readback(frame);
+    frame.ranges.clear();
+    m_open.clear();
+}
+
+void GpuTimer::endFrame() {
+    m_frames[m_frameIndex].pending = !m_queries.empty();
+}
+
+void GpuTimer::begin(const char* name) {
+    Frame& frame = m_frames[m_frameIndex];
+    if (m_queries.empty() || frame.ranges.size() >= m_maxStages) {
+        m_open.push_back(~0u); // Out of queries; keeps begin / end balanced
+        return;
+    }
+
+    unsigned int base = (m_frameIndex * m_maxStages + (unsigned int)frame.ranges.size()) * 2;
+    Range range = { findStage(name), m_queries[base], m_queries[base + 1] };
+    glQueryCounter(range.startQuery, GL_TIMESTAMP);
+    m_open.push_back((unsigned int)frame.ranges.size());
+    frame.ranges.push_back(range);
+}
+
+void GpuTimer::end() {
+    if (m_open.empty())
+        return;
+    if (m_open.back() != ~0u)
+        glQueryCounter(m_frames[m_frameIndex].ranges[m_open.back()].endQuery, GL_TIMESTAMP);
+    m_open.pop_back();
+}
+
+float GpuTimer::getTime(const char* name) const {
+    for (auto& stage : m_stages)
+        if (stage.name == name)
+            return stage.time;
+    return 0;
+}
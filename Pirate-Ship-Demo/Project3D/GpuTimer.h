@@ -0,0 +1,67 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Per-stage GPU timing with timestamp queries
+// Stages are named ranges within a frame and may nest. Results are read back a few
+// frames later, once the GPU has finished them, so timing never stalls the pipeline.
+class GpuTimer {
+public:
+
+    static const unsigned int FRAME_LATENCY = 4; // Frames of query sets in flight
+
+    struct Stage {
+        std::string name;
+        int         depth;      // Nesting level when first recorded
+        float       time;       // Smoothed GPU time in milliseconds
+        float       lastTime;   // Most recent measurement in milliseconds
+    };
+
+    GpuTimer();
+    ~GpuTimer();
+
+    // Creates the query objects; maxStages bounds the ranges recorded per frame
+    void initialise(unsigned int maxStages = 32);
+
+    // Collects finished results and starts recording a new frame
+    void beginFrame();
+    void endFrame();
+
+    // Marks the start / end of a named stage
+    void begin(const char* name);
+    void end();
+
+    // Stages in the order they were first recorded
+    const std::vector<Stage>& getStages() const { return m_stages; }
+
+    // Returns the smoothed time of a stage in milliseconds, 0 if unknown
+    float getTime(const char* name) const;
+
+    // GPU time from the first to the last query of the most recently completed frame
+    float getFrameTime() const { return m_frameTime; }
+
+protected:
+
+    struct Range {
+        unsigned int stage;
+        unsigned int startQuery;
+        unsigned int endQuery;
+    };
+
+    struct Frame {
+        std::vector<Range> ranges;
+        bool pending = false;
+    };
+
+    unsigned int findStage(const char* name);
+    void readback(Frame& frame);
+
+    unsigned int m_maxStages;
+    std::vector<unsigned int> m_queries; // Two per range per frame
+    Frame m_frames[FRAME_LATENCY];
+    unsigned int m_frameIndex;
+    std::vector<unsigned int> m_open; // Indices of the open ranges in the current frame
+
+    std::vector<Stage> m_stages;
+    float m_frameTime;
+};
@@ -0,0 +1,152 @@
+#include "IndirectBatch.h"
+#include "glad.h"
+#include <algorithm>
+#include <cstdio>
+
+IndirectBatch::IndirectBatch()
+    : m_commandBuffer(0),
+    m_recordBuffer(0),
+    m_commandCapacity(0),
+    m_recordCapacity(0) {
+}
+
+IndirectBatch::~IndirectBatch() {
+    if (m_commandBuffer) glDeleteBuffers(1, &m_commandBuffer);
+    if (m_recordBuffer) glDeleteBuffers(1, &m_recordBuffer);
+}
+
+bool IndirectBatch::isSupported() {
+    // gl_DrawID is core in 4.6; multi-draw indirect and SSBOs in 4.3
+    return GLAD_GL_VERSION_4_6 != 0;
+}
+
+bool IndirectBatch::initialise() {
+    if (!isSupported()) {
+        printf("Warning: OpenGL 4.6 not available, indirect batching disabled\n");
+        return false;
+    }
+
+    glGenBuffers(1, &m_commandBuffer);
+    glGenBuffers(1, &m_recordBuffer);
+    return true;
+}
+
+void IndirectBatch::begin() {
+    m_instances.clear();
+    m_groups.clear();
+    m_commands.clear();
+    m_records.clear();
+}
+
+void IndirectBatch::add(const Mesh& mesh, const glm::mat4& transform, float tilingFactor,
+    const std::vector<bool>* visibleSubMeshes) {
+    m_instances.push_back({ &mesh, transform, tilingFactor, visibleSubMeshes });
+}
+
+void IndirectBatch::end() {
+    // Group instances by mesh so each mesh needs only one VAO / texture bind
+    std::stable_sort(m_instances.begin(), m_instances.end(),
+        [](const Instance& a, const Instance& b) { return a.mesh < b.mesh; });
+
+    for (auto& instance : m_instances) {
+        const Mesh& mesh = *instance.mesh;
+
+        if (m_groups.empty() || m_groups.back().mesh != &mesh)
+            m_groups.push_back({ &mesh, (unsigned int)m_commands.size(), 0 });
+
+        for (auto& sub : mesh.getSubMeshes()) {
+            if (instance.visibleSubMeshes != nullptr &&
+                !(*instance.visibleSubMeshes)[&sub - mesh.getSubMeshes().data()])
+                continue;
+
+            DrawCommand command;
+            command.count = sub.indexCount;
+            command.instanceCount = 1;
+            command.firstIndex = sub.firstIndex;
+            command.baseVertex = sub.baseVertex;
+            command.baseInstance = 0;
+            m_commands.push_back(command);
+
+            DrawRecord record;
+            record.modelMatrix = instance.transform;
+            record.ambient = glm::vec4(mesh.getAmbient(), instance.tilingFactor);
+            record.diffuse = glm::vec4(mesh.getDiffuse(), mesh.getSpecularPower());
+            record.specular = glm::vec4(mesh.getSpecular(), 0.0f);
+            record.textureLayer = sub.textureLayer;
+            record.padding[0] = record.padding[1] = record.padding[2] = 0;
+            m_records.push_back(record);
+
+            m_groups.back().commandCount++;
+        }
+    }
+
+    if (m_commands.empty())
+        return;
+
+    // Upload command buffer, growing (or orphaning) the storage as needed
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    size_t commandBytes = m_commands.size() * sizeof(DrawCommand);
+    if (commandBytes > m_commandCapacity) {
+        m_commandCapacity = commandBytes;
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commandBytes, m_commands.data(), GL_STREAM_DRAW);
+    }
+    else {
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, m_commandCapacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commandBytes, m_commands.data());
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // Upload per-draw records
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_recordBuffer);
+    size_t recordBytes = m_records.size() * sizeof(DrawRecord);
+    if (recordBytes > m_recordCapacity) {
+        m_recordCapacity = recordBytes;
+        glBufferData(GL_SHADER_STORAGE_BUFFER, recordBytes, m_records.data(), GL_STREAM_DRAW);
+    }
+    else {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, m_recordCapacity, nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, recordBytes, m_records.data());
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void IndirectBatch::draw(aie::ShaderProgram* shader) {
+    submit(shader, false);
+}
+
+void IndirectBatch::drawDepth(aie::ShaderProgram* shader) {
+    submit(shader, true);
+}
+
+void IndirectBatch::submit(aie::ShaderProgram* shader, bool depthOnly) {
+    if (m_commands.empty())
+        return;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, m_recordBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_commandBuffer);
+    if (!depthOnly) {
+        glActiveTexture(GL_TEXTURE0);
+        shader->bindUniform("diffuseTexArray", 0);
+    }
+
+    for (auto& group : m_groups) {
+        // gl_DrawID restarts at zero for every multi-draw, so offset into the records
+        shader->bindUniform("DrawBase", (int)group.firstCommand);
+
+        if (depthOnly) {
+            glBindVertexArray(group.mesh->getDepthVAO());
+        }
+        else {
+            glBindVertexArray(group.mesh->getVAO());
+            glBindTexture(GL_TEXTURE_2D_ARRAY, group.mesh->getTextureArray());
+        }
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+            (void*)(group.firstCommand * sizeof(DrawCommand)),
+            (GLsizei)group.commandCount, 0);
+    }
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    if (!depthOnly)
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
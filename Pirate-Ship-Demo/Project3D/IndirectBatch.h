@@ -0,0 +1,92 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "Mesh.h"
+#include "Shader.h"
+
+// GPU-driven scene submission
+// Collects mesh instances for a pass and draws every submesh of every instance with
+// one glMultiDrawElementsIndirect call per mesh. Per-draw transforms and materials
+// are stored in an SSBO indexed by gl_DrawID, and textures come from each mesh's
+// packed texture array, so no per-submesh binds or uniforms are needed.
+class IndirectBatch {
+public:
+
+    // Matches the layout glMultiDrawElementsIndirect reads from the command buffer
+    struct DrawCommand {
+        unsigned int count;
+        unsigned int instanceCount;
+        unsigned int firstIndex;
+        int          baseVertex;
+        unsigned int baseInstance;
+    };
+
+    // Per-draw record (std430 layout, see phong_indirect.vert)
+    struct DrawRecord {
+        glm::mat4 modelMatrix;
+        glm::vec4 ambient;      // xyz = Ka, w = tiling factor
+        glm::vec4 diffuse;      // xyz = Kd, w = specular power
+        glm::vec4 specular;     // xyz = Ks, w = unused
+        int       textureLayer;
+        int       padding[3];
+    };
+
+    IndirectBatch();
+    ~IndirectBatch();
+
+    // Returns true if the context supports gl_DrawID / multi-draw indirect
+    static bool isSupported();
+
+    // Creates the GPU buffers used by the batch
+    bool initialise();
+
+    // Starts collecting a new pass
+    void begin();
+
+    // Queues every submesh of a mesh at the given transform
+    // The mesh must have had buildTextureArray() called
+    // If a visibility list is given, submeshes flagged false are skipped
+    void add(const Mesh& mesh, const glm::mat4& transform, float tilingFactor = 1.0f,
+        const std::vector<bool>* visibleSubMeshes = nullptr);
+
+    // Builds the command buffer / draw records and uploads them
+    void end();
+
+    // Issues the multi-draw calls; the shader must already be bound
+    void draw(aie::ShaderProgram* shader);
+
+    // Issues the multi-draw calls with the position-only stream and no textures
+    void drawDepth(aie::ShaderProgram* shader);
+
+    // Number of indirect draws (submeshes) and multi-draw calls in the pass
+    unsigned int getDrawCount() const { return (unsigned int)m_commands.size(); }
+    unsigned int getMultiDrawCount() const { return (unsigned int)m_groups.size(); }
+
+protected:
+
+    void submit(aie::ShaderProgram* shader, bool depthOnly);
+
+    // A contiguous range of commands that share a mesh (VAO and texture array)
+    struct Group {
+        const Mesh*  mesh;
+        unsigned int firstCommand;
+        unsigned int commandCount;
+    };
+
+    struct Instance {
+        const Mesh* mesh;
+        glm::mat4   transform;
+        float       tilingFactor;
+        const std::vector<bool>* visibleSubMeshes;
+    };
+
+    std::vector<Instance>    m_instances;
+    std::vector<Group>       m_groups;
+    std::vector<DrawCommand> m_commands;
+    std::vector<DrawRecord>  m_records;
+
+    unsigned int m_commandBuffer;
+    unsigned int m_recordBuffer;
+    size_t       m_commandCapacity;
+    size_t       m_recordCapacity;
+};
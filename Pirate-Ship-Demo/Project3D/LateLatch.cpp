@@ -0,0 +1,123 @@
+#include "LateLatch.h"
+#include "glad.h"
+#include "../dependencies/glfw/include/GLFW/glfw3.h"
+#include <cstdio>
+#include <cstring>
+
+LateLatch::LateLatch()
+    : m_buffer(0),
+    m_slotSize(0),
+    m_mapped(nullptr),
+    m_slot(0),
+    m_slots{},
+    m_frameStartLatency(0.0f),
+    m_latchedLatency(0.0f) {
+}
+
+LateLatch::~LateLatch() {
+    for (Slot& slot : m_slots) {
+        if (slot.fence) glDeleteSync(slot.fence);
+        if (slot.query) glDeleteQueries(1, &slot.query);
+    }
+    if (m_buffer) {
+        if (m_mapped) {
+            glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        }
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+bool LateLatch::initialise() {
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    m_slotSize = ((unsigned int)sizeof(glm::mat4) + alignment - 1) / alignment * alignment;
+    GLsizeiptr size = (GLsizeiptr)m_slotSize * SLOT_COUNT;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+    if (GLAD_GL_VERSION_4_4) {
+        // Coherent, so a write is visible to every command issued after it without a flush
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, size, nullptr, flags);
+        m_mapped = (unsigned char*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+    }
+    else {
+        printf("Warning: OpenGL 4.4 not available, late latching falls back to buffer updates\n");
+        glBufferData(GL_UNIFORM_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    for (Slot& slot : m_slots)
+        glGenQueries(1, &slot.query);
+
+    // Every slot starts as an identity correction, so shaders are valid before the first frame
+    for (m_slot = 0; m_slot < SLOT_COUNT; m_slot++)
+        write(glm::mat4(1.0f));
+    m_slot = 0;
+    glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, m_buffer, 0, sizeof(glm::mat4));
+    return true;
+}
+
+void LateLatch::bindBlock(const aie::ShaderProgram& shader) const {
+    shader.bindUniformBlock("LateLatch", BINDING);
+}
+
+void LateLatch::write(const glm::mat4& correction) {
+    if (m_mapped) {
+        memcpy(m_mapped + m_slot * m_slotSize, &correction[0][0], sizeof(glm::mat4));
+    }
+    else {
+        glBindBuffer(GL_UNIFORM_BUFFER, m_buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, m_slot * m_slotSize, sizeof(glm::mat4), &correction[0][0]);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+}
+
+void LateLatch::beginFrame(double inputTime) {
+    m_slot = (m_slot + 1) % SLOT_COUNT;
+    Slot& slot = m_slots[m_slot];
+
+    // The GPU must be done with the frame that last used this slot before it is overwritten
+    if (slot.fence) {
+        while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+        }
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+    }
+
+    // That frame's timestamp is therefore ready without stalling
+    if (slot.pending) {
+        GLuint64 gpuTime = 0;
+        glGetQueryObjectui64v(slot.query, GL_QUERY_RESULT, &gpuTime);
+        double finished = gpuTime * 1e-9 + slot.clockOffset;
+        m_frameStartLatency = glm::mix(m_frameStartLatency, (float)((finished - slot.inputTime) * 1000.0), 0.1f);
+        m_latchedLatency = glm::mix(m_latchedLatency, (float)((finished - slot.latchTime) * 1000.0), 0.1f);
+        slot.pending = false;
+    }
+
+    // Relates GPU timestamps to glfwGetTime for this frame
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    slot.clockOffset = glfwGetTime() - gpuNow * 1e-9;
+    slot.inputTime = inputTime;
+    slot.latchTime = inputTime;
+
+    write(glm::mat4(1.0f));
+    glBindBufferRange(GL_UNIFORM_BUFFER, BINDING, m_buffer, m_slot * m_slotSize, sizeof(glm::mat4));
+}
+
+void LateLatch::latch(const glm::mat4& preparedProjectionView, const glm::mat4& latchedProjectionView) {
+    // In double precision, as the inverse of a perspective projection loses depth precision in float
+    glm::dmat4 correction = glm::dmat4(latchedProjectionView) * glm::inverse(glm::dmat4(preparedProjectionView));
+    write(glm::mat4(correction));
+    m_slots[m_slot].latchTime = glfwGetTime();
+}
+
+void LateLatch::endFrame() {
+    Slot& slot = m_slots[m_slot];
+    glQueryCounter(slot.query, GL_TIMESTAMP);
+    slot.pending = true;
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <glm/glm.hpp>
+#include "Shader.h"
+
+// Late-latched camera
+// A frame is prepared (culling, light binning, command recording) with the camera sampled
+// in update(). Just before the scene is submitted the camera is sampled again, and the
+// correction from the prepared projection-view to the new one is written into the frame's
+// slot of a persistently mapped uniform buffer, which the scene vertex shaders apply
+// (the LateLatch block). Each slot is fenced and only rewritten once the GPU has finished
+// the frame that used it, so the ring doubles as a frame queue limit.
+// The time from each camera sample to the GPU finishing the frame is measured with
+// timestamp queries, read back when the slot comes round again.
+class LateLatch {
+public:
+
+    static const unsigned int SLOT_COUNT = 6;   // More than the Application allows in flight
+    static const unsigned int BINDING = 1;      // Uniform buffer binding of the LateLatch block
+
+    LateLatch();
+    ~LateLatch();
+
+    // Persistent mapping needs OpenGL 4.4; older contexts update the slot with glBufferSubData
+    bool initialise();
+    bool isPersistent() const { return m_mapped != nullptr; }
+
+    // Connects a shader's LateLatch block to the buffer
+    void bindBlock(const aie::ShaderProgram& shader) const;
+
+    // Claims the next slot, waiting for the GPU to release it, and starts it with no correction
+    // inputTime is when the prepared camera's input was polled (glfwGetTime)
+    void beginFrame(double inputTime);
+
+    // Writes the correction from the prepared to the newly sampled projection-view
+    void latch(const glm::mat4& preparedProjectionView, const glm::mat4& latchedProjectionView);
+
+    // Marks the end of the frame's scene work on the GPU
+    void endFrame();
+
+    // Smoothed milliseconds from each camera sample to the GPU finishing the frame
+    // (excluding display scan-out, which the GL cannot observe)
+    float getFrameStartLatency() const { return m_frameStartLatency; }
+    float getLatchedLatency() const { return m_latchedLatency; }
+
+protected:
+
+    void write(const glm::mat4& correction);
+
+    unsigned int m_buffer;
+    unsigned int m_slotSize;        // Slot stride, rounded up to the uniform buffer offset alignment
+    unsigned char* m_mapped;
+    unsigned int m_slot;
+
+    struct Slot {
+        struct __GLsync* fence;
+        unsigned int query;         // GL_TIMESTAMP at the end of the frame's scene work
+        bool pending;               // Query issued and not yet read back
+        double inputTime;
+        double latchTime;
+        double clockOffset;         // CPU minus GPU clock, in seconds, when the slot began
+    };
+    Slot m_slots[SLOT_COUNT];
+
+    float m_frameStartLatency;
+    float m_latchedLatency;
+};
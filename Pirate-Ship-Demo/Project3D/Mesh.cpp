@@ -1,26 +1,41 @@
 ﻿#include "Mesh.h"
 #include "Shader.h"
+#include "GLStats.h"
+#include "Profiler.h"
 #include <assimp/scene.h>
 #include <assimp/cimport.h>
 #include <assimp/postprocess.h>
 #include <vector>
 #include <cassert>
+#include <algorithm>
 
 Mesh::Mesh()
-    : Ka(0.1f), Kd(1.0f), Ks(1.0f), specularPower(32.0f) {
+    : m_vao(0), m_vbo(0), m_ibo(0), m_depthVao(0), m_positionVbo(0), m_geometryBytes(0),
+    m_boundsMin(0), m_boundsMax(0), m_textureArray(0), m_textureArrayBytes(0),
+    Ka(0.1f), Kd(1.0f), Ks(1.0f), specularPower(32.0f) {
 }
 
 Mesh::~Mesh() {
 
-    // Cleanup all submeshes
-    for (auto& sub : m_subMeshes) {
-        if (sub.vao) glDeleteVertexArrays(1, &sub.vao);
-        if (sub.vbo) glDeleteBuffers(1, &sub.vbo);
-        if (sub.ibo) glDeleteBuffers(1, &sub.ibo);
-    }
+    // Cleanup shared geometry and packed textures
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    if (m_vbo) glDeleteBuffers(1, &m_vbo);
+    if (m_ibo) glDeleteBuffers(1, &m_ibo);
+    if (m_depthVao) glDeleteVertexArrays(1, &m_depthVao);
+    if (m_positionVbo) glDeleteBuffers(1, &m_positionVbo);
+    if (m_textureArray) glDeleteTextures(1, &m_textureArray);
+}
+
+bool Mesh::initialiseFromFile(const char* filename, unsigned int maxOccluderTriangles) {
+    if (!loadFile(filename, maxOccluderTriangles))
+        return false;
+    upload();
+    return true;
 }
 
-bool Mesh::initialiseFromFile(const char* filename) {
+bool Mesh::loadFile(const char* filename, unsigned int maxOccluderTriangles) {
+    PROFILE_SCOPE("Mesh::loadFile");
+
     // Load model using Assimp
     const aiScene* scene = aiImportFile(filename,
         aiProcess_Triangulate |
@@ -36,13 +51,22 @@ bool Mesh::initialiseFromFile(const char* filename) {
     // Clear out any existing submeshes
     m_subMeshes.clear();
 
+    // Every submesh is appended to one shared vertex / index buffer so the whole
+    // mesh can be drawn from a single VAO (and a single multi-draw command buffer)
+    std::vector<Vertex>& vertices = m_stagingVertices;
+    std::vector<unsigned int>& indices = m_stagingIndices;
+    vertices.clear();
+    indices.clear();
+
     // For each aiMesh in the scene, create a SubMesh
     for (unsigned int meshIndex = 0; meshIndex < scene->mNumMeshes; meshIndex++) {
         aiMesh* mesh = scene->mMeshes[meshIndex];
-        std::vector<Vertex>    vertices;
-        std::vector<unsigned int> indices;
 
-        vertices.reserve(mesh->mNumVertices);
+        SubMesh subMesh;
+        subMesh.baseVertex = (int)vertices.size();
+        subMesh.firstIndex = (unsigned int)indices.size();
+
+        vertices.reserve(vertices.size() + mesh->mNumVertices);
         for (unsigned int v = 0; v < mesh->mNumVertices; v++) {
             Vertex vertex{};
             vertex.position = glm::vec4(
@@ -77,7 +101,7 @@ bool Mesh::initialiseFromFile(const char* filename) {
             vertices.push_back(vertex);
         }
 
-        indices.reserve(static_cast<std::vector<unsigned int, std::allocator<unsigned int>>::size_type>(mesh->mNumFaces) * 3);
+        indices.reserve(indices.size() + static_cast<std::vector<unsigned int, std::allocator<unsigned int>>::size_type>(mesh->mNumFaces) * 3);
         for (unsigned int f = 0; f < mesh->mNumFaces; f++) {
             const aiFace& face = mesh->mFaces[f];
             // Ensure it's a triangle
@@ -88,37 +112,16 @@ bool Mesh::initialiseFromFile(const char* filename) {
             }
         }
 
-        // Setup OpenGL buffers
-        SubMesh subMesh;
-        glGenVertexArrays(1, &subMesh.vao);
-        glBindVertexArray(subMesh.vao);
-
-        // Vertex buffer
-        glGenBuffers(1, &subMesh.vbo);
-        glBindBuffer(GL_ARRAY_BUFFER, subMesh.vbo);
-        glBufferData(GL_ARRAY_BUFFER,
-            vertices.size() * sizeof(Vertex),
-            vertices.data(),
-            GL_STATIC_DRAW);
-
-   
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 4, GL_FLOAT, GL_TRUE, sizeof(Vertex), (void*)16);
-
-        glEnableVertexAttribArray(2);
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)32);
+        subMesh.indexCount = (unsigned int)indices.size() - subMesh.firstIndex;
 
-        glGenBuffers(1, &subMesh.ibo);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, subMesh.ibo);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-            indices.size() * sizeof(unsigned int),
-            indices.data(),
-            GL_STATIC_DRAW);
-
-        subMesh.indexCount = (unsigned int)indices.size();
+        // Local bounds of this submesh
+        if (mesh->mNumVertices > 0) {
+            subMesh.boundsMin = subMesh.boundsMax = glm::vec3(vertices[subMesh.baseVertex].position);
+            for (size_t v = subMesh.baseVertex; v < vertices.size(); v++) {
+                subMesh.boundsMin = glm::min(subMesh.boundsMin, glm::vec3(vertices[v].position));
+                subMesh.boundsMax = glm::max(subMesh.boundsMax, glm::vec3(vertices[v].position));
+            }
+        }
 
         // Grab the material name from the mesh’s material index
         if (scene->mMaterials && mesh->mMaterialIndex < scene->mNumMaterials) {
@@ -136,11 +139,6 @@ bool Mesh::initialiseFromFile(const char* filename) {
             subMesh.materialName = "default-grey.jpg";
         }
 
-        // Unbind
-        glBindVertexArray(0);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-
         // Store this submesh
         m_subMeshes.push_back(subMesh);
     }
@@ -148,10 +146,128 @@ bool Mesh::initialiseFromFile(const char* filename) {
     // Done with Assimp data
     aiReleaseImport(scene);
 
+    // Whole-mesh bounds
+    if (!m_subMeshes.empty()) {
+        m_boundsMin = m_subMeshes[0].boundsMin;
+        m_boundsMax = m_subMeshes[0].boundsMax;
+        for (auto& sub : m_subMeshes) {
+            m_boundsMin = glm::min(m_boundsMin, sub.boundsMin);
+            m_boundsMax = glm::max(m_boundsMax, sub.boundsMax);
+        }
+    }
+
+    // Build the occluder from the largest triangles; being a subset of the real
+    // surface it is always conservative for software occlusion culling
+    struct Triangle {
+        float area;
+        unsigned int subMesh;
+        unsigned int offset;    // First index within the submesh
+    };
+    std::vector<Triangle> triangleAreas;
+    for (auto& sub : m_subMeshes) {
+        for (unsigned int i = 0; i < sub.indexCount; i += 3) {
+            unsigned int first = sub.firstIndex + i;
+            glm::vec3 a(vertices[sub.baseVertex + indices[first]].position);
+            glm::vec3 b(vertices[sub.baseVertex + indices[first + 1]].position);
+            glm::vec3 c(vertices[sub.baseVertex + indices[first + 2]].position);
+            float area = glm::length(glm::cross(b - a, c - a)) * 0.5f;
+            triangleAreas.push_back({ area, (unsigned int)(&sub - m_subMeshes.data()), i });
+        }
+    }
+    size_t occluderCount = std::min<size_t>(maxOccluderTriangles, triangleAreas.size());
+    std::partial_sort(triangleAreas.begin(), triangleAreas.begin() + occluderCount, triangleAreas.end(),
+        [](const Triangle& a, const Triangle& b) { return a.area > b.area; });
+
+    m_occluderTriangles.clear();
+    m_occluderTriangles.reserve(occluderCount * 3);
+    for (size_t t = 0; t < occluderCount; t++) {
+        const SubMesh& sub = m_subMeshes[triangleAreas[t].subMesh];
+        unsigned int first = sub.firstIndex + triangleAreas[t].offset;
+        for (unsigned int corner = 0; corner < 3; corner++)
+            m_occluderTriangles.push_back(glm::vec3(vertices[sub.baseVertex + indices[first + corner]].position));
+    }
+
     return true;
 }
 
+void Mesh::upload() {
+    PROFILE_SCOPE("Mesh::upload");
+    std::vector<Vertex>& vertices = m_stagingVertices;
+    std::vector<unsigned int>& indices = m_stagingIndices;
+    if (vertices.empty())
+        return;
+
+    // Release any geometry from a previous load
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+    if (m_vbo) glDeleteBuffers(1, &m_vbo);
+    if (m_ibo) glDeleteBuffers(1, &m_ibo);
+    if (m_depthVao) glDeleteVertexArrays(1, &m_depthVao);
+    if (m_positionVbo) glDeleteBuffers(1, &m_positionVbo);
+
+    // Setup OpenGL buffers
+    glGenVertexArrays(1, &m_vao);
+    glBindVertexArray(m_vao);
+
+    // Vertex buffer
+    glGenBuffers(1, &m_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glBufferData(GL_ARRAY_BUFFER,
+        vertices.size() * sizeof(Vertex),
+        vertices.data(),
+        GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_TRUE, sizeof(Vertex), (void*)16);
+
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)32);
+
+    glGenBuffers(1, &m_ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+        indices.size() * sizeof(unsigned int),
+        indices.data(),
+        GL_STATIC_DRAW);
+
+    // Position-only stream for depth passes (a quarter of the full vertex size)
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (auto& vertex : vertices)
+        positions.push_back(glm::vec3(vertex.position));
+
+    glGenVertexArrays(1, &m_depthVao);
+    glBindVertexArray(m_depthVao);
+
+    glGenBuffers(1, &m_positionVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, m_positionVbo);
+    glBufferData(GL_ARRAY_BUFFER,
+        positions.size() * sizeof(glm::vec3),
+        positions.data(),
+        GL_STATIC_DRAW);
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+
+    m_geometryBytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(unsigned int) +
+        positions.size() * sizeof(glm::vec3);
+
+    // Unbind
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+    // The geometry now lives on the GPU
+    std::vector<Vertex>().swap(vertices);
+    std::vector<unsigned int>().swap(indices);
+}
+
 void Mesh::loadMaterial(const char* fileName) {
+    PROFILE_SCOPE("Mesh::loadMaterial");
     std::fstream file(fileName, std::ios::in);
     if (!file) {
         std::cerr << "Failed to open material file: " << fileName << std::endl;
@@ -189,27 +305,118 @@ void Mesh::loadMaterial(const char* fileName) {
     }
 }
 
-void Mesh::draw(aie::ShaderProgram* shader) {
+bool Mesh::buildTextureArray(unsigned int maxLayerSize) {
+    if (textures.empty()) {
+        std::cerr << "Warning: No textures to pack into a texture array" << std::endl;
+        return false;
+    }
+
+    // All layers share one size, so use the largest texture (capped) and let
+    // the blit below rescale anything that doesn't match
+    unsigned int layerSize = 1;
+    for (auto& entry : textures)
+        layerSize = std::max(layerSize, std::max(entry.second.getWidth(), entry.second.getHeight()));
+    layerSize = std::min(layerSize, maxLayerSize);
+
+    GLsizei layerCount = (GLsizei)textures.size();
+    GLsizei mipLevels = 1;
+    while ((layerSize >> mipLevels) > 0)
+        mipLevels++;
+
+    if (m_textureArray) glDeleteTextures(1, &m_textureArray);
+    glGenTextures(1, &m_textureArray);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, m_textureArray);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, mipLevels, GL_RGBA8, layerSize, layerSize, layerCount);
+    m_textureArrayBytes = (size_t)layerSize * layerSize * 4 * layerCount * 4 / 3;
+
+    // Copy each texture into its layer on the GPU, rescaling with linear filtering
+    GLuint framebuffers[2] = { 0, 0 };
+    glGenFramebuffers(2, framebuffers);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffers[0]);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffers[1]);
+
+    std::map<std::string, int> layers;
+    int layer = 0;
+    for (auto& entry : textures) {
+        const aie::Texture& texture = entry.second;
+        if (texture.getHandle() != 0) {
+            glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture.getHandle(), 0);
+            glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_textureArray, 0, layer);
+            glBlitFramebuffer(0, 0, texture.getWidth(), texture.getHeight(),
+                0, 0, layerSize, layerSize, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+        layers[entry.first] = layer++;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(2, framebuffers);
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    // Assign each submesh the layer of its material texture
+    auto fallback = layers.find("default-grey.jpg");
+    for (auto& sub : m_subMeshes) {
+        auto it = layers.find(resolveTextureName(sub.materialName));
+        if (it != layers.end())
+            sub.textureLayer = it->second;
+        else
+            sub.textureLayer = (fallback != layers.end()) ? fallback->second : 0;
+    }
+
+    return true;
+}
+
+size_t Mesh::getTextureBytes() const {
+    size_t bytes = m_textureArrayBytes;
+    for (auto& entry : textures)
+        bytes += (size_t)entry.second.getWidth() * entry.second.getHeight() * entry.second.getFormat();
+    return bytes;
+}
+
+void Mesh::draw(aie::ShaderProgram* shader, const std::vector<bool>* visibleSubMeshes) {
+    GL_STATS_SECTION("Mesh::draw");
+    PROFILE_SCOPE("Mesh::draw");
+
+    // Bind the shared VAO once
+    glBindVertexArray(m_vao);
+
     // For each submesh, apply its material & draw
     for (auto& sub : m_subMeshes) {
+        if (visibleSubMeshes != nullptr && !(*visibleSubMeshes)[&sub - m_subMeshes.data()])
+            continue;
+
         applyMaterial(shader, sub.materialName);
 
-        // Bind the VAO
-        glBindVertexArray(sub.vao);
-        glDrawElements(GL_TRIANGLES, sub.indexCount, GL_UNSIGNED_INT, 0);
+        glDrawElementsBaseVertex(GL_TRIANGLES, sub.indexCount, GL_UNSIGNED_INT,
+            (void*)(sub.firstIndex * sizeof(unsigned int)), sub.baseVertex);
     }
     // unbind
     glBindVertexArray(0);
 }
 
-void Mesh::applyMaterial(aie::ShaderProgram* shader, const std::string& textureName) const {
-    // Set material properties in the shader
-    shader->bindUniform("Ka", Ka);
-    shader->bindUniform("Kd", Kd);
-    shader->bindUniform("Ks", Ks);
-    shader->bindUniform("specularPower", specularPower);
+void Mesh::drawDepth(const std::vector<bool>* visibleSubMeshes) const {
+    GL_STATS_SECTION("Mesh::drawDepth");
+    PROFILE_SCOPE("Mesh::drawDepth");
+
+    glBindVertexArray(m_depthVao);
 
-    std::string correctedTextureName = textureName; // Store the texture name for potential correction
+    for (auto& sub : m_subMeshes) {
+        if (visibleSubMeshes != nullptr && !(*visibleSubMeshes)[&sub - m_subMeshes.data()])
+            continue;
+
+        glDrawElementsBaseVertex(GL_TRIANGLES, sub.indexCount, GL_UNSIGNED_INT,
+            (void*)(sub.firstIndex * sizeof(unsigned int)), sub.baseVertex);
+    }
+    glBindVertexArray(0);
+}
+
+std::string Mesh::resolveTextureName(const std::string& materialName) const {
+    std::string correctedTextureName = materialName; // Store the texture name for potential correction
 
     // If the texture name starts with "mat_", remove the "mat_#" prefix to extract the actual texture filename
     if (correctedTextureName.rfind("mat_", 0) == 0) {
@@ -225,9 +432,25 @@ void Mesh::applyMaterial(aie::ShaderProgram* shader, const std::string& textureN
         if (correctedTextureName == "mtl_001")
             correctedTextureName = "./textures/txt_001_diff.png";
     }
+    return correctedTextureName;
+}
+
+const aie::Texture* Mesh::findTexture(const std::string& materialName) const {
+    auto it = textures.find(resolveTextureName(materialName));
+    if (it == textures.end())
+        it = textures.find("default-grey.jpg");
+    return it != textures.end() ? &it->second : nullptr;
+}
+
+void Mesh::applyMaterial(aie::ShaderProgram* shader, const std::string& textureName) const {
+    // Set material properties in the shader
+    shader->bindUniform("Ka", Ka);
+    shader->bindUniform("Kd", Kd);
+    shader->bindUniform("Ks", Ks);
+    shader->bindUniform("specularPower", specularPower);
 
     // Attempt to find the corrected texture name in the texture map
-    auto it = textures.find(correctedTextureName);
+    auto it = textures.find(resolveTextureName(textureName));
     if (it != textures.end()) {
         glActiveTexture(GL_TEXTURE0); // Activate texture unit 0
         it->second.bind(0); // Bind the found texture to unit 0
@@ -16,11 +16,14 @@ class Mesh {
 public:
 
     // Structure to hold data for each submesh
+    // All submeshes share the mesh's vertex / index buffers and are addressed by offset
     struct SubMesh {
-        unsigned int vao = 0;
-        unsigned int vbo = 0;
-        unsigned int ibo = 0;
+        unsigned int firstIndex = 0;    // First index within the shared index buffer
+        int          baseVertex = 0;    // Offset added to each index within the shared vertex buffer
         unsigned int indexCount = 0;
+        int          textureLayer = 0;  // Layer within the packed texture array
+        glm::vec3    boundsMin = glm::vec3(0);  // Local-space bounding box
+        glm::vec3    boundsMax = glm::vec3(0);
         std::string  materialName;  // Material file name
     };
 
@@ -35,22 +38,88 @@ public:
 	virtual ~Mesh(); // Destructor
 
     // Loads a mesh from a file (supports multiple submeshes)
-    bool initialiseFromFile(const char* filename);
+    bool initialiseFromFile(const char* filename, unsigned int maxOccluderTriangles = 512);
+
+    // initialiseFromFile() in two halves, so a model can be parsed on a worker thread:
+    // loadFile() only touches CPU data, upload() creates the buffers on the GL thread
+    bool loadFile(const char* filename, unsigned int maxOccluderTriangles = 512);
+    void upload();
 
     // Loads a material file (.mtl) and its associated textures
     void loadMaterial(const char* fileName);
 
+    // Packs every loaded material texture into a single GL_TEXTURE_2D_ARRAY,
+    // one layer per texture, and assigns each submesh its layer
+    bool buildTextureArray(unsigned int maxLayerSize = 1024);
+
     // Draws the mesh with the given shader
-    void draw(aie::ShaderProgram* shader);
+    // If a visibility list is given, submeshes flagged false are skipped
+    void draw(aie::ShaderProgram* shader, const std::vector<bool>* visibleSubMeshes = nullptr);
+
+    // Draws positions only (no material binds), for depth-only passes
+    void drawDepth(const std::vector<bool>* visibleSubMeshes = nullptr) const;
 
     // Applies a named material from internal texture storage
     void applyMaterial(aie::ShaderProgram* shader, const std::string& textureName) const;
 
+    // Texture a material name resolves to, falling back to default-grey.jpg, or nullptr
+    // Touches no GL state, so it can be called while recording commands on a worker
+    const aie::Texture* findTexture(const std::string& materialName) const;
+
+    // Accessors used by batched / indirect rendering
+    const std::vector<SubMesh>& getSubMeshes() const { return m_subMeshes; }
+    unsigned int getVAO() const { return m_vao; }
+    unsigned int getDepthVAO() const { return m_depthVao; }
+    unsigned int getTextureArray() const { return m_textureArray; }
+    const glm::vec3& getAmbient() const { return Ka; }
+    const glm::vec3& getDiffuse() const { return Kd; }
+    const glm::vec3& getSpecular() const { return Ks; }
+    float getSpecularPower() const { return specularPower; }
+
+    // Local-space bounds of the whole mesh
+    const glm::vec3& getBoundsMin() const { return m_boundsMin; }
+    const glm::vec3& getBoundsMax() const { return m_boundsMax; }
+
+    // Simplified occluder geometry (triangle list, 3 vertices per triangle) made of
+    // the mesh's largest triangles, so it never covers more than the mesh itself
+    const std::vector<glm::vec3>& getOccluderTriangles() const { return m_occluderTriangles; }
+
+    // Approximate GPU memory held by the uploaded buffers, and by the material
+    // textures plus the packed texture array with its mips
+    size_t getGeometryBytes() const { return m_geometryBytes; }
+    size_t getTextureBytes() const;
+    unsigned int getTextureCount() const { return (unsigned int)textures.size(); }
 
 protected:
+    // Maps an OBJ material name onto the key of its texture in the texture storage
+    std::string resolveTextureName(const std::string& materialName) const;
+
     // Stores all submeshes of the model
     std::vector<SubMesh> m_subMeshes;
 
+    // Shared geometry for all submeshes
+    unsigned int m_vao;
+    unsigned int m_vbo;
+    unsigned int m_ibo;
+
+    // Position-only stream sharing the index buffer, for depth-only passes
+    unsigned int m_depthVao;
+    unsigned int m_positionVbo;
+    size_t m_geometryBytes;
+
+    // Geometry parsed by loadFile(), held until upload()
+    std::vector<Vertex> m_stagingVertices;
+    std::vector<unsigned int> m_stagingIndices;
+
+    // Local-space bounds and CPU occluder geometry, built at load
+    glm::vec3 m_boundsMin;
+    glm::vec3 m_boundsMax;
+    std::vector<glm::vec3> m_occluderTriangles;
+
+    // Packed material textures (0 until buildTextureArray() succeeds)
+    unsigned int m_textureArray;
+    size_t m_textureArrayBytes;
+
     // Material properties (Phong lighting)
     glm::vec3 Ka; // Ambient reflectance
     glm::vec3 Kd; // Diffuse reflectance
@@ -58,6 +127,6 @@ protected:
     float specularPower; // Shininess factor
 
     // Texture storage
-    std::map<std::string, aie::Texture> textures; 
+    std::map<std::string, aie::Texture> textures;
 
 };
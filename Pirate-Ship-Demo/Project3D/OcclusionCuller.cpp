@@ -0,0 +1,276 @@
+#include "OcclusionCuller.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cfloat>
+#include <cmath>
+#include <thread>
+#include <emmintrin.h>
+
+// Clip-space w below this is treated as behind the near plane
+static const float MIN_W = 1e-4f;
+
+OcclusionCuller::OcclusionCuller(unsigned int width, unsigned int height, unsigned int threadCount)
+    : m_width(0),
+    m_height(0),
+    m_tilesX(0),
+    m_tilesY(0),
+    m_threadCount(threadCount),
+    m_projectionView(1.0f),
+    m_rasterizeTime(0.0f) {
+
+    if (m_threadCount == 0) {
+        // Leave a core for the main thread, but don't go wider than the buffer benefits from
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        m_threadCount = std::clamp(hardwareThreads > 1 ? hardwareThreads - 1 : 1u, 1u, 4u);
+    }
+
+    resize(width, height);
+}
+
+OcclusionCuller::~OcclusionCuller() {
+}
+
+void OcclusionCuller::resize(unsigned int width, unsigned int height) {
+    m_tilesX = (width + TILE_WIDTH - 1) / TILE_WIDTH;
+    m_tilesY = (height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    m_width = m_tilesX * TILE_WIDTH;
+    m_height = m_tilesY * TILE_HEIGHT;
+
+    m_depth.assign((size_t)m_width * m_height, 1.0f);
+    m_tileDepth.assign((size_t)m_tilesX * m_tilesY, 1.0f);
+}
+
+void OcclusionCuller::begin(const glm::mat4& projectionView) {
+    m_projectionView = projectionView;
+    m_triangles.clear();
+}
+
+void OcclusionCuller::addOccluder(const std::vector<glm::vec3>& triangles, const glm::mat4& transform) {
+    glm::mat4 pvm = m_projectionView * transform;
+    float halfWidth = m_width * 0.5f;
+    float halfHeight = m_height * 0.5f;
+
+    for (size_t i = 0; i + 2 < triangles.size(); i += 3) {
+        ScreenTriangle triangle;
+        bool clipped = false;
+
+        for (int v = 0; v < 3; v++) {
+            glm::vec4 clip = pvm * glm::vec4(triangles[i + v], 1.0f);
+
+            // Occluders may be dropped freely, so skip anything crossing the near plane
+            if (clip.w < MIN_W || clip.z < -clip.w) {
+                clipped = true;
+                break;
+            }
+
+            float invW = 1.0f / clip.w;
+            triangle.x[v] = (clip.x * invW + 1.0f) * halfWidth;
+            triangle.y[v] = (clip.y * invW + 1.0f) * halfHeight;
+            triangle.z[v] = std::min(clip.z * invW * 0.5f + 0.5f, 1.0f);
+        }
+        if (clipped)
+            continue;
+
+        float minX = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+        float maxX = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+        float minY = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+        float maxY = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+
+        // Reject triangles entirely off screen
+        if (maxX < 0 || maxY < 0 || minX >= m_width || minY >= m_height)
+            continue;
+
+        triangle.minY = std::max(0, (int)std::floor(minY));
+        triangle.maxY = std::min((int)m_height - 1, (int)std::ceil(maxY));
+        m_triangles.push_back(triangle);
+    }
+}
+
+void OcclusionCuller::rasterize() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // Bands are whole rows of tiles so each thread can also build its own tile depths
+    unsigned int bandCount = std::min(m_threadCount, m_tilesY);
+    unsigned int tileRowsPerBand = (m_tilesY + bandCount - 1) / bandCount;
+
+    auto band = [this, tileRowsPerBand](unsigned int index) {
+        unsigned int tileRowBegin = index * tileRowsPerBand;
+        unsigned int tileRowEnd = std::min(tileRowBegin + tileRowsPerBand, m_tilesY);
+        if (tileRowBegin >= tileRowEnd)
+            return;
+        rasterizeBand(tileRowBegin * TILE_HEIGHT, tileRowEnd * TILE_HEIGHT);
+        updateTiles(tileRowBegin, tileRowEnd);
+    };
+
+    aie::JobSystem::getInstance()->parallelFor(bandCount, [&band](unsigned int first, unsigned int last) {
+        for (unsigned int i = first; i < last; i++)
+            band(i);
+    }, 1);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    m_rasterizeTime = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
+void OcclusionCuller::rasterizeBand(unsigned int rowBegin, unsigned int rowEnd) {
+    std::fill(m_depth.begin() + (size_t)rowBegin * m_width, m_depth.begin() + (size_t)rowEnd * m_width, 1.0f);
+
+    for (auto& triangle : m_triangles) {
+        if (triangle.maxY < (int)rowBegin || triangle.minY >= (int)rowEnd)
+            continue;
+        rasterizeTriangle(triangle, (int)rowBegin, (int)rowEnd);
+    }
+}
+
+void OcclusionCuller::rasterizeTriangle(const ScreenTriangle& t, int rowBegin, int rowEnd) {
+    float x0 = t.x[0], y0 = t.y[0], z0 = t.z[0];
+    float x1 = t.x[1], y1 = t.y[1], z1 = t.z[1];
+    float x2 = t.x[2], y2 = t.y[2], z2 = t.z[2];
+
+    // Occluders are double sided, so wind everything counter-clockwise
+    float area = (x1 - x0) * (y2 - y0) - (x2 - x0) * (y1 - y0);
+    if (std::fabs(area) < 1e-6f)
+        return;
+    if (area < 0) {
+        std::swap(x1, x2); std::swap(y1, y2); std::swap(z1, z2);
+        area = -area;
+    }
+
+    // Edge functions E(x,y) = A*x + B*y + C, each weighting the opposite vertex
+    float A0 = y1 - y2, B0 = x2 - x1, C0 = x1 * y2 - x2 * y1;
+    float A1 = y2 - y0, B1 = x0 - x2, C1 = x2 * y0 - x0 * y2;
+    float A2 = y0 - y1, B2 = x1 - x0, C2 = x0 * y1 - x1 * y0;
+
+    // Depth plane from the barycentric weights
+    float invArea = 1.0f / area;
+    float Zx = (A0 * z0 + A1 * z1 + A2 * z2) * invArea;
+    float Zy = (B0 * z0 + B1 * z1 + B2 * z2) * invArea;
+    float Zc = (C0 * z0 + C1 * z1 + C2 * z2) * invArea;
+
+    int minX = std::max(0, (int)std::floor(std::min({ x0, x1, x2 }))) & ~3;
+    int maxX = std::min((int)m_width - 1, (int)std::ceil(std::max({ x0, x1, x2 })));
+    int minY = std::max(t.minY, rowBegin);
+    int maxY = std::min(t.maxY, rowEnd - 1);
+
+    const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 a0 = _mm_set1_ps(A0), a1 = _mm_set1_ps(A1), a2 = _mm_set1_ps(A2);
+    const __m128 zx = _mm_set1_ps(Zx);
+    const __m128 four = _mm_set1_ps(4.0f);
+
+    for (int y = minY; y <= maxY; y++) {
+        float py = y + 0.5f;
+        __m128 px = _mm_add_ps(_mm_set1_ps((float)minX), laneOffsets);
+
+        // Row constants, then step four pixels at a time along x
+        __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, px), _mm_set1_ps(B0 * py + C0));
+        __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, px), _mm_set1_ps(B1 * py + C1));
+        __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, px), _mm_set1_ps(B2 * py + C2));
+        __m128 z = _mm_add_ps(_mm_mul_ps(zx, px), _mm_set1_ps(Zy * py + Zc));
+
+        __m128 e0Step = _mm_mul_ps(a0, four);
+        __m128 e1Step = _mm_mul_ps(a1, four);
+        __m128 e2Step = _mm_mul_ps(a2, four);
+        __m128 zStep = _mm_mul_ps(zx, four);
+
+        float* row = m_depth.data() + (size_t)y * m_width;
+        for (int x = minX; x <= maxX; x += 4) {
+            __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+
+            if (_mm_movemask_ps(inside) != 0) {
+                __m128 depth = _mm_loadu_ps(row + x);
+                __m128 nearest = _mm_min_ps(depth, z);
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, depth)));
+            }
+
+            e0 = _mm_add_ps(e0, e0Step);
+            e1 = _mm_add_ps(e1, e1Step);
+            e2 = _mm_add_ps(e2, e2Step);
+            z = _mm_add_ps(z, zStep);
+        }
+    }
+}
+
+void OcclusionCuller::updateTiles(unsigned int tileRowBegin, unsigned int tileRowEnd) {
+    for (unsigned int ty = tileRowBegin; ty < tileRowEnd; ty++) {
+        for (unsigned int tx = 0; tx < m_tilesX; tx++) {
+            __m128 farthest = _mm_setzero_ps();
+            for (unsigned int y = 0; y < TILE_HEIGHT; y++) {
+                const float* row = m_depth.data() + (size_t)(ty * TILE_HEIGHT + y) * m_width + tx * TILE_WIDTH;
+                for (unsigned int x = 0; x < TILE_WIDTH; x += 4)
+                    farthest = _mm_max_ps(farthest, _mm_loadu_ps(row + x));
+            }
+
+            // Horizontal max of the four lanes
+            farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+            farthest = _mm_max_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+            m_tileDepth[ty * m_tilesX + tx] = _mm_cvtss_f32(farthest);
+        }
+    }
+}
+
+bool OcclusionCuller::isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& transform) const {
+    glm::mat4 pvm = m_projectionView * transform;
+
+    glm::vec3 ndcMin(FLT_MAX), ndcMax(-FLT_MAX);
+    int cornersBehind = 0;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 local((corner & 1) ? boundsMax.x : boundsMin.x,
+            (corner & 2) ? boundsMax.y : boundsMin.y,
+            (corner & 4) ? boundsMax.z : boundsMin.z);
+        glm::vec4 clip = pvm * glm::vec4(local, 1.0f);
+
+        if (clip.w < MIN_W) {
+            cornersBehind++;
+            continue;
+        }
+
+        glm::vec3 ndc = glm::vec3(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+
+    // Entirely behind the camera, or crossing the near plane (assume visible)
+    if (cornersBehind == 8)
+        return false;
+    if (cornersBehind > 0)
+        return true;
+
+    // Frustum rejection
+    if (ndcMax.x < -1 || ndcMin.x > 1 || ndcMax.y < -1 || ndcMin.y > 1 || ndcMin.z > 1)
+        return false;
+
+    float nearestDepth = std::max(ndcMin.z * 0.5f + 0.5f, 0.0f);
+
+    int x0 = std::max(0, (int)std::floor((ndcMin.x + 1.0f) * 0.5f * m_width));
+    int x1 = std::min((int)m_width - 1, (int)std::floor((ndcMax.x + 1.0f) * 0.5f * m_width));
+    int y0 = std::max(0, (int)std::floor((ndcMin.y + 1.0f) * 0.5f * m_height));
+    int y1 = std::min((int)m_height - 1, (int)std::floor((ndcMax.y + 1.0f) * 0.5f * m_height));
+
+    const __m128 nearest = _mm_set1_ps(nearestDepth);
+
+    for (int ty = y0 / (int)TILE_HEIGHT; ty <= y1 / (int)TILE_HEIGHT; ty++) {
+        for (int tx = x0 / (int)TILE_WIDTH; tx <= x1 / (int)TILE_WIDTH; tx++) {
+
+            // Coarse test: the box is behind the farthest occluder depth in this tile, so hidden here
+            if (nearestDepth > m_tileDepth[ty * m_tilesX + tx])
+                continue;
+
+            // Fine test over the part of the tile the box covers
+            int rowBegin = std::max(y0, ty * (int)TILE_HEIGHT);
+            int rowEnd = std::min(y1, (ty + 1) * (int)TILE_HEIGHT - 1);
+            int columnBegin = std::max(x0, tx * (int)TILE_WIDTH) & ~3;
+            int columnEnd = std::min(x1, (tx + 1) * (int)TILE_WIDTH - 1);
+
+            for (int y = rowBegin; y <= rowEnd; y++) {
+                const float* row = m_depth.data() + (size_t)y * m_width;
+                for (int x = columnBegin; x <= columnEnd; x += 4) {
+                    if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), nearest)) != 0)
+                        return true;
+                }
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+// CPU software occlusion culling
+// Occluder triangles are rasterized into a small tiled depth buffer using SSE,
+// split into horizontal bands run as parallel jobs. A coarse per-tile maximum
+// depth lets most bounds tests be resolved without touching individual pixels.
+// Nothing in here touches OpenGL, so it can be driven headless (e.g. in tests).
+class OcclusionCuller {
+public:
+
+    // Tile dimensions for the hierarchical (coarse) depth buffer
+    static const unsigned int TILE_WIDTH = 8;
+    static const unsigned int TILE_HEIGHT = 8;
+
+    // Width is rounded up to a multiple of TILE_WIDTH, height to TILE_HEIGHT
+    // The work is split into up to threadCount parallel jobs
+    // A thread count of 0 picks one based on the available hardware threads
+    OcclusionCuller(unsigned int width = 320, unsigned int height = 192, unsigned int threadCount = 0);
+    ~OcclusionCuller();
+
+    // Resizes the depth buffer
+    void resize(unsigned int width, unsigned int height);
+
+    // Starts a new frame with the given camera; clears all queued occluders
+    void begin(const glm::mat4& projectionView);
+
+    // Queues occluder triangles (3 vertices per triangle) with a local-to-world transform
+    void addOccluder(const std::vector<glm::vec3>& triangles, const glm::mat4& transform);
+
+    // Rasterizes all queued occluders and builds the coarse tile depths
+    void rasterize();
+
+    // Returns true if any part of the box (local space bounds + transform) may be visible
+    // Boxes outside the view frustum are reported as not visible
+    bool isVisible(const glm::vec3& boundsMin, const glm::vec3& boundsMax, const glm::mat4& transform) const;
+
+    // Depth buffer access (row-major, 0 = near, 1 = far)
+    unsigned int getWidth() const { return m_width; }
+    unsigned int getHeight() const { return m_height; }
+    const float* getDepthBuffer() const { return m_depth.data(); }
+
+    // Statistics for the last frame
+    unsigned int getOccluderTriangleCount() const { return (unsigned int)(m_triangles.size()); }
+    float getRasterizeTime() const { return m_rasterizeTime; } // milliseconds
+    unsigned int getThreadCount() const { return m_threadCount; }
+
+protected:
+
+    // Screen-space occluder triangle, ready for rasterization
+    struct ScreenTriangle {
+        float x[3], y[3], z[3];
+        int minY, maxY;
+    };
+
+    // Rasterizes every triangle overlapping the rows [rowBegin, rowEnd)
+    void rasterizeBand(unsigned int rowBegin, unsigned int rowEnd);
+    void rasterizeTriangle(const ScreenTriangle& triangle, int rowBegin, int rowEnd);
+
+    // Computes the maximum depth of each tile in the rows [tileRowBegin, tileRowEnd)
+    void updateTiles(unsigned int tileRowBegin, unsigned int tileRowEnd);
+
+    unsigned int m_width;
+    unsigned int m_height;
+    unsigned int m_tilesX;
+    unsigned int m_tilesY;
+    unsigned int m_threadCount;
+
+    glm::mat4 m_projectionView;
+
+    std::vector<float> m_depth;     // Per-pixel depth, rows are a multiple of 4 floats
+    std::vector<float> m_tileDepth; // Farthest depth within each tile
+
+    std::vector<ScreenTriangle> m_triangles;
+
+    float m_rasterizeTime;
+};
@@ -0,0 +1,173 @@
+#include "PostProcess.h"
+#include "glad.h"
+#include <algorithm>
+#include <cmath>
+
+PostProcess::PostProcess()
+    : bloomThreshold(1.0f),
+    bloomIntensity(0.3f),
+    exposure(1.0f),
+    m_vao(0),
+    m_bloomQuality(BLOOM_MEDIUM),
+    m_bloomDivisor(2),
+    m_builtQuality(-1),
+    m_blurWeights{},
+    m_blurOffsets{},
+    m_blurTaps(0) {
+}
+
+PostProcess::~PostProcess() {
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+}
+
+bool PostProcess::initialise() {
+    m_downsampleShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/fullscreen.vert");
+    m_downsampleShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/bloom_downsample.frag");
+    m_blurShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/fullscreen.vert");
+    m_blurShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/blur.frag");
+    m_upsampleShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/fullscreen.vert");
+    m_upsampleShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/bloom_upsample.frag");
+    m_tonemapShader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/fullscreen.vert");
+    m_tonemapShader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/tonemap.frag");
+
+    glGenVertexArrays(1, &m_vao);
+    return m_downsampleShader.link() && m_blurShader.link() &&
+        m_upsampleShader.link() && m_tonemapShader.link();
+}
+
+void PostProcess::updateBlurKernel() {
+    // Discrete Gaussian of the quality's radius, then pairs of taps merged into one
+    // bilinear fetch placed between them (weighted by their contribution)
+    const int radii[] = { 0, 2, 4, 6 };
+    int radius = radii[m_bloomQuality];
+    float sigma = std::max(radius * 0.5f, 1.0f);
+
+    float discrete[7] = {};
+    float total = 0;
+    for (int i = 0; i <= radius; i++) {
+        discrete[i] = std::exp(-(float)(i * i) / (2.0f * sigma * sigma));
+        total += i == 0 ? discrete[i] : discrete[i] * 2.0f;
+    }
+
+    m_blurTaps = 0;
+    m_blurWeights[m_blurTaps] = discrete[0] / total;
+    m_blurOffsets[m_blurTaps++] = 0.0f;
+    for (int i = 1; i <= radius; i += 2) {
+        float a = discrete[i];
+        float b = i + 1 <= radius ? discrete[i + 1] : 0.0f;
+        m_blurWeights[m_blurTaps] = (a + b) / total;
+        m_blurOffsets[m_blurTaps++] = (i * a + (i + 1) * b) / (a + b);
+    }
+}
+
+void PostProcess::drawFullscreen(bool additive) const {
+    glDisable(GL_DEPTH_TEST);
+    if (additive) {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+    }
+    else {
+        glDisable(GL_BLEND);
+    }
+
+    glBindVertexArray(m_vao);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindVertexArray(0);
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+void PostProcess::addPasses(RenderGraph& graph, RenderGraph::Handle sceneColour, RenderGraph::Handle& output) {
+    if (m_builtQuality != m_bloomQuality) {
+        updateBlurKernel();
+        m_builtQuality = m_bloomQuality;
+    }
+
+    // Bloom pyramid, halving from the configured starting resolution
+    const unsigned int levelCounts[] = { 0, 3, 4, 5 };
+    unsigned int levelWidth = std::max(graph.getWidth(sceneColour) / m_bloomDivisor, 1u);
+    unsigned int levelHeight = std::max(graph.getHeight(sceneColour) / m_bloomDivisor, 1u);
+    std::vector<RenderGraph::Handle> levels;
+    for (unsigned int i = 0; i < levelCounts[m_bloomQuality] && levelWidth > 1 && levelHeight > 1; i++) {
+        levels.push_back(graph.createTexture("Bloom Level", { levelWidth, levelHeight, GL_R11F_G11F_B10F, true }));
+        levelWidth /= 2;
+        levelHeight /= 2;
+    }
+
+    // Bright pass into the first level, then successive downsamples
+    for (size_t i = 0; i < levels.size(); i++) {
+        RenderGraph::Handle source = i == 0 ? sceneColour : levels[i - 1];
+        float threshold = i == 0 ? bloomThreshold : -1.0f;
+        float tapSpread = i == 0 ? m_bloomDivisor * 0.5f : 1.0f;
+        graph.addPass("Bloom Downsample", "Bloom", [this, source, threshold, tapSpread](RenderGraph& graph) {
+            m_downsampleShader.bind();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.getTexture(source));
+            m_downsampleShader.bindUniform("SourceTex", 0);
+            m_downsampleShader.bindUniform("Threshold", threshold);
+            m_downsampleShader.bindUniform("TapSpread", tapSpread);
+            drawFullscreen();
+        }).read(source).writeColour(levels[i]);
+    }
+
+    // Separable blur of every level, horizontal into a temporary then vertical into a new target
+    auto addBlur = [&](RenderGraph::Handle source, RenderGraph::Handle& target, const glm::vec2& direction) {
+        graph.addPass("Bloom Blur", "Bloom", [this, source, direction](RenderGraph& graph) {
+            m_blurShader.bind();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.getTexture(source));
+            m_blurShader.bindUniform("SourceTex", 0);
+            m_blurShader.bindUniform("TapCount", m_blurTaps);
+            m_blurShader.bindUniform("Weights", (int)MAX_BLUR_TAPS, m_blurWeights);
+            m_blurShader.bindUniform("Offsets", (int)MAX_BLUR_TAPS, m_blurOffsets);
+            m_blurShader.bindUniform("Direction", direction);
+            drawFullscreen();
+        }).read(source).writeColour(target);
+    };
+    for (auto& level : levels) {
+        unsigned int width = graph.getWidth(level);
+        unsigned int height = graph.getHeight(level);
+        RenderGraph::Handle horizontal = graph.createTexture("Bloom Blur", { width, height, GL_R11F_G11F_B10F, true });
+        RenderGraph::Handle blurred = graph.createTexture("Bloom Level Blurred", { width, height, GL_R11F_G11F_B10F, true });
+        addBlur(level, horizontal, glm::vec2(1.0f / width, 0.0f));
+        addBlur(horizontal, blurred, glm::vec2(0.0f, 1.0f / height));
+        level = blurred;
+    }
+
+    // Accumulate from the smallest level back up into the first
+    for (size_t i = levels.size(); i > 1; i--) {
+        RenderGraph::Handle source = levels[i - 1];
+        graph.addPass("Bloom Upsample", "Bloom", [this, source](RenderGraph& graph) {
+            m_upsampleShader.bind();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, graph.getTexture(source));
+            m_upsampleShader.bindUniform("SourceTex", 0);
+            drawFullscreen(true);
+        }).read(source).writeColour(levels[i - 2], RenderGraph::LOAD_KEEP);
+    }
+
+    // Resolve: bloom, exposure and tone curve
+    RenderGraph::Handle bloom = levels.empty() ? RenderGraph::INVALID_HANDLE : levels[0];
+    float intensity = levels.empty() ? 0.0f : bloomIntensity;
+    float exposureScale = exposure;
+    RenderGraph::Builder tonemap = graph.addPass("Tonemap", "Tonemap",
+        [this, sceneColour, bloom, intensity, exposureScale](RenderGraph& graph) {
+        m_tonemapShader.bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, graph.getTexture(sceneColour));
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, bloom != RenderGraph::INVALID_HANDLE ? graph.getTexture(bloom) : 0);
+        glActiveTexture(GL_TEXTURE0);
+        m_tonemapShader.bindUniform("SceneTex", 0);
+        m_tonemapShader.bindUniform("BloomTex", 1);
+        m_tonemapShader.bindUniform("BloomIntensity", intensity);
+        m_tonemapShader.bindUniform("Exposure", exposureScale);
+        drawFullscreen();
+    });
+    tonemap.read(sceneColour);
+    if (bloom != RenderGraph::INVALID_HANDLE)
+        tonemap.read(bloom);
+    tonemap.writeColour(output);
+}
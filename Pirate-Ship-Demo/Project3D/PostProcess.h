@@ -0,0 +1,62 @@
+#pragma once
+#include <vector>
+#include "Shader.h"
+#include "RenderGraph.h"
+
+// HDR post-processing stack
+// The scene renders into an RGBA16F target. Bloom extracts bright pixels into a
+// reduced resolution pyramid, blurs each level with a separable Gaussian and sums
+// the levels back up; the resolve pass adds bloom, applies exposure and a filmic
+// tone curve, and writes the result to the output target.
+// Every pyramid level is a transient render graph texture.
+class PostProcess {
+public:
+
+    enum BloomQuality : int {
+        BLOOM_OFF,
+        BLOOM_LOW,      // 3 levels, 5 tap blur
+        BLOOM_MEDIUM,   // 4 levels, 9 tap blur
+        BLOOM_HIGH      // 5 levels, 13 tap blur
+    };
+
+    PostProcess();
+    ~PostProcess();
+
+    // Loads the post-processing shaders
+    bool initialise();
+
+    // Adds the bloom and tone mapping passes that resolve the HDR scene colour into output
+    void addPasses(RenderGraph& graph, RenderGraph::Handle sceneColour, RenderGraph::Handle& output);
+
+    // Settings
+    void setBloomQuality(int quality) { m_bloomQuality = quality; }
+    int getBloomQuality() const { return m_bloomQuality; }
+    void setBloomDivisor(unsigned int divisor) { m_bloomDivisor = divisor; }   // 2 = half, 4 = quarter resolution
+    unsigned int getBloomDivisor() const { return m_bloomDivisor; }
+    float bloomThreshold;   // Luminance where bloom starts
+    float bloomIntensity;   // Strength of the bloom added back
+    float exposure;         // Linear scale applied before the tone curve
+
+protected:
+
+    // Draws a full-screen triangle without depth testing, optionally blending additively
+    void drawFullscreen(bool additive = false) const;
+
+    // Builds the linear-sampled Gaussian weights for the current quality
+    void updateBlurKernel();
+
+    aie::ShaderProgram m_downsampleShader;
+    aie::ShaderProgram m_blurShader;
+    aie::ShaderProgram m_upsampleShader;
+    aie::ShaderProgram m_tonemapShader;
+    unsigned int m_vao;
+
+    int m_bloomQuality;
+    unsigned int m_bloomDivisor;
+    int m_builtQuality;                 // Quality the blur kernel was built for
+
+    static const unsigned int MAX_BLUR_TAPS = 8;
+    float m_blurWeights[MAX_BLUR_TAPS];
+    float m_blurOffsets[MAX_BLUR_TAPS];
+    int m_blurTaps;
+};
@@ -0,0 +1,173 @@
+#include "RenderCommands.h"
+#include "glad.h"
+#include <algorithm>
+
+void RenderCommandBuffer::clear() {
+    m_commands.clear();
+    m_matrices.clear();
+}
+
+void RenderCommandBuffer::setTransform(const glm::mat4& projectionViewModel, const glm::mat4& modelMatrix) {
+    RenderCommand command = {};
+    command.type = RenderCommand::SET_TRANSFORM;
+    command.index = (unsigned int)m_matrices.size();
+    m_matrices.push_back(projectionViewModel);
+    m_matrices.push_back(modelMatrix);
+    m_commands.push_back(command);
+}
+
+void RenderCommandBuffer::setTilingFactor(float tilingFactor) {
+    RenderCommand command = {};
+    command.type = RenderCommand::SET_TILING;
+    command.value = tilingFactor;
+    m_commands.push_back(command);
+}
+
+void RenderCommandBuffer::drawMesh(const Mesh& mesh, const std::vector<bool>* visibleSubMeshes) {
+    const std::vector<Mesh::SubMesh>& subMeshes = mesh.getSubMeshes();
+    for (unsigned int i = 0; i < (unsigned int)subMeshes.size(); i++) {
+        if (visibleSubMeshes != nullptr && !(*visibleSubMeshes)[i])
+            continue;
+
+        RenderCommand command = {};
+        command.type = RenderCommand::DRAW_SUBMESH;
+        command.index = i;
+        command.mesh = &mesh;
+        command.texture = mesh.findTexture(subMeshes[i].materialName);
+        m_commands.push_back(command);
+    }
+}
+
+void RenderCommandBuffer::drawMeshDepth(const Mesh& mesh, const std::vector<bool>* visibleSubMeshes) {
+    const std::vector<Mesh::SubMesh>& subMeshes = mesh.getSubMeshes();
+    for (unsigned int i = 0; i < (unsigned int)subMeshes.size(); i++) {
+        if (visibleSubMeshes != nullptr && !(*visibleSubMeshes)[i])
+            continue;
+
+        RenderCommand command = {};
+        command.type = RenderCommand::DRAW_SUBMESH_DEPTH;
+        command.index = i;
+        command.mesh = &mesh;
+        m_commands.push_back(command);
+    }
+}
+
+RenderQueue::RenderQueue()
+    : m_bufferCount(0) {
+}
+
+RenderQueue::~RenderQueue() {
+    wait();
+}
+
+void RenderQueue::record(unsigned int count, const RecordFunction& function, unsigned int jobCount) {
+    // The previous recording may still be running if it was never replayed
+    wait();
+
+    aie::JobSystem* jobs = aie::JobSystem::getInstance();
+    if (jobCount == 0)
+        jobCount = jobs->getWorkerCount();
+    m_bufferCount = std::min(jobCount, count);
+    if (m_buffers.size() < m_bufferCount)
+        m_buffers.resize(m_bufferCount);
+    m_function = function;
+
+    jobs->beginBatch(m_recorded);
+    for (unsigned int i = 0; i < m_bufferCount; i++) {
+        unsigned int begin = (unsigned int)((unsigned long long)count * i / m_bufferCount);
+        unsigned int end = (unsigned int)((unsigned long long)count * (i + 1) / m_bufferCount);
+        jobs->submit([this, i, begin, end]() {
+            m_buffers[i].clear();
+            m_function(m_buffers[i], begin, end);
+        }, &m_recorded);
+    }
+    jobs->endBatch(m_recorded);
+}
+
+void RenderQueue::wait() {
+    if (!m_recorded.isDone())
+        aie::JobSystem::getInstance()->wait(m_recorded);
+}
+
+void RenderQueue::execute(const aie::ShaderProgram& shader) {
+    wait();
+
+    // Locations are looked up once per pass instead of by name for every draw
+    int projectionViewModelLocation = shader.getUniform("ProjectionViewModel");
+    int modelMatrixLocation = shader.getUniform("ModelMatrix");
+    int tilingFactorLocation = shader.getUniform("tilingFactor");
+    int ambientLocation = shader.getUniform("Ka");
+    int diffuseLocation = shader.getUniform("Kd");
+    int specularLocation = shader.getUniform("Ks");
+    int specularPowerLocation = shader.getUniform("specularPower");
+    int diffuseTexLocation = shader.getUniform("diffuseTex");
+    if (diffuseTexLocation >= 0)
+        glUniform1i(diffuseTexLocation, 0);
+
+    // Redundant VAO, material, texture and tiling changes are filtered out
+    const Mesh* boundMesh = nullptr;
+    bool boundDepthOnly = false;
+    const aie::Texture* boundTexture = nullptr;
+    float tilingFactor = 0.0f;
+    bool tilingSet = false;
+
+    for (unsigned int b = 0; b < m_bufferCount; b++) {
+        const RenderCommandBuffer& buffer = m_buffers[b];
+        for (const RenderCommand& command : buffer.m_commands) {
+            switch (command.type) {
+            case RenderCommand::SET_TRANSFORM:
+                if (projectionViewModelLocation >= 0)
+                    glUniformMatrix4fv(projectionViewModelLocation, 1, GL_FALSE, &buffer.m_matrices[command.index][0][0]);
+                if (modelMatrixLocation >= 0)
+                    glUniformMatrix4fv(modelMatrixLocation, 1, GL_FALSE, &buffer.m_matrices[command.index + 1][0][0]);
+                break;
+
+            case RenderCommand::SET_TILING:
+                if (tilingFactorLocation >= 0 && (!tilingSet || command.value != tilingFactor)) {
+                    glUniform1f(tilingFactorLocation, command.value);
+                    tilingFactor = command.value;
+                    tilingSet = true;
+                }
+                break;
+
+            case RenderCommand::DRAW_SUBMESH:
+            case RenderCommand::DRAW_SUBMESH_DEPTH: {
+                bool depthOnly = command.type == RenderCommand::DRAW_SUBMESH_DEPTH;
+                if (command.mesh != boundMesh || depthOnly != boundDepthOnly) {
+                    glBindVertexArray(depthOnly ? command.mesh->getDepthVAO() : command.mesh->getVAO());
+                    if (!depthOnly) {
+                        if (ambientLocation >= 0)
+                            glUniform3fv(ambientLocation, 1, &command.mesh->getAmbient()[0]);
+                        if (diffuseLocation >= 0)
+                            glUniform3fv(diffuseLocation, 1, &command.mesh->getDiffuse()[0]);
+                        if (specularLocation >= 0)
+                            glUniform3fv(specularLocation, 1, &command.mesh->getSpecular()[0]);
+                        if (specularPowerLocation >= 0)
+                            glUniform1f(specularPowerLocation, command.mesh->getSpecularPower());
+                    }
+                    boundMesh = command.mesh;
+                    boundDepthOnly = depthOnly;
+                }
+
+                if (command.texture != nullptr && command.texture != boundTexture) {
+                    command.texture->bind(0);
+                    boundTexture = command.texture;
+                }
+
+                const Mesh::SubMesh& sub = command.mesh->getSubMeshes()[command.index];
+                glDrawElementsBaseVertex(GL_TRIANGLES, sub.indexCount, GL_UNSIGNED_INT,
+                    (void*)(sub.firstIndex * sizeof(unsigned int)), sub.baseVertex);
+                break;
+            }
+            }
+        }
+    }
+    glBindVertexArray(0);
+}
+
+unsigned int RenderQueue::getCommandCount() const {
+    unsigned int count = 0;
+    for (unsigned int b = 0; b < m_bufferCount; b++)
+        count += m_buffers[b].getCommandCount();
+    return count;
+}
@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <functional>
+#include <glm/glm.hpp>
+#include "JobSystem.h"
+#include "Mesh.h"
+#include "Shader.h"
+
+// One recorded draw-state change or draw call
+// Plain data only: recording never touches GL, and replay needs nothing but the command
+struct RenderCommand {
+    enum Type : unsigned int {
+        SET_TRANSFORM,      // ProjectionViewModel and ModelMatrix, from the buffer's matrices at index
+        SET_TILING,         // tilingFactor = value
+        DRAW_SUBMESH,       // Submesh index of mesh with its material and texture
+        DRAW_SUBMESH_DEPTH  // Submesh index of mesh from the position-only stream
+    };
+
+    Type                type;
+    unsigned int        index;
+    float               value;
+    const Mesh*         mesh;
+    const aie::Texture* texture;
+};
+
+// Linear list of commands recorded by one job
+// Clearing keeps the capacity, so once the scene is stable recording does not allocate.
+// Matrices are copied in when recorded, so the scene can change as soon as recording ends.
+class RenderCommandBuffer {
+public:
+
+    void clear();
+
+    void setTransform(const glm::mat4& projectionViewModel, const glm::mat4& modelMatrix);
+    void setTilingFactor(float tilingFactor);
+
+    // One draw per visible submesh, with its texture resolved now rather than at replay
+    void drawMesh(const Mesh& mesh, const std::vector<bool>* visibleSubMeshes = nullptr);
+    void drawMeshDepth(const Mesh& mesh, const std::vector<bool>* visibleSubMeshes = nullptr);
+
+    unsigned int getCommandCount() const { return (unsigned int)m_commands.size(); }
+
+protected:
+
+    friend class RenderQueue;
+
+    std::vector<RenderCommand> m_commands;
+    std::vector<glm::mat4> m_matrices;
+};
+
+// One pass's worth of commands, recorded in parallel and replayed on the GL thread
+// record() splits the items into contiguous ranges and records each range into its own
+// buffer as a job, then returns straight away so the GL thread can get on with other
+// work. execute() waits for the jobs and replays the buffers in range order, so the
+// draw order is the same as recording everything on one thread.
+class RenderQueue {
+public:
+
+    typedef std::function<void(RenderCommandBuffer& buffer, unsigned int begin, unsigned int end)> RecordFunction;
+
+    RenderQueue();
+    ~RenderQueue();
+
+    // Records items [0, count) across up to jobCount jobs (0 uses one per worker)
+    // The function and anything it reads must stay valid until wait() or execute()
+    void record(unsigned int count, const RecordFunction& function, unsigned int jobCount = 0);
+
+    // Blocks until recording has finished, running other jobs meanwhile
+    void wait();
+
+    // Replays the last recording with the bound shader; must be called on the GL thread
+    // Uniforms the shader does not use are skipped, so one recording suits any pass shader
+    void execute(const aie::ShaderProgram& shader);
+
+    // Statistics for the last recording
+    unsigned int getCommandCount() const;
+    unsigned int getBufferCount() const { return m_bufferCount; }
+
+protected:
+
+    std::vector<RenderCommandBuffer> m_buffers;
+    unsigned int m_bufferCount;     // Buffers used by the last recording
+    RecordFunction m_function;
+    aie::JobCounter m_recorded;
+};
@@ -0,0 +1,487 @@
+#include "RenderGraph.h"
+#include "GpuTimer.h"
+#include "Profiler.h"
+#include "glad.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+// Approximate size of one texel, for the memory statistics
+static size_t bytesPerTexel(unsigned int format) {
+    switch (format) {
+    case GL_R8:                 return 1;
+    case GL_R16F:               return 2;
+    case GL_RGBA16F:            return 8;
+    case GL_RGBA32F:            return 16;
+    case GL_DEPTH32F_STENCIL8:  return 8;
+    default:                    return 4;
+    }
+}
+
+static bool hasStencil(unsigned int format) {
+    return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
+
+// Barrier needed before reading, in the given way, something written incoherently
+static GLbitfield barrierBits(unsigned int access) {
+    GLbitfield bits = 0;
+    if (access & RenderGraph::ACCESS_ATTACHMENT) bits |= GL_FRAMEBUFFER_BARRIER_BIT;
+    if (access & RenderGraph::ACCESS_SAMPLED) bits |= GL_TEXTURE_FETCH_BARRIER_BIT;
+    if (access & RenderGraph::ACCESS_STORAGE) bits |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT;
+    if (access & RenderGraph::ACCESS_INDIRECT) bits |= GL_COMMAND_BARRIER_BIT;
+    return bits;
+}
+
+RenderGraph::Builder& RenderGraph::Builder::read(Handle resource, unsigned int access) {
+    m_graph->addRead(m_pass, resource, access);
+    return *this;
+}
+
+RenderGraph::Builder& RenderGraph::Builder::write(Handle& resource, unsigned int access) {
+    resource = m_graph->addVersion(resource, m_pass, access);
+    m_graph->m_passes[m_pass].writes.push_back({ resource, access });
+    return *this;
+}
+
+RenderGraph::Builder& RenderGraph::Builder::writeColour(Handle& texture, LoadOp load) {
+    if (load == LOAD_KEEP)
+        read(texture, ACCESS_ATTACHMENT);
+    write(texture, ACCESS_ATTACHMENT);
+    m_graph->m_passes[m_pass].colours.push_back({ texture, load });
+    return *this;
+}
+
+RenderGraph::Builder& RenderGraph::Builder::writeDepth(Handle& texture, LoadOp load) {
+    if (load == LOAD_KEEP)
+        read(texture, ACCESS_ATTACHMENT);
+    write(texture, ACCESS_ATTACHMENT);
+    m_graph->m_passes[m_pass].depth = { texture, load };
+    return *this;
+}
+
+RenderGraph::Builder& RenderGraph::Builder::setSideEffects() {
+    m_graph->m_passes[m_pass].sideEffects = true;
+    return *this;
+}
+
+RenderGraph::RenderGraph()
+    : m_frame(0),
+    m_pooledBytes(0),
+    m_transientBytes(0) {
+}
+
+RenderGraph::~RenderGraph() {
+    for (auto& framebuffer : m_framebuffers)
+        glDeleteFramebuffers(1, &framebuffer.second);
+    for (auto& pooled : m_pool)
+        glDeleteTextures(1, &pooled.texture);
+}
+
+void RenderGraph::reset() {
+    m_resources.clear();
+    m_nodes.clear();
+    m_passes.clear();
+    m_order.clear();
+    for (auto& pooled : m_pool)
+        pooled.inUse = false;
+    m_frame++;
+}
+
+RenderGraph::Handle RenderGraph::addResource(const char* name, const TextureDesc& desc, unsigned int id, bool imported) {
+    Resource resource = { name, desc, id, imported, false, false, {}, NO_PASS, 0 };
+    resource.versions.push_back((Handle)m_nodes.size());
+    m_resources.push_back(resource);
+    m_nodes.push_back({ (unsigned int)m_resources.size() - 1, NO_PASS, 0, {}, 0 });
+    return resource.versions.back();
+}
+
+RenderGraph::Handle RenderGraph::createTexture(const char* name, const TextureDesc& desc) {
+    return addResource(name, desc, 0, false);
+}
+
+RenderGraph::Handle RenderGraph::importTexture(const char* name, unsigned int texture, unsigned int width, unsigned int height) {
+    return addResource(name, { width, height, 0, false }, texture, true);
+}
+
+void RenderGraph::importBackBuffer(unsigned int width, unsigned int height, Handle& colour, Handle& depth) {
+    colour = addResource("Back Buffer", { width, height, 0, false }, 0, true);
+    depth = addResource("Back Buffer Depth", { width, height, GL_DEPTH24_STENCIL8, false }, 0, true);
+    for (Handle handle : { colour, depth }) {
+        m_resources[m_nodes[handle].resource].backBuffer = true;
+        m_resources[m_nodes[handle].resource].output = true;
+    }
+}
+
+void RenderGraph::markOutput(Handle resource) {
+    m_resources[m_nodes[resource].resource].output = true;
+}
+
+RenderGraph::Builder RenderGraph::addPass(const char* name, const char* timerStage, ExecuteFunction execute) {
+    Pass pass = { name, timerStage, execute, {}, {}, {}, { INVALID_HANDLE, LOAD_DONT_CARE }, false, 0, false };
+    m_passes.push_back(pass);
+    return Builder(this, (unsigned int)m_passes.size() - 1);
+}
+
+void RenderGraph::addRead(unsigned int pass, Handle node, unsigned int access) {
+    // One entry per version, so reference counting sees each reader once
+    for (auto& read : m_passes[pass].reads) {
+        if (read.node == node) {
+            read.access |= access;
+            return;
+        }
+    }
+    m_passes[pass].reads.push_back({ node, access });
+    m_nodes[node].readers.push_back(pass);
+}
+
+RenderGraph::Handle RenderGraph::addVersion(Handle node, unsigned int pass, unsigned int access) {
+    Resource& resource = m_resources[m_nodes[node].resource];
+    if (resource.versions.back() != node)
+        printf("Render graph: pass '%s' writes an old version of '%s'\n", m_passes[pass].name.c_str(), resource.name.c_str());
+
+    Handle version = (Handle)m_nodes.size();
+    m_nodes.push_back({ m_nodes[node].resource, pass, access, {}, 0 });
+    resource.versions.push_back(version);
+    return version;
+}
+
+bool RenderGraph::compile() {
+    PROFILE_SCOPE("RenderGraph::compile");
+    cullPasses();
+    bool ordered = orderPasses();
+    allocateTextures();
+    return ordered;
+}
+
+void RenderGraph::cullPasses() {
+    // Reference counts: readers per version, written versions per pass
+    for (auto& node : m_nodes)
+        node.refCount = (unsigned int)node.readers.size();
+    for (auto& resource : m_resources)
+        if (resource.output)
+            m_nodes[resource.versions.back()].refCount++;
+    for (auto& pass : m_passes) {
+        pass.refCount = (unsigned int)pass.writes.size() + (pass.sideEffects ? 1 : 0);
+        pass.culled = false;
+    }
+
+    // Versions nobody reads release their writer, which may in turn release what it read
+    std::vector<Handle> unreferenced;
+    for (Handle i = 0; i < (Handle)m_nodes.size(); i++)
+        if (m_nodes[i].refCount == 0)
+            unreferenced.push_back(i);
+
+    while (!unreferenced.empty()) {
+        const Node& node = m_nodes[unreferenced.back()];
+        unreferenced.pop_back();
+        if (node.writer == NO_PASS)
+            continue;
+
+        Pass& writer = m_passes[node.writer];
+        if (--writer.refCount > 0)
+            continue;
+        writer.culled = true;
+        for (auto& read : writer.reads)
+            if (--m_nodes[read.node].refCount == 0)
+                unreferenced.push_back(read.node);
+    }
+}
+
+bool RenderGraph::orderPasses() {
+    // Edges: read after write, and a new version only after the previous one's writer and readers
+    unsigned int passCount = (unsigned int)m_passes.size();
+    std::vector<std::vector<unsigned int>> successors(passCount);
+    std::vector<unsigned int> incoming(passCount, 0);
+    auto addEdge = [&](unsigned int from, unsigned int to) {
+        if (from == NO_PASS || from == to || m_passes[from].culled)
+            return;
+        successors[from].push_back(to);
+        incoming[to]++;
+    };
+
+    unsigned int liveCount = 0;
+    for (unsigned int i = 0; i < passCount; i++) {
+        const Pass& pass = m_passes[i];
+        if (pass.culled)
+            continue;
+        liveCount++;
+
+        for (auto& read : pass.reads) {
+            const Node& node = m_nodes[read.node];
+            if (node.writer == NO_PASS && !m_resources[node.resource].imported)
+                printf("Render graph: pass '%s' reads '%s' before anything writes it\n",
+                    pass.name.c_str(), m_resources[node.resource].name.c_str());
+            addEdge(node.writer, i);
+        }
+        for (auto& write : pass.writes) {
+            const std::vector<Handle>& versions = m_resources[m_nodes[write.node].resource].versions;
+            auto version = std::find(versions.begin(), versions.end(), write.node);
+            if (version == versions.begin())
+                continue;
+            const Node& previous = m_nodes[*(version - 1)];
+            addEdge(previous.writer, i);
+            for (unsigned int reader : previous.readers)
+                addEdge(reader, i);
+        }
+    }
+
+    // Topological sort, keeping declaration order wherever the dependencies allow
+    m_order.clear();
+    std::vector<bool> scheduled(passCount, false);
+    while (m_order.size() < liveCount) {
+        unsigned int next = NO_PASS;
+        for (unsigned int i = 0; i < passCount && next == NO_PASS; i++)
+            if (!m_passes[i].culled && !scheduled[i] && incoming[i] == 0)
+                next = i;
+        if (next == NO_PASS)
+            break;
+
+        scheduled[next] = true;
+        m_order.push_back(next);
+        for (unsigned int successor : successors[next])
+            incoming[successor]--;
+    }
+
+    if (m_order.size() < liveCount) {
+        printf("Render graph: dependency cycle, running passes in declaration order\n");
+        m_order.clear();
+        for (unsigned int i = 0; i < passCount; i++)
+            if (!m_passes[i].culled)
+                m_order.push_back(i);
+        return false;
+    }
+    return true;
+}
+
+void RenderGraph::allocateTextures() {
+    // Lifetime of each resource as positions in the execution order
+    for (auto& resource : m_resources) {
+        resource.firstPass = NO_PASS;
+        resource.lastPass = 0;
+    }
+    for (unsigned int position = 0; position < m_order.size(); position++) {
+        const Pass& pass = m_passes[m_order[position]];
+        auto touch = [&](Handle node) {
+            Resource& resource = m_resources[m_nodes[node].resource];
+            resource.firstPass = std::min(resource.firstPass, position);
+            resource.lastPass = std::max(resource.lastPass, position);
+        };
+        for (auto& read : pass.reads) touch(read.node);
+        for (auto& write : pass.writes) touch(write.node);
+    }
+
+    std::vector<std::vector<unsigned int>> starting(m_order.size()), ending(m_order.size());
+    for (unsigned int i = 0; i < m_resources.size(); i++) {
+        const Resource& resource = m_resources[i];
+        if (resource.imported || resource.firstPass == NO_PASS)
+            continue;
+        starting[resource.firstPass].push_back(i);
+        ending[resource.lastPass].push_back(i);
+    }
+
+    // Walk the frame, returning each texture to the pool after its last use so a later
+    // transient with the same size and format can take it over
+    m_transientBytes = 0;
+    for (unsigned int position = 0; position < m_order.size(); position++) {
+        for (unsigned int i : starting[position]) {
+            Resource& resource = m_resources[i];
+            resource.id = acquireTexture(resource.desc);
+            m_transientBytes += resource.desc.width * resource.desc.height * bytesPerTexel(resource.desc.format);
+        }
+        for (unsigned int i : ending[position])
+            for (auto& pooled : m_pool)
+                if (pooled.texture == m_resources[i].id)
+                    pooled.inUse = false;
+    }
+
+    releaseUnusedTextures();
+}
+
+unsigned int RenderGraph::acquireTexture(const TextureDesc& desc) {
+    GLint filter = desc.linearFilter ? GL_LINEAR : GL_NEAREST;
+    for (auto& pooled : m_pool) {
+        if (pooled.inUse || pooled.desc.width != desc.width || pooled.desc.height != desc.height ||
+            pooled.desc.format != desc.format)
+            continue;
+
+        pooled.inUse = true;
+        pooled.lastUsedFrame = m_frame;
+        if (pooled.desc.linearFilter != desc.linearFilter) {
+            glBindTexture(GL_TEXTURE_2D, pooled.texture);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            pooled.desc.linearFilter = desc.linearFilter;
+        }
+        return pooled.texture;
+    }
+
+    PooledTexture pooled = { desc, 0, m_frame, true };
+    glGenTextures(1, &pooled.texture);
+    glBindTexture(GL_TEXTURE_2D, pooled.texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, desc.format, desc.width, desc.height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    m_pool.push_back(pooled);
+    return pooled.texture;
+}
+
+void RenderGraph::releaseUnusedTextures() {
+    // Textures left behind by a resize or a disabled feature
+    for (size_t i = 0; i < m_pool.size();) {
+        if (m_frame - m_pool[i].lastUsedFrame <= POOL_GRACE_FRAMES) {
+            i++;
+            continue;
+        }
+
+        unsigned int texture = m_pool[i].texture;
+        for (auto framebuffer = m_framebuffers.begin(); framebuffer != m_framebuffers.end();) {
+            const std::vector<unsigned int>& attachments = framebuffer->first;
+            if (std::find(attachments.begin(), attachments.end(), texture) != attachments.end()) {
+                glDeleteFramebuffers(1, &framebuffer->second);
+                framebuffer = m_framebuffers.erase(framebuffer);
+            }
+            else {
+                ++framebuffer;
+            }
+        }
+        glDeleteTextures(1, &texture);
+        m_pool.erase(m_pool.begin() + i);
+    }
+
+    m_pooledBytes = 0;
+    for (auto& pooled : m_pool)
+        m_pooledBytes += pooled.desc.width * pooled.desc.height * bytesPerTexel(pooled.desc.format);
+}
+
+unsigned int RenderGraph::getTexture(Handle resource) const {
+    return m_resources[m_nodes[resource].resource].id;
+}
+
+unsigned int RenderGraph::getWidth(Handle resource) const {
+    return m_resources[m_nodes[resource].resource].desc.width;
+}
+
+unsigned int RenderGraph::getHeight(Handle resource) const {
+    return m_resources[m_nodes[resource].resource].desc.height;
+}
+
+unsigned int RenderGraph::getFramebuffer(Handle colour, Handle depth) {
+    std::vector<const Resource*> colours;
+    if (colour != INVALID_HANDLE)
+        colours.push_back(&m_resources[m_nodes[colour].resource]);
+    return findFramebuffer(colours, depth != INVALID_HANDLE ? &m_resources[m_nodes[depth].resource] : nullptr);
+}
+
+unsigned int RenderGraph::findFramebuffer(const std::vector<const Resource*>& colours, const Resource* depth) {
+    for (auto colour : colours)
+        if (colour->backBuffer)
+            return 0;
+    if (depth && depth->backBuffer)
+        return 0;
+
+    // Keyed on the attachment textures: colours in order, then depth (0 for none)
+    std::vector<unsigned int> key;
+    for (auto colour : colours)
+        key.push_back(colour->id);
+    key.push_back(depth ? depth->id : 0);
+
+    auto found = m_framebuffers.find(key);
+    if (found != m_framebuffers.end())
+        return found->second;
+
+    unsigned int fbo;
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    std::vector<GLenum> drawBuffers;
+    for (unsigned int i = 0; i < colours.size(); i++) {
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colours[i]->id, 0);
+        drawBuffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+    }
+    if (drawBuffers.empty()) {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    }
+    else {
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+    }
+    if (depth)
+        glFramebufferTexture2D(GL_FRAMEBUFFER, hasStencil(depth->desc.format) ?
+            GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depth->id, 0);
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE)
+        printf("Render graph framebuffer incomplete (0x%x)\n", status);
+    m_framebuffers[key] = fbo;
+    return fbo;
+}
+
+void RenderGraph::bindAttachments(const Pass& pass, const float* clearColour) {
+    if (pass.colours.empty() && pass.depth.node == INVALID_HANDLE)
+        return;
+
+    std::vector<const Resource*> colours;
+    for (auto& colour : pass.colours)
+        colours.push_back(&m_resources[m_nodes[colour.node].resource]);
+    const Resource* depth = pass.depth.node != INVALID_HANDLE ? &m_resources[m_nodes[pass.depth.node].resource] : nullptr;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, findFramebuffer(colours, depth));
+    const Resource* first = colours.empty() ? depth : colours[0];
+    glViewport(0, 0, first->desc.width, first->desc.height);
+
+    for (unsigned int i = 0; i < pass.colours.size(); i++)
+        if (pass.colours[i].load == LOAD_CLEAR)
+            glClearBufferfv(GL_COLOR, i, clearColour);
+    if (depth && pass.depth.load == LOAD_CLEAR) {
+        glDepthMask(GL_TRUE);
+        if (depth->backBuffer || hasStencil(depth->desc.format)) {
+            glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+        }
+        else {
+            const float farDepth = 1.0f;
+            glClearBufferfv(GL_DEPTH, 0, &farDepth);
+        }
+    }
+}
+
+void RenderGraph::execute(GpuTimer* timer) {
+    PROFILE_SCOPE("RenderGraph::execute");
+    float clearColour[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColour);
+
+    const char* stage = nullptr;
+    for (unsigned int index : m_order) {
+        Pass& pass = m_passes[index];
+        PROFILE_GPU_SCOPE(aie::Profiler::intern(pass.name));
+
+        if (timer) {
+            bool sameStage = stage == pass.timerStage ||
+                (stage && pass.timerStage && std::strcmp(stage, pass.timerStage) == 0);
+            if (!sameStage) {
+                if (stage) timer->end();
+                if (pass.timerStage) timer->begin(pass.timerStage);
+                stage = pass.timerStage;
+            }
+        }
+
+        // Image and storage buffer writes are not coherent with later reads
+        GLbitfield barriers = 0;
+        for (auto& read : pass.reads) {
+            const Node& node = m_nodes[read.node];
+            if (node.writer != NO_PASS && (node.writeAccess & ACCESS_STORAGE))
+                barriers |= barrierBits(read.access);
+        }
+        if (barriers)
+            glMemoryBarrier(barriers);
+
+        bindAttachments(pass, clearColour);
+        pass.execute(*this);
+    }
+    if (timer && stage)
+        timer->end();
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
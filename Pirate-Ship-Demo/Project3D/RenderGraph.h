@@ -0,0 +1,196 @@
+#pragma once
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+class GpuTimer;
+
+// Per-frame graph of render passes
+// Each frame the renderer declares its passes and the textures they read and write, then compiles and executes the graph. Compiling
+//  - culls passes whose results are never read (and that have no side effects)
+//  - orders the remaining passes by their dependencies
+//  - works out the lifetime of every transient texture and assigns it a pooled texture,
+//    so transients that are never alive at the same time share one allocation
+// Executing binds (and clears) each pass's attachments, inserts memory barriers after
+// incoherent writes and runs the pass. Transient textures are described with the size
+// they need this frame; pooled textures that go unused for a few frames are released,
+// so window and render resolution changes need no resize code anywhere else.
+//
+// Writing a resource creates a new version of it, and the handle passed to the write
+// is updated to that version. Reads refer to a specific version, which is what lets
+// the graph tell "depth after the pre-pass" apart from "depth after the scene".
+class RenderGraph {
+public:
+
+    typedef unsigned int Handle;
+    static const Handle INVALID_HANDLE = ~0u;
+
+    struct TextureDesc {
+        unsigned int width;
+        unsigned int height;
+        unsigned int format;    // Sized internal format
+        bool linearFilter;      // Otherwise nearest
+    };
+
+    // How an attachment's existing contents are treated at the start of a pass
+    enum LoadOp : int {
+        LOAD_KEEP,          // Contents are read (blending, depth testing against them)
+        LOAD_CLEAR,         // Cleared to the background colour / far depth
+        LOAD_DONT_CARE      // Every pixel is overwritten, or the garbage is never read
+    };
+
+    // How a pass touches a resource, used to pick memory barriers
+    enum Access : unsigned int {
+        ACCESS_ATTACHMENT   = 1,    // Framebuffer attachment (the graph's or the pass's own)
+        ACCESS_SAMPLED      = 2,    // Texture fetches
+        ACCESS_STORAGE      = 4,    // Image load/store or shader storage buffer
+        ACCESS_INDIRECT     = 8     // Indirect draw/dispatch arguments
+    };
+
+    // Declares the resources used by one pass
+    class Builder {
+    public:
+        Builder(RenderGraph* graph, unsigned int pass) : m_graph(graph), m_pass(pass) {}
+
+        Builder& read(Handle resource, unsigned int access = ACCESS_SAMPLED);
+
+        // Written by the pass through its own framebuffer, images or buffers
+        Builder& write(Handle& resource, unsigned int access = ACCESS_ATTACHMENT);
+
+        // Attachments the graph binds (in call order) before running the pass
+        Builder& writeColour(Handle& texture, LoadOp load = LOAD_DONT_CARE);
+        Builder& writeDepth(Handle& texture, LoadOp load = LOAD_CLEAR);
+
+        // Never culled, e.g. a pass that only updates state for the next frame
+        Builder& setSideEffects();
+
+    private:
+        RenderGraph* m_graph;
+        unsigned int m_pass;
+    };
+
+    typedef std::function<void(RenderGraph& graph)> ExecuteFunction;
+
+    RenderGraph();
+    ~RenderGraph();
+
+    // Starts declaring a new frame
+    void reset();
+
+    // Resources for this frame
+    Handle createTexture(const char* name, const TextureDesc& desc);
+    Handle importTexture(const char* name, unsigned int texture, unsigned int width, unsigned int height);
+
+    // Colour and depth of the default framebuffer, always treated as outputs
+    void importBackBuffer(unsigned int width, unsigned int height, Handle& colour, Handle& depth);
+
+    // Keeps the writers of an imported resource alive even when nothing reads it this frame
+    void markOutput(Handle resource);
+
+    // Adds a pass; consecutive passes with the same timer stage are timed together
+    Builder addPass(const char* name, const char* timerStage, ExecuteFunction execute);
+
+    // Culls, orders and allocates; returns false if the dependencies contain a cycle
+    bool compile();
+
+    void execute(GpuTimer* timer = nullptr);
+
+    // Valid while executing
+    unsigned int getTexture(Handle resource) const;
+    unsigned int getWidth(Handle resource) const;
+    unsigned int getHeight(Handle resource) const;
+
+    // Framebuffer with the given attachments, e.g. as a blit source (either may be INVALID_HANDLE)
+    unsigned int getFramebuffer(Handle colour, Handle depth);
+
+    // Statistics from the last compile
+    unsigned int getPassCount() const { return (unsigned int)m_passes.size(); }
+    const std::string& getPassName(unsigned int pass) const { return m_passes[pass].name; }
+    bool isPassCulled(unsigned int pass) const { return m_passes[pass].culled; }
+    const std::vector<unsigned int>& getExecutionOrder() const { return m_order; }
+    unsigned int getPooledTextureCount() const { return (unsigned int)m_pool.size(); }
+    size_t getPooledBytes() const { return m_pooledBytes; }             // Memory held by the pool
+    size_t getTransientBytes() const { return m_transientBytes; }       // Memory without aliasing
+
+protected:
+
+    static const unsigned int NO_PASS = ~0u;
+
+    // Frames a pooled texture may go unused before it is released
+    static const unsigned int POOL_GRACE_FRAMES = 4;
+
+    struct Resource {
+        std::string name;
+        TextureDesc desc;
+        unsigned int id;            // GL name, imported or assigned from the pool
+        bool imported;
+        bool backBuffer;
+        bool output;
+        std::vector<Handle> versions;
+        unsigned int firstPass;     // Lifetime in execution order
+        unsigned int lastPass;
+    };
+
+    // One version of a resource
+    struct Node {
+        unsigned int resource;
+        unsigned int writer;
+        unsigned int writeAccess;
+        std::vector<unsigned int> readers;
+        unsigned int refCount;
+    };
+
+    struct ResourceAccess {
+        Handle node;
+        unsigned int access;
+    };
+
+    struct Attachment {
+        Handle node;
+        LoadOp load;
+    };
+
+    struct Pass {
+        std::string name;
+        const char* timerStage;
+        ExecuteFunction execute;
+        std::vector<ResourceAccess> reads;
+        std::vector<ResourceAccess> writes;
+        std::vector<Attachment> colours;
+        Attachment depth;
+        bool sideEffects;
+        unsigned int refCount;
+        bool culled;
+    };
+
+    struct PooledTexture {
+        TextureDesc desc;
+        unsigned int texture;
+        unsigned int lastUsedFrame;
+        bool inUse;
+    };
+
+    Handle addResource(const char* name, const TextureDesc& desc, unsigned int id, bool imported);
+    Handle addVersion(Handle node, unsigned int pass, unsigned int access);
+    void addRead(unsigned int pass, Handle node, unsigned int access);
+
+    void cullPasses();
+    bool orderPasses();
+    void allocateTextures();
+    unsigned int acquireTexture(const TextureDesc& desc);
+    void releaseUnusedTextures();
+    unsigned int findFramebuffer(const std::vector<const Resource*>& colours, const Resource* depth);
+    void bindAttachments(const Pass& pass, const float* clearColour);
+
+    std::vector<Resource> m_resources;
+    std::vector<Node> m_nodes;
+    std::vector<Pass> m_passes;
+    std::vector<unsigned int> m_order;
+
+    std::vector<PooledTexture> m_pool;
+    std::map<std::vector<unsigned int>, unsigned int> m_framebuffers; // Attachment textures -> FBO
+    unsigned int m_frame;
+    size_t m_pooledBytes;
+    size_t m_transientBytes;
+};
@@ -1,31 +1,16 @@
 #include <cstdio>
 #include <cassert>
+#include <string>
 #include "Shader.h"
+#include "Profiler.h"
 
 namespace aie {
 
-Shader::~Shader() {
-	// Delete OpenGL shader when object is destroyed
-	glDeleteShader(m_handle);
-}
-
-// Loads and compiles a shader from file
-bool Shader::loadShader(unsigned int stage, const char* filename) {
-	assert(stage > 0 && stage < eShaderStage::SHADER_STAGE_Count); // Ensure valid stage
+// Includes nested deeper than this are assumed to be recursive
+static const int MAX_INCLUDE_DEPTH = 8;
 
-	m_stage = stage;
-
-	// Determine shader type and create the corresponding OpenGL shader
-	switch (stage) {
-	case eShaderStage::VERTEX:	m_handle = glCreateShader(GL_VERTEX_SHADER);	break;
-	case eShaderStage::TESSELLATION_EVALUATION:	m_handle = glCreateShader(GL_TESS_EVALUATION_SHADER);	break;
-	case eShaderStage::TESSELLATION_CONTROL:	m_handle = glCreateShader(GL_TESS_CONTROL_SHADER);	break;
-	case eShaderStage::GEOMETRY:	m_handle = glCreateShader(GL_GEOMETRY_SHADER);	break;
-	case eShaderStage::FRAGMENT:	m_handle = glCreateShader(GL_FRAGMENT_SHADER);	break;
-	default:	return false;
-	};
-
-	// Open file safely
+// Reads a whole file into text
+static bool readFile(const char* filename, std::string& text) {
 	FILE* file = nullptr;
 	errno_t err = fopen_s(&file, filename, "rb");
 
@@ -34,7 +19,6 @@ bool Shader::loadShader(unsigned int stage, const char* filename) {
 		return false;
 	}
 
-	// Read shader file contents
 	fseek(file, 0, SEEK_END);
 	long size = ftell(file);
 	if (size <= 0) {
@@ -42,38 +26,98 @@ bool Shader::loadShader(unsigned int stage, const char* filename) {
 		fclose(file);
 		return false;
 	}
-
 	fseek(file, 0, SEEK_SET);
 
-	// Allocate buffer and read file contents
-	char* source = new char[size + 1];
-	if (!source) {
-		printf("Error: Failed to allocate memory for shader source.\n");
-		fclose(file);
+	text.resize((size_t)size);
+	size_t bytesRead = fread(&text[0], sizeof(char), (size_t)size, file);
+	fclose(file);
+	if (bytesRead != (size_t)size) {
+		printf("Error: Failed to read entire shader file: %s\n", filename);
 		return false;
 	}
+	return true;
+}
 
-	size_t bytesRead = fread_s(source, static_cast<size_t>(size) + 1, sizeof(char), size, file);
-	if (bytesRead != size) {
-		printf("Error: Failed to read entire shader file: %s\n", filename);
-		delete[] source;
-		fclose(file);
+// Reads a shader source, replacing each #include "file" line with that file, found
+// relative to the including file. #line directives keep compile errors pointing at the
+// right line; the included text is numbered as source string 1
+static bool readSource(const std::string& filename, std::string& source, int depth) {
+	if (depth > MAX_INCLUDE_DEPTH) {
+		printf("Error: Shader includes nested too deeply: %s\n", filename.c_str());
 		return false;
 	}
 
-	// Null-terminate the string
-	source[size] = '\0';
+	std::string text;
+	if (!readFile(filename.c_str(), text))
+		return false;
 
-	// Close file
-	fclose(file);
+	size_t folderEnd = filename.find_last_of("/\\");
+	std::string folder = folderEnd == std::string::npos ? "" : filename.substr(0, folderEnd + 1);
+
+	int lineNumber = 1;
+	size_t lineStart = 0;
+	while (lineStart < text.size()) {
+		size_t lineEnd = text.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = text.size();
+		std::string line = text.substr(lineStart, lineEnd - lineStart);
+
+		size_t directive = line.find_first_not_of(" \t");
+		if (directive != std::string::npos && line.compare(directive, 8, "#include") == 0) {
+			size_t nameStart = line.find('"', directive);
+			size_t nameEnd = nameStart == std::string::npos ? nameStart : line.find('"', nameStart + 1);
+			if (nameEnd == std::string::npos) {
+				printf("Error: Malformed #include in %s(%d)\n", filename.c_str(), lineNumber);
+				return false;
+			}
+
+			source += "#line 1 1\n";
+			if (!readSource(folder + line.substr(nameStart + 1, nameEnd - nameStart - 1), source, depth + 1))
+				return false;
+			source += "\n#line " + std::to_string(lineNumber + 1) + " 0\n";
+		}
+		else {
+			source.append(line);
+			source += '\n';
+		}
+
+		lineNumber++;
+		lineStart = lineEnd + 1;
+	}
+	return true;
+}
+
+Shader::~Shader() {
+	// Delete OpenGL shader when object is destroyed
+	glDeleteShader(m_handle);
+}
+
+// Loads and compiles a shader from file
+bool Shader::loadShader(unsigned int stage, const char* filename) {
+	assert(stage > 0 && stage < eShaderStage::SHADER_STAGE_Count); // Ensure valid stage
+
+	m_stage = stage;
+
+	// Determine shader type and create the corresponding OpenGL shader
+	switch (stage) {
+	case eShaderStage::VERTEX:	m_handle = glCreateShader(GL_VERTEX_SHADER);	break;
+	case eShaderStage::TESSELLATION_EVALUATION:	m_handle = glCreateShader(GL_TESS_EVALUATION_SHADER);	break;
+	case eShaderStage::TESSELLATION_CONTROL:	m_handle = glCreateShader(GL_TESS_CONTROL_SHADER);	break;
+	case eShaderStage::GEOMETRY:	m_handle = glCreateShader(GL_GEOMETRY_SHADER);	break;
+	case eShaderStage::FRAGMENT:	m_handle = glCreateShader(GL_FRAGMENT_SHADER);	break;
+	default:	return false;
+	};
+
+	// Read shader file contents, with any files it includes
+	std::string source;
+	if (!readSource(filename, source, 0))
+		return false;
 
 	// Pass shader source to OpenGL
-	glShaderSource(m_handle, 1, (const char**)&source, nullptr);
+	const char* sourceText = source.c_str();
+	glShaderSource(m_handle, 1, &sourceText, nullptr);
 	glCompileShader(m_handle);
 
-	// Clean up allocated memory
-	delete[] source;
-
 	// Check for compilation errors
 	int success = GL_TRUE;
 	glGetShaderiv(m_handle, GL_COMPILE_STATUS, &success);
@@ -147,6 +191,7 @@ void ShaderProgram::attachShader(const std::shared_ptr<Shader>& shader) {
 }
 
 bool ShaderProgram::link() {
+	PROFILE_SCOPE("ShaderProgram::link");
 	m_program = glCreateProgram();
 	for (auto& s : m_shaders)
 		if (s != nullptr)
@@ -176,6 +221,14 @@ int ShaderProgram::getUniform(const char* name) const {
 	return glGetUniformLocation(m_program, name);
 }
 
+bool ShaderProgram::bindUniformBlock(const char* name, unsigned int binding) const {
+	unsigned int index = glGetUniformBlockIndex(m_program, name);
+	if (index == GL_INVALID_INDEX)
+		return false;
+	glUniformBlockBinding(m_program, index, binding);
+	return true;
+}
+
 bool ShaderProgram::bindUniform(const char* name, int value) const {
 	assert(m_program > 0 && "Invalid shader program");
 	int i = glGetUniformLocation(m_program, name);
@@ -66,6 +66,9 @@ namespace aie {
         // Retrieves the location of a uniform variable in the shader
         int getUniform(const char* name) const;
 
+        // Connects a uniform block to a buffer binding point; returns false if the shader has no such block
+        bool bindUniformBlock(const char* name, unsigned int binding) const;
+
         // Uniform binding functions (set variables inside the shader)
         bool bindUniform(const char* name, int value) const;
         bool bindUniform(const char* name, float value) const;
@@ -1,5 +1,6 @@
 #include "glad.h"
 #include "Texture.h"
+#include "Profiler.h"
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
@@ -48,7 +49,8 @@ Texture::~Texture() {
 }
 
 bool Texture::load(const char* filename) {
-	
+	PROFILE_SCOPE("Texture::load");
+
 	// If a texture was previously loaded, delete it before loading a new one
 	if (m_glHandle != 0) {
 		glDeleteTextures(1, &m_glHandle);
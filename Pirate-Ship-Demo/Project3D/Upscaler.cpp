@@ -0,0 +1,40 @@
+#include "Upscaler.h"
+#include "glad.h"
+
+Upscaler::Upscaler()
+    : sharpness(0.8f),
+    m_vao(0) {
+}
+
+Upscaler::~Upscaler() {
+    if (m_vao) glDeleteVertexArrays(1, &m_vao);
+}
+
+bool Upscaler::initialise() {
+    m_shader.loadShader(aie::eShaderStage::VERTEX, "../bin/Shaders/fullscreen.vert");
+    m_shader.loadShader(aie::eShaderStage::FRAGMENT, "../bin/Shaders/upscale.frag");
+    glGenVertexArrays(1, &m_vao);
+    return m_shader.link();
+}
+
+void Upscaler::addPass(RenderGraph& graph, RenderGraph::Handle source, RenderGraph::Handle& output) {
+    float filterSharpness = sharpness;
+    graph.addPass("Upscale", "Upscale", [this, source, filterSharpness](RenderGraph& graph) {
+        glDisable(GL_DEPTH_TEST);
+        glDisable(GL_BLEND);
+
+        m_shader.bind();
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, graph.getTexture(source));
+        m_shader.bindUniform("SourceTex", 0);
+        m_shader.bindUniform("Sharpness", filterSharpness);
+
+        glBindVertexArray(m_vao);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+    }).read(source).writeColour(output);
+}
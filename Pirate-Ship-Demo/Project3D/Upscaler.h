@@ -0,0 +1,26 @@
+#pragma once
+#include "Shader.h"
+#include "RenderGraph.h"
+
+// Edge-adaptive spatial upscaler
+// The tone-mapped image is resolved into an LDR target at render resolution, then
+// stretched to the output with a Catmull-Rom filter that is smoothed along local
+// edges (to hide stair-stepping) and clamped to nearby texels (to avoid ringing).
+class Upscaler {
+public:
+
+    Upscaler();
+    ~Upscaler();
+
+    bool initialise();
+
+    // Adds the pass that upscales the render resolution image into output
+    void addPass(RenderGraph& graph, RenderGraph::Handle source, RenderGraph::Handle& output);
+
+    float sharpness; // 0 = bilinear, 1 = full Catmull-Rom
+
+protected:
+
+    aie::ShaderProgram m_shader;
+    unsigned int m_vao;
+};
@@ -1,13 +1,65 @@
 #include "Application3D.h"
+#include "MetricsServer.h"
+#include <cstdlib>
+#include <cstring>
 
-int main() {
+// Command line:
+//   --benchmark [frames]  run unattended along the camera path and write a report (default 600 frames)
+//   --report <file>       where the benchmark report goes (default benchmark.json)
+//   --headless            keep the window hidden
+//   --egl                 create the context through EGL
+//   --null-gl             no context: GL calls are checked and counted but do nothing
+//   --metrics <port>      serve OpenMetrics at http://127.0.0.1:<port>/metrics
+//   --metrics-socket <path> the same over a Unix domain socket
+int main(int argc, char* argv[]) {
 	
 	// Allocate memory for the application
 	auto app = new Application3D();
 
+	unsigned int benchmarkFrames = 0;
+	const char* reportFile = "benchmark.json";
+	bool headless = false, useEGL = false, nullGL = false;
+	unsigned short metricsPort = 0;
+	const char* metricsSocket = nullptr;
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--benchmark") == 0) {
+			benchmarkFrames = 600;
+			if (i + 1 < argc && argv[i + 1][0] != '-')
+				benchmarkFrames = (unsigned int)atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--report") == 0 && i + 1 < argc)
+			reportFile = argv[++i];
+		else if (strcmp(argv[i], "--headless") == 0)
+			headless = true;
+		else if (strcmp(argv[i], "--egl") == 0)
+			useEGL = true;
+		else if (strcmp(argv[i], "--null-gl") == 0)
+			nullGL = true;
+		else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc)
+			metricsPort = (unsigned short)atoi(argv[++i]);
+		else if (strcmp(argv[i], "--metrics-socket") == 0 && i + 1 < argc)
+			metricsSocket = argv[++i];
+	}
+	if (benchmarkFrames > 0)
+		app->setBenchmark(benchmarkFrames, reportFile);
+	app->setHeadless(headless, useEGL);
+	if (nullGL)
+		app->setGLBackend(aie::Application::GL_BACKEND_NULL);
+
+#ifdef AIE_METRICS
+	if (metricsSocket)
+		aie::MetricsServer::startUnix(metricsSocket);
+	else if (metricsPort > 0)
+		aie::MetricsServer::start(metricsPort);
+#endif
+
 	// Initialise and run the application loop
 	app->run("Real-Time 3D OpenGL Application - LowPoly Pirate Ship", 1280, 720, false);
 
+#ifdef AIE_METRICS
+	aie::MetricsServer::stop();
+#endif
+
 	// Deallocate memory before exiting
 	delete app;
 
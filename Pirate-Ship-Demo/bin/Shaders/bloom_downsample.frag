@@ -0,0 +1,30 @@
+#version 410
+
+in vec2 vTexCoords;
+
+uniform sampler2D SourceTex;
+uniform float Threshold; // Bright pass luminance threshold, negative for a plain downsample
+uniform float TapSpread; // Half the source texels per target pixel (1 for a 2x reduction)
+
+out vec4 FragColour;
+
+void main() {
+    // Four bilinear taps spread over the source texels under this pixel
+    vec2 texel = TapSpread / vec2(textureSize(SourceTex, 0));
+    vec3 colour = texture(SourceTex, vTexCoords + texel * vec2(-1.0, -1.0)).rgb;
+    colour += texture(SourceTex, vTexCoords + texel * vec2(1.0, -1.0)).rgb;
+    colour += texture(SourceTex, vTexCoords + texel * vec2(-1.0, 1.0)).rgb;
+    colour += texture(SourceTex, vTexCoords + texel * vec2(1.0, 1.0)).rgb;
+    colour *= 0.25;
+
+    if (Threshold >= 0.0) {
+        // Soft knee so bloom fades in rather than popping at the threshold
+        float brightness = max(colour.r, max(colour.g, colour.b));
+        float knee = Threshold * 0.5;
+        float soft = clamp(brightness - Threshold + knee, 0.0, 2.0 * knee);
+        soft = soft * soft / (4.0 * knee + 1e-4);
+        colour *= max(soft, brightness - Threshold) / max(brightness, 1e-4);
+    }
+
+    FragColour = vec4(colour, 1.0);
+}
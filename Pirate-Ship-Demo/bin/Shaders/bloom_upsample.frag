@@ -0,0 +1,11 @@
+#version 410
+
+in vec2 vTexCoords;
+
+uniform sampler2D SourceTex; // Smaller bloom level, added onto the bound target
+
+out vec4 FragColour;
+
+void main() {
+    FragColour = vec4(texture(SourceTex, vTexCoords).rgb, 1.0);
+}
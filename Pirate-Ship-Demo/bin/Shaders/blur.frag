@@ -0,0 +1,21 @@
+#version 410
+
+in vec2 vTexCoords;
+
+uniform sampler2D SourceTex;
+uniform vec2 Direction;     // One texel along the blur axis
+uniform int TapCount;       // Linear-sampled taps either side, including the centre
+uniform float Weights[8];
+uniform float Offsets[8];   // In texels, between the pair of texels each tap covers
+
+out vec4 FragColour;
+
+void main() {
+    vec3 colour = texture(SourceTex, vTexCoords).rgb * Weights[0];
+    for (int i = 1; i < TapCount; i++) {
+        vec2 offset = Direction * Offsets[i];
+        colour += texture(SourceTex, vTexCoords + offset).rgb * Weights[i];
+        colour += texture(SourceTex, vTexCoords - offset).rgb * Weights[i];
+    }
+    FragColour = vec4(colour, 1.0);
+}
@@ -0,0 +1,53 @@
+#version 430
+
+in vec2 vTexCoords;
+
+// G-buffer (see GBuffer.h)
+uniform sampler2D AlbedoSpecularPowerTex;
+uniform sampler2D NormalTex;
+uniform sampler2D AmbientSpecularTex;
+uniform sampler2D DepthTex;
+
+uniform mat4 InverseProjectionView; // Reconstructs world position from depth
+
+#include "lighting.glsl"
+
+out vec4 FragColour; // Output final pixel colour
+
+vec3 decodeNormal(vec2 f) {
+    f = f * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+void main() {
+    float depth = texture(DepthTex, vTexCoords).r;
+    if (depth >= 1.0)
+        discard; // Nothing drawn here, keep the background
+
+    // Unpack the G-buffer
+    vec4 albedoSpecularPower = texture(AlbedoSpecularPowerTex, vTexCoords);
+    vec4 ambientSpecular = texture(AmbientSpecularTex, vTexCoords);
+    vec3 N = decodeNormal(texture(NormalTex, vTexCoords).xy);
+    vec3 albedo = albedoSpecularPower.rgb;
+    float specularPower = exp2(albedoSpecularPower.a * 10.0);
+    float Ks = ambientSpecular.a;
+
+    vec4 clipPosition = vec4(vec3(vTexCoords, depth) * 2.0 - 1.0, 1.0);
+    vec4 worldPosition = InverseProjectionView * clipPosition;
+    vec3 position = worldPosition.xyz / worldPosition.w;
+
+    // View direction
+    vec3 V = normalize(cameraPosition - position);
+
+    vec3 ambient = (AmbientColour + FillLightAmbient) * ambientOcclusion() * ambientSpecular.rgb;
+    vec3 sun = directionalLight(LightDirection, LightColour, N, V, albedo, vec3(Ks), specularPower) * sunShadow(position, N);
+    vec3 fill = directionalLight(FillLightDirection, FillLightColour, N, V, albedo, vec3(Ks), specularPower);
+
+    vec3 finalColour = ambient + sun + fill;
+    if (UseClusteredLights)
+        finalColour += clusteredLighting(position, N, V, albedo, vec3(Ks), specularPower);
+    FragColour = vec4(finalColour, 1.0);
+}
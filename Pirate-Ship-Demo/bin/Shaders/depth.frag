@@ -0,0 +1,5 @@
+#version 410
+
+// Depth-only pass: no colour output, the rasterizer writes depth
+void main() {
+}
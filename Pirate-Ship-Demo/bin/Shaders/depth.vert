@@ -0,0 +1,19 @@
+#version 410
+
+// Position-only vertex stream
+layout(location = 0) in vec4 Position;
+
+// Must match phong.vert exactly so the colour pass can use GL_EQUAL depth testing
+invariant gl_Position;
+
+uniform mat4 ProjectionViewModel;
+
+// Correction from the camera the frame was prepared with to the camera sampled just
+// before submission (identity unless late latching is on); see LateLatch.h
+layout(std140) uniform LateLatch {
+    mat4 LatchCorrection;
+};
+
+void main() {
+    gl_Position = LatchCorrection * (ProjectionViewModel * Position); // Transform to clip space
+}
@@ -0,0 +1,34 @@
+#version 460
+
+// Position-only vertex stream
+layout(location = 0) in vec4 Position;
+
+// Per-draw records, indexed by gl_DrawID (see phong_indirect.vert)
+struct DrawRecord {
+    mat4 ModelMatrix;
+    vec4 Ambient;
+    vec4 Diffuse;
+    vec4 Specular;
+    int TextureLayer;
+};
+
+layout(std430, binding = 0) readonly buffer DrawRecords {
+    DrawRecord records[];
+};
+
+// Must match phong_indirect.vert exactly so the colour pass can use GL_EQUAL depth testing
+invariant gl_Position;
+
+uniform mat4 ProjectionView;
+uniform int DrawBase;
+
+// Correction from the camera the frame was prepared with to the camera sampled just
+// before submission (identity unless late latching is on); see LateLatch.h
+layout(std140) uniform LateLatch {
+    mat4 LatchCorrection;
+};
+
+void main() {
+    vec4 worldPosition = records[DrawBase + gl_DrawID].ModelMatrix * Position;
+    gl_Position = LatchCorrection * (ProjectionView * worldPosition); // Transform to clip space
+}
@@ -0,0 +1,10 @@
+#version 410
+
+// Full-screen triangle generated from gl_VertexID, drawn with no vertex buffers
+out vec2 vTexCoords;
+
+void main() {
+    vec2 position = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+    vTexCoords = position;
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
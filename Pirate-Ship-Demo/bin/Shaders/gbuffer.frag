@@ -0,0 +1,38 @@
+#version 410
+
+// Inputs from vertex shader
+in vec4 vPosition;
+in vec3 vNormal;
+in vec2 vTexCoords;
+
+// Material properties
+uniform vec3 Ka; // Ambient reflectance
+uniform vec3 Kd; // Diffuse reflectance
+uniform vec3 Ks; // Specular reflectance
+uniform float specularPower; // Shininess
+
+// Texture Sampling
+uniform sampler2D diffuseTex; // Diffuse texture map
+uniform float tilingFactor; // Texture scaling
+
+// G-buffer targets (see GBuffer.h)
+layout(location = 0) out vec4 AlbedoSpecularPower;
+layout(location = 1) out vec2 Normal;
+layout(location = 2) out vec4 AmbientSpecular;
+
+// Octahedral normal encoding into [0, 1]
+vec2 encodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.xy * 0.5 + 0.5;
+}
+
+void main() {
+    vec3 textureColour = texture(diffuseTex, vTexCoords * tilingFactor).rgb;
+
+    // Specular power stored as log2(power) / 10, covering 1 - 1024
+    AlbedoSpecularPower = vec4(Kd * textureColour, clamp(log2(max(specularPower, 1.0)) / 10.0, 0.0, 1.0));
+    Normal = encodeNormal(normalize(vNormal));
+    AmbientSpecular = vec4(Ka * textureColour, max(Ks.r, max(Ks.g, Ks.b)));
+}
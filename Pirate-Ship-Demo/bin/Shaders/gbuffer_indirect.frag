@@ -0,0 +1,47 @@
+#version 460
+
+// Inputs from vertex shader
+in vec4 vPosition;
+in vec3 vNormal;
+in vec2 vTexCoords;
+flat in int vDrawIndex;
+
+// Per-draw transform and material (see phong_indirect.vert)
+struct DrawRecord {
+    mat4 ModelMatrix;
+    vec4 Ambient;
+    vec4 Diffuse;
+    vec4 Specular;
+    int TextureLayer;
+};
+
+layout(std430, binding = 0) readonly buffer DrawRecords {
+    DrawRecord records[];
+};
+
+// Packed material textures, one layer per material
+uniform sampler2DArray diffuseTexArray;
+
+// G-buffer targets (see GBuffer.h)
+layout(location = 0) out vec4 AlbedoSpecularPower;
+layout(location = 1) out vec2 Normal;
+layout(location = 2) out vec4 AmbientSpecular;
+
+// Octahedral normal encoding into [0, 1]
+vec2 encodeNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    if (n.z < 0.0)
+        n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return n.xy * 0.5 + 0.5;
+}
+
+void main() {
+    DrawRecord record = records[vDrawIndex];
+    vec3 textureColour = texture(diffuseTexArray, vec3(vTexCoords * record.Ambient.w, record.TextureLayer)).rgb;
+    vec3 Ks = record.Specular.xyz;
+
+    // Specular power stored as log2(power) / 10, covering 1 - 1024
+    AlbedoSpecularPower = vec4(record.Diffuse.xyz * textureColour, clamp(log2(max(record.Diffuse.w, 1.0)) / 10.0, 0.0, 1.0));
+    Normal = encodeNormal(normalize(vNormal));
+    AmbientSpecular = vec4(record.Ambient.xyz * textureColour, max(Ks.r, max(Ks.g, Ks.b)));
+}
@@ -0,0 +1,116 @@
+// Scene lighting shared by the forward and deferred shaders (included after #version)
+// The sun and fill light, clustered point / spot lights, sun shadows and ambient occlusion
+
+// Camera & Light Data
+uniform vec3 cameraPosition;
+uniform vec3 AmbientColour;      // Sun ambient light
+uniform vec3 FillLightAmbient;   // Fill light ambient
+uniform vec3 LightColour;        // Sun (primary) light colour
+uniform vec3 LightDirection;     // Sun (primary) light direction
+uniform vec3 FillLightColour;    // Fill (secondary) light colour
+uniform vec3 FillLightDirection; // Fill (secondary) light direction
+
+// Clustered local lights (see ClusteredLighting.h)
+struct Light {
+    vec4 PositionRange;  // xyz = position, w = range
+    vec4 ColourType;     // rgb = colour, w = 0 point / 1 spot
+    vec4 DirectionCos;   // xyz = spot direction, w = cos(outer angle)
+    vec4 SpotParams;     // x = cos(inner angle)
+};
+
+layout(std430, binding = 1) readonly buffer Lights {
+    Light lights[];
+};
+
+layout(std430, binding = 2) readonly buffer Clusters {
+    uvec2 clusters[]; // x = offset into lightIndices, y = count
+};
+
+layout(std430, binding = 3) readonly buffer LightIndices {
+    uint lightIndices[];
+};
+
+uniform mat4 ViewMatrix;
+uniform vec3 ClusterGrid;    // Tiles x, tiles y, depth slices
+uniform float ClusterScale;  // slice = log(viewDepth) * scale + bias
+uniform float ClusterBias;
+uniform vec2 ScreenSize;
+uniform bool UseClusteredLights;
+
+// Sun shadows (see CascadedShadowMap.h)
+uniform sampler2DArrayShadow ShadowMap;
+uniform mat4 ShadowMatrices[4];     // World to shadow map [0, 1] per cascade
+uniform vec4 CascadeTexelSizes;     // World size of a shadow texel per cascade
+uniform bool UseShadows;
+
+// Screen-space ambient occlusion at render resolution
+uniform sampler2D AmbientOcclusionTex;
+uniform bool UseAmbientOcclusion;
+
+// Fraction of the sun reaching a point, 3x3 PCF in the first cascade that contains it
+float sunShadow(vec3 position, vec3 N) {
+    if (!UseShadows)
+        return 1.0;
+
+    vec2 texelSize = 1.0 / vec2(textureSize(ShadowMap, 0).xy);
+    for (int cascade = 0; cascade < 4; cascade++) {
+        // Offset along the normal by a texel and a half to avoid acne
+        vec3 biased = position + N * CascadeTexelSizes[cascade] * 1.5;
+        vec3 coords = (ShadowMatrices[cascade] * vec4(biased, 1.0)).xyz;
+        if (any(lessThan(coords, vec3(texelSize, 0.0))) || any(greaterThan(coords, vec3(1.0 - texelSize, 1.0))))
+            continue;
+
+        float lit = 0.0;
+        for (int y = -1; y <= 1; y++)
+            for (int x = -1; x <= 1; x++)
+                lit += texture(ShadowMap, vec4(coords.xy + vec2(x, y) * texelSize, cascade, coords.z));
+        return lit / 9.0;
+    }
+    return 1.0;
+}
+
+// Ambient occlusion at this pixel, 1 when it is off
+float ambientOcclusion() {
+    return UseAmbientOcclusion ? texelFetch(AmbientOcclusionTex, ivec2(gl_FragCoord.xy), 0).r : 1.0;
+}
+
+// Diffuse and specular light from a directional light shining along direction
+vec3 directionalLight(vec3 direction, vec3 colour, vec3 N, vec3 V, vec3 albedo, vec3 Ks, float specularPower) {
+    vec3 L = normalize(direction);
+    float lambertTerm = max(0.0, dot(N, -L));
+    float specularTerm = pow(max(0.0, dot(reflect(L, N), V)), specularPower);
+    return colour * (albedo * lambertTerm + Ks * specularTerm);
+}
+
+// Sums the diffuse and specular contribution of every light in this fragment's cluster
+vec3 clusteredLighting(vec3 position, vec3 N, vec3 V, vec3 albedo, vec3 Ks, float specularPower) {
+    ivec3 grid = ivec3(ClusterGrid);
+    float viewDepth = -(ViewMatrix * vec4(position, 1.0)).z;
+    ivec3 cluster;
+    cluster.xy = clamp(ivec2(gl_FragCoord.xy / ScreenSize * ClusterGrid.xy), ivec2(0), grid.xy - 1);
+    cluster.z = clamp(int(log(max(viewDepth, 1e-4)) * ClusterScale + ClusterBias), 0, grid.z - 1);
+    uvec2 lightRange = clusters[(cluster.z * grid.y + cluster.y) * grid.x + cluster.x];
+
+    vec3 colour = vec3(0);
+    for (uint i = 0; i < lightRange.y; i++) {
+        Light light = lights[lightIndices[lightRange.x + i]];
+        vec3 toLight = light.PositionRange.xyz - position;
+        float distanceSq = dot(toLight, toLight);
+        float radius = light.PositionRange.w;
+        if (distanceSq >= radius * radius)
+            continue;
+
+        // Smooth windowed inverse square falloff, reaching zero at the light's range
+        float window = clamp(1.0 - pow(distanceSq / (radius * radius), 2.0), 0.0, 1.0);
+        float attenuation = window * window / (distanceSq + 1.0);
+
+        vec3 L = toLight * inversesqrt(distanceSq);
+        if (light.ColourType.w > 0.5)
+            attenuation *= smoothstep(light.DirectionCos.w, light.SpotParams.x, dot(-L, light.DirectionCos.xyz));
+
+        float lambertTerm = max(0.0, dot(N, L));
+        float specularTerm = pow(max(0.0, dot(reflect(-L, N), V)), specularPower);
+        colour += light.ColourType.rgb * attenuation * (albedo * lambertTerm + Ks * specularTerm);
+    }
+    return colour;
+}
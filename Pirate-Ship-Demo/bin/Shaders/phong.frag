@@ -24,8 +24,40 @@ uniform float specularPower; // Shininess
 uniform sampler2D diffuseTex; // Diffuse texture map
 uniform float tilingFactor; // Texture scaling
 
+// Sun shadows (see CascadedShadowMap.h)
+uniform sampler2DArrayShadow ShadowMap;
+uniform mat4 ShadowMatrices[4];     // World to shadow map [0, 1] per cascade
+uniform vec4 CascadeTexelSizes;     // World size of a shadow texel per cascade
+uniform bool UseShadows;
+
+// Screen-space ambient occlusion at render resolution
+uniform sampler2D AmbientOcclusionTex;
+uniform bool UseAmbientOcclusion;
+
 out vec4 FragColour; // Output final pixel colour
 
+// Fraction of the sun reaching a point, 3x3 PCF in the first cascade that contains it
+float sunShadow(vec3 position, vec3 N) {
+    if (!UseShadows)
+        return 1.0;
+
+    vec2 texelSize = 1.0 / vec2(textureSize(ShadowMap, 0).xy);
+    for (int cascade = 0; cascade < 4; cascade++) {
+        // Offset along the normal by a texel and a half to avoid acne
+        vec3 biased = position + N * CascadeTexelSizes[cascade] * 1.5;
+        vec3 coords = (ShadowMatrices[cascade] * vec4(biased, 1.0)).xyz;
+        if (any(lessThan(coords, vec3(texelSize, 0.0))) || any(greaterThan(coords, vec3(1.0 - texelSize, 1.0))))
+            continue;
+
+        float lit = 0.0;
+        for (int y = -1; y <= 1; y++)
+            for (int x = -1; x <= 1; x++)
+                lit += texture(ShadowMap, vec4(coords.xy + vec2(x, y) * texelSize, cascade, coords.z));
+        return lit / 9.0;
+    }
+    return 1.0;
+}
+
 void main() {
     vec3 N = normalize(vNormal);
 
@@ -47,12 +79,16 @@ void main() {
     vec3 R2 = reflect(L2, N);
     float specularTerm2 = pow(max(0.0, dot(R2, V)), specularPower);
     
+    // Sun visibility from the shadow cascades
+    float shadow = sunShadow(vPosition.xyz, N);
+
     // Combine lighting effects
-    vec3 ambient = (AmbientColour + FillLightAmbient) * Ka * textureColour;
+    float occlusion = UseAmbientOcclusion ? texelFetch(AmbientOcclusionTex, ivec2(gl_FragCoord.xy), 0).r : 1.0;
+    vec3 ambient = (AmbientColour + FillLightAmbient) * occlusion * Ka * textureColour;
     
     // Diffuse and specular contributions
-    vec3 diffuse1 = LightColour * Kd * lambertTerm1 * textureColour;
-    vec3 specular1 = LightColour * Ks * specularTerm1;
+    vec3 diffuse1 = LightColour * Kd * lambertTerm1 * textureColour * shadow;
+    vec3 specular1 = LightColour * Ks * specularTerm1 * shadow;
     vec3 diffuse2 = FillLightColour * Kd * lambertTerm2 * textureColour;
     vec3 specular2 = FillLightColour * Ks * specularTerm2;
     
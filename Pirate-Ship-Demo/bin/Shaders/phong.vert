@@ -10,14 +10,23 @@ out vec4 vPosition;
 out vec3 vNormal;
 out vec2 vTexCoords;
 
+// Declared invariant so depth-only passes produce identical depth
+invariant gl_Position;
+
 // Transformation matrices
 uniform mat4 ProjectionViewModel;
 uniform mat4 ModelMatrix;
 
+// Correction from the camera the frame was prepared with to the camera sampled just
+// before submission (identity unless late latching is on); see LateLatch.h
+layout(std140) uniform LateLatch {
+    mat4 LatchCorrection;
+};
+
 void main() {
     vPosition = ModelMatrix * Position; // Transform vertex position to world space
     vNormal = normalize((ModelMatrix * Normal).xyz); // Convert normal to world space
     vTexCoords = TexCoords; // Pass texture coordinates to fragment shader
-    gl_Position = ProjectionViewModel * Position; // Transform to clip space
+    gl_Position = LatchCorrection * (ProjectionViewModel * Position); // Transform to clip space
 }
 
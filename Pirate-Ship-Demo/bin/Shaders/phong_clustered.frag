@@ -0,0 +1,39 @@
+#version 430
+
+// Inputs from vertex shader
+in vec4 vPosition;
+in vec3 vNormal;
+in vec2 vTexCoords;
+
+// Material properties
+uniform vec3 Ka; // Ambient reflectance
+uniform vec3 Kd; // Diffuse reflectance
+uniform vec3 Ks; // Specular reflectance
+uniform float specularPower; // Shininess
+
+// Texture Sampling
+uniform sampler2D diffuseTex; // Diffuse texture map
+uniform float tilingFactor; // Texture scaling
+
+#include "lighting.glsl"
+
+out vec4 FragColour; // Output final pixel colour
+
+void main() {
+    vec3 N = normalize(vNormal);
+
+    // Sample texture with tiling
+    vec3 textureColour = texture(diffuseTex, vTexCoords * tilingFactor).rgb;
+    vec3 albedo = Kd * textureColour;
+
+    // View direction
+    vec3 V = normalize(cameraPosition - vPosition.xyz);
+
+    vec3 ambient = (AmbientColour + FillLightAmbient) * ambientOcclusion() * Ka * textureColour;
+    vec3 sun = directionalLight(LightDirection, LightColour, N, V, albedo, Ks, specularPower) * sunShadow(vPosition.xyz, N);
+    vec3 fill = directionalLight(FillLightDirection, FillLightColour, N, V, albedo, Ks, specularPower);
+
+    vec3 finalColour = ambient + sun + fill;
+    finalColour += clusteredLighting(vPosition.xyz, N, V, albedo, Ks, specularPower);
+    FragColour = vec4(finalColour, 1.0);
+}
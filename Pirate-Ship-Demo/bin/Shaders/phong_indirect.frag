@@ -0,0 +1,54 @@
+#version 460
+
+// Inputs from vertex shader
+in vec4 vPosition;
+in vec3 vNormal;
+in vec2 vTexCoords;
+flat in int vDrawIndex;
+
+// Per-draw transform and material (see phong_indirect.vert)
+struct DrawRecord {
+    mat4 ModelMatrix;
+    vec4 Ambient;
+    vec4 Diffuse;
+    vec4 Specular;
+    int TextureLayer;
+};
+
+layout(std430, binding = 0) readonly buffer DrawRecords {
+    DrawRecord records[];
+};
+
+// Packed material textures, one layer per material
+uniform sampler2DArray diffuseTexArray;
+
+#include "lighting.glsl"
+
+out vec4 FragColour; // Output final pixel colour
+
+void main() {
+    DrawRecord record = records[vDrawIndex];
+    vec3 Ka = record.Ambient.xyz;
+    vec3 Kd = record.Diffuse.xyz;
+    vec3 Ks = record.Specular.xyz;
+    float specularPower = record.Diffuse.w;
+    float tilingFactor = record.Ambient.w;
+
+    vec3 N = normalize(vNormal);
+
+    // Sample texture layer with tiling
+    vec3 textureColour = texture(diffuseTexArray, vec3(vTexCoords * tilingFactor, record.TextureLayer)).rgb;
+    vec3 albedo = Kd * textureColour;
+
+    // View direction
+    vec3 V = normalize(cameraPosition - vPosition.xyz);
+
+    vec3 ambient = (AmbientColour + FillLightAmbient) * ambientOcclusion() * Ka * textureColour;
+    vec3 sun = directionalLight(LightDirection, LightColour, N, V, albedo, Ks, specularPower) * sunShadow(vPosition.xyz, N);
+    vec3 fill = directionalLight(FillLightDirection, FillLightColour, N, V, albedo, Ks, specularPower);
+
+    vec3 finalColour = ambient + sun + fill;
+    if (UseClusteredLights)
+        finalColour += clusteredLighting(vPosition.xyz, N, V, albedo, Ks, specularPower);
+    FragColour = vec4(finalColour, 1.0);
+}
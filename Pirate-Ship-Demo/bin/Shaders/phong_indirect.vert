@@ -0,0 +1,48 @@
+#version 460
+
+// Vertex attributes from mesh
+layout(location = 0) in vec4 Position;
+layout(location = 1) in vec4 Normal;
+layout(location = 2) in vec2 TexCoords;
+
+// Per-draw transform and material, indexed by gl_DrawID
+struct DrawRecord {
+    mat4 ModelMatrix;
+    vec4 Ambient;   // xyz = Ka, w = tiling factor
+    vec4 Diffuse;   // xyz = Kd, w = specular power
+    vec4 Specular;  // xyz = Ks
+    int TextureLayer;
+};
+
+layout(std430, binding = 0) readonly buffer DrawRecords {
+    DrawRecord records[];
+};
+
+// Outputs to fragment shader
+out vec4 vPosition;
+out vec3 vNormal;
+out vec2 vTexCoords;
+flat out int vDrawIndex;
+
+// Declared invariant so depth-only passes produce identical depth
+invariant gl_Position;
+
+// Transformation matrices
+uniform mat4 ProjectionView;
+uniform int DrawBase; // Index of the first record for this multi-draw
+
+// Correction from the camera the frame was prepared with to the camera sampled just
+// before submission (identity unless late latching is on); see LateLatch.h
+layout(std140) uniform LateLatch {
+    mat4 LatchCorrection;
+};
+
+void main() {
+    vDrawIndex = DrawBase + gl_DrawID;
+    mat4 model = records[vDrawIndex].ModelMatrix;
+
+    vPosition = model * Position; // Transform vertex position to world space
+    vNormal = normalize((model * Normal).xyz); // Convert normal to world space
+    vTexCoords = TexCoords; // Pass texture coordinates to fragment shader
+    gl_Position = LatchCorrection * (ProjectionView * vPosition); // Transform to clip space
+}
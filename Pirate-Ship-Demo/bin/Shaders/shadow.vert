@@ -0,0 +1,10 @@
+#version 410
+
+// Position-only vertex stream
+layout(location = 0) in vec4 Position;
+
+uniform mat4 ModelMatrix;
+
+void main() {
+    gl_Position = ModelMatrix * Position; // World space, projected per cascade in shadow.geom
+}
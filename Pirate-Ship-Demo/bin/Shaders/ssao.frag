@@ -0,0 +1,81 @@
+#version 410
+
+in vec2 vTexCoords;
+
+uniform sampler2D LinearDepthTex; // Half resolution view depth
+uniform sampler2D NormalTex;      // Octahedral world normals (G-buffer)
+uniform bool UseNormalTex;        // Otherwise normals are rebuilt from depth
+uniform mat4 ViewMatrix;
+
+uniform vec2 TanHalfFov;          // Tangent of the half field of view in x and y
+uniform float ProjectionScale;    // Half resolution pixels per world unit at depth 1
+uniform float FarPlane;
+uniform float Radius;
+uniform float Intensity;
+uniform int SampleCount;
+
+out float Occlusion;
+
+const float TWO_PI = 6.28318530718;
+const float SPIRAL_TURNS = 7.0;
+
+vec3 decodeNormal(vec2 f) {
+    f = f * 2.0 - 1.0;
+    vec3 n = vec3(f, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+vec3 viewPosition(ivec2 pixel) {
+    vec2 uv = (vec2(pixel) + 0.5) / vec2(textureSize(LinearDepthTex, 0));
+    float depth = texelFetch(LinearDepthTex, pixel, 0).r;
+    return vec3((uv * 2.0 - 1.0) * TanHalfFov * depth, -depth);
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 last = textureSize(LinearDepthTex, 0) - 1;
+    vec3 P = viewPosition(pixel);
+    if (-P.z >= FarPlane * 0.999) {
+        Occlusion = 1.0;
+        return;
+    }
+
+    vec3 N;
+    if (UseNormalTex) {
+        N = normalize(mat3(ViewMatrix) * decodeNormal(texture(NormalTex, vTexCoords).xy));
+    }
+    else {
+        // Use the neighbour on the same surface (smallest depth step) on each axis
+        vec3 left = viewPosition(max(pixel - ivec2(1, 0), ivec2(0)));
+        vec3 right = viewPosition(min(pixel + ivec2(1, 0), last));
+        vec3 down = viewPosition(max(pixel - ivec2(0, 1), ivec2(0)));
+        vec3 up = viewPosition(min(pixel + ivec2(0, 1), last));
+        vec3 dx = abs(right.z - P.z) < abs(P.z - left.z) ? right - P : P - left;
+        vec3 dy = abs(up.z - P.z) < abs(P.z - down.z) ? up - P : P - down;
+        N = normalize(cross(dx, dy));
+    }
+
+    // Interleaved gradient noise rotates the spiral per pixel; the blur averages it out
+    float angle = fract(52.9829189 * fract(dot(gl_FragCoord.xy, vec2(0.06711056, 0.00583715)))) * TWO_PI;
+    float screenRadius = Radius * ProjectionScale / -P.z;
+    float radius2 = Radius * Radius;
+
+    // Alchemy estimator over a spiral of screen space samples
+    float sum = 0.0;
+    for (int i = 0; i < SampleCount; i++) {
+        float t = (float(i) + 0.5) / float(SampleCount);
+        float a = t * SPIRAL_TURNS * TWO_PI + angle;
+        ivec2 offset = ivec2(vec2(cos(a), sin(a)) * t * screenRadius);
+        vec3 S = viewPosition(clamp(pixel + offset, ivec2(0), last));
+
+        vec3 v = S - P;
+        float vv = dot(v, v);
+        float vn = dot(v, N);
+        float falloff = max(0.0, 1.0 - vv / radius2);
+        sum += falloff * max(0.0, vn + P.z * 0.002) / (vv + 0.01);
+    }
+
+    Occlusion = clamp(1.0 - Intensity * 2.0 * sum / float(SampleCount), 0.0, 1.0);
+}
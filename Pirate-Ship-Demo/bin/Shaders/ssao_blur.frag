@@ -0,0 +1,29 @@
+#version 410
+
+uniform sampler2D OcclusionTex;
+uniform sampler2D LinearDepthTex;
+uniform vec2 Direction; // (1, 0) or (0, 1)
+
+out float Occlusion;
+
+const int BLUR_RADIUS = 4;
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 last = textureSize(OcclusionTex, 0) - 1;
+    ivec2 direction = ivec2(Direction);
+    float centreDepth = texelFetch(LinearDepthTex, pixel, 0).r;
+
+    // Gaussian weights attenuated by relative depth difference so edges stay sharp
+    float sum = 0.0;
+    float weightSum = 0.0;
+    for (int i = -BLUR_RADIUS; i <= BLUR_RADIUS; i++) {
+        ivec2 samplePixel = clamp(pixel + direction * i, ivec2(0), last);
+        float depth = texelFetch(LinearDepthTex, samplePixel, 0).r;
+        float weight = exp(-float(i * i) / 18.0) * exp(-abs(depth - centreDepth) / (centreDepth * 0.02));
+        sum += texelFetch(OcclusionTex, samplePixel, 0).r * weight;
+        weightSum += weight;
+    }
+
+    Occlusion = sum / weightSum;
+}
@@ -0,0 +1,22 @@
+#version 410
+
+uniform sampler2D DepthTex; // Full resolution hardware depth
+uniform vec2 ClipPlanes;    // Near, far
+
+out float LinearDepth;
+
+float linearDepth(float depth) {
+    float z = depth * 2.0 - 1.0;
+    return 2.0 * ClipPlanes.x * ClipPlanes.y / (ClipPlanes.y + ClipPlanes.x - z * (ClipPlanes.y - ClipPlanes.x));
+}
+
+void main() {
+    // Keep the nearest of each 2x2 block so thin foreground edges survive
+    ivec2 last = textureSize(DepthTex, 0) - 1;
+    ivec2 pixel = ivec2(gl_FragCoord.xy) * 2;
+    float depth = min(min(texelFetch(DepthTex, pixel, 0).r,
+                          texelFetch(DepthTex, min(pixel + ivec2(1, 0), last), 0).r),
+                      min(texelFetch(DepthTex, min(pixel + ivec2(0, 1), last), 0).r,
+                          texelFetch(DepthTex, min(pixel + ivec2(1, 1), last), 0).r));
+    LinearDepth = linearDepth(depth);
+}
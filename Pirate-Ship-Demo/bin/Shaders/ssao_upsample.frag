@@ -0,0 +1,38 @@
+#version 410
+
+uniform sampler2D OcclusionTex;   // Half resolution, blurred
+uniform sampler2D LinearDepthTex; // Half resolution view depth
+uniform sampler2D DepthTex;       // Full resolution hardware depth
+uniform vec2 ClipPlanes;          // Near, far
+
+out float Occlusion;
+
+float linearDepth(float depth) {
+    float z = depth * 2.0 - 1.0;
+    return 2.0 * ClipPlanes.x * ClipPlanes.y / (ClipPlanes.y + ClipPlanes.x - z * (ClipPlanes.y - ClipPlanes.x));
+}
+
+void main() {
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 last = textureSize(OcclusionTex, 0) - 1;
+    float depth = linearDepth(texelFetch(DepthTex, pixel, 0).r);
+
+    // Bilinear weights over the four nearest half resolution texels, scaled by depth similarity
+    vec2 position = (vec2(pixel) + 0.5) * 0.5 - 0.5;
+    ivec2 base = ivec2(floor(position));
+    vec2 f = position - vec2(base);
+
+    float sum = 0.0;
+    float weightSum = 0.0;
+    for (int i = 0; i < 4; i++) {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 samplePixel = clamp(base + offset, ivec2(0), last);
+        vec2 bilinear = mix(1.0 - f, f, vec2(offset));
+        float sampleDepth = texelFetch(LinearDepthTex, samplePixel, 0).r;
+        float weight = bilinear.x * bilinear.y / (abs(sampleDepth - depth) / depth + 0.001);
+        sum += texelFetch(OcclusionTex, samplePixel, 0).r * weight;
+        weightSum += weight;
+    }
+
+    Occlusion = sum / max(weightSum, 1e-5);
+}
@@ -0,0 +1,26 @@
+#version 410
+
+in vec2 vTexCoords;
+
+uniform sampler2D SceneTex; // HDR scene colour
+uniform sampler2D BloomTex; // Summed bloom pyramid
+uniform float BloomIntensity;
+uniform float Exposure;
+
+out vec4 FragColour;
+
+// Filmic curve (Narkowicz's ACES fit): soft shoulder instead of clipping at 1
+vec3 filmic(vec3 x) {
+    const float a = 2.51;
+    const float b = 0.03;
+    const float c = 2.43;
+    const float d = 0.59;
+    const float e = 0.14;
+    return clamp((x * (a * x + b)) / (x * (c * x + d) + e), 0.0, 1.0);
+}
+
+void main() {
+    vec3 colour = texture(SceneTex, vTexCoords).rgb;
+    colour += texture(BloomTex, vTexCoords).rgb * BloomIntensity;
+    FragColour = vec4(filmic(colour * Exposure), 1.0);
+}
@@ -0,0 +1,70 @@
+#version 410
+
+in vec2 vTexCoords;
+
+uniform sampler2D SourceTex; // Tone-mapped image at render resolution
+uniform float Sharpness;     // 0 = bilinear, 1 = full Catmull-Rom
+
+out vec4 FragColour;
+
+float luma(vec3 colour) {
+    return dot(colour, vec3(0.299, 0.587, 0.114));
+}
+
+// Catmull-Rom filter from 5 bilinear fetches (corner taps are negligible and dropped)
+vec3 catmullRom(vec2 uv, vec2 sourceSize) {
+    vec2 position = uv * sourceSize;
+    vec2 centre = floor(position - 0.5) + 0.5;
+    vec2 f = position - centre;
+
+    vec2 w0 = f * (-0.5 + f * (1.0 - 0.5 * f));
+    vec2 w1 = 1.0 + f * f * (-2.5 + 1.5 * f);
+    vec2 w2 = f * (0.5 + f * (2.0 - 1.5 * f));
+    vec2 w3 = f * f * (-0.5 + 0.5 * f);
+
+    // The middle pair of weights collapses into one bilinear fetch
+    vec2 w12 = w1 + w2;
+    vec2 offset12 = w2 / w12;
+
+    vec2 texel = 1.0 / sourceSize;
+    vec2 uv0 = (centre - 1.0) * texel;
+    vec2 uv3 = (centre + 2.0) * texel;
+    vec2 uv12 = (centre + offset12) * texel;
+
+    vec3 colour = texture(SourceTex, vec2(uv12.x, uv0.y)).rgb * w12.x * w0.y;
+    colour += texture(SourceTex, vec2(uv0.x, uv12.y)).rgb * w0.x * w12.y;
+    colour += texture(SourceTex, uv12).rgb * w12.x * w12.y;
+    colour += texture(SourceTex, vec2(uv3.x, uv12.y)).rgb * w3.x * w12.y;
+    colour += texture(SourceTex, vec2(uv12.x, uv3.y)).rgb * w12.x * w3.y;
+    float weight = w12.x * w0.y + w0.x * w12.y + w12.x * w12.y + w3.x * w12.y + w12.x * w3.y;
+    return colour / weight;
+}
+
+void main() {
+    vec2 sourceSize = vec2(textureSize(SourceTex, 0));
+    vec2 texel = 1.0 / sourceSize;
+
+    // 2x2 source texels around this pixel bound the result to prevent ringing
+    vec2 corner = (floor(vTexCoords * sourceSize - 0.5) + 0.5) * texel;
+    vec3 a = texture(SourceTex, corner).rgb;
+    vec3 b = texture(SourceTex, corner + vec2(texel.x, 0.0)).rgb;
+    vec3 c = texture(SourceTex, corner + vec2(0.0, texel.y)).rgb;
+    vec3 d = texture(SourceTex, corner + texel).rgb;
+    vec3 minimum = min(min(a, b), min(c, d));
+    vec3 maximum = max(max(a, b), max(c, d));
+
+    vec3 bilinear = texture(SourceTex, vTexCoords).rgb;
+    vec3 colour = mix(bilinear, catmullRom(vTexCoords, sourceSize), Sharpness);
+
+    // Local luma gradient; along strong edges blend in samples taken parallel to the edge
+    float la = luma(a), lb = luma(b), lc = luma(c), ld = luma(d);
+    vec2 gradient = vec2((lb + ld) - (la + lc), (lc + ld) - (la + lb));
+    float edge = length(gradient);
+    if (edge > 0.05) {
+        vec2 along = vec2(-gradient.y, gradient.x) / edge * texel * 0.75;
+        vec3 smoothed = 0.5 * (texture(SourceTex, vTexCoords + along).rgb + texture(SourceTex, vTexCoords - along).rgb);
+        colour = mix(colour, smoothed, clamp(edge * 2.0, 0.0, 0.5));
+    }
+
+    FragColour = vec4(clamp(colour, minimum, maximum), 1.0);
+}
@@ -2,16 +2,48 @@
 #include "gl_core_4_4.h"
 #include "../glfw/include/GLFW/glfw3.h"
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <thread>
 #include "Input.h"
+#include "GLStats.h"
+#include "JobSystem.h"
+#include "FlightRecorder.h"
+#include "MetricsServer.h"
+#include "NullGL.h"
+#include "Profiler.h"
 #include "imgui_glfw3.h"
 
 namespace aie {
 
 Application::Application()
 	: m_window(nullptr),
+	m_headless(false),
+	m_useEGL(false),
+	m_glBackend(GL_BACKEND_DRIVER),
 	m_gameOver(false),
-	m_fps(0) {
+	m_fps(0),
+	m_presentMode(PRESENT_VSYNC),
+	m_targetFPS(0),
+	m_maxFramesInFlight(2),
+	m_frameFences(),
+	m_frameIndex(0),
+	m_nextFrameTime(0),
+	m_sleepOvershoot(0.002),
+	m_limiterWaitTime(0),
+	m_fenceWaitTime(0),
+	m_fixedTimestep(false),
+	m_tickRate(60),
+	m_maxCatchUpSteps(5),
+	m_accumulator(0),
+	m_simulationTime(0),
+	m_interpolationAlpha(0),
+	m_ticksLastFrame(0),
+	m_recordingInput(false),
+	m_playingInput(false),
+	m_loopPlayback(false),
+	m_playbackFrame(0) {
 }
 
 Application::~Application() {
@@ -22,20 +54,54 @@ bool Application::createWindow(const char* title, int width, int height, bool fu
 	if (glfwInit() == GL_FALSE)
 		return false;
 
+	// GLFW 3.2 always needs a display connection for its window, so headless runs on
+	// a machine without one still need a virtual display (e.g. Xvfb)
+	if (m_headless) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		if (m_useEGL)
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+		fullscreen = false;
+	}
+
+	// the null backend needs a window for input, but no context and nothing shown
+	bool nullGL = m_glBackend == GL_BACKEND_NULL;
+	if (nullGL) {
+		glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		fullscreen = false;
+	}
+
 	m_window = glfwCreateWindow(width, height, title, (fullscreen ? glfwGetPrimaryMonitor() : nullptr), nullptr);
 	if (m_window == nullptr) {
 		glfwTerminate();
 		return false;
 	}
 
-	glfwMakeContextCurrent(m_window);
-	glfwSwapInterval(1); // Enable VSync
+	if (nullGL) {
+		m_presentMode = PRESENT_IMMEDIATE;
+		NullGL::install();
 
-	if (ogl_LoadFunctions() == ogl_LOAD_FAILED) {
-		glfwDestroyWindow(m_window);
-		glfwTerminate();
-		return false;
+		// like a new context, the viewport starts out covering the window
+		glViewport(0, 0, width, height);
 	}
+	else {
+		glfwMakeContextCurrent(m_window);
+
+		// Enable VSync, unless headless where nothing is shown
+		m_presentMode = m_headless ? PRESENT_IMMEDIATE : PRESENT_VSYNC;
+		glfwSwapInterval(m_headless ? 0 : 1);
+
+		if (ogl_LoadFunctions() == ogl_LOAD_FAILED) {
+			glfwDestroyWindow(m_window);
+			glfwTerminate();
+			return false;
+		}
+	}
+
+#ifdef AIE_GL_STATS
+	// counts whichever backend was loaded
+	GLStats::install();
+#endif
 
 	glfwSetWindowSizeCallback(m_window, [](GLFWwindow*, int w, int h){ glViewport(0, 0, w, h); });
 
@@ -48,7 +114,7 @@ bool Application::createWindow(const char* title, int width, int height, bool fu
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
 	// start input manager
-	Input::create();
+	Input::create(m_window);
 
 	// imgui
 	ImGui_Init(m_window, true);
@@ -58,46 +124,104 @@ bool Application::createWindow(const char* title, int width, int height, bool fu
 
 void Application::destroyWindow() {
 
+#ifdef AIE_PROFILER
+	Profiler::shutdownGpu();
+#endif
+
+	for (auto& fence : m_frameFences) {
+		if (fence != nullptr)
+			glDeleteSync(fence);
+		fence = nullptr;
+	}
+
 	ImGui_Shutdown();
 	Input::destroy();
 
 	glfwDestroyWindow(m_window);
 	glfwTerminate();
+
+#ifdef AIE_GL_STATS
+	GLStats::uninstall();
+#endif
+	NullGL::uninstall();
+}
+
+void* Application::getGLProcAddress(const char* name) {
+#ifdef AIE_GL_STATS
+	if (void* counted = GLStats::getProcAddress(name))
+		return counted;
+#endif
+	if (NullGL::isInstalled())
+		return NullGL::getProcAddress(name);
+	return (void*)glfwGetProcAddress(name);
 }
 
 void Application::run(const char* title, int width, int height, bool fullscreen) {
 
+#ifdef AIE_PROFILER
+	Profiler::setThreadName("Main");
+#endif
+
+	// start the job system first so startup() can already use it
+	JobSystem::create();
+
+	bool initialised = false;
+	{
+		PROFILE_SCOPE("Startup");
+		initialised = createWindow(title, width, height, fullscreen) && startup();
+	}
+
 	// start game loop if successfully initialised
-	if (createWindow(title,width,height, fullscreen) &&
-		startup()) {
+	if (initialised) {
 
 		// variables for timing
 		double prevTime = glfwGetTime();
 		double currTime = 0;
+		double frameTime = 0;
 		double deltaTime = 0;
 		unsigned int frames = 0;
 		double fpsInterval = 0;
 
 		// loop while game is running
+		// this loop is the only place that polls events, builds the UI and presents
 		while (!m_gameOver) {
 
+			// while minimised nothing is simulated, drawn or presented, so no frame is opened
+			// for the profiler and recorders; sleep until an event arrives instead of spinning
+			if (glfwGetWindowAttrib(m_window, GLFW_ICONIFIED) != 0) {
+				glfwWaitEventsTimeout(0.1);
+				Input::getInstance()->processEvents();
+				prevTime = glfwGetTime();
+				m_gameOver = m_gameOver || glfwWindowShouldClose(m_window) == GLFW_TRUE;
+				continue;
+			}
+
+#ifdef AIE_PROFILER
+			Profiler::beginFrame();
+#endif
+
+			// pace: hold the frame back for the frame rate cap and the GPU
+			{
+				PROFILE_SCOPE("Pace");
+				limitFrameRate();
+				waitForFramesInFlight();
+			}
+
 			// update delta time
 			currTime = glfwGetTime();
-			deltaTime = currTime - prevTime;
+			frameTime = currTime - prevTime;
+			deltaTime = frameTime;
 			if (deltaTime > 0.1f)
 				deltaTime = 0.1f;
 
 			prevTime = currTime;
 
-			// clear input
-			Input::getInstance()->clearStatus();
-
-			// update window events (input etc)
-			glfwPollEvents();
-
-			// skip if minimised
-			if (glfwGetWindowAttrib(m_window, GLFW_ICONIFIED) != 0)
-				continue;
+			// poll: update window events, then apply the input they recorded
+			{
+				PROFILE_SCOPE("Poll");
+				glfwPollEvents();
+				Input::getInstance()->processEvents();
+			}
 
 			// update fps every second
 			frames++;
@@ -106,20 +230,94 @@ void Application::run(const char* title, int width, int height, bool fullscreen)
 				m_fps = frames;
 				frames = 0;
 				fpsInterval -= 1.0f;
+				JobSystem::getInstance()->updateStatistics();
+			}
+
+			// replay: the recorded frame's input and time stand in for the live ones
+			if (m_playingInput && m_playbackFrame >= m_inputRecording.getFrameCount()) {
+				if (m_loopPlayback)
+					restartInput();
+				else
+					stopInputPlayback();
 			}
 
-			// clear imgui
-			ImGui_NewFrame();
+			if (m_playingInput) {
+				frameTime = m_inputRecording.getFrameTime(m_playbackFrame);
+				deltaTime = frameTime;
+				if (deltaTime > 0.1f)
+					deltaTime = 0.1f;
 
-			update(float(deltaTime));
+				const InputEvent* events = m_inputRecording.getEvents(m_playbackFrame);
+				for (unsigned int i = 0; i < m_inputRecording.getEventCount(m_playbackFrame); ++i)
+					Input::getInstance()->replayEvent(events[i]);
+				m_playbackFrame++;
+			}
+			else if (m_recordingInput) {
+				m_inputRecording.addFrame(frameTime, Input::getInstance()->getFrameEvents());
+			}
+
+			// run anything worker jobs handed back to the main thread (e.g. GL uploads)
+			{
+				PROFILE_SCOPE("Main Thread Jobs");
+				JobSystem::getInstance()->runMainThreadJobs();
+			}
 
-			draw();
+			// simulate: whole ticks of the fixed time step, the remainder carries over
+			m_ticksLastFrame = 0;
+			if (m_fixedTimestep) {
+				PROFILE_SCOPE("Simulate");
+				double timeStep = 1.0 / m_tickRate;
+				m_accumulator += frameTime;
+				while (m_accumulator >= timeStep && m_ticksLastFrame < m_maxCatchUpSteps) {
+					fixedUpdate(float(timeStep));
+					m_accumulator -= timeStep;
+					m_simulationTime += timeStep;
+					m_ticksLastFrame++;
+				}
+
+				// past the catch-up limit the simulation falls behind real time
+				if (m_accumulator >= timeStep)
+					m_accumulator = 0;
+				m_interpolationAlpha = float(m_accumulator / timeStep);
+			}
 
-			// draw IMGUI last
-			ImGui::Render();
+			// update: imgui windows can be built from here on
+			{
+				PROFILE_SCOPE("Update");
+				ImGui_NewFrame();
+				update(float(deltaTime));
+			}
 
-			//present backbuffer to the monitor
-			glfwSwapBuffers(m_window);
+			// render
+			{
+				PROFILE_GPU_SCOPE("Draw");
+				draw();
+			}
+
+			// ui: draw IMGUI last, over the scene
+			{
+				PROFILE_GPU_SCOPE("ImGui");
+				ImGui::Render();
+			}
+
+			// present backbuffer to the monitor
+			{
+				PROFILE_SCOPE("Present");
+				present();
+			}
+
+#ifdef AIE_PROFILER
+			Profiler::endFrame();
+#endif
+#ifdef AIE_FLIGHT_RECORDER
+			FlightRecorder::endFrame();
+#endif
+#ifdef AIE_METRICS
+			if (MetricsServer::isRunning()) {
+				MetricsServer::recordFrame(float(frameTime), m_fps);
+				MetricsServer::publish();
+			}
+#endif
 
 			// should the game exit?
 			m_gameOver = m_gameOver || glfwWindowShouldClose(m_window) == GLFW_TRUE;
@@ -129,6 +327,52 @@ void Application::run(const char* title, int width, int height, bool fullscreen)
 	// cleanup
 	shutdown();
 	destroyWindow();
+	JobSystem::destroy();
+}
+
+void Application::startInputRecording() {
+	stopInputPlayback();
+	m_inputRecording.clear();
+	m_recordingInput = true;
+	restartInput();
+}
+
+bool Application::stopInputRecording(const char* filename) {
+	if (!m_recordingInput)
+		return false;
+	m_recordingInput = false;
+	return m_inputRecording.save(filename);
+}
+
+bool Application::startInputPlayback(const char* filename, bool loop) {
+	m_recordingInput = false;
+	stopInputPlayback();
+	if (!m_inputRecording.load(filename))
+		return false;
+
+	m_playingInput = true;
+	m_loopPlayback = loop;
+	Input::getInstance()->setLiveInputBlocked(true);
+	restartInput();
+	return true;
+}
+
+void Application::stopInputPlayback() {
+	if (!m_playingInput)
+		return;
+	m_playingInput = false;
+	Input::getInstance()->setLiveInputBlocked(false);
+	Input::getInstance()->resetState();
+}
+
+void Application::restartInput() {
+	// the tick phase is part of the state, so the same frame times give the same ticks
+	m_accumulator = 0;
+	m_simulationTime = 0;
+	m_interpolationAlpha = 0;
+	m_playbackFrame = 0;
+	Input::getInstance()->resetState();
+	resetSimulation();
 }
 
 bool Application::hasWindowClosed() {
@@ -144,7 +388,103 @@ void Application::setBackgroundColour(float r, float g, float b, float a) {
 }
 
 void Application::setVSync(bool enable) {
-	glfwSwapInterval(enable ? 1 : 0);
+	setPresentMode(enable ? PRESENT_VSYNC : PRESENT_IMMEDIATE);
+}
+
+void Application::setPresentMode(EPresentMode mode) {
+	if (mode == PRESENT_ADAPTIVE_VSYNC && !isAdaptiveVSyncSupported())
+		mode = PRESENT_VSYNC;
+
+	// a negative interval is adaptive v-sync
+	m_presentMode = mode;
+	if (m_glBackend != GL_BACKEND_NULL)
+		glfwSwapInterval(mode == PRESENT_VSYNC ? 1 : mode == PRESENT_ADAPTIVE_VSYNC ? -1 : 0);
+}
+
+bool Application::isAdaptiveVSyncSupported() const {
+	return glfwExtensionSupported("WGL_EXT_swap_control_tear") == GLFW_TRUE ||
+		glfwExtensionSupported("GLX_EXT_swap_control_tear") == GLFW_TRUE;
+}
+
+void Application::setMaxFramesInFlight(unsigned int frames) {
+	m_maxFramesInFlight = frames < MAX_FRAMES_IN_FLIGHT ? frames : MAX_FRAMES_IN_FLIGHT;
+}
+
+void Application::setFixedTimestep(bool enabled) {
+	if (enabled && !m_fixedTimestep) {
+		m_accumulator = 0;
+		m_interpolationAlpha = 0;
+	}
+	m_fixedTimestep = enabled;
+}
+
+void Application::limitFrameRate() {
+	double start = glfwGetTime();
+	if (m_targetFPS <= 0) {
+		m_nextFrameTime = start;
+		m_limiterWaitTime = 0;
+		return;
+	}
+
+	// deadlines follow on from each other so frame times average out to the target, but
+	// after a stall (or when the cap is first set) start again rather than rush to catch up
+	double interval = 1.0 / m_targetFPS;
+	double deadline = m_nextFrameTime;
+	if (deadline < start - interval || deadline > start + interval)
+		deadline = start;
+
+	// sleep in short steps while there is time for the OS to oversleep, then spin the rest
+	double now = start;
+	while (deadline - now > 0.001 + m_sleepOvershoot) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		double woken = glfwGetTime();
+
+		// the estimate follows the worst recent oversleep and slowly decays back down
+		m_sleepOvershoot = std::max(woken - now - 0.001, m_sleepOvershoot * 0.99);
+		now = woken;
+	}
+	while (now < deadline) {
+		std::this_thread::yield();
+		now = glfwGetTime();
+	}
+
+	m_nextFrameTime = deadline + interval;
+	m_limiterWaitTime = float((now - start) * 1000.0);
+}
+
+void Application::waitForFramesInFlight() {
+	m_fenceWaitTime = 0;
+	if (m_maxFramesInFlight == 0 || m_frameIndex < m_maxFramesInFlight)
+		return;
+
+	// the frame presented m_maxFramesInFlight frames ago must have finished on the GPU
+	__GLsync*& fence = m_frameFences[(m_frameIndex - m_maxFramesInFlight) % MAX_FRAMES_IN_FLIGHT];
+	if (fence == nullptr)
+		return;
+
+	double start = glfwGetTime();
+	while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {
+	}
+	m_fenceWaitTime = float((glfwGetTime() - start) * 1000.0);
+
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+void Application::present() {
+	if (m_glBackend != GL_BACKEND_NULL)
+		glfwSwapBuffers(m_window);
+
+	// replaces the fence of the frame MAX_FRAMES_IN_FLIGHT ago, which has been waited on if it mattered
+	__GLsync*& fence = m_frameFences[m_frameIndex % MAX_FRAMES_IN_FLIGHT];
+	if (fence != nullptr)
+		glDeleteSync(fence);
+	fence = m_maxFramesInFlight > 0 ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : nullptr;
+	m_frameIndex++;
+
+#ifdef AIE_GL_STATS
+	GLStats::endFrame();
+#endif
 }
 
 void Application::setShowCursor(bool visible) {
@@ -1,8 +1,13 @@
 #pragma once
 
+#include "InputRecording.h"
+
 // forward declared structure for access to GLFW window
 struct GLFWwindow;
 
+// forward declared OpenGL fence sync object
+struct __GLsync;
+
 namespace aie {
 
 // this is the pure-virtual base class that wraps up an application for us.
@@ -24,6 +29,36 @@ public:
 	virtual void update(float deltaTime) = 0;
 	virtual void draw() = 0;
 
+	// called with a constant time step in fixed timestep mode, zero or more times per
+	// frame before update(), so simulation is independent of the frame rate
+	virtual void fixedUpdate(float /*timeStep*/) {}
+
+	// called when input recording or playback starts, and each time playback loops, to put
+	// whatever the input drives back in its starting state so every replay matches
+	virtual void resetSimulation() {}
+
+	// headless runs keep the window hidden and never wait for v-sync, and can create the
+	// context through EGL instead of WGL/GLX (e.g. Mesa's llvmpipe on a CI machine)
+	// must be set before run()
+	void setHeadless(bool headless, bool useEGL = false) { m_headless = headless; m_useEGL = useEGL; }
+	bool isHeadless() const { return m_headless; }
+
+	// which GL the engine's calls reach
+	enum EGLBackend : int {
+		GL_BACKEND_DRIVER,		// a real context from the window
+		GL_BACKEND_NULL			// no context: calls are checked and counted but do nothing (see NullGL)
+	};
+
+	// the null backend measures the CPU cost of rendering without the driver or a GPU
+	// must be set before run()
+	void setGLBackend(EGLBackend backend) { m_glBackend = backend; }
+	EGLBackend getGLBackend() const { return m_glBackend; }
+
+	// for GL loaders other than gl_core_4_4 (e.g. glad), so they load the same backend,
+	// through the GLStats counters when they are compiled in
+	// gladLoadGLLoader((GLADloadproc)aie::Application::getGLProcAddress)
+	static void* getGLProcAddress(const char* name);
+
 	// wipes the screen clear to begin a frame of drawing
 	void clearScreen();
 
@@ -33,9 +68,69 @@ public:
 	// show or hide the OS cursor
 	void setShowCursor(bool visible);
 
+	// how buffer swaps are synchronised with the display
+	enum EPresentMode : int {
+		PRESENT_VSYNC,			// wait for the vertical blank
+		PRESENT_ADAPTIVE_VSYNC,	// wait for the blank, but swap straight away if the frame missed it
+		PRESENT_IMMEDIATE		// never wait for the display
+	};
+
 	// enable or disable v-sync
 	void setVSync(bool enabled);
 
+	// adaptive v-sync falls back to v-sync where the driver lacks swap_control_tear
+	void setPresentMode(EPresentMode mode);
+	EPresentMode getPresentMode() const { return m_presentMode; }
+	bool isAdaptiveVSyncSupported() const;
+
+	// caps the frame rate with a sleep then spin limiter, 0 for uncapped
+	void setTargetFPS(float fps) { m_targetFPS = fps; }
+	float getTargetFPS() const { return m_targetFPS; }
+
+	// limits how many frames the GPU can fall behind the CPU, using fence syncs
+	// 1 keeps the CPU and GPU in lock step for the lowest latency, 0 leaves it to the driver
+	void setMaxFramesInFlight(unsigned int frames);
+	unsigned int getMaxFramesInFlight() const { return m_maxFramesInFlight; }
+
+	// fixed timestep mode: frame time is accumulated and spent in whole ticks of fixedUpdate()
+	// the leftover fraction of a tick is the interpolation alpha, for draw() to blend the
+	// last two ticks so rendering stays smooth at any refresh rate
+	// the tick rate is kept to at least 1 per second, so the time step stays finite
+	void setFixedTimestep(bool enabled);
+	bool isFixedTimestep() const { return m_fixedTimestep; }
+	void setTickRate(float ticksPerSecond) { m_tickRate = ticksPerSecond > 1.0f ? ticksPerSecond : 1.0f; }
+	float getTickRate() const { return m_tickRate; }
+	float getTimeStep() const { return 1.0f / m_tickRate; }
+
+	// ticks run per frame before the rest of the frame time is dropped, so a slow frame
+	// slows the simulation down rather than making the next frame slower still
+	void setMaxCatchUpSteps(unsigned int steps) { m_maxCatchUpSteps = steps; }
+	unsigned int getMaxCatchUpSteps() const { return m_maxCatchUpSteps; }
+
+	// 0 at the latest tick, approaching 1 just before the next one
+	float getInterpolationAlpha() const { return m_interpolationAlpha; }
+
+	// time of the latest tick, the sum of every time step so far
+	double getSimulationTime() const { return m_simulationTime; }
+	unsigned int getTicksLastFrame() const { return m_ticksLastFrame; }
+
+	// input recording: from the next frame on, each frame's time and input events are
+	// captured. playback feeds them back in place of live input and the measured frame
+	// time, so every playback of a recording runs the same frames with the same input
+	void startInputRecording();
+	// ends the recording and saves it, returning false if the file could not be written
+	bool stopInputRecording(const char* filename);
+	bool startInputPlayback(const char* filename, bool loop = false);
+	void stopInputPlayback();
+	bool isRecordingInput() const { return m_recordingInput; }
+	bool isPlayingInput() const { return m_playingInput; }
+	unsigned int getPlaybackFrame() const { return m_playbackFrame; }
+	const InputRecording& getInputRecording() const { return m_inputRecording; }
+
+	// milliseconds the last frame was held back by the frame rate cap / by its fence
+	float getLimiterWaitTime() const { return m_limiterWaitTime; }
+	float getFenceWaitTime() const { return m_fenceWaitTime; }
+
 	// sets m_gameOver to true which will close the application safely when the frame ends
 	void quit() { m_gameOver = true; }
 
@@ -60,13 +155,59 @@ protected:
 	virtual bool createWindow(const char* title, int width, int height, bool fullscreen);
 	virtual void destroyWindow();
 
+	static const unsigned int MAX_FRAMES_IN_FLIGHT = 4;
+
+	// frame pacing, run at the start of every frame
+	// waits until the frame rate cap allows the next frame to start
+	void limitFrameRate();
+	// waits until no more than the allowed number of frames are queued on the GPU
+	void waitForFramesInFlight();
+
+	// swaps the back buffer and fences the frame's GL commands
+	void present();
+
+	// returns input and the simulation to where recording and playback start from
+	void restartInput();
+
 	GLFWwindow*		m_window;
 
+	bool			m_headless;
+	bool			m_useEGL;
+	EGLBackend		m_glBackend;
+
 	// if set to false, the main game loop will exit
 	bool			m_gameOver;
 	
 	unsigned int	m_fps;
 
+	EPresentMode	m_presentMode;
+	float			m_targetFPS;
+	unsigned int	m_maxFramesInFlight;
+
+	// fences of the last frames presented, indexed by frame number
+	__GLsync*		m_frameFences[MAX_FRAMES_IN_FLIGHT];
+	unsigned int	m_frameIndex;
+
+	double			m_nextFrameTime;	// when the frame rate cap lets the next frame start
+	double			m_sleepOvershoot;	// recent worst case of sleeping longer than asked
+
+	float			m_limiterWaitTime;
+	float			m_fenceWaitTime;
+
+	bool			m_fixedTimestep;
+	float			m_tickRate;
+	unsigned int	m_maxCatchUpSteps;
+	double			m_accumulator;		// frame time not yet spent on ticks
+	double			m_simulationTime;
+	float			m_interpolationAlpha;
+	unsigned int	m_ticksLastFrame;
+
+	InputRecording	m_inputRecording;
+	bool			m_recordingInput;
+	bool			m_playingInput;
+	bool			m_loopPlayback;
+	unsigned int	m_playbackFrame;	// next recorded frame to replay
+
 };
 
 } // namespace aie
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include "FlightRecorder.h"
+
+#ifdef AIE_FLIGHT_RECORDER
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <imgui.h>
+
+// heap allocations are counted by replacing the global operator new and delete
+// the runtime's array forms pass on to these, the aligned forms are not counted
+static std::atomic<unsigned long long> s_allocations(0);
+static std::atomic<unsigned long long> s_frees(0);
+
+void* operator new(std::size_t size) {
+	s_allocations.fetch_add(1, std::memory_order_relaxed);
+	if (size == 0)
+		size = 1;
+	while (true) {
+		void* memory = std::malloc(size);
+		if (memory != nullptr)
+			return memory;
+		std::new_handler handler = std::get_new_handler();
+		if (handler == nullptr)
+			throw std::bad_alloc();
+		handler();
+	}
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return operator new(size);
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void operator delete(void* memory) noexcept {
+	if (memory == nullptr)
+		return;
+	s_frees.fetch_add(1, std::memory_order_relaxed);
+	std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept {
+	operator delete(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+	operator delete(memory);
+}
+
+namespace aie {
+
+// hitches listed in the ImGui panel
+static const unsigned int RECENT_HITCHES = 8;
+
+struct RecorderState {
+	bool					enabled = true;
+	float					threshold = 2.0f;
+	float					minimumMilliseconds = 10.0f;
+	float					window = 5.0f;
+	float					cooldown = 10.0f;
+	std::string				prefix = "hitch_";
+	unsigned int			maxDumps = 16;
+
+	FlightRecorder::Frame	frames[FlightRecorder::HISTORY_FRAMES] = {};
+	unsigned int			frameCount = 0;		// ever recorded, the ring holds the latest
+	unsigned long long		lastFrameEnd = 0;
+	unsigned long long		lastAllocations = 0;
+	unsigned long long		lastFrees = 0;
+	bool					skipNext = false;	// the frame that wrote a dump
+
+	unsigned int			hitches = 0;
+	unsigned int			dumps = 0;
+	FlightRecorder::Frame	recentHitches[RECENT_HITCHES] = {};
+	unsigned long long		cooldownUntil = 0;
+
+	// a hitch waiting for the GPU to time it
+	bool					pending = false;
+	unsigned int			pendingNumber = 0;
+	unsigned long long		pendingStart = 0;
+	unsigned int			pendingFrames = 0;
+
+	float					medianScratch[FlightRecorder::MEDIAN_FRAMES];
+};
+
+static RecorderState s_recorder;
+
+static unsigned long long secondsToTicks(float seconds) {
+	return (unsigned long long)(seconds * Profiler::getTicksPerSecond());
+}
+
+// the median time of the frames before the latest
+static float medianOfPrevious() {
+	unsigned int count = std::min(s_recorder.frameCount - 1, FlightRecorder::MEDIAN_FRAMES);
+	for (unsigned int i = 0; i < count; i++)
+		s_recorder.medianScratch[i] = FlightRecorder::getFrame(FlightRecorder::getFrameCount() - 2 - i).milliseconds;
+	float* middle = s_recorder.medianScratch + count / 2;
+	std::nth_element(s_recorder.medianScratch, middle, s_recorder.medianScratch + count);
+	return *middle;
+}
+
+static bool writeWindow(const char* filename, unsigned long long until) {
+	unsigned long long window = secondsToTicks(s_recorder.window);
+	return Profiler::writeTraceSince(filename, until > window ? until - window : 0);
+}
+
+void FlightRecorder::endFrame() {
+	unsigned long long now = Profiler::now();
+	unsigned long long allocations = s_allocations.load(std::memory_order_relaxed);
+	unsigned long long frees = s_frees.load(std::memory_order_relaxed);
+	unsigned long long start = s_recorder.lastFrameEnd;
+	unsigned long long frameAllocations = allocations - s_recorder.lastAllocations;
+	unsigned long long frameFrees = frees - s_recorder.lastFrees;
+	s_recorder.lastFrameEnd = now;
+	s_recorder.lastAllocations = allocations;
+	s_recorder.lastFrees = frees;
+
+	// a frame lasts from the end of one to the end of the next, pacing included
+	if (!s_recorder.enabled || start == 0)
+		return;
+
+	Frame& frame = s_recorder.frames[s_recorder.frameCount % HISTORY_FRAMES];
+	frame.number = Profiler::getFrameNumber() - 1;
+	frame.start = start;
+	frame.end = now;
+	frame.milliseconds = (float)Profiler::toMilliseconds(now - start);
+	frame.allocations = (unsigned int)frameAllocations;
+	frame.frees = (unsigned int)frameFrees;
+#ifdef AIE_GL_STATS
+	frame.gl = GLStats::getLastFrame().total;
+#endif
+	s_recorder.frameCount++;
+	frame.median = s_recorder.frameCount > 1 ? medianOfPrevious() : frame.milliseconds;
+
+	Profiler::counter("Frame ms", frame.milliseconds);
+	Profiler::counter("Median ms", frame.median);
+	Profiler::counter("Allocations", frame.allocations);
+#ifdef AIE_GL_STATS
+	Profiler::counter("Draw calls", frame.gl.drawCalls);
+	Profiler::counter("Triangles", frame.gl.triangles);
+	Profiler::counter("Upload KB", frame.gl.bufferUploadBytes / 1024.0);
+#endif
+
+	// dump a hitch once its GPU scopes have been read back, so they are in the trace too
+	if (s_recorder.pending && --s_recorder.pendingFrames == 0) {
+		std::string filename = s_recorder.prefix + std::to_string(s_recorder.pendingNumber) + ".json";
+		if (writeWindow(filename.c_str(), s_recorder.pendingStart))
+			s_recorder.dumps++;
+		s_recorder.pending = false;
+		s_recorder.cooldownUntil = Profiler::now() + secondsToTicks(s_recorder.cooldown);
+		s_recorder.skipNext = true;
+		return;
+	}
+
+	// the median needs a full window before it is trusted, which also skips loading
+	bool skip = s_recorder.skipNext;
+	s_recorder.skipNext = false;
+	if (skip || s_recorder.frameCount <= MEDIAN_FRAMES)
+		return;
+	if (frame.milliseconds <= frame.median * s_recorder.threshold || frame.milliseconds <= s_recorder.minimumMilliseconds)
+		return;
+
+	s_recorder.recentHitches[s_recorder.hitches % RECENT_HITCHES] = frame;
+	s_recorder.hitches++;
+	if (!s_recorder.pending && now >= s_recorder.cooldownUntil && s_recorder.dumps < s_recorder.maxDumps) {
+		s_recorder.pending = true;
+		s_recorder.pendingNumber = frame.number;
+		s_recorder.pendingStart = frame.start;
+		s_recorder.pendingFrames = Profiler::GPU_FRAME_LATENCY;
+	}
+}
+
+void FlightRecorder::setEnabled(bool enabled) {
+	s_recorder.enabled = enabled;
+}
+
+bool FlightRecorder::isEnabled() {
+	return s_recorder.enabled;
+}
+
+void FlightRecorder::setThreshold(float multiplier, float minimumMilliseconds) {
+	s_recorder.threshold = multiplier;
+	s_recorder.minimumMilliseconds = minimumMilliseconds;
+}
+
+void FlightRecorder::setWindow(float seconds) {
+	s_recorder.window = seconds;
+}
+
+void FlightRecorder::setCooldown(float seconds) {
+	s_recorder.cooldown = seconds;
+}
+
+void FlightRecorder::setOutput(const char* prefix, unsigned int maxDumps) {
+	s_recorder.prefix = prefix;
+	s_recorder.maxDumps = maxDumps;
+}
+
+unsigned int FlightRecorder::getFrameCount() {
+	return std::min(s_recorder.frameCount, HISTORY_FRAMES);
+}
+
+const FlightRecorder::Frame& FlightRecorder::getFrame(unsigned int index) {
+	return s_recorder.frames[(s_recorder.frameCount - getFrameCount() + index) % HISTORY_FRAMES];
+}
+
+unsigned int FlightRecorder::getHitchCount() {
+	return s_recorder.hitches;
+}
+
+unsigned int FlightRecorder::getDumpCount() {
+	return s_recorder.dumps;
+}
+
+unsigned long long FlightRecorder::getAllocationCount() {
+	return s_allocations.load(std::memory_order_relaxed);
+}
+
+unsigned long long FlightRecorder::getFreeCount() {
+	return s_frees.load(std::memory_order_relaxed);
+}
+
+bool FlightRecorder::dump(const char* filename) {
+	return writeWindow(filename, Profiler::now());
+}
+
+void FlightRecorder::drawImGui() {
+	ImGui::Checkbox("Enabled", &s_recorder.enabled);
+	ImGui::SliderFloat("Threshold (x median)", &s_recorder.threshold, 1.25f, 5.0f);
+	ImGui::SliderFloat("Minimum (ms)", &s_recorder.minimumMilliseconds, 0.0f, 100.0f);
+	ImGui::SliderFloat("Window (s)", &s_recorder.window, 1.0f, 10.0f);
+
+	if (getFrameCount() > 0) {
+		const Frame& frame = getFrame(getFrameCount() - 1);
+		ImGui::Text("frame %.2f ms, median %.2f ms, %u allocations", frame.milliseconds, frame.median, frame.allocations);
+	}
+	ImGui::Text("%u hitches, %u of %u dumps written", s_recorder.hitches, s_recorder.dumps, s_recorder.maxDumps);
+
+	unsigned int listed = std::min(s_recorder.hitches, RECENT_HITCHES);
+	for (unsigned int i = 0; i < listed; i++) {
+		const Frame& hitch = s_recorder.recentHitches[(s_recorder.hitches - 1 - i) % RECENT_HITCHES];
+		ImGui::Text("frame %-8u %8.2f ms (median %.2f)", hitch.number, hitch.milliseconds, hitch.median);
+	}
+
+	if (ImGui::Button("Dump Now"))
+		dump((s_recorder.prefix + "manual.json").c_str());
+}
+
+} // namespace aie
+
+#endif
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "Profiler.h"
+#include "GLStats.h"
+
+// the flight recorder needs the profiler, and is compiled in with it unless
+// AIE_NO_FLIGHT_RECORDER is defined, for every project that links bootstrap
+#if defined(AIE_PROFILER) && !defined(AIE_NO_FLIGHT_RECORDER)
+#define AIE_FLIGHT_RECORDER
+#endif
+
+#ifdef AIE_FLIGHT_RECORDER
+
+namespace aie {
+
+// an always on recorder that writes a trace when a frame takes much longer than usual
+// every frame it keeps a summary (time, GL counts, heap allocations) in a fixed ring and
+// passes the counts to the profiler as counters, whose own rings keep the scopes. a frame
+// over the threshold times the rolling median is a hitch: a few frames later, once the
+// GPU has timed it, the last seconds of profiler history are written as a Chrome trace,
+// named after the hitch's frame. writing takes a few milliseconds on the frame thread, so
+// after a dump hitches are ignored for a while, and only so many dumps are written.
+class FlightRecorder {
+public:
+
+	struct Frame {
+		unsigned int		number;
+		unsigned long long	start;			// profiler ticks
+		unsigned long long	end;
+		float				milliseconds;
+		float				median;			// of the frames before it
+		unsigned int		allocations;	// operator new calls during the frame
+		unsigned int		frees;
+#ifdef AIE_GL_STATS
+		GLStats::Counters	gl;
+#endif
+	};
+
+	static const unsigned int HISTORY_FRAMES = 1024;	// summaries kept
+	static const unsigned int MEDIAN_FRAMES = 120;		// frames the median is taken over
+
+	// call once a frame after Profiler::endFrame(), from the same thread
+	static void endFrame();
+
+	static void setEnabled(bool enabled);
+	static bool isEnabled();
+
+	// a frame is a hitch when it takes longer than both the threshold times the median
+	// and the minimum, so jitter in very short frames is not reported
+	static void setThreshold(float multiplier, float minimumMilliseconds);
+
+	// how much history each dump holds, and how long after a dump until the next
+	static void setWindow(float seconds);
+	static void setCooldown(float seconds);
+
+	// dumps are written as <prefix><frame>.json; no more than maxDumps are written
+	static void setOutput(const char* prefix, unsigned int maxDumps);
+
+	// summaries of recent frames, oldest first
+	static unsigned int getFrameCount();
+	static const Frame& getFrame(unsigned int index);
+
+	static unsigned int getHitchCount();
+	static unsigned int getDumpCount();
+
+	// heap allocations made through operator new since the program started
+	static unsigned long long getAllocationCount();
+	static unsigned long long getFreeCount();
+
+	// writes the window of history now, as a hitch would
+	static bool dump(const char* filename);
+
+	// settings, the current median and the latest hitches
+	static void drawImGui();
+};
+
+} // namespace aie
+
+#endif
@@ -0,0 +1,624 @@
+#include "GLStats.h"
+
+#ifdef AIE_GL_STATS
+
+#include "gl_core_4_4.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <imgui.h>
+
+namespace aie {
+
+// every entry point that is counted
+#define GL_STATS_FUNCTIONS(X) \
+	X(glDrawArrays) X(glDrawElements) X(glDrawElementsBaseVertex) X(glMultiDrawElementsIndirect) \
+	X(glUseProgram) X(glBindVertexArray) X(glBindTexture) X(glActiveTexture) \
+	X(glBindBuffer) X(glBindBufferBase) X(glBindBufferRange) X(glBindFramebuffer) \
+	X(glEnable) X(glDisable) X(glBlendFunc) X(glBlendEquation) \
+	X(glBlendEquationSeparate) X(glDepthFunc) X(glDepthMask) X(glColorMask) \
+	X(glViewport) X(glScissor) X(glClearColor) X(glPolygonOffset) \
+	X(glUniform1f) X(glUniform1fv) X(glUniform1i) X(glUniform1iv) \
+	X(glUniform2f) X(glUniform2fv) X(glUniform3f) X(glUniform3fv) \
+	X(glUniform4f) X(glUniform4fv) X(glUniformMatrix2fv) X(glUniformMatrix3fv) \
+	X(glUniformMatrix4fv) X(glBufferData) X(glBufferSubData) X(glBufferStorage) \
+	X(glMapBufferRange) X(glGetIntegerv) X(glGetFloatv) X(glGetBooleanv) \
+	X(glGetInteger64v) X(glGetError) X(glGetString) X(glGetStringi) \
+	X(glGetUniformLocation) X(glGetAttribLocation) X(glGetUniformBlockIndex) X(glGetProgramiv) \
+	X(glGetShaderiv) X(glGetQueryObjectiv) X(glGetQueryObjectuiv) X(glGetQueryObjectui64v) \
+	X(glIsEnabled) X(glDeleteTextures) X(glDeleteBuffers) X(glDeleteVertexArrays) \
+	X(glDeleteFramebuffers)
+
+// the functions each wrapper passes its call on to
+#define GL_STATS_NEXT(name) static decltype(_ptrc_##name) next_##name = nullptr;
+GL_STATS_FUNCTIONS(GL_STATS_NEXT)
+#undef GL_STATS_NEXT
+
+// state no call has set yet, so the first set is never redundant
+static const unsigned int UNKNOWN = 0xffffffff;
+
+struct IndexedBuffer {
+	GLuint		buffer;
+	GLintptr	offset;
+	GLsizeiptr	size;
+};
+
+// what the wrapped calls last set, to tell redundant sets apart
+struct ShadowState {
+	GLuint		program = UNKNOWN;
+	GLuint		vertexArray = UNKNOWN;
+	GLuint		activeTexture = UNKNOWN;
+	GLuint		drawFramebuffer = UNKNOWN;
+	GLuint		readFramebuffer = UNKNOWN;
+	std::unordered_map<unsigned long long, GLuint> textures;			// by unit and target
+	std::unordered_map<GLenum, GLuint> buffers;							// by target
+	std::unordered_map<unsigned long long, IndexedBuffer> indexedBuffers;	// by target and index
+	std::unordered_map<GLenum, bool> capabilities;
+	GLenum		blend[4] = { UNKNOWN, UNKNOWN, UNKNOWN, UNKNOWN };		// src, dst, rgb and alpha equations
+	GLenum		depthFunc = UNKNOWN;
+	GLuint		depthMask = UNKNOWN;
+	GLuint		colourMask = UNKNOWN;
+	GLint		viewport[4] = { -1, -1, -1, -1 };
+	GLint		scissor[4] = { -1, -1, -1, -1 };
+	GLfloat		clearColour[4] = { -1, -1, -1, -1 };
+	GLfloat		polygonOffset[2] = { -1, -1 };
+};
+
+struct GLStatsState {
+	bool			installed = false;
+	ShadowState		shadow;
+
+	std::vector<const char*> sectionNames;
+	unsigned int	section = 0;
+
+	GLStats::Frame	frame = {};
+	std::vector<GLStats::Frame> history;	// a ring of HISTORY_FRAMES
+	unsigned int	historyStart = 0;
+	unsigned int	frameNumber = 0;
+};
+
+static GLStatsState s_stats;
+
+// the counters of the section the calls are made in
+static GLStats::Counters& counters() {
+	return s_stats.frame.sections[s_stats.section];
+}
+
+// counts a redundant set and returns whether the call changes anything
+static bool stateChanged(bool changed) {
+	if (!changed)
+		counters().redundantStateSets++;
+	return changed;
+}
+
+static unsigned long long bindingKey(GLuint index, GLenum target) {
+	return ((unsigned long long)index << 32) | target;
+}
+
+static unsigned int countTriangles(GLenum mode, GLsizei count) {
+	switch (mode) {
+	case GL_TRIANGLES:		return (unsigned int)count / 3;
+	case GL_TRIANGLE_STRIP:
+	case GL_TRIANGLE_FAN:	return count > 2 ? (unsigned int)count - 2 : 0;
+	default:				return 0;
+	}
+}
+
+static void CODEGEN_FUNCPTR stats_glDrawArrays(GLenum mode, GLint first, GLsizei count) {
+	counters().drawCalls++;
+	counters().triangles += countTriangles(mode, count);
+	next_glDrawArrays(mode, first, count);
+}
+
+static void CODEGEN_FUNCPTR stats_glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices) {
+	counters().drawCalls++;
+	counters().triangles += countTriangles(mode, count);
+	next_glDrawElements(mode, count, type, indices);
+}
+
+static void CODEGEN_FUNCPTR stats_glDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices, GLint basevertex) {
+	counters().drawCalls++;
+	counters().triangles += countTriangles(mode, count);
+	next_glDrawElementsBaseVertex(mode, count, type, indices, basevertex);
+}
+
+// the counts are in a GPU buffer, so only the draws are known
+static void CODEGEN_FUNCPTR stats_glMultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride) {
+	counters().drawCalls += drawcount > 0 ? (unsigned int)drawcount : 0;
+	next_glMultiDrawElementsIndirect(mode, type, indirect, drawcount, stride);
+}
+
+static void CODEGEN_FUNCPTR stats_glUseProgram(GLuint program) {
+	counters().programBinds++;
+	stateChanged(s_stats.shadow.program != program);
+	s_stats.shadow.program = program;
+	next_glUseProgram(program);
+}
+
+static void CODEGEN_FUNCPTR stats_glBindVertexArray(GLuint array) {
+	counters().vertexArrayBinds++;
+	stateChanged(s_stats.shadow.vertexArray != array);
+	s_stats.shadow.vertexArray = array;
+	next_glBindVertexArray(array);
+}
+
+static void CODEGEN_FUNCPTR stats_glBindTexture(GLenum target, GLuint texture) {
+	counters().textureBinds++;
+	auto inserted = s_stats.shadow.textures.insert(std::make_pair(bindingKey(s_stats.shadow.activeTexture, target), texture));
+	if (!inserted.second && stateChanged(inserted.first->second != texture))
+		inserted.first->second = texture;
+	next_glBindTexture(target, texture);
+}
+
+static void CODEGEN_FUNCPTR stats_glActiveTexture(GLenum texture) {
+	stateChanged(s_stats.shadow.activeTexture != texture - GL_TEXTURE0);
+	s_stats.shadow.activeTexture = texture - GL_TEXTURE0;
+	next_glActiveTexture(texture);
+}
+
+static void CODEGEN_FUNCPTR stats_glBindBuffer(GLenum target, GLuint buffer) {
+	auto inserted = s_stats.shadow.buffers.insert(std::make_pair(target, buffer));
+	if (!inserted.second && stateChanged(inserted.first->second != buffer))
+		inserted.first->second = buffer;
+	next_glBindBuffer(target, buffer);
+}
+
+// binding to an index also binds to the target
+static void bindIndexedBuffer(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	IndexedBuffer binding = { buffer, offset, size };
+	auto inserted = s_stats.shadow.indexedBuffers.insert(std::make_pair(bindingKey(index, target), binding));
+	if (!inserted.second) {
+		IndexedBuffer& previous = inserted.first->second;
+		if (stateChanged(previous.buffer != buffer || previous.offset != offset || previous.size != size))
+			previous = binding;
+	}
+	s_stats.shadow.buffers[target] = buffer;
+}
+
+static void CODEGEN_FUNCPTR stats_glBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+	bindIndexedBuffer(target, index, buffer, 0, -1);
+	next_glBindBufferBase(target, index, buffer);
+}
+
+static void CODEGEN_FUNCPTR stats_glBindBufferRange(GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	bindIndexedBuffer(target, index, buffer, offset, size);
+	next_glBindBufferRange(target, index, buffer, offset, size);
+}
+
+static void CODEGEN_FUNCPTR stats_glBindFramebuffer(GLenum target, GLuint framebuffer) {
+	bool draw = target != GL_READ_FRAMEBUFFER, read = target != GL_DRAW_FRAMEBUFFER;
+	stateChanged((draw && s_stats.shadow.drawFramebuffer != framebuffer) || (read && s_stats.shadow.readFramebuffer != framebuffer));
+	if (draw) s_stats.shadow.drawFramebuffer = framebuffer;
+	if (read) s_stats.shadow.readFramebuffer = framebuffer;
+	next_glBindFramebuffer(target, framebuffer);
+}
+
+static void setCapability(GLenum cap, bool enabled) {
+	auto inserted = s_stats.shadow.capabilities.insert(std::make_pair(cap, enabled));
+	if (!inserted.second && stateChanged(inserted.first->second != enabled))
+		inserted.first->second = enabled;
+}
+
+static void CODEGEN_FUNCPTR stats_glEnable(GLenum cap) {
+	setCapability(cap, true);
+	next_glEnable(cap);
+}
+
+static void CODEGEN_FUNCPTR stats_glDisable(GLenum cap) {
+	setCapability(cap, false);
+	next_glDisable(cap);
+}
+
+static void CODEGEN_FUNCPTR stats_glBlendFunc(GLenum sfactor, GLenum dfactor) {
+	GLenum* blend = s_stats.shadow.blend;
+	if (stateChanged(blend[0] != sfactor || blend[1] != dfactor)) {
+		blend[0] = sfactor;
+		blend[1] = dfactor;
+	}
+	next_glBlendFunc(sfactor, dfactor);
+}
+
+static void CODEGEN_FUNCPTR stats_glBlendEquation(GLenum mode) {
+	GLenum* blend = s_stats.shadow.blend;
+	if (stateChanged(blend[2] != mode || blend[3] != mode))
+		blend[2] = blend[3] = mode;
+	next_glBlendEquation(mode);
+}
+
+static void CODEGEN_FUNCPTR stats_glBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha) {
+	GLenum* blend = s_stats.shadow.blend;
+	if (stateChanged(blend[2] != modeRGB || blend[3] != modeAlpha)) {
+		blend[2] = modeRGB;
+		blend[3] = modeAlpha;
+	}
+	next_glBlendEquationSeparate(modeRGB, modeAlpha);
+}
+
+static void CODEGEN_FUNCPTR stats_glDepthFunc(GLenum func) {
+	stateChanged(s_stats.shadow.depthFunc != func);
+	s_stats.shadow.depthFunc = func;
+	next_glDepthFunc(func);
+}
+
+static void CODEGEN_FUNCPTR stats_glDepthMask(GLboolean flag) {
+	stateChanged(s_stats.shadow.depthMask != flag);
+	s_stats.shadow.depthMask = flag;
+	next_glDepthMask(flag);
+}
+
+static void CODEGEN_FUNCPTR stats_glColorMask(GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {
+	GLuint mask = (red ? 1 : 0) | (green ? 2 : 0) | (blue ? 4 : 0) | (alpha ? 8 : 0);
+	stateChanged(s_stats.shadow.colourMask != mask);
+	s_stats.shadow.colourMask = mask;
+	next_glColorMask(red, green, blue, alpha);
+}
+
+// sets four values of shadow state at once
+template <typename T>
+static void setState(T* state, T a, T b, T c, T d) {
+	if (stateChanged(state[0] != a || state[1] != b || state[2] != c || state[3] != d)) {
+		state[0] = a;
+		state[1] = b;
+		state[2] = c;
+		state[3] = d;
+	}
+}
+
+static void CODEGEN_FUNCPTR stats_glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	setState<GLint>(s_stats.shadow.viewport, x, y, width, height);
+	next_glViewport(x, y, width, height);
+}
+
+static void CODEGEN_FUNCPTR stats_glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+	setState<GLint>(s_stats.shadow.scissor, x, y, width, height);
+	next_glScissor(x, y, width, height);
+}
+
+static void CODEGEN_FUNCPTR stats_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+	setState<GLfloat>(s_stats.shadow.clearColour, red, green, blue, alpha);
+	next_glClearColor(red, green, blue, alpha);
+}
+
+static void CODEGEN_FUNCPTR stats_glPolygonOffset(GLfloat factor, GLfloat units) {
+	GLfloat* offset = s_stats.shadow.polygonOffset;
+	if (stateChanged(offset[0] != factor || offset[1] != units)) {
+		offset[0] = factor;
+		offset[1] = units;
+	}
+	next_glPolygonOffset(factor, units);
+}
+
+// defines a wrapper that bumps a counter of the current section and passes the call on
+#define GL_STATS_COUNTED(name, counter, ret, params, args) \
+	static ret CODEGEN_FUNCPTR stats_##name params { counters().counter++; return next_##name args; }
+
+GL_STATS_COUNTED(glUniform1f, uniformUploads, void, (GLint location, GLfloat v0), (location, v0))
+GL_STATS_COUNTED(glUniform1fv, uniformUploads, void, (GLint location, GLsizei count, const GLfloat* value), (location, count, value))
+GL_STATS_COUNTED(glUniform1i, uniformUploads, void, (GLint location, GLint v0), (location, v0))
+GL_STATS_COUNTED(glUniform1iv, uniformUploads, void, (GLint location, GLsizei count, const GLint* value), (location, count, value))
+GL_STATS_COUNTED(glUniform2f, uniformUploads, void, (GLint location, GLfloat v0, GLfloat v1), (location, v0, v1))
+GL_STATS_COUNTED(glUniform2fv, uniformUploads, void, (GLint location, GLsizei count, const GLfloat* value), (location, count, value))
+GL_STATS_COUNTED(glUniform3f, uniformUploads, void, (GLint location, GLfloat v0, GLfloat v1, GLfloat v2), (location, v0, v1, v2))
+GL_STATS_COUNTED(glUniform3fv, uniformUploads, void, (GLint location, GLsizei count, const GLfloat* value), (location, count, value))
+GL_STATS_COUNTED(glUniform4f, uniformUploads, void, (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3), (location, v0, v1, v2, v3))
+GL_STATS_COUNTED(glUniform4fv, uniformUploads, void, (GLint location, GLsizei count, const GLfloat* value), (location, count, value))
+GL_STATS_COUNTED(glUniformMatrix2fv, uniformUploads, void, (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value),
+	(location, count, transpose, value))
+GL_STATS_COUNTED(glUniformMatrix3fv, uniformUploads, void, (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value),
+	(location, count, transpose, value))
+GL_STATS_COUNTED(glUniformMatrix4fv, uniformUploads, void, (GLint location, GLsizei count, GLboolean transpose, const GLfloat* value),
+	(location, count, transpose, value))
+
+GL_STATS_COUNTED(glGetIntegerv, queries, void, (GLenum pname, GLint* data), (pname, data))
+GL_STATS_COUNTED(glGetFloatv, queries, void, (GLenum pname, GLfloat* data), (pname, data))
+GL_STATS_COUNTED(glGetBooleanv, queries, void, (GLenum pname, GLboolean* data), (pname, data))
+GL_STATS_COUNTED(glGetInteger64v, queries, void, (GLenum pname, GLint64* data), (pname, data))
+GL_STATS_COUNTED(glGetError, queries, GLenum, (), ())
+GL_STATS_COUNTED(glGetString, queries, const GLubyte*, (GLenum name), (name))
+GL_STATS_COUNTED(glGetStringi, queries, const GLubyte*, (GLenum name, GLuint index), (name, index))
+GL_STATS_COUNTED(glGetUniformLocation, queries, GLint, (GLuint program, const GLchar* name), (program, name))
+GL_STATS_COUNTED(glGetAttribLocation, queries, GLint, (GLuint program, const GLchar* name), (program, name))
+GL_STATS_COUNTED(glGetUniformBlockIndex, queries, GLuint, (GLuint program, const GLchar* uniformBlockName), (program, uniformBlockName))
+GL_STATS_COUNTED(glGetProgramiv, queries, void, (GLuint program, GLenum pname, GLint* params), (program, pname, params))
+GL_STATS_COUNTED(glGetShaderiv, queries, void, (GLuint shader, GLenum pname, GLint* params), (shader, pname, params))
+GL_STATS_COUNTED(glGetQueryObjectiv, queries, void, (GLuint id, GLenum pname, GLint* params), (id, pname, params))
+GL_STATS_COUNTED(glGetQueryObjectuiv, queries, void, (GLuint id, GLenum pname, GLuint* params), (id, pname, params))
+GL_STATS_COUNTED(glGetQueryObjectui64v, queries, void, (GLuint id, GLenum pname, GLuint64* params), (id, pname, params))
+GL_STATS_COUNTED(glIsEnabled, queries, GLboolean, (GLenum cap), (cap))
+
+#undef GL_STATS_COUNTED
+
+static void CODEGEN_FUNCPTR stats_glBufferData(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage) {
+	if (data != nullptr && size > 0)
+		counters().bufferUploadBytes += (unsigned long long)size;
+	next_glBufferData(target, size, data, usage);
+}
+
+static void CODEGEN_FUNCPTR stats_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data) {
+	if (size > 0)
+		counters().bufferUploadBytes += (unsigned long long)size;
+	next_glBufferSubData(target, offset, size, data);
+}
+
+static void CODEGEN_FUNCPTR stats_glBufferStorage(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) {
+	if (data != nullptr && size > 0)
+		counters().bufferUploadBytes += (unsigned long long)size;
+	next_glBufferStorage(target, size, data, flags);
+}
+
+// a range mapped for writing is counted as uploaded in full, as it may all be written
+static void* CODEGEN_FUNCPTR stats_glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+	if ((access & GL_MAP_WRITE_BIT) != 0 && length > 0)
+		counters().bufferUploadBytes += (unsigned long long)length;
+	return next_glMapBufferRange(target, offset, length, access);
+}
+
+// deleting a bound object binds 0 in its place, and its name may be given out again
+static void CODEGEN_FUNCPTR stats_glDeleteTextures(GLsizei n, const GLuint* textures) {
+	for (GLsizei i = 0; i < n; i++) {
+		for (auto& binding : s_stats.shadow.textures)
+			if (binding.second == textures[i]) binding.second = 0;
+	}
+	next_glDeleteTextures(n, textures);
+}
+
+static void CODEGEN_FUNCPTR stats_glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+	for (GLsizei i = 0; i < n; i++) {
+		for (auto& binding : s_stats.shadow.buffers)
+			if (binding.second == buffers[i]) binding.second = 0;
+		for (auto& binding : s_stats.shadow.indexedBuffers)
+			if (binding.second.buffer == buffers[i]) binding.second.buffer = 0;
+	}
+	next_glDeleteBuffers(n, buffers);
+}
+
+static void CODEGEN_FUNCPTR stats_glDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+	for (GLsizei i = 0; i < n; i++) {
+		if (s_stats.shadow.vertexArray == arrays[i])
+			s_stats.shadow.vertexArray = 0;
+	}
+	next_glDeleteVertexArrays(n, arrays);
+}
+
+static void CODEGEN_FUNCPTR stats_glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+	for (GLsizei i = 0; i < n; i++) {
+		if (s_stats.shadow.drawFramebuffer == framebuffers[i])
+			s_stats.shadow.drawFramebuffer = 0;
+		if (s_stats.shadow.readFramebuffer == framebuffers[i])
+			s_stats.shadow.readFramebuffer = 0;
+	}
+	next_glDeleteFramebuffers(n, framebuffers);
+}
+
+bool GLStats::install() {
+	if (s_stats.installed)
+		return false;
+
+	s_stats.shadow = ShadowState();
+	s_stats.section = 0;
+	s_stats.frame = Frame();
+	s_stats.history.clear();
+	s_stats.historyStart = 0;
+	s_stats.frameNumber = 0;
+	if (s_stats.sectionNames.empty())
+		s_stats.sectionNames.push_back("other");
+
+	// entry points that failed to load are left alone, so they still fail the same way
+#define GL_STATS_INSTALL(name) next_##name = _ptrc_##name; if (next_##name != nullptr) _ptrc_##name = stats_##name;
+	GL_STATS_FUNCTIONS(GL_STATS_INSTALL)
+#undef GL_STATS_INSTALL
+
+	s_stats.installed = true;
+	return true;
+}
+
+void GLStats::uninstall() {
+	if (!s_stats.installed)
+		return;
+
+#define GL_STATS_REMOVE(name) if (next_##name != nullptr) _ptrc_##name = next_##name; next_##name = nullptr;
+	GL_STATS_FUNCTIONS(GL_STATS_REMOVE)
+#undef GL_STATS_REMOVE
+
+	s_stats.installed = false;
+}
+
+bool GLStats::isInstalled() {
+	return s_stats.installed;
+}
+
+void* GLStats::getProcAddress(const char* name) {
+	if (!s_stats.installed)
+		return nullptr;
+
+#define GL_STATS_FIND(function) if (strcmp(name, #function) == 0) return next_##function != nullptr ? (void*)stats_##function : nullptr;
+	GL_STATS_FUNCTIONS(GL_STATS_FIND)
+#undef GL_STATS_FIND
+	return nullptr;
+}
+
+unsigned int GLStats::registerSection(const char* name) {
+	if (s_stats.sectionNames.empty())
+		s_stats.sectionNames.push_back("other");
+
+	for (unsigned int i = 0; i < s_stats.sectionNames.size(); i++) {
+		if (strcmp(s_stats.sectionNames[i], name) == 0)
+			return i;
+	}
+
+	// past the limit, calls go to "other"
+	if (s_stats.sectionNames.size() >= MAX_SECTIONS) {
+		printf("GLStats: too many sections, %s is counted as other\n", name);
+		return 0;
+	}
+	s_stats.sectionNames.push_back(name);
+	return (unsigned int)s_stats.sectionNames.size() - 1;
+}
+
+unsigned int GLStats::getSectionCount() {
+	return (unsigned int)s_stats.sectionNames.size();
+}
+
+const char* GLStats::getSectionName(unsigned int section) {
+	return section < s_stats.sectionNames.size() ? s_stats.sectionNames[section] : "";
+}
+
+unsigned int GLStats::beginSection(unsigned int section) {
+	unsigned int previous = s_stats.section;
+	s_stats.section = section;
+	return previous;
+}
+
+void GLStats::endSection(unsigned int previous) {
+	s_stats.section = previous;
+}
+
+void GLStats::endFrame() {
+	Frame& frame = s_stats.frame;
+	frame.number = s_stats.frameNumber++;
+
+	// the total is summed once here rather than bumped by every call
+	frame.total = Counters();
+	for (unsigned int i = 0; i < MAX_SECTIONS; i++) {
+		const Counters& section = frame.sections[i];
+		frame.total.drawCalls += section.drawCalls;
+		frame.total.triangles += section.triangles;
+		frame.total.programBinds += section.programBinds;
+		frame.total.vertexArrayBinds += section.vertexArrayBinds;
+		frame.total.textureBinds += section.textureBinds;
+		frame.total.uniformUploads += section.uniformUploads;
+		frame.total.bufferUploadBytes += section.bufferUploadBytes;
+		frame.total.redundantStateSets += section.redundantStateSets;
+		frame.total.queries += section.queries;
+	}
+
+	if (s_stats.history.size() < HISTORY_FRAMES) {
+		s_stats.history.push_back(frame);
+	}
+	else {
+		s_stats.history[s_stats.historyStart] = frame;
+		s_stats.historyStart = (s_stats.historyStart + 1) % HISTORY_FRAMES;
+	}
+
+	frame = Frame();
+}
+
+unsigned int GLStats::getFrameCount() {
+	return (unsigned int)s_stats.history.size();
+}
+
+const GLStats::Frame& GLStats::getFrame(unsigned int index) {
+	return s_stats.history[(s_stats.historyStart + index) % s_stats.history.size()];
+}
+
+const GLStats::Frame& GLStats::getLastFrame() {
+	static const Frame empty = {};
+	return s_stats.history.empty() ? empty : getFrame(getFrameCount() - 1);
+}
+
+static bool isEmpty(const GLStats::Counters& counters) {
+	static const GLStats::Counters zero = {};
+	return memcmp(&counters, &zero, sizeof(zero)) == 0;
+}
+
+bool GLStats::writeCsv(const char* filename) {
+	FILE* file = nullptr;
+	fopen_s(&file, filename, "w");
+	if (file == nullptr) {
+		printf("Failed to write GL stats: %s\n", filename);
+		return false;
+	}
+
+	fprintf(file, "frame,section,draw_calls,triangles,program_binds,vertex_array_binds,texture_binds,"
+		"uniform_uploads,buffer_upload_bytes,redundant_state_sets,queries\n");
+	auto writeRow = [file](unsigned int frame, const char* section, const Counters& counters) {
+		fprintf(file, "%u,%s,%u,%u,%u,%u,%u,%u,%llu,%u,%u\n", frame, section, counters.drawCalls, counters.triangles,
+			counters.programBinds, counters.vertexArrayBinds, counters.textureBinds, counters.uniformUploads,
+			counters.bufferUploadBytes, counters.redundantStateSets, counters.queries);
+	};
+	for (unsigned int i = 0; i < getFrameCount(); i++) {
+		const Frame& frame = getFrame(i);
+		writeRow(frame.number, "total", frame.total);
+		for (unsigned int section = 0; section < getSectionCount(); section++) {
+			if (!isEmpty(frame.sections[section]))
+				writeRow(frame.number, getSectionName(section), frame.sections[section]);
+		}
+	}
+
+	bool written = ferror(file) == 0;
+	fclose(file);
+	return written;
+}
+
+bool GLStats::writeJson(const char* filename) {
+	FILE* file = nullptr;
+	fopen_s(&file, filename, "w");
+	if (file == nullptr) {
+		printf("Failed to write GL stats: %s\n", filename);
+		return false;
+	}
+
+	// section names are C++ identifiers, so need no escaping
+	auto writeCounters = [file](const Counters& counters) {
+		fprintf(file, "{ \"draw_calls\": %u, \"triangles\": %u, \"program_binds\": %u, \"vertex_array_binds\": %u, "
+			"\"texture_binds\": %u, \"uniform_uploads\": %u, \"buffer_upload_bytes\": %llu, \"redundant_state_sets\": %u, "
+			"\"queries\": %u }", counters.drawCalls, counters.triangles, counters.programBinds, counters.vertexArrayBinds,
+			counters.textureBinds, counters.uniformUploads, counters.bufferUploadBytes, counters.redundantStateSets,
+			counters.queries);
+	};
+
+	// one frame per line
+	fprintf(file, "{\n  \"frames\": [\n");
+	for (unsigned int i = 0; i < getFrameCount(); i++) {
+		const Frame& frame = getFrame(i);
+		fprintf(file, "    { \"frame\": %u, \"total\": ", frame.number);
+		writeCounters(frame.total);
+		fprintf(file, ", \"sections\": {");
+		bool first = true;
+		for (unsigned int section = 0; section < getSectionCount(); section++) {
+			if (isEmpty(frame.sections[section]))
+				continue;
+			fprintf(file, "%s \"%s\": ", first ? "" : ",", getSectionName(section));
+			writeCounters(frame.sections[section]);
+			first = false;
+		}
+		fprintf(file, " } }%s\n", i + 1 < getFrameCount() ? "," : "");
+	}
+	fprintf(file, "  ]\n}\n");
+
+	bool written = ferror(file) == 0;
+	fclose(file);
+	return written;
+}
+
+void GLStats::drawImGui() {
+	const Frame& frame = getLastFrame();
+
+	// fixed width rows, like the other panels, so the window can still size itself
+	ImGui::Text("%-24s %6s %8s %5s %5s %5s %6s %9s %6s %5s", "", "draws", "tris", "progs", "vaos", "texs",
+		"unifs", "upload KB", "redund", "gets");
+	auto row = [](const char* name, const Counters& counters) {
+		ImGui::Text("%-24s %6u %8u %5u %5u %5u %6u %9.1f %6u %5u", name, counters.drawCalls, counters.triangles,
+			counters.programBinds, counters.vertexArrayBinds, counters.textureBinds, counters.uniformUploads,
+			counters.bufferUploadBytes / 1024.0, counters.redundantStateSets, counters.queries);
+	};
+	for (unsigned int section = 0; section < getSectionCount(); section++) {
+		if (!isEmpty(frame.sections[section]))
+			row(getSectionName(section), frame.sections[section]);
+	}
+	row("total", frame.total);
+
+	if (ImGui::Button("Save CSV"))
+		writeCsv("gl_stats.csv");
+	ImGui::SameLine();
+	if (ImGui::Button("Save JSON"))
+		writeJson("gl_stats.json");
+	ImGui::SameLine();
+	ImGui::Text("last %u frames", getFrameCount());
+}
+
+} // namespace aie
+
+#endif
@@ -0,0 +1,101 @@
+#pragma once
+
+// the stats layer is compiled in unless AIE_NO_GL_STATS is defined, which must then be
+// defined for every project that links bootstrap so they agree; compiled out, the
+// sections below are empty statements and nothing is wrapped
+#ifndef AIE_NO_GL_STATS
+#define AIE_GL_STATS
+#endif
+
+#ifdef AIE_GL_STATS
+
+namespace aie {
+
+// per-frame counts of the GL calls the engine makes
+// installing it wraps the gl_core_4_4 entry points that draw, bind, upload, set state or
+// query with functions that count the call and pass it on to whatever was loaded before
+// (the driver, or NullGL). other loaders reach the same wrappers through
+// Application::getGLProcAddress(). calls are attributed to the innermost section open
+// when they are made (see GL_STATS_SECTION), so the cost of each part of a frame can be
+// told apart. a state set is redundant when it sets what the previous call already set.
+class GLStats {
+public:
+
+	struct Counters {
+		unsigned int		drawCalls;
+		unsigned int		triangles;			// indirect draws are counted as draws only
+		unsigned int		programBinds;
+		unsigned int		vertexArrayBinds;
+		unsigned int		textureBinds;
+		unsigned int		uniformUploads;
+		unsigned long long	bufferUploadBytes;	// buffer data, sub data and mapped ranges written
+		unsigned int		redundantStateSets;
+		unsigned int		queries;			// glGet*, glIsEnabled and glGetError
+	};
+
+	static const unsigned int MAX_SECTIONS = 16;
+	static const unsigned int HISTORY_FRAMES = 600;
+
+	struct Frame {
+		unsigned int		number;
+		Counters			total;
+		Counters			sections[MAX_SECTIONS];
+	};
+
+	// wraps the gl_core_4_4 entry points; false if already installed
+	static bool install();
+
+	// puts back the entry points that were there before install()
+	static void uninstall();
+
+	static bool isInstalled();
+
+	// the wrapper for an entry point, or nullptr if it is not counted
+	static void* getProcAddress(const char* name);
+
+	// section 0 collects calls made outside any section
+	// names must outlive the layer; registering the same name twice gives the same section
+	static unsigned int registerSection(const char* name);
+	static unsigned int getSectionCount();
+	static const char* getSectionName(unsigned int section);
+
+	// makes a section current and returns the one it replaces, for endSection()
+	static unsigned int beginSection(unsigned int section);
+	static void endSection(unsigned int previous);
+
+	// ends the frame in progress and keeps it in the history
+	static void endFrame();
+
+	// completed frames, oldest first
+	static unsigned int getFrameCount();
+	static const Frame& getFrame(unsigned int index);
+	static const Frame& getLastFrame();
+
+	// one line per section that made calls in each frame of the history, with its total
+	static bool writeCsv(const char* filename);
+	static bool writeJson(const char* filename);
+
+	// the last frame's counts per section, with buttons to save the history
+	static void drawImGui();
+};
+
+// attributes the GL calls until the end of the scope to a section
+class GLStatsSection {
+public:
+	GLStatsSection(unsigned int section) : m_previous(GLStats::beginSection(section)) {}
+	~GLStatsSection() { GLStats::endSection(m_previous); }
+private:
+	unsigned int m_previous;
+};
+
+} // namespace aie
+
+#define GL_STATS_SECTION(name) \
+	static const unsigned int glStatsSectionId = aie::GLStats::registerSection(name); \
+	aie::GLStatsSection glStatsSection(glStatsSectionId)
+
+#else
+
+#define GL_STATS_SECTION(name)
+
+#endif
@@ -1,5 +1,6 @@
 #include "Gizmos.h"
 #include "gl_core_4_4.h"
+#include "GLStats.h"
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 #include <iostream>
@@ -937,6 +938,7 @@ void Gizmos::draw(const glm::mat4& projection, const glm::mat4& view) {
 }
 
 void Gizmos::draw(const glm::mat4& projectionView) {
+	GL_STATS_SECTION("Gizmos::draw");
 	if ( sm_singleton != nullptr && 
 		(sm_singleton->m_lineCount > 0 || 
 		 sm_singleton->m_triCount > 0 || 
@@ -1003,6 +1005,7 @@ void Gizmos::draw2D(float screenWidth, float screenHeight) {
 }
 
 void Gizmos::draw2D(const glm::mat4& projection) {
+	GL_STATS_SECTION("Gizmos::draw2D");
 	if ( sm_singleton != nullptr && 
 		(sm_singleton->m_2DlineCount > 0 || 
 		 sm_singleton->m_2DtriCount > 0)) {
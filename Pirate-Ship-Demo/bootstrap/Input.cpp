@@ -1,140 +1,294 @@
 #include "Input.h"
 #include <GLFW/glfw3.h>
+#include <algorithm>
 
 namespace aie {
 
 Input* Input::m_instance = nullptr;
 
-Input::Input() {
+Input::Input(GLFWwindow* window) {
 
-	// track current/previous key and mouse button states
-	m_lastKeys = new int[GLFW_KEY_LAST + 1];
-	m_currentKeys = new int[GLFW_KEY_LAST + 1];
+	// not the current context's window: the null GL backend makes no context current
+	m_window = window;
 
-	auto window = glfwGetCurrentContext();
+	// keys already held when the application starts are picked up once here;
+	// from then on only events change the state
+	for (int i = GLFW_KEY_SPACE; i <= GLFW_KEY_LAST; ++i) {
+		if (glfwGetKey(m_window, i) == GLFW_PRESS) {
+			m_keysDown.set(i);
+			m_pressedKeys.push_back(i);
+		}
+	}
 
-	for (int i = GLFW_KEY_SPACE; i <= GLFW_KEY_LAST; ++i)
-		m_lastKeys[i] = m_currentKeys[i] = glfwGetKey(window, i);
+	for (int i = 0; i < MOUSE_BUTTON_COUNT; ++i)
+		m_buttonsDown[i] = glfwGetMouseButton(m_window, i) == GLFW_PRESS;
 
-	for (int i = 0; i < 8; ++i)
-		m_lastButtons[i] = m_currentButtons[i] = glfwGetMouseButton(window, i);
+	m_eventHead = 0;
+	m_eventTail = 0;
+	m_droppedEvents = 0;
 
 	// set up callbacks
+	// they run inside glfwPollEvents and do nothing but record the event
 	auto KeyPressCallback = [](GLFWwindow* window, int key, int scancode, int action, int mods) {
-
-		for (auto& f : Input::getInstance()->m_keyCallbacks)
-			f(window, key, scancode, action, mods);
+		InputEvent event = { glfwGetTime(), INPUT_EVENT_KEY, key, scancode, action, mods, 0, 0 };
+		Input::getInstance()->pushEvent(event);
 	};
 
 	auto CharacterInputCallback = [](GLFWwindow* window, unsigned int character) {
-
-		Input::getInstance()->m_pressedCharacters.push_back(character);
-
-		for (auto& f : Input::getInstance()->m_charCallbacks)
-			f(window, character);
+		InputEvent event = { glfwGetTime(), INPUT_EVENT_CHARACTER, (int)character, 0, 0, 0, 0, 0 };
+		Input::getInstance()->pushEvent(event);
 	};
 
 	auto MouseMoveCallback = [](GLFWwindow* window, double x, double y) {
-		int w = 0, h = 0;
-		glfwGetWindowSize(window, &w, &h);
-
-		Input::getInstance()->onMouseMove((int)x, h - (int)y);
-
-		for (auto& f : Input::getInstance()->m_mouseMoveCallbacks)
-			f(window, x, h - y);
+		InputEvent event = { glfwGetTime(), INPUT_EVENT_MOUSE_MOVE, 0, 0, 0, 0, x, y };
+		Input::getInstance()->pushEvent(event);
 	};
 
 	auto MouseInputCallback = [](GLFWwindow* window, int button, int action, int mods) {
-		
-		for (auto& f : Input::getInstance()->m_mouseButtonCallbacks)
-			f(window, button, action, mods);
+		InputEvent event = { glfwGetTime(), INPUT_EVENT_MOUSE_BUTTON, button, 0, action, mods, 0, 0 };
+		Input::getInstance()->pushEvent(event);
 	};
 
 	auto MouseScrollCallback = [](GLFWwindow* window, double xoffset, double yoffset) {
-
-		Input::getInstance()->m_mouseScroll += yoffset;
-
-		for (auto& f : Input::getInstance()->m_mouseScrollCallbacks)
-			f(window, xoffset, yoffset);
+		InputEvent event = { glfwGetTime(), INPUT_EVENT_MOUSE_SCROLL, 0, 0, 0, 0, xoffset, yoffset };
+		Input::getInstance()->pushEvent(event);
 	};
 
 	auto MouseEnterCallback = [](GLFWwindow* window, int entered) {
-		// Set flag to prevent large mouse delta on entering screen
-		Input::getInstance()->m_firstMouseMove = true;
+		InputEvent event = { glfwGetTime(), INPUT_EVENT_MOUSE_ENTER, 0, 0, entered, 0, 0, 0 };
+		Input::getInstance()->pushEvent(event);
 	};
 
-	glfwSetKeyCallback(window, KeyPressCallback);
-	glfwSetCharCallback(window, CharacterInputCallback);
-	glfwSetMouseButtonCallback(window, MouseInputCallback);
-	glfwSetCursorPosCallback(window, MouseMoveCallback);
-	glfwSetScrollCallback(window, MouseScrollCallback);
-	glfwSetCursorEnterCallback(window, MouseEnterCallback);
-	
+	glfwSetKeyCallback(m_window, KeyPressCallback);
+	glfwSetCharCallback(m_window, CharacterInputCallback);
+	glfwSetMouseButtonCallback(m_window, MouseInputCallback);
+	glfwSetCursorPosCallback(m_window, MouseMoveCallback);
+	glfwSetScrollCallback(m_window, MouseScrollCallback);
+	glfwSetCursorEnterCallback(m_window, MouseEnterCallback);
+
 	m_mouseX = 0;
 	m_mouseY = 0;
+	m_oldMouseX = 0;
+	m_oldMouseY = 0;
 	m_mouseScroll = 0;
+	m_cursorX = 0;
+	m_cursorY = 0;
+	m_motionX = 0;
+	m_motionY = 0;
+	m_firstMouseMove = true;
+	m_mouseCaptured = false;
+	m_liveInputBlocked = false;
+	m_cursorDisabled = false;
 }
 
 Input::~Input() {
-	delete[] m_lastKeys;
-	delete[] m_currentKeys;
+	if (m_cursorDisabled)
+		glfwSetInputMode(m_window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
 }
 
-void Input::onMouseMove(int newXPos, int newYPos) {
-	m_mouseX = newXPos;
-	m_mouseY = newYPos;
+void Input::pushEvent(const InputEvent& event) {
+
+	unsigned int head = m_eventHead.load(std::memory_order_relaxed);
+	unsigned int tail = m_eventTail.load(std::memory_order_acquire);
+
+	// a full ring drops the newest event rather than blocking the producer
+	if (head - tail >= EVENT_CAPACITY) {
+		m_droppedEvents++;
+		return;
+	}
+
+	m_events[head & (EVENT_CAPACITY - 1)] = event;
+	m_eventHead.store(head + 1, std::memory_order_release);
+}
+
+void Input::onMouseMove(double newXPos, double newYPos) {
+	int w = 0, h = 0;
+	glfwGetWindowSize(m_window, &w, &h);
+
 	if (m_firstMouseMove) {
 		// On first move after startup/entering window reset old mouse position
-		m_oldMouseX = newXPos;
-		m_oldMouseY = newYPos;
+		m_cursorX = newXPos;
+		m_cursorY = newYPos;
+		m_oldMouseX = (int)newXPos;
+		m_oldMouseY = h - (int)newYPos;
 		m_firstMouseMove = false;
 	}
+
+	m_motionX += newXPos - m_cursorX;
+	m_motionY += newYPos - m_cursorY;
+	m_cursorX = newXPos;
+	m_cursorY = newYPos;
+
+	m_mouseX = (int)newXPos;
+	m_mouseY = h - (int)newYPos;
 }
 
-void Input::clearStatus() {
+void Input::processEvents() {
 
 	m_pressedCharacters.clear();
+	m_frameEvents.clear();
 
-	auto window = glfwGetCurrentContext();
+	m_keysPressed.reset();
+	m_keysReleased.reset();
+	m_buttonsPressed.reset();
+	m_buttonsReleased.reset();
 
-	m_pressedKeys.clear();
+	// update old mouse position
+	m_oldMouseX = m_mouseX;
+	m_oldMouseY = m_mouseY;
+	m_motionX = 0;
+	m_motionY = 0;
+
+	unsigned int tail = m_eventTail.load(std::memory_order_relaxed);
+	unsigned int head = m_eventHead.load(std::memory_order_acquire);
+
+	for (; tail != head; ++tail) {
+		const InputEvent& event = m_events[tail & (EVENT_CAPACITY - 1)];
+		if (!m_liveInputBlocked) {
+			applyEvent(event);
+			m_frameEvents.push_back(event);
+		}
+		dispatchEvent(event);
+	}
 
-	// update keys
-	for (int i = GLFW_KEY_SPACE; i <= GLFW_KEY_LAST; ++i) {
+	m_eventTail.store(tail, std::memory_order_release);
+}
+
+void Input::replayEvent(const InputEvent& event) {
+	applyEvent(event);
+	m_frameEvents.push_back(event);
+}
+
+void Input::setLiveInputBlocked(bool blocked) {
+	if (blocked == m_liveInputBlocked)
+		return;
+
+	// live and replayed cursor positions are unrelated, so motion restarts either way
+	m_liveInputBlocked = blocked;
+	m_firstMouseMove = true;
+	updateCursorMode();
+}
 
-		m_lastKeys[i] = m_currentKeys[i];
+void Input::resetState() {
 
-		if ((m_currentKeys[i] = glfwGetKey(window, i)) == GLFW_PRESS)
-			m_pressedKeys.push_back(m_currentKeys[i]);
+	m_keysDown.reset();
+	m_keysPressed.reset();
+	m_keysReleased.reset();
+	m_buttonsDown.reset();
+	m_buttonsPressed.reset();
+	m_buttonsReleased.reset();
+	m_pressedKeys.clear();
+	m_pressedCharacters.clear();
+
+	m_mouseScroll = 0;
+	m_motionX = 0;
+	m_motionY = 0;
+	m_firstMouseMove = true;
+	m_mouseCaptured = false;
+	updateCursorMode();
+}
+
+void Input::applyEvent(const InputEvent& event) {
+
+	switch (event.type) {
+	case INPUT_EVENT_KEY:
+		if (event.code >= 0 && event.code < KEY_COUNT) {
+			if (event.action == GLFW_PRESS && !m_keysDown[event.code]) {
+				m_keysDown.set(event.code);
+				m_keysPressed.set(event.code);
+				m_pressedKeys.push_back(event.code);
+			}
+			else if (event.action == GLFW_RELEASE && m_keysDown[event.code]) {
+				m_keysDown.reset(event.code);
+				m_keysReleased.set(event.code);
+				m_pressedKeys.erase(std::find(m_pressedKeys.begin(), m_pressedKeys.end(), event.code));
+			}
+		}
+		break;
+
+	case INPUT_EVENT_CHARACTER:
+		m_pressedCharacters.push_back((unsigned int)event.code);
+		break;
+
+	case INPUT_EVENT_MOUSE_BUTTON:
+		if (event.code >= 0 && event.code < MOUSE_BUTTON_COUNT) {
+			if (event.action == GLFW_PRESS && !m_buttonsDown[event.code]) {
+				m_buttonsDown.set(event.code);
+				m_buttonsPressed.set(event.code);
+			}
+			else if (event.action == GLFW_RELEASE && m_buttonsDown[event.code]) {
+				m_buttonsDown.reset(event.code);
+				m_buttonsReleased.set(event.code);
+			}
+		}
+		break;
+
+	case INPUT_EVENT_MOUSE_MOVE:
+		onMouseMove(event.x, event.y);
+		break;
+
+	case INPUT_EVENT_MOUSE_SCROLL:
+		m_mouseScroll += event.y;
+		break;
+
+	case INPUT_EVENT_MOUSE_ENTER:
+		// Set flag to prevent large mouse delta on entering screen
+		m_firstMouseMove = true;
+		break;
 	}
+}
+
+void Input::dispatchEvent(const InputEvent& event) {
+
+	switch (event.type) {
+	case INPUT_EVENT_KEY:
+		for (auto& f : m_keyCallbacks)
+			f(m_window, event.code, event.scancode, event.action, event.mods);
+		break;
 
-	// update mouse
-	for (int i = 0; i < 8 ; ++i) {
-		m_lastButtons[i] = m_currentButtons[i];
-		m_currentButtons[i] = glfwGetMouseButton(window, i);
+	case INPUT_EVENT_CHARACTER:
+		for (auto& f : m_charCallbacks)
+			f(m_window, (unsigned int)event.code);
+		break;
+
+	case INPUT_EVENT_MOUSE_BUTTON:
+		for (auto& f : m_mouseButtonCallbacks)
+			f(m_window, event.code, event.action, event.mods);
+		break;
+
+	case INPUT_EVENT_MOUSE_MOVE: {
+		int w = 0, h = 0;
+		glfwGetWindowSize(m_window, &w, &h);
+
+		for (auto& f : m_mouseMoveCallbacks)
+			f(m_window, event.x, h - event.y);
+		break;
 	}
 
-	// update old mouse position
-	m_oldMouseX = m_mouseX;
-	m_oldMouseY = m_mouseY;
+	case INPUT_EVENT_MOUSE_SCROLL:
+		for (auto& f : m_mouseScrollCallbacks)
+			f(m_window, event.x, event.y);
+		break;
+
+	default:
+		break;
+	}
 }
 
 bool Input::isKeyDown(int inputKeyID) {
-	return m_currentKeys[inputKeyID] == GLFW_PRESS;
+	return m_keysDown[inputKeyID];
 }
 
 bool Input::isKeyUp(int inputKeyID) {
-	return m_currentKeys[inputKeyID] == GLFW_RELEASE;
+	return !m_keysDown[inputKeyID];
 }
 
 bool Input::wasKeyPressed(int inputKeyID) {
-	return m_currentKeys[inputKeyID] == GLFW_PRESS && 
-		m_lastKeys[inputKeyID] == GLFW_RELEASE;
+	return m_keysPressed[inputKeyID];
 }
 
 bool Input::wasKeyReleased(int inputKeyID) {
-	return m_currentKeys[inputKeyID] == GLFW_RELEASE && 
-		m_lastKeys[inputKeyID] == GLFW_PRESS;
+	return m_keysReleased[inputKeyID];
 }
 
 const std::vector<int> &Input::getPressedKeys() const {
@@ -146,21 +300,19 @@ const std::vector<unsigned int> &Input::getPressedCharacters() const {
 }
 
 bool Input::isMouseButtonDown(int inputMouseID) {
-	return m_currentButtons[inputMouseID] == GLFW_PRESS;
+	return m_buttonsDown[inputMouseID];
 }
 
 bool Input::isMouseButtonUp(int inputMouseID) {
-	return m_currentButtons[inputMouseID] == GLFW_RELEASE;
+	return !m_buttonsDown[inputMouseID];
 }
 
 bool Input::wasMouseButtonPressed(int inputMouseID) {
-	return m_currentButtons[inputMouseID] == GLFW_PRESS && 
-		m_lastButtons[inputMouseID] == GLFW_RELEASE;
+	return m_buttonsPressed[inputMouseID];
 }
 
 bool Input::wasMouseButtonReleased(int inputMouseID) {
-	return m_currentButtons[inputMouseID] == GLFW_RELEASE && 
-		m_lastButtons[inputMouseID] == GLFW_PRESS;
+	return m_buttonsReleased[inputMouseID];
 }
 
 int Input::getMouseX() {
@@ -196,4 +348,101 @@ void Input::getMouseDelta(int * x, int * y)
 	if (y != nullptr) *y = m_mouseY - m_oldMouseY;
 }
 
-} // namespace aie
\ No newline at end of file
+void Input::getMouseMotion(double* x, double* y) {
+	if (x != nullptr) *x = m_motionX;
+	if (y != nullptr) *y = m_motionY;
+}
+
+void Input::getPendingMouseMotion(double* x, double* y) {
+
+	double dx = 0, dy = 0;
+
+	// the cursor position comes straight from the OS, ahead of any queued move events
+	if (!m_firstMouseMove && !m_liveInputBlocked) {
+		double cursorX = 0, cursorY = 0;
+		glfwGetCursorPos(m_window, &cursorX, &cursorY);
+		dx = cursorX - m_cursorX;
+		dy = cursorY - m_cursorY;
+	}
+
+	if (x != nullptr) *x = dx;
+	if (y != nullptr) *y = dy;
+}
+
+void Input::setMouseCaptured(bool captured) {
+
+	if (captured == m_mouseCaptured)
+		return;
+
+	m_mouseCaptured = captured;
+	updateCursorMode();
+
+	// the cursor jumps when the mode changes, so motion restarts from the next move event
+	m_firstMouseMove = true;
+}
+
+void Input::updateCursorMode() {
+
+	bool disabled = m_mouseCaptured && !m_liveInputBlocked;
+	if (disabled == m_cursorDisabled)
+		return;
+
+	m_cursorDisabled = disabled;
+	glfwSetInputMode(m_window, GLFW_CURSOR, disabled ? GLFW_CURSOR_DISABLED : GLFW_CURSOR_NORMAL);
+
+	// raw motion arrived in GLFW 3.3; older builds get the OS accelerated motion
+#ifdef GLFW_RAW_MOUSE_MOTION
+	if (glfwRawMouseMotionSupported())
+		glfwSetInputMode(m_window, GLFW_RAW_MOUSE_MOTION, disabled ? GLFW_TRUE : GLFW_FALSE);
+#endif
+}
+
+void Input::bindActionKey(int action, int inputKeyID) {
+	if (action >= (int)m_actions.size())
+		m_actions.resize(action + 1);
+	m_actions[action].push_back({ inputKeyID, false });
+}
+
+void Input::bindActionMouseButton(int action, int inputMouseID) {
+	if (action >= (int)m_actions.size())
+		m_actions.resize(action + 1);
+	m_actions[action].push_back({ inputMouseID, true });
+}
+
+void Input::clearActionBindings(int action) {
+	if (action < (int)m_actions.size())
+		m_actions[action].clear();
+}
+
+bool Input::isActionDown(int action) {
+	if (action >= (int)m_actions.size())
+		return false;
+	for (auto& binding : m_actions[action]) {
+		if (binding.mouseButton ? m_buttonsDown[binding.code] : m_keysDown[binding.code])
+			return true;
+	}
+	return false;
+}
+
+bool Input::wasActionPressed(int action) {
+	if (action >= (int)m_actions.size())
+		return false;
+	for (auto& binding : m_actions[action]) {
+		if (binding.mouseButton ? m_buttonsPressed[binding.code] : m_keysPressed[binding.code])
+			return true;
+	}
+	return false;
+}
+
+bool Input::wasActionReleased(int action) {
+	// released only once no other binding is holding it down
+	if (action >= (int)m_actions.size() || isActionDown(action))
+		return false;
+	for (auto& binding : m_actions[action]) {
+		if (binding.mouseButton ? m_buttonsReleased[binding.code] : m_keysReleased[binding.code])
+			return true;
+	}
+	return false;
+}
+
+} // namespace aie
@@ -3,6 +3,8 @@
 #include <vector>
 #include <functional>
 #include <map>
+#include <bitset>
+#include <atomic>
 
 struct GLFWwindow;
 
@@ -136,7 +138,32 @@ enum EInputCodes : int {
 	INPUT_MOUSE_BUTTON_8		= 7,
 };
 
+// the kinds of event the GLFW callbacks record
+enum EInputEventType : int {
+	INPUT_EVENT_KEY,
+	INPUT_EVENT_CHARACTER,
+	INPUT_EVENT_MOUSE_BUTTON,
+	INPUT_EVENT_MOUSE_MOVE,
+	INPUT_EVENT_MOUSE_SCROLL,
+	INPUT_EVENT_MOUSE_ENTER,
+};
+
+// one input event, as it arrived from GLFW
+// plain data, so a frame's events can be saved and injected again to replay it
+struct InputEvent {
+	double			time;		// glfwGetTime() when the callback ran
+	EInputEventType	type;
+	int				code;		// key, mouse button or character
+	int				scancode;	// keys only
+	int				action;		// GLFW_PRESS / GLFW_RELEASE / GLFW_REPEAT, or entered for MOUSE_ENTER
+	int				mods;
+	double			x, y;		// cursor position (window coordinates) or scroll offset
+};
+
 // a singleton class that manages Input from the keyboard and mouse
+// the GLFW callbacks only append timestamped events to a lock-free ring; once per frame
+// processEvents() applies them to the key and button bitsets and forwards them to the
+// observers, so the cost follows the number of events rather than the number of keys
 class Input {
 public:
 
@@ -151,7 +178,7 @@ public:
 	bool wasKeyPressed(int inputKeyID);
 	bool wasKeyReleased(int inputKeyID);
 
-	// returns access to all keys that are currently pressed
+	// returns access to all keys that are currently pressed, in the order they went down
 	const std::vector<int>& getPressedKeys() const;
 	const std::vector<unsigned int>& getPressedCharacters() const;
 
@@ -176,6 +203,52 @@ public:
 	// query how far the mouse wheel has been moved 
 	double getMouseScroll();
 
+	// mouse motion this frame, summed from every move event (y grows downwards)
+	// while the mouse is captured this is unbounded by the window edges
+	void getMouseMotion(double* x, double* y);
+
+	// motion the OS has reported since the last processEvents() that is still to be
+	// processed, for sampling the mouse again later in the frame without consuming it
+	void getPendingMouseMotion(double* x, double* y);
+
+	// hides the cursor and locks it to the window, so motion is unlimited (GLFW_CURSOR_DISABLED)
+	// unaccelerated raw motion is used as well when the GLFW build and the platform support it
+	void setMouseCaptured(bool captured);
+	bool isMouseCaptured() const { return m_mouseCaptured; }
+
+	// actions are application defined ids (0 and up) that any number of keys and mouse
+	// buttons can be bound to, so game code does not hard code its controls
+	void bindActionKey(int action, int inputKeyID);
+	void bindActionMouseButton(int action, int inputMouseID);
+	void clearActionBindings(int action);
+
+	// an action is down while any of its bindings is down
+	bool isActionDown(int action);
+	bool wasActionPressed(int action);
+	bool wasActionReleased(int action);
+
+	// the events applied by the last processEvents(), in arrival order
+	const std::vector<InputEvent>& getFrameEvents() const { return m_frameEvents; }
+
+	// while live input is blocked only replayEvent() changes the state; live events still
+	// reach the observers, so the UI stays usable during a replay
+	void setLiveInputBlocked(bool blocked);
+	bool isLiveInputBlocked() const { return m_liveInputBlocked; }
+
+	// applies a recorded event after processEvents(), as if it had just arrived
+	void replayEvent(const InputEvent& event);
+
+	// releases every key and button and restarts mouse motion, so a recording and its
+	// replay begin from the same state
+	void resetState();
+
+	// events lost because the ring was full when they arrived
+	unsigned int getDroppedEventCount() const { return m_droppedEvents; }
+
+	// should be called once by the application each frame after glfwPollEvents
+	// clears the per-frame state and applies every event recorded since the last call
+	void processEvents();
+
 	// delgates for attaching input observers to the Input class
 	typedef std::function<void(GLFWwindow* window, int key, int scancode, int action, int mods)> KeyCallback;
 	typedef std::function<void(GLFWwindow* window, unsigned int character)> CharCallback;
@@ -199,19 +272,32 @@ protected:
 	static Input* m_instance;
 
 	// only want the Application class to be able to create / destroy
-	static void create()			{ m_instance = new Input(); }
+	static void create(GLFWwindow* window)	{ m_instance = new Input(window); }
 	static void destroy()			{ delete m_instance; }
 
-	// should be called once by the application each frame after the current update
-	// or before glfwPollEvents
-	void clearStatus();
-
 private:
 
 	// constructor private for singleton
-	Input();
+	Input(GLFWwindow* window);
 	~Input();
 
+	// GLFW_KEY_LAST + 1 and the number of GLFW mouse buttons
+	static const int KEY_COUNT = 349;
+	static const int MOUSE_BUTTON_COUNT = 8;
+
+	// must be a power of two
+	static const unsigned int EVENT_CAPACITY = 1024;
+
+	// single producer (the thread polling events), single consumer (processEvents)
+	void pushEvent(const InputEvent& event);
+	void applyEvent(const InputEvent& event);		// updates the state
+	void dispatchEvent(const InputEvent& event);	// forwards to the observers
+
+	// the cursor is only locked while captured by live input
+	void updateCursorMode();
+
+	GLFWwindow*					m_window;
+
 	std::vector<int>			m_pressedKeys;
 	std::vector<unsigned int>	m_pressedCharacters;
 		
@@ -221,9 +307,32 @@ private:
 	int		m_oldMouseY;
 	double	m_mouseScroll;
 
+	// unflipped cursor position of the last move event, and this frame's motion
+	double	m_cursorX;
+	double	m_cursorY;
+	double	m_motionX;
+	double	m_motionY;
+
 	bool	m_firstMouseMove;	// flag for first mouse input after start or mouse entering window
+	bool	m_mouseCaptured;
+	bool	m_liveInputBlocked;
+	bool	m_cursorDisabled;	// mode last set on the GLFW window
+
+	void onMouseMove(double newXPos, double newYPos);
+
+	// event ring, indices increase forever and are masked on access
+	InputEvent					m_events[EVENT_CAPACITY];
+	std::atomic<unsigned int>	m_eventHead;
+	std::atomic<unsigned int>	m_eventTail;
+	unsigned int				m_droppedEvents;
+
+	std::vector<InputEvent>		m_frameEvents;
 
-	void onMouseMove(int newXPos, int newYPos);
+	struct ActionBinding {
+		int		code;
+		bool	mouseButton;
+	};
+	std::vector<std::vector<ActionBinding>> m_actions;
 	
 	std::vector<KeyCallback>			m_keyCallbacks;
 	std::vector<CharCallback>			m_charCallbacks;
@@ -232,8 +341,10 @@ private:
 	std::vector<MouseScrollCallback>	m_mouseScrollCallbacks;
 
 	// used to track down/up/released/pressed
-	int* m_lastKeys, *m_currentKeys;
-	int m_lastButtons[8], m_currentButtons[8];
+	// pressed and released are only set by this frame's events, so a tap shorter than a
+	// frame still shows up as both
+	std::bitset<KEY_COUNT>			m_keysDown, m_keysPressed, m_keysReleased;
+	std::bitset<MOUSE_BUTTON_COUNT>	m_buttonsDown, m_buttonsPressed, m_buttonsReleased;
 };
 
 } // namespace aie
\ No newline at end of file
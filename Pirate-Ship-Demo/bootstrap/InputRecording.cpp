@@ -0,0 +1,207 @@
+#include "InputRecording.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+namespace aie {
+
+// file layout, all little-endian:
+//	header	"AIIR", uint32 version, uint32 frame count, uint32 event count
+//	frames	double frame time, uint32 event count
+//	events	uint8 type, uint8 action, uint8 mods, uint8 unused, float time, then
+//			key: int32 code, int32 scancode
+//			character / mouse button: int32 code
+//			mouse move / scroll: double x, double y
+static const char fileMagic[4] = { 'A', 'I', 'I', 'R' };
+static const uint32_t fileVersion = 1;
+
+template <typename T>
+static void writeValue(std::vector<unsigned char>& data, const T& value) {
+	const unsigned char* bytes = (const unsigned char*)&value;
+	data.insert(data.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T>
+static bool readValue(const std::vector<unsigned char>& data, size_t& offset, T& value) {
+	if (offset + sizeof(T) > data.size())
+		return false;
+	memcpy(&value, data.data() + offset, sizeof(T));
+	offset += sizeof(T);
+	return true;
+}
+
+void InputRecording::clear() {
+	m_frames.clear();
+	m_events.clear();
+	m_startTime = 0;
+}
+
+void InputRecording::addFrame(double frameTime, const std::vector<InputEvent>& events) {
+
+	if (m_events.empty() && !events.empty())
+		m_startTime = events.front().time;
+
+	Frame frame = { frameTime, (unsigned int)m_events.size(), (unsigned int)events.size() };
+	m_frames.push_back(frame);
+
+	for (auto event : events) {
+		event.time -= m_startTime;
+		m_events.push_back(event);
+	}
+}
+
+double InputRecording::getDuration() const {
+	double duration = 0;
+	for (auto& frame : m_frames)
+		duration += frame.frameTime;
+	return duration;
+}
+
+bool InputRecording::save(const char* filename) const {
+
+	// built in memory and written with one call
+	std::vector<unsigned char> data;
+	data.reserve(16 + m_frames.size() * 12 + m_events.size() * 24);
+
+	data.insert(data.end(), fileMagic, fileMagic + 4);
+	writeValue(data, fileVersion);
+	writeValue(data, (uint32_t)m_frames.size());
+	writeValue(data, (uint32_t)m_events.size());
+
+	for (auto& frame : m_frames) {
+		writeValue(data, frame.frameTime);
+		writeValue(data, (uint32_t)frame.eventCount);
+	}
+
+	for (auto& event : m_events) {
+		writeValue(data, (uint8_t)event.type);
+		writeValue(data, (uint8_t)event.action);
+		writeValue(data, (uint8_t)event.mods);
+		writeValue(data, (uint8_t)0);
+		writeValue(data, (float)event.time);
+
+		switch (event.type) {
+		case INPUT_EVENT_KEY:
+			writeValue(data, (int32_t)event.code);
+			writeValue(data, (int32_t)event.scancode);
+			break;
+		case INPUT_EVENT_CHARACTER:
+		case INPUT_EVENT_MOUSE_BUTTON:
+			writeValue(data, (int32_t)event.code);
+			break;
+		case INPUT_EVENT_MOUSE_MOVE:
+		case INPUT_EVENT_MOUSE_SCROLL:
+			writeValue(data, event.x);
+			writeValue(data, event.y);
+			break;
+		default:
+			break;
+		}
+	}
+
+	FILE* file = nullptr;
+	fopen_s(&file, filename, "wb");
+	if (file == nullptr) {
+		printf("Failed to write input recording: %s\n", filename);
+		return false;
+	}
+
+	bool written = fwrite(data.data(), 1, data.size(), file) == data.size();
+	fclose(file);
+
+	if (!written)
+		printf("Failed to write input recording: %s\n", filename);
+	return written;
+}
+
+bool InputRecording::load(const char* filename) {
+
+	clear();
+
+	FILE* file = nullptr;
+	fopen_s(&file, filename, "rb");
+	if (file == nullptr) {
+		printf("Failed to open input recording: %s\n", filename);
+		return false;
+	}
+
+	std::vector<unsigned char> data;
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	if (size > 0) {
+		data.resize((size_t)size);
+		data.resize(fread(data.data(), 1, data.size(), file));
+	}
+	fclose(file);
+
+	size_t offset = 4;
+	uint32_t version = 0, frameCount = 0, eventCount = 0;
+	if (data.size() < 4 || memcmp(data.data(), fileMagic, 4) != 0 ||
+		!readValue(data, offset, version) || version != fileVersion ||
+		!readValue(data, offset, frameCount) ||
+		!readValue(data, offset, eventCount)) {
+		printf("Not an input recording: %s\n", filename);
+		return false;
+	}
+
+	bool valid = true;
+	unsigned int firstEvent = 0;
+	for (uint32_t i = 0; i < frameCount && valid; ++i) {
+		Frame frame = {};
+		uint32_t frameEvents = 0;
+		valid = readValue(data, offset, frame.frameTime) && readValue(data, offset, frameEvents) &&
+			frameEvents <= eventCount - firstEvent;
+		frame.firstEvent = firstEvent;
+		frame.eventCount = frameEvents;
+		firstEvent += frameEvents;
+		m_frames.push_back(frame);
+	}
+
+	for (uint32_t i = 0; i < eventCount && valid; ++i) {
+		InputEvent event = {};
+		uint8_t type = 0, action = 0, mods = 0, unused = 0;
+		float time = 0;
+		int32_t code = 0, scancode = 0;
+		valid = readValue(data, offset, type) && readValue(data, offset, action) &&
+			readValue(data, offset, mods) && readValue(data, offset, unused) &&
+			readValue(data, offset, time);
+
+		event.type = (EInputEventType)type;
+		event.action = action;
+		event.mods = mods;
+		event.time = time;
+
+		switch (event.type) {
+		case INPUT_EVENT_KEY:
+			valid = valid && readValue(data, offset, code) && readValue(data, offset, scancode);
+			break;
+		case INPUT_EVENT_CHARACTER:
+		case INPUT_EVENT_MOUSE_BUTTON:
+			valid = valid && readValue(data, offset, code);
+			break;
+		case INPUT_EVENT_MOUSE_MOVE:
+		case INPUT_EVENT_MOUSE_SCROLL:
+			valid = valid && readValue(data, offset, event.x) && readValue(data, offset, event.y);
+			break;
+		case INPUT_EVENT_MOUSE_ENTER:
+			break;
+		default:
+			valid = false;
+			break;
+		}
+
+		event.code = code;
+		event.scancode = scancode;
+		m_events.push_back(event);
+	}
+
+	if (!valid || firstEvent != eventCount) {
+		printf("Input recording is truncated or corrupt: %s\n", filename);
+		clear();
+		return false;
+	}
+	return true;
+}
+
+} // namespace aie
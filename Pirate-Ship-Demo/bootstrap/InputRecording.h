@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+#include "Input.h"
+
+namespace aie {
+
+// the input applied in each frame of a run, together with the frame's time
+// replaying the frames through the Application in place of live input and the measured
+// frame time simulates exactly the same frames again (see Application::startInputPlayback)
+// saved as a compact binary file: a header, one small record per frame, then the events
+// packed by type, with only the fields the event type uses
+class InputRecording {
+public:
+
+	InputRecording() : m_startTime(0) {}
+	~InputRecording() {}
+
+	void clear();
+
+	// appends a frame; event times are stored relative to the first event
+	void addFrame(double frameTime, const std::vector<InputEvent>& events);
+
+	// returns false if the file could not be written / read, or is not a recording
+	bool save(const char* filename) const;
+	bool load(const char* filename);
+
+	unsigned int getFrameCount() const { return (unsigned int)m_frames.size(); }
+
+	// the unclamped time the frame took when it was recorded, in seconds
+	double getFrameTime(unsigned int frame) const { return m_frames[frame].frameTime; }
+
+	// the events applied in a frame, in arrival order
+	unsigned int getEventCount(unsigned int frame) const { return m_frames[frame].eventCount; }
+	const InputEvent* getEvents(unsigned int frame) const { return m_events.data() + m_frames[frame].firstEvent; }
+
+	// total of every frame time
+	double getDuration() const;
+
+protected:
+
+	struct Frame {
+		double			frameTime;
+		unsigned int	firstEvent;
+		unsigned int	eventCount;
+	};
+
+	std::vector<Frame>		m_frames;
+	std::vector<InputEvent>	m_events;
+	double					m_startTime;
+};
+
+} // namespace aie
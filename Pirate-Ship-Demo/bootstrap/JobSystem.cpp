@@ -0,0 +1,521 @@
+#include "JobSystem.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace aie {
+
+JobSystem* JobSystem::m_instance = nullptr;
+
+struct Job {
+	JobSystem::JobFunction	function;
+	JobCounter*				counter = nullptr;
+	Job*					next = nullptr;			// link in a counter's continuation list
+	bool					mainThread = false;
+	bool					heap = false;			// allocated with new rather than from a job ring
+	std::atomic<bool>		pending { false };		// ring slot in use
+};
+
+// marks a counter's continuation list as closed, i.e. its count has reached zero
+static Job s_closedList;
+static Job* const CLOSED = &s_closedList;
+
+// index of the worker running on this thread, or NO_WORKER
+static const unsigned int NO_WORKER = ~0u;
+static thread_local unsigned int t_workerIndex = NO_WORKER;
+
+// jobs run inside other jobs (while they wait) are already inside the outer job's busy time
+static thread_local unsigned int t_jobDepth = 0;
+
+typedef std::chrono::high_resolution_clock Clock;
+
+// bounded Chase-Lev deque; only the owning worker pushes and pops (at the bottom),
+// any other worker may steal (from the top)
+class JobSystem::WorkDeque {
+public:
+
+	WorkDeque() : m_top(0), m_bottom(0) {}
+
+	bool push(Job* job) {
+		long long bottom = m_bottom.load(std::memory_order_relaxed);
+		long long top = m_top.load(std::memory_order_acquire);
+		if (bottom - top >= (long long)QUEUE_CAPACITY)
+			return false;
+
+		// publishes the job (and everything written to it) to thieves
+		m_jobs[bottom & (QUEUE_CAPACITY - 1)].store(job, std::memory_order_relaxed);
+		m_bottom.store(bottom + 1, std::memory_order_release);
+		return true;
+	}
+
+	Job* pop() {
+		long long bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+		m_bottom.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long top = m_top.load(std::memory_order_relaxed);
+
+		if (top > bottom) {
+			// empty
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+			return nullptr;
+		}
+
+		Job* job = m_jobs[bottom & (QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (top == bottom) {
+			// last job, race any thief for it
+			if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+				job = nullptr;
+			m_bottom.store(bottom + 1, std::memory_order_relaxed);
+		}
+		return job;
+	}
+
+	Job* steal() {
+		long long top = m_top.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long bottom = m_bottom.load(std::memory_order_acquire);
+		if (top >= bottom)
+			return nullptr;
+
+		Job* job = m_jobs[top & (QUEUE_CAPACITY - 1)].load(std::memory_order_relaxed);
+		if (!m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			return nullptr;
+		return job;
+	}
+
+private:
+
+	std::atomic<long long>	m_top;
+	std::atomic<long long>	m_bottom;
+	std::atomic<Job*>		m_jobs[QUEUE_CAPACITY];
+};
+
+// bounded multi-producer multi-consumer queue (Vyukov); each cell's sequence number
+// says whether it is ready to be written or read for the current lap
+class JobSystem::JobQueue {
+public:
+
+	JobQueue() : m_enqueuePosition(0), m_dequeuePosition(0) {
+		for (size_t i = 0; i < QUEUE_CAPACITY; ++i)
+			m_cells[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	bool push(Job* job) {
+		size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+		for (;;) {
+			Cell& cell = m_cells[position & (QUEUE_CAPACITY - 1)];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)position;
+			if (difference == 0) {
+				if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					cell.job = job;
+					cell.sequence.store(position + 1, std::memory_order_release);
+					return true;
+				}
+			}
+			else if (difference < 0) {
+				// full
+				return false;
+			}
+			else {
+				position = m_enqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	Job* pop() {
+		size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+		for (;;) {
+			Cell& cell = m_cells[position & (QUEUE_CAPACITY - 1)];
+			size_t sequence = cell.sequence.load(std::memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)(position + 1);
+			if (difference == 0) {
+				if (m_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+					Job* job = cell.job;
+					cell.sequence.store(position + QUEUE_CAPACITY, std::memory_order_release);
+					return job;
+				}
+			}
+			else if (difference < 0) {
+				// empty
+				return nullptr;
+			}
+			else {
+				position = m_dequeuePosition.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+private:
+
+	struct Cell {
+		std::atomic<size_t>	sequence;
+		Job*				job;
+	};
+
+	Cell				m_cells[QUEUE_CAPACITY];
+	std::atomic<size_t>	m_enqueuePosition;
+	std::atomic<size_t>	m_dequeuePosition;
+};
+
+struct JobSystem::Worker {
+	WorkDeque					deque;
+	std::unique_ptr<Job[]>		jobs { new Job[QUEUE_CAPACITY] };	// reused for jobs submitted on this thread
+	unsigned int				nextJob = 0;
+	unsigned int				stealSeed = 0;
+	std::thread					thread;
+
+	std::atomic<unsigned int>		jobsExecuted { 0 };
+	std::atomic<unsigned int>		jobsStolen { 0 };
+	std::atomic<unsigned long long>	busyTime { 0 };					// nanoseconds
+};
+
+JobCounter::JobCounter()
+	: m_count(0),
+	m_continuations(CLOSED) {
+}
+
+JobCounter::~JobCounter() {
+}
+
+bool JobCounter::isDone() const {
+	// the list is closed after the count reaches zero, as the last thing that touches the
+	// counter, so once both are seen the counter can safely go out of scope
+	return m_count.load(std::memory_order_acquire) == 0 &&
+		m_continuations.load(std::memory_order_acquire) == CLOSED;
+}
+
+JobSystem::JobSystem(unsigned int workerCount)
+	: m_sharedQueue(new JobQueue()),
+	m_mainQueue(new JobQueue()),
+	m_running(true),
+	m_sleepingWorkers(0) {
+
+	if (workerCount == 0)
+		workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+	// the creating thread is the main thread and takes part as worker 0
+	t_workerIndex = 0;
+	for (unsigned int i = 0; i < workerCount; ++i) {
+		m_workers.push_back(new Worker());
+		m_workers[i]->stealSeed = i * 2654435761u + 1;
+	}
+	m_workerStats.resize(workerCount, WorkerStats { 0, 0, 0.0f });
+
+	for (unsigned int i = 1; i < workerCount; ++i)
+		m_workers[i]->thread = std::thread(&JobSystem::workerLoop, this, i);
+
+	m_statisticsStart = Clock::now();
+}
+
+JobSystem::~JobSystem() {
+
+	// let the main thread finish anything still queued for it
+	runMainThreadJobs();
+
+	m_running = false;
+	m_wake.notify_all();
+	for (unsigned int i = 1; i < m_workers.size(); ++i)
+		m_workers[i]->thread.join();
+
+	for (auto worker : m_workers)
+		delete worker;
+	delete m_sharedQueue;
+	delete m_mainQueue;
+	t_workerIndex = NO_WORKER;
+}
+
+bool JobSystem::isMainThread() const {
+	return t_workerIndex == 0;
+}
+
+Job* JobSystem::allocateJob(const JobFunction& function, JobCounter* counter, EJobAffinity affinity, bool longLived) {
+
+	// short-lived jobs on a worker thread come from its ring, unless the slot
+	// is still in use; anything else is allocated on the heap
+	Job* job = nullptr;
+	unsigned int worker = t_workerIndex;
+	if (!longLived && worker < m_workers.size()) {
+		Worker& owner = *m_workers[worker];
+		Job* slot = &owner.jobs[owner.nextJob++ & (QUEUE_CAPACITY - 1)];
+		if (!slot->pending.load(std::memory_order_acquire))
+			job = slot;
+	}
+	if (job == nullptr) {
+		job = new Job();
+		job->heap = true;
+	}
+
+	job->function = function;
+	job->counter = counter;
+	job->next = nullptr;
+	job->mainThread = affinity == JOB_MAIN_THREAD;
+	job->pending.store(true, std::memory_order_relaxed);
+	return job;
+}
+
+void JobSystem::releaseJob(Job* job) {
+	if (job->heap) {
+		delete job;
+		return;
+	}
+
+	// drop anything the function captured before the slot is reused
+	job->function = nullptr;
+	job->pending.store(false, std::memory_order_release);
+}
+
+void JobSystem::addToCounter(JobCounter* counter) {
+	if (counter->m_count.fetch_add(1, std::memory_order_acq_rel) != 0)
+		return;
+
+	// reopen the continuation list when a finished counter gets new jobs. the last job
+	// of the previous round may not have closed the list yet, so wait for it; otherwise
+	// it would close the new round's list, and touch the counter after the new round's
+	// waiter has been told it is done
+	Job* closed = CLOSED;
+	while (!counter->m_continuations.compare_exchange_weak(closed, nullptr, std::memory_order_acq_rel)) {
+		closed = CLOSED;
+		std::this_thread::yield();
+	}
+}
+
+void JobSystem::submit(const JobFunction& function, JobCounter* counter, EJobAffinity affinity) {
+	if (counter != nullptr)
+		addToCounter(counter);
+
+	// main thread jobs can sit in their queue for a whole frame, so they never use a ring slot
+	schedule(allocateJob(function, counter, affinity, affinity == JOB_MAIN_THREAD));
+}
+
+void JobSystem::submitAfter(JobCounter& dependency, const JobFunction& function, JobCounter* counter, EJobAffinity affinity) {
+	if (counter != nullptr)
+		addToCounter(counter);
+
+	// the job may wait indefinitely, so it never uses a ring slot
+	Job* job = allocateJob(function, counter, affinity, true);
+
+	Job* head = dependency.m_continuations.load(std::memory_order_acquire);
+	for (;;) {
+		if (head == CLOSED) {
+			// dependency already done, unless a submission is reopening it
+			if (dependency.m_count.load(std::memory_order_acquire) == 0) {
+				schedule(job);
+				return;
+			}
+			std::this_thread::yield();
+			head = dependency.m_continuations.load(std::memory_order_acquire);
+			continue;
+		}
+		job->next = head;
+		if (dependency.m_continuations.compare_exchange_weak(head, job, std::memory_order_acq_rel, std::memory_order_acquire))
+			return;
+	}
+}
+
+void JobSystem::beginBatch(JobCounter& counter) {
+	addToCounter(&counter);
+}
+
+void JobSystem::endBatch(JobCounter& counter) {
+	finish(&counter);
+}
+
+void JobSystem::schedule(Job* job) {
+	unsigned int worker = t_workerIndex;
+
+	if (job->mainThread) {
+		if (worker == 0) {
+			// already on the main thread
+			execute(0, job, false);
+			return;
+		}
+		while (!m_mainQueue->push(job))
+			std::this_thread::yield();
+		return;
+	}
+
+	if (worker < m_workers.size()) {
+		// a full deque means plenty of queued work, so just run this one now
+		if (!m_workers[worker]->deque.push(job)) {
+			execute(worker, job, false);
+			return;
+		}
+	}
+	else {
+		while (!m_sharedQueue->push(job))
+			std::this_thread::yield();
+	}
+	wakeWorker();
+}
+
+void JobSystem::wakeWorker() {
+	if (m_sleepingWorkers.load(std::memory_order_seq_cst) > 0)
+		m_wake.notify_one();
+}
+
+void JobSystem::wait(JobCounter& counter) {
+	unsigned int worker = t_workerIndex;
+	while (!counter.isDone()) {
+		if (worker < m_workers.size() && runOneJob(worker))
+			continue;
+		std::this_thread::yield();
+	}
+}
+
+void JobSystem::parallelFor(unsigned int count, const RangeFunction& function, unsigned int grainSize) {
+	if (count == 0)
+		return;
+
+	// around four ranges per worker balances uneven ranges without drowning in tiny jobs
+	if (grainSize == 0)
+		grainSize = std::max(1u, count / (getWorkerCount() * 4));
+	if (grainSize >= count) {
+		function(0, count);
+		return;
+	}
+
+	JobCounter counter;
+	beginBatch(counter);
+	for (unsigned int begin = grainSize; begin < count; begin += grainSize) {
+		unsigned int end = std::min(begin + grainSize, count);
+		submit([&function, begin, end]() { function(begin, end); }, &counter);
+	}
+	endBatch(counter);
+
+	// the calling thread takes the first range, then helps with the rest
+	function(0, grainSize);
+	wait(counter);
+}
+
+void JobSystem::runMainThreadJobs() {
+	if (!isMainThread())
+		return;
+
+	while (Job* job = m_mainQueue->pop())
+		execute(0, job, false);
+}
+
+bool JobSystem::runOneJob(unsigned int worker) {
+	Worker& self = *m_workers[worker];
+	bool stolen = false;
+
+	Job* job = self.deque.pop();
+	if (job == nullptr && worker == 0)
+		job = m_mainQueue->pop();
+	if (job == nullptr)
+		job = m_sharedQueue->pop();
+
+	if (job == nullptr) {
+		// steal from the others, starting at a random victim
+		unsigned int workerCount = (unsigned int)m_workers.size();
+		self.stealSeed ^= self.stealSeed << 13;
+		self.stealSeed ^= self.stealSeed >> 17;
+		self.stealSeed ^= self.stealSeed << 5;
+		for (unsigned int i = 0; i < workerCount && job == nullptr; ++i) {
+			unsigned int victim = (self.stealSeed + i) % workerCount;
+			if (victim != worker)
+				job = m_workers[victim]->deque.steal();
+		}
+		stolen = job != nullptr;
+	}
+
+	if (job == nullptr)
+		return false;
+
+	execute(worker, job, stolen);
+	return true;
+}
+
+void JobSystem::execute(unsigned int worker, Job* job, bool stolen) {
+	auto start = Clock::now();
+	++t_jobDepth;
+	{
+		PROFILE_SCOPE("Job");
+		job->function();
+	}
+	--t_jobDepth;
+	auto end = Clock::now();
+
+	Worker& self = *m_workers[worker];
+	if (t_jobDepth == 0)
+		self.busyTime.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(), std::memory_order_relaxed);
+	self.jobsExecuted.fetch_add(1, std::memory_order_relaxed);
+	if (stolen)
+		self.jobsStolen.fetch_add(1, std::memory_order_relaxed);
+
+	JobCounter* counter = job->counter;
+	releaseJob(job);
+	if (counter != nullptr)
+		finish(counter);
+}
+
+void JobSystem::finish(JobCounter* counter) {
+	if (counter->m_count.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+
+	// last job done, release everything waiting on the counter; nothing may touch
+	// the counter after this, a waiting thread is free to destroy it
+	Job* job = counter->m_continuations.exchange(CLOSED, std::memory_order_acq_rel);
+	while (job != nullptr) {
+		Job* next = job->next;
+		schedule(job);
+		job = next;
+	}
+}
+
+void JobSystem::workerLoop(unsigned int worker) {
+	t_workerIndex = worker;
+#ifdef AIE_PROFILER
+	Profiler::setThreadName(("Worker " + std::to_string(worker)).c_str());
+#endif
+
+	unsigned int idleSpins = 0;
+	while (m_running.load(std::memory_order_acquire)) {
+		if (runOneJob(worker)) {
+			idleSpins = 0;
+			continue;
+		}
+
+		// jobs tend to arrive in bursts, so spin for a while before sleeping
+		if (++idleSpins < 64) {
+			std::this_thread::yield();
+			continue;
+		}
+		idleSpins = 0;
+
+		// check once more after announcing the sleep, so a submission that missed
+		// the announcement is still picked up
+		m_sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+		if (runOneJob(worker)) {
+			m_sleepingWorkers.fetch_sub(1, std::memory_order_seq_cst);
+			continue;
+		}
+
+		// submission never takes the mutex, so a wakeup can still slip past;
+		// the timeout bounds how late such a job starts
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		if (m_running.load(std::memory_order_acquire))
+			m_wake.wait_for(lock, std::chrono::milliseconds(1));
+		m_sleepingWorkers.fetch_sub(1, std::memory_order_seq_cst);
+	}
+}
+
+void JobSystem::updateStatistics() {
+	auto now = Clock::now();
+	double interval = std::chrono::duration<double, std::nano>(now - m_statisticsStart).count();
+	m_statisticsStart = now;
+
+	for (unsigned int i = 0; i < m_workers.size(); ++i) {
+		Worker& worker = *m_workers[i];
+		WorkerStats& stats = m_workerStats[i];
+		stats.jobsExecuted = worker.jobsExecuted.exchange(0, std::memory_order_relaxed);
+		stats.jobsStolen = worker.jobsStolen.exchange(0, std::memory_order_relaxed);
+		unsigned long long busyTime = worker.busyTime.exchange(0, std::memory_order_relaxed);
+		stats.utilisation = interval > 0 ? (float)std::min(1.0, busyTime / interval) : 0.0f;
+	}
+}
+
+} // namespace aie
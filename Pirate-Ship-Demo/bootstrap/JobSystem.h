@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace aie {
+
+struct Job;
+
+// counts the jobs submitted against it that have not finished yet
+// jobs can be held back until a counter reaches zero (see JobSystem::submitAfter) and
+// threads can help run other jobs while they wait for one (see JobSystem::wait)
+// all of a counter's jobs should be submitted before anything waits on it; submitting
+// several inside JobSystem::beginBatch / endBatch keeps it from reaching zero part way
+class JobCounter {
+public:
+
+	JobCounter();
+	~JobCounter();
+
+	// true once every job submitted against the counter has run and released its continuations
+	bool isDone() const;
+
+protected:
+
+	friend class JobSystem;
+
+	std::atomic<int>	m_count;
+
+	// jobs waiting for the count to reach zero, closed off once it has
+	std::atomic<Job*>	m_continuations;
+};
+
+// a singleton work-stealing job scheduler
+// every worker thread, and the main thread, owns a deque of jobs. a thread pushes and
+// pops its own jobs at one end while idle workers steal from the other end, so
+// submitting and running jobs never takes a lock. jobs submitted from threads outside
+// the scheduler go through a shared lock-free queue instead. jobs with main thread
+// affinity (anything touching OpenGL) are only run by the main thread, while it waits
+// on a counter or when the Application runs them once per frame
+class JobSystem {
+public:
+
+	typedef std::function<void()> JobFunction;
+	typedef std::function<void(unsigned int begin, unsigned int end)> RangeFunction;
+
+	enum EJobAffinity : int {
+		JOB_ANY_THREAD,
+		JOB_MAIN_THREAD
+	};
+
+	struct WorkerStats {
+		unsigned int	jobsExecuted;	// jobs run in the last statistics interval
+		unsigned int	jobsStolen;		// of those, jobs taken from another worker's deque
+		float			utilisation;	// fraction of the interval spent running jobs
+	};
+
+	// returns access to the singleton instance
+	static JobSystem* getInstance() { return m_instance; }
+
+	// queues a job; the counter (if any) counts it until it has run
+	void submit(const JobFunction& function, JobCounter* counter = nullptr, EJobAffinity affinity = JOB_ANY_THREAD);
+
+	// queues a job that only starts once the dependency counter has reached zero
+	void submitAfter(JobCounter& dependency, const JobFunction& function, JobCounter* counter = nullptr,
+		EJobAffinity affinity = JOB_ANY_THREAD);
+
+	// holds the counter open while a batch of jobs is submitted against it, so neither a
+	// waiter nor submitAfter sees it finish before the whole batch is in
+	void beginBatch(JobCounter& counter);
+	void endBatch(JobCounter& counter);
+
+	// runs other jobs on the calling thread until the counter reaches zero
+	void wait(JobCounter& counter);
+
+	// calls function over ranges covering [0, count) across all workers, including the
+	// calling thread, and returns once every range has run
+	// a grain size of 0 picks one from the count and the number of workers
+	void parallelFor(unsigned int count, const RangeFunction& function, unsigned int grainSize = 0);
+
+	// runs all queued main thread jobs, must be called from the main thread
+	void runMainThreadJobs();
+
+	// number of threads running jobs, including the main thread (worker 0)
+	unsigned int getWorkerCount() const { return (unsigned int)m_workers.size(); }
+	bool isMainThread() const;
+
+	// per-worker statistics, gathered once per second by the Application
+	const WorkerStats& getWorkerStats(unsigned int worker) const { return m_workerStats[worker]; }
+
+protected:
+
+	// just giving the Application class access to the JobSystem singleton
+	friend class Application;
+
+	// singleton pointer
+	static JobSystem* m_instance;
+
+	// only want the Application class to be able to create / destroy
+	// a worker count of 0 uses one worker per hardware thread
+	static void create(unsigned int workerCount = 0)	{ m_instance = new JobSystem(workerCount); }
+	static void destroy()								{ delete m_instance; m_instance = nullptr; }
+
+	// gathers the statistics since the previous call and starts a new interval
+	void updateStatistics();
+
+private:
+
+	// capacity of every deque and queue, and of each thread's ring of reusable jobs
+	static const unsigned int QUEUE_CAPACITY = 4096;
+
+	class WorkDeque;
+	class JobQueue;
+	struct Worker;
+
+	// constructor private for singleton
+	JobSystem(unsigned int workerCount);
+	~JobSystem();
+
+	Job* allocateJob(const JobFunction& function, JobCounter* counter, EJobAffinity affinity, bool longLived);
+	void releaseJob(Job* job);
+	void addToCounter(JobCounter* counter);
+	void schedule(Job* job);
+	void wakeWorker();
+
+	// finds and runs one job on the given worker, returns false if there was none
+	bool runOneJob(unsigned int worker);
+	void execute(unsigned int worker, Job* job, bool stolen);
+	void finish(JobCounter* counter);
+
+	void workerLoop(unsigned int worker);
+
+	std::vector<Worker*>	m_workers;		// worker 0 is the main thread
+	JobQueue*				m_sharedQueue;	// submissions from threads outside the scheduler
+	JobQueue*				m_mainQueue;	// jobs with main thread affinity
+
+	std::atomic<bool>			m_running;
+	std::atomic<unsigned int>	m_sleepingWorkers;
+	std::mutex					m_sleepMutex;
+	std::condition_variable		m_wake;
+
+	std::vector<WorkerStats>						m_workerStats;
+	std::chrono::high_resolution_clock::time_point	m_statisticsStart;
+};
+
+} // namespace aie
@@ -0,0 +1,468 @@
+#include "MetricsServer.h"
+
+#ifdef AIE_METRICS
+
+#include "FlightRecorder.h"
+#include "GLStats.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <afunix.h>
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "psapi.lib")
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace aie {
+
+#ifdef _WIN32
+typedef SOCKET Socket;
+static const Socket INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+#else
+typedef int Socket;
+static const Socket INVALID_SOCKET_HANDLE = -1;
+#endif
+
+// upper bounds of the frame time buckets, in seconds: 240, 120, 90, 60, 45, 30, 20, 10, 4 and 1 FPS
+static const double s_bucketBounds[MetricsServer::HISTOGRAM_BUCKETS] = {
+	1.0 / 240, 1.0 / 120, 1.0 / 90, 1.0 / 60, 1.0 / 45, 1.0 / 30, 1.0 / 20, 1.0 / 10, 1.0 / 4, 1.0
+};
+
+// the largest request read, anything longer is answered without the rest
+static const unsigned int MAX_REQUEST = 2048;
+
+// a client that sends or reads nothing for this long is dropped, in milliseconds
+static const unsigned int CLIENT_TIMEOUT = 1000;
+
+// totals of GL calls since the server started; per frame counts would overflow
+struct GLTotals {
+	unsigned long long	drawCalls;
+	unsigned long long	triangles;
+	unsigned long long	programBinds;
+	unsigned long long	vertexArrayBinds;
+	unsigned long long	textureBinds;
+	unsigned long long	uniformUploads;
+	unsigned long long	bufferUploadBytes;
+	unsigned long long	redundantStateSets;
+};
+
+struct Gauge {
+	const char*		name;
+	const char*		help;
+	double			value;
+};
+
+// everything a scrape reports, copied as a whole between the threads
+struct Snapshot {
+	unsigned long long	frames;
+	unsigned long long	buckets[MetricsServer::HISTOGRAM_BUCKETS];	// frames in each bucket, not cumulative
+	double				frameSeconds;
+	unsigned int		fps;
+	unsigned long long	allocations;
+	unsigned long long	frees;
+	bool				hasGLTotals;
+	GLTotals			gl;
+	Gauge				gauges[MetricsServer::MAX_GAUGES];
+	unsigned int		gaugeCount;
+};
+
+// the middle buffer's index carries this when it holds a snapshot the server has not taken
+static const unsigned int FRESH = 4;
+
+struct ServerState {
+	// only touched by the render thread
+	Snapshot			recording = {};
+	unsigned int		back = 0;
+
+	// the render thread swaps its finished buffer for the middle one, the server thread
+	// swaps its old one for the middle one when that is fresh
+	Snapshot			buffers[3] = {};
+	std::atomic<unsigned int> middle;
+
+	// only touched by the server thread
+	unsigned int		front = 2;
+
+	std::atomic<bool>	running;
+	std::thread			thread;
+	Socket				listener = INVALID_SOCKET_HANDLE;
+	std::string			unixPath;
+
+	ServerState() : middle(1), running(false) {}
+};
+
+static ServerState s_server;
+
+static void closeSocket(Socket socket) {
+#ifdef _WIN32
+	closesocket(socket);
+#else
+	close(socket);
+#endif
+}
+
+static void setNonBlocking(Socket socket, bool nonBlocking) {
+#ifdef _WIN32
+	u_long mode = nonBlocking ? 1 : 0;
+	ioctlsocket(socket, FIONBIO, &mode);
+#else
+	int flags = fcntl(socket, F_GETFL, 0);
+	fcntl(socket, F_SETFL, nonBlocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+#endif
+}
+
+static void setTimeouts(Socket socket, unsigned int milliseconds) {
+#ifdef _WIN32
+	DWORD timeout = milliseconds;
+#else
+	timeval timeout = { (time_t)(milliseconds / 1000), (suseconds_t)((milliseconds % 1000) * 1000) };
+#endif
+	setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+	setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+}
+
+// the process's resident memory, or 0 where it is not known
+static unsigned long long residentBytes() {
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.WorkingSetSize;
+	return 0;
+#elif defined(__linux__)
+	unsigned long long pages = 0, resident = 0;
+	FILE* file = fopen("/proc/self/statm", "r");
+	if (file == nullptr)
+		return 0;
+	int read = fscanf(file, "%llu %llu", &pages, &resident);
+	fclose(file);
+	return read == 2 ? resident * (unsigned long long)sysconf(_SC_PAGESIZE) : 0;
+#else
+	return 0;
+#endif
+}
+
+static void appendf(std::string& text, const char* format, ...) {
+	char line[512];
+	va_list args;
+	va_start(args, format);
+	int length = vsnprintf(line, sizeof(line), format, args);
+	va_end(args);
+	if (length > 0)
+		text.append(line, std::min((size_t)length, sizeof(line) - 1));
+}
+
+static void appendCounter(std::string& text, const char* name, const char* help, unsigned long long value) {
+	appendf(text, "# TYPE %s counter\n# HELP %s %s\n%s_total %llu\n", name, name, help, name, value);
+}
+
+static void appendGauge(std::string& text, const char* name, const char* help, double value) {
+	appendf(text, "# TYPE %s gauge\n# HELP %s %s\n%s %.17g\n", name, name, help, name, value);
+}
+
+// the snapshot in the OpenMetrics text format
+static std::string formatMetrics(const Snapshot& snapshot) {
+	std::string text;
+	text.reserve(4096);
+
+	appendf(text, "# TYPE aie_frame_seconds histogram\n# HELP aie_frame_seconds Time from one frame to the next.\n");
+	unsigned long long cumulative = 0;
+	for (unsigned int i = 0; i < MetricsServer::HISTOGRAM_BUCKETS; i++) {
+		cumulative += snapshot.buckets[i];
+		appendf(text, "aie_frame_seconds_bucket{le=\"%.6g\"} %llu\n", s_bucketBounds[i], cumulative);
+	}
+	appendf(text, "aie_frame_seconds_bucket{le=\"+Inf\"} %llu\n", snapshot.frames);
+	appendf(text, "aie_frame_seconds_sum %.17g\naie_frame_seconds_count %llu\n", snapshot.frameSeconds, snapshot.frames);
+
+	appendGauge(text, "aie_fps", "Frames presented in the last second.", snapshot.fps);
+
+	unsigned long long resident = residentBytes();
+	if (resident > 0)
+		appendGauge(text, "aie_process_resident_memory_bytes", "Memory the process has resident.", (double)resident);
+
+#ifdef AIE_FLIGHT_RECORDER
+	appendCounter(text, "aie_heap_allocations", "Calls to operator new.", snapshot.allocations);
+	appendCounter(text, "aie_heap_frees", "Calls to operator delete.", snapshot.frees);
+#endif
+
+	if (snapshot.hasGLTotals) {
+		const GLTotals& gl = snapshot.gl;
+		appendCounter(text, "aie_gl_draw_calls", "GL draw calls.", gl.drawCalls);
+		appendCounter(text, "aie_gl_triangles", "Triangles drawn by direct draws.", gl.triangles);
+		appendCounter(text, "aie_gl_program_binds", "GL program binds.", gl.programBinds);
+		appendCounter(text, "aie_gl_vertex_array_binds", "GL vertex array binds.", gl.vertexArrayBinds);
+		appendCounter(text, "aie_gl_texture_binds", "GL texture binds.", gl.textureBinds);
+		appendCounter(text, "aie_gl_uniform_uploads", "GL uniform uploads.", gl.uniformUploads);
+		appendCounter(text, "aie_gl_buffer_upload_bytes", "Bytes written to GL buffers.", gl.bufferUploadBytes);
+		appendCounter(text, "aie_gl_redundant_state_sets", "GL state sets that changed nothing.", gl.redundantStateSets);
+	}
+
+	for (unsigned int i = 0; i < snapshot.gaugeCount; i++)
+		appendGauge(text, snapshot.gauges[i].name, snapshot.gauges[i].help, snapshot.gauges[i].value);
+
+	text += "# EOF\n";
+	return text;
+}
+
+static void sendAll(Socket client, const std::string& data) {
+	int flags = 0;
+#ifdef MSG_NOSIGNAL
+	flags = MSG_NOSIGNAL;	// a scraper that hangs up must not kill the process
+#endif
+	size_t sent = 0;
+	while (sent < data.size()) {
+		int result = send(client, data.data() + sent, (int)(data.size() - sent), flags);
+		if (result <= 0)
+			return;
+		sent += (size_t)result;
+	}
+}
+
+// reads one request and answers it with the latest snapshot
+static void answer(Socket client) {
+	setNonBlocking(client, false);
+	setTimeouts(client, CLIENT_TIMEOUT);
+
+	// only the request line matters, but the headers are read so the client is not reset
+	char request[MAX_REQUEST + 1];
+	size_t length = 0;
+	request[0] = 0;
+	while (length < MAX_REQUEST && strstr(request, "\r\n\r\n") == nullptr) {
+		int received = recv(client, request + length, (int)(MAX_REQUEST - length), 0);
+		if (received <= 0)
+			break;
+		length += (size_t)received;
+		request[length] = 0;
+	}
+
+	const char* status = "200 OK";
+	const char* contentType = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+	std::string body;
+	if (strncmp(request, "GET ", 4) != 0) {
+		status = "405 Method Not Allowed";
+		contentType = "text/plain";
+		body = "only GET is supported\n";
+	}
+	else if (strncmp(request + 4, "/metrics ", 9) != 0 && strncmp(request + 4, "/ ", 2) != 0) {
+		status = "404 Not Found";
+		contentType = "text/plain";
+		body = "metrics are at /metrics\n";
+	}
+	else {
+		unsigned int middle = s_server.middle.load(std::memory_order_acquire);
+		if (middle & FRESH)
+			s_server.front = s_server.middle.exchange(s_server.front, std::memory_order_acq_rel) & ~FRESH;
+		body = formatMetrics(s_server.buffers[s_server.front]);
+	}
+
+	std::string response;
+	appendf(response, "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+		status, contentType, (unsigned int)body.size());
+	response += body;
+	sendAll(client, response);
+}
+
+// waits for connections a short while at a time, so stop() is noticed promptly
+static void serve() {
+	while (s_server.running.load()) {
+		fd_set readable;
+		FD_ZERO(&readable);
+		FD_SET(s_server.listener, &readable);
+		timeval timeout = { 0, 100000 };
+		if (select((int)s_server.listener + 1, &readable, nullptr, nullptr, &timeout) <= 0)
+			continue;
+
+		Socket client = accept(s_server.listener, nullptr, nullptr);
+		if (client == INVALID_SOCKET_HANDLE)
+			continue;
+		answer(client);
+		closeSocket(client);
+	}
+}
+
+static bool startSockets() {
+#ifdef _WIN32
+	WSADATA data;
+	if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+		printf("Failed to start the metrics server: no sockets\n");
+		return false;
+	}
+#endif
+	return true;
+}
+
+static void stopSockets() {
+#ifdef _WIN32
+	WSACleanup();
+#endif
+}
+
+// starts the server thread on a bound socket
+static bool serveOn(Socket listener) {
+	if (listen(listener, 8) != 0)
+		return false;
+	setNonBlocking(listener, true);
+
+	s_server.listener = listener;
+	s_server.running = true;
+	s_server.thread = std::thread(serve);
+	return true;
+}
+
+bool MetricsServer::start(unsigned short port) {
+	if (isRunning() || !startSockets())
+		return false;
+
+	Socket listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (listener == INVALID_SOCKET_HANDLE) {
+		stopSockets();
+		return false;
+	}
+
+	int reuse = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+	sockaddr_in address = {};
+	address.sin_family = AF_INET;
+	address.sin_port = htons(port);
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(listener, (const sockaddr*)&address, sizeof(address)) != 0 || !serveOn(listener)) {
+		printf("Failed to start the metrics server on port %u\n", port);
+		closeSocket(listener);
+		stopSockets();
+		return false;
+	}
+
+	printf("Serving metrics at http://127.0.0.1:%u/metrics\n", port);
+	return true;
+}
+
+bool MetricsServer::startUnix(const char* path) {
+	if (isRunning() || !startSockets())
+		return false;
+
+	sockaddr_un address = {};
+	address.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(address.sun_path)) {
+		printf("Failed to start the metrics server: socket path too long: %s\n", path);
+		stopSockets();
+		return false;
+	}
+	memcpy(address.sun_path, path, strlen(path) + 1);
+
+	Socket listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listener == INVALID_SOCKET_HANDLE) {
+		stopSockets();
+		return false;
+	}
+
+	// a socket file left by a previous run would stop the bind
+	std::remove(path);
+	if (bind(listener, (const sockaddr*)&address, sizeof(address)) != 0 || !serveOn(listener)) {
+		printf("Failed to start the metrics server on %s\n", path);
+		closeSocket(listener);
+		stopSockets();
+		return false;
+	}
+
+	s_server.unixPath = path;
+	printf("Serving metrics on %s\n", path);
+	return true;
+}
+
+void MetricsServer::stop() {
+	if (!isRunning())
+		return;
+
+	s_server.running = false;
+	s_server.thread.join();
+	closeSocket(s_server.listener);
+	s_server.listener = INVALID_SOCKET_HANDLE;
+	if (!s_server.unixPath.empty()) {
+		std::remove(s_server.unixPath.c_str());
+		s_server.unixPath.clear();
+	}
+	stopSockets();
+}
+
+bool MetricsServer::isRunning() {
+	return s_server.running.load(std::memory_order_relaxed);
+}
+
+void MetricsServer::recordFrame(float seconds, unsigned int fps) {
+	Snapshot& snapshot = s_server.recording;
+	snapshot.frames++;
+	snapshot.frameSeconds += seconds;
+	snapshot.fps = fps;
+	for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+		if (seconds <= s_bucketBounds[i]) {
+			snapshot.buckets[i]++;
+			break;
+		}
+	}
+
+#ifdef AIE_GL_STATS
+	if (GLStats::isInstalled()) {
+		const GLStats::Counters& counters = GLStats::getLastFrame().total;
+		GLTotals& gl = snapshot.gl;
+		gl.drawCalls += counters.drawCalls;
+		gl.triangles += counters.triangles;
+		gl.programBinds += counters.programBinds;
+		gl.vertexArrayBinds += counters.vertexArrayBinds;
+		gl.textureBinds += counters.textureBinds;
+		gl.uniformUploads += counters.uniformUploads;
+		gl.bufferUploadBytes += counters.bufferUploadBytes;
+		gl.redundantStateSets += counters.redundantStateSets;
+		snapshot.hasGLTotals = true;
+	}
+#endif
+}
+
+void MetricsServer::setGauge(const char* name, const char* help, double value) {
+	Snapshot& snapshot = s_server.recording;
+	for (unsigned int i = 0; i < snapshot.gaugeCount; i++) {
+		if (snapshot.gauges[i].name == name || strcmp(snapshot.gauges[i].name, name) == 0) {
+			snapshot.gauges[i].value = value;
+			return;
+		}
+	}
+	if (snapshot.gaugeCount < MAX_GAUGES) {
+		Gauge gauge = { name, help, value };
+		snapshot.gauges[snapshot.gaugeCount++] = gauge;
+	}
+}
+
+void MetricsServer::publish() {
+#ifdef AIE_FLIGHT_RECORDER
+	s_server.recording.allocations = FlightRecorder::getAllocationCount();
+	s_server.recording.frees = FlightRecorder::getFreeCount();
+#endif
+
+	s_server.buffers[s_server.back] = s_server.recording;
+	s_server.back = s_server.middle.exchange(s_server.back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+}
+
+} // namespace aie
+
+#endif
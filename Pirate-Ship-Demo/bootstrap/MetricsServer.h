@@ -0,0 +1,51 @@
+#pragma once
+
+// the metrics server is compiled in unless AIE_NO_METRICS is defined, which must then be
+// defined for every project that links bootstrap so they agree
+#ifndef AIE_NO_METRICS
+#define AIE_METRICS
+#endif
+
+#ifdef AIE_METRICS
+
+namespace aie {
+
+// serves the application's frame metrics to scrapers in the OpenMetrics text format
+// the render thread records each frame and publishes a snapshot of everything recorded so
+// far. a background thread answers HTTP requests on the loopback interface, or on a Unix
+// domain socket, with the latest published snapshot. the two threads hand snapshots over
+// through three buffers and an atomic exchange, so neither ever waits on the other.
+// published: a frame time histogram, FPS, heap allocations (with the flight recorder),
+// GL call totals (with GLStats), the process's resident memory, and the application's own
+// gauges, such as how much texture and mesh memory is resident.
+class MetricsServer {
+public:
+
+	static const unsigned int MAX_GAUGES = 32;
+	static const unsigned int HISTOGRAM_BUCKETS = 10;
+
+	// starts serving on 127.0.0.1 at the port; false if the port could not be listened on
+	static bool start(unsigned short port);
+
+	// the same on a Unix domain socket, replacing any file at the path
+	static bool startUnix(const char* path);
+
+	// stops the server thread and closes the socket
+	static void stop();
+
+	static bool isRunning();
+
+	// counts a frame that took the given time, from the render thread
+	static void recordFrame(float seconds, unsigned int fps);
+
+	// sets a gauge until it is next set, from the render thread; names must be valid
+	// metric names and, like the help text, outlive the server
+	static void setGauge(const char* name, const char* help, double value);
+
+	// hands what has been recorded to the server thread, once a frame
+	static void publish();
+};
+
+} // namespace aie
+
+#endif
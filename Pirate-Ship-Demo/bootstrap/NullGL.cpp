@@ -0,0 +1,1170 @@
+#include "NullGL.h"
+#include "gl_core_4_4.h"
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace aie {
+
+// every entry point the engine calls, bootstrap and projects alike
+#define NULL_GL_FUNCTIONS(X) \
+	X(glActiveTexture) X(glAttachShader) X(glBeginQuery) X(glBindAttribLocation) \
+	X(glBindBuffer) X(glBindBufferBase) X(glBindBufferRange) X(glBindFramebuffer) \
+	X(glBindTexture) X(glBindVertexArray) X(glBlendEquation) X(glBlendEquationSeparate) \
+	X(glBlendFunc) X(glBlitFramebuffer) X(glBufferData) X(glBufferStorage) \
+	X(glBufferSubData) X(glCheckFramebufferStatus) X(glClear) X(glClearBufferfi) \
+	X(glClearBufferfv) X(glClearColor) X(glClientWaitSync) X(glColorMask) \
+	X(glCompileShader) X(glCreateProgram) X(glCreateShader) X(glDeleteBuffers) \
+	X(glDeleteFramebuffers) X(glDeleteProgram) X(glDeleteQueries) X(glDeleteShader) \
+	X(glDeleteSync) X(glDeleteTextures) X(glDeleteVertexArrays) X(glDepthFunc) \
+	X(glDepthMask) X(glDetachShader) X(glDisable) X(glDrawArrays) \
+	X(glDrawBuffer) X(glDrawBuffers) X(glDrawElements) X(glDrawElementsBaseVertex) \
+	X(glEnable) X(glEnableVertexAttribArray) X(glEndQuery) X(glFenceSync) \
+	X(glFramebufferTexture) X(glFramebufferTexture2D) X(glFramebufferTextureLayer) X(glGenBuffers) \
+	X(glGenFramebuffers) X(glGenQueries) X(glGenTextures) X(glGenVertexArrays) \
+	X(glGenerateMipmap) X(glGetAttribLocation) X(glGetBooleanv) X(glGetError) \
+	X(glGetFloatv) X(glGetInteger64v) X(glGetIntegerv) X(glGetProgramInfoLog) \
+	X(glGetProgramiv) X(glGetQueryObjectiv) X(glGetQueryObjectui64v) X(glGetQueryObjectuiv) \
+	X(glGetShaderInfoLog) X(glGetShaderiv) X(glGetString) X(glGetStringi) \
+	X(glGetUniformBlockIndex) X(glGetUniformLocation) X(glIsEnabled) X(glLinkProgram) \
+	X(glMapBufferRange) X(glMemoryBarrier) X(glMultiDrawElementsIndirect) X(glPolygonOffset) \
+	X(glQueryCounter) X(glReadBuffer) X(glScissor) X(glShaderSource) \
+	X(glTexImage2D) X(glTexParameterfv) X(glTexParameteri) X(glTexStorage2D) \
+	X(glTexStorage3D) X(glUniform1f) X(glUniform1fv) X(glUniform1i) \
+	X(glUniform1iv) X(glUniform2f) X(glUniform2fv) X(glUniform3f) \
+	X(glUniform3fv) X(glUniform4f) X(glUniform4fv) X(glUniformBlockBinding) \
+	X(glUniformMatrix2fv) X(glUniformMatrix3fv) X(glUniformMatrix4fv) X(glUnmapBuffer) \
+	X(glUseProgram) X(glVertexAttribPointer) X(glViewport)
+
+enum ENullGLFunction : unsigned int {
+#define NULL_GL_ENUM(name) NULLGL_##name,
+	NULL_GL_FUNCTIONS(NULL_GL_ENUM)
+#undef NULL_GL_ENUM
+	NULLGL_FUNCTION_COUNT
+};
+
+static const char* functionNames[NULLGL_FUNCTION_COUNT] = {
+#define NULL_GL_NAME(name) #name,
+	NULL_GL_FUNCTIONS(NULL_GL_NAME)
+#undef NULL_GL_NAME
+};
+
+enum EObjectType {
+	OBJECT_BUFFER,
+	OBJECT_TEXTURE,
+	OBJECT_VERTEX_ARRAY,
+	OBJECT_FRAMEBUFFER,
+	OBJECT_QUERY,
+	OBJECT_SHADER,
+	OBJECT_PROGRAM
+};
+
+static const char* objectTypeNames[] = { "buffer", "texture", "vertex array", "framebuffer", "query", "shader", "program" };
+
+struct NullObject {
+	EObjectType		type;
+
+	// buffers: the size given to glBufferData / glBufferStorage, and memory for mapping,
+	// only allocated the first time the buffer is mapped
+	GLsizeiptr		size;
+	std::vector<unsigned char> storage;
+	bool			mapped;
+
+	// shaders and programs
+	GLenum			shaderType;
+	unsigned int	attachedShaders;
+	bool			linked;
+
+	// programs: names are given locations in the order they are first asked for
+	std::unordered_map<std::string, GLint> uniforms;
+	std::unordered_map<std::string, GLint> attributes;
+	std::unordered_map<std::string, GLuint> blocks;
+};
+
+// everything a context would hold, and the counts
+struct NullGLState {
+	bool			installed = false;
+	void*			driverFunctions[NULLGL_FUNCTION_COUNT] = {};
+
+	unsigned int	calls[NULLGL_FUNCTION_COUNT] = {};
+	unsigned int	totalCalls = 0;
+	unsigned int	drawCalls = 0;
+	bool			reported[NULLGL_FUNCTION_COUNT] = {};
+	unsigned int	errorCount = 0;
+	std::string		lastError;
+	GLenum			error = GL_NO_ERROR;
+
+	bool			recording = false;
+	std::vector<const char*> recordedCalls;
+
+	// object names are shared by every type, so a name of the wrong type is always caught
+	GLuint			nextName = 1;
+	std::unordered_map<GLuint, NullObject> objects;
+	std::unordered_set<size_t> syncs;
+	size_t			nextSync = 1;
+
+	std::unordered_map<GLenum, GLuint> buffers;					// by target
+	std::unordered_map<unsigned long long, GLuint> textures;	// by unit and target
+	GLuint			activeTexture = 0;
+	GLuint			program = 0;
+	GLuint			vertexArray = 0;
+	GLuint			drawFramebuffer = 0;
+	GLuint			readFramebuffer = 0;
+	GLuint			activeQueries = 0;
+
+	std::unordered_set<GLenum> enabled;
+	GLint			viewport[4] = {};
+	GLint			scissor[4] = {};
+	GLfloat			clearColour[4] = {};
+	GLenum			blendSrcRGB = GL_ONE, blendDstRGB = GL_ZERO;
+	GLenum			blendSrcAlpha = GL_ONE, blendDstAlpha = GL_ZERO;
+	GLenum			blendEquationRGB = GL_FUNC_ADD, blendEquationAlpha = GL_FUNC_ADD;
+	GLenum			depthFunc = GL_LESS;
+	GLboolean		depthMask = GL_TRUE;
+};
+
+static NullGLState s_state;
+
+// counts the call and adds it to the recording
+static void called(ENullGLFunction function) {
+	s_state.calls[function]++;
+	s_state.totalCalls++;
+	if (s_state.recording)
+		s_state.recordedCalls.push_back(functionNames[function]);
+}
+
+// a call that a driver would reject: the first error sticks until glGetError() like in GL
+static void fail(ENullGLFunction function, GLenum error, const char* format, ...) {
+	char message[256];
+	int length = snprintf(message, sizeof(message), "%s: ", functionNames[function]);
+	va_list args;
+	va_start(args, format);
+	vsnprintf(message + length, sizeof(message) - length, format, args);
+	va_end(args);
+
+	s_state.errorCount++;
+	s_state.lastError = message;
+	if (s_state.error == GL_NO_ERROR)
+		s_state.error = error;
+	if (!s_state.reported[function]) {
+		s_state.reported[function] = true;
+		printf("NullGL error: %s\n", message);
+	}
+}
+
+// the live object with the name, if it is of the type
+static NullObject* findObject(GLuint name, EObjectType type) {
+	auto found = s_state.objects.find(name);
+	return found != s_state.objects.end() && found->second.type == type ? &found->second : nullptr;
+}
+
+// 0, or the name of a live object of the type
+static bool checkName(ENullGLFunction function, GLuint name, EObjectType type) {
+	if (name == 0 || findObject(name, type) != nullptr)
+		return true;
+	fail(function, GL_INVALID_OPERATION, "%u is not a %s", name, objectTypeNames[type]);
+	return false;
+}
+
+static void genObjects(ENullGLFunction function, GLsizei n, GLuint* names, EObjectType type) {
+	if (n < 0) {
+		fail(function, GL_INVALID_VALUE, "negative count");
+		return;
+	}
+	for (GLsizei i = 0; i < n; i++) {
+		names[i] = s_state.nextName++;
+		NullObject& object = s_state.objects[names[i]];
+		object.type = type;
+		object.size = 0;
+		object.mapped = false;
+		object.shaderType = 0;
+		object.attachedShaders = 0;
+		object.linked = false;
+	}
+}
+
+// unused names are silently ignored, as in GL; anything bound to a deleted name is unbound
+static void deleteObjects(ENullGLFunction function, GLsizei n, const GLuint* names, EObjectType type) {
+	if (n < 0) {
+		fail(function, GL_INVALID_VALUE, "negative count");
+		return;
+	}
+	for (GLsizei i = 0; i < n; i++) {
+		if (findObject(names[i], type) == nullptr)
+			continue;
+		s_state.objects.erase(names[i]);
+		for (auto& binding : s_state.buffers)
+			if (binding.second == names[i]) binding.second = 0;
+		for (auto& binding : s_state.textures)
+			if (binding.second == names[i]) binding.second = 0;
+		if (s_state.vertexArray == names[i]) s_state.vertexArray = 0;
+		if (s_state.drawFramebuffer == names[i]) s_state.drawFramebuffer = 0;
+		if (s_state.readFramebuffer == names[i]) s_state.readFramebuffer = 0;
+	}
+}
+
+// the buffer bound to a target, reporting when there is none
+static NullObject* boundBuffer(ENullGLFunction function, GLenum target) {
+	auto found = s_state.buffers.find(target);
+	NullObject* buffer = found != s_state.buffers.end() ? findObject(found->second, OBJECT_BUFFER) : nullptr;
+	if (buffer == nullptr)
+		fail(function, GL_INVALID_OPERATION, "no buffer bound to target 0x%04X", target);
+	return buffer;
+}
+
+static unsigned long long textureKey(GLuint unit, GLenum target) {
+	return ((unsigned long long)unit << 32) | target;
+}
+
+static GLuint boundTextureName(GLenum target) {
+	auto found = s_state.textures.find(textureKey(s_state.activeTexture, target));
+	return found != s_state.textures.end() ? found->second : 0;
+}
+
+static bool checkBoundTexture(ENullGLFunction function, GLenum target) {
+	if (boundTextureName(target) != 0)
+		return true;
+	fail(function, GL_INVALID_OPERATION, "no texture bound to target 0x%04X on unit %u", target, s_state.activeTexture);
+	return false;
+}
+
+static bool checkFramebufferTarget(ENullGLFunction function, GLenum target) {
+	GLuint framebuffer = target == GL_READ_FRAMEBUFFER ? s_state.readFramebuffer : s_state.drawFramebuffer;
+	if (framebuffer != 0)
+		return true;
+	fail(function, GL_INVALID_OPERATION, "the default framebuffer is bound");
+	return false;
+}
+
+// uniforms need a linked program in use and a location it handed out (-1 is ignored)
+static bool checkUniform(ENullGLFunction function, GLint location, GLsizei count) {
+	NullObject* program = findObject(s_state.program, OBJECT_PROGRAM);
+	if (program == nullptr) {
+		fail(function, GL_INVALID_OPERATION, "no program in use");
+		return false;
+	}
+	if (count < 0) {
+		fail(function, GL_INVALID_VALUE, "negative count");
+		return false;
+	}
+	if (location < -1 || location >= (GLint)program->uniforms.size()) {
+		fail(function, GL_INVALID_OPERATION, "location %d is not a uniform of program %u", location, s_state.program);
+		return false;
+	}
+	return true;
+}
+
+// draws need a linked program in use and a vertex array bound (core profile)
+static bool checkDraw(ENullGLFunction function, GLsizei count) {
+	if (count < 0) {
+		fail(function, GL_INVALID_VALUE, "negative count");
+		return false;
+	}
+	NullObject* program = findObject(s_state.program, OBJECT_PROGRAM);
+	if (program == nullptr || !program->linked) {
+		fail(function, GL_INVALID_OPERATION, "no linked program in use");
+		return false;
+	}
+	if (s_state.vertexArray == 0) {
+		fail(function, GL_INVALID_OPERATION, "no vertex array bound");
+		return false;
+	}
+	return true;
+}
+
+// a loader such as glad refuses a context that lists no extensions at all, so this one
+// lists a single made-up extension that nothing acts on
+static const char* const extensions[] = { "GL_AIE_null_context" };
+static const unsigned int EXTENSION_COUNT = sizeof(extensions) / sizeof(extensions[0]);
+
+// the integer state a query returns, or 0 values if the engine never asks for it
+// returns how many values were written
+static unsigned int getIntegers(GLenum pname, GLint64* data) {
+	data[0] = 0;
+	switch (pname) {
+	case GL_CURRENT_PROGRAM:					data[0] = s_state.program; break;
+	case GL_VERTEX_ARRAY_BINDING:				data[0] = s_state.vertexArray; break;
+	case GL_DRAW_FRAMEBUFFER_BINDING:			data[0] = s_state.drawFramebuffer; break;
+	case GL_READ_FRAMEBUFFER_BINDING:			data[0] = s_state.readFramebuffer; break;
+	case GL_ACTIVE_TEXTURE:						data[0] = GL_TEXTURE0 + s_state.activeTexture; break;
+	case GL_TEXTURE_BINDING_2D:					data[0] = boundTextureName(GL_TEXTURE_2D); break;
+	case GL_TEXTURE_BINDING_2D_ARRAY:			data[0] = boundTextureName(GL_TEXTURE_2D_ARRAY); break;
+	case GL_ARRAY_BUFFER_BINDING:				data[0] = s_state.buffers[GL_ARRAY_BUFFER]; break;
+	case GL_ELEMENT_ARRAY_BUFFER_BINDING:		data[0] = s_state.buffers[GL_ELEMENT_ARRAY_BUFFER]; break;
+	case GL_UNIFORM_BUFFER_BINDING:				data[0] = s_state.buffers[GL_UNIFORM_BUFFER]; break;
+	case GL_BLEND_SRC:
+	case GL_BLEND_SRC_RGB:						data[0] = s_state.blendSrcRGB; break;
+	case GL_BLEND_DST:
+	case GL_BLEND_DST_RGB:						data[0] = s_state.blendDstRGB; break;
+	case GL_BLEND_SRC_ALPHA:					data[0] = s_state.blendSrcAlpha; break;
+	case GL_BLEND_DST_ALPHA:					data[0] = s_state.blendDstAlpha; break;
+	case GL_BLEND_EQUATION_RGB:					data[0] = s_state.blendEquationRGB; break;
+	case GL_BLEND_EQUATION_ALPHA:				data[0] = s_state.blendEquationAlpha; break;
+	case GL_DEPTH_FUNC:							data[0] = s_state.depthFunc; break;
+	case GL_DEPTH_WRITEMASK:					data[0] = s_state.depthMask; break;
+	case GL_VIEWPORT:
+		for (int i = 0; i < 4; i++) data[i] = s_state.viewport[i];
+		return 4;
+	case GL_SCISSOR_BOX:
+		for (int i = 0; i < 4; i++) data[i] = s_state.scissor[i];
+		return 4;
+	case GL_MAJOR_VERSION:						data[0] = 4; break;
+	case GL_MINOR_VERSION:						data[0] = 6; break;
+	case GL_NUM_EXTENSIONS:						data[0] = EXTENSION_COUNT; break;
+	case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:
+	case GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT:	data[0] = 256; break;
+	case GL_MAX_TEXTURE_SIZE:					data[0] = 16384; break;
+	case GL_MAX_ARRAY_TEXTURE_LAYERS:			data[0] = 2048; break;
+	case GL_MAX_COLOR_ATTACHMENTS:
+	case GL_MAX_DRAW_BUFFERS:					data[0] = 8; break;
+	case GL_MAX_TEXTURE_IMAGE_UNITS:			data[0] = 32; break;
+	case GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS:	data[0] = 192; break;
+	case GL_MAX_UNIFORM_BUFFER_BINDINGS:		data[0] = 84; break;
+	case GL_MAX_VIEWPORT_DIMS:
+		data[0] = data[1] = 16384;
+		return 2;
+	case GL_TIMESTAMP:							data[0] = 0; break;
+	default: break;
+	}
+	return 1;
+}
+
+// the entry points
+
+static void CODEGEN_FUNCPTR null_glActiveTexture(GLenum texture) {
+	called(NULLGL_glActiveTexture);
+	if (texture < GL_TEXTURE0 || texture >= GL_TEXTURE0 + 32)
+		fail(NULLGL_glActiveTexture, GL_INVALID_ENUM, "texture unit 0x%04X out of range", texture);
+	else
+		s_state.activeTexture = texture - GL_TEXTURE0;
+}
+
+static void CODEGEN_FUNCPTR null_glAttachShader(GLuint program, GLuint shader) {
+	called(NULLGL_glAttachShader);
+	NullObject* programObject = findObject(program, OBJECT_PROGRAM);
+	if (programObject == nullptr || findObject(shader, OBJECT_SHADER) == nullptr)
+		fail(NULLGL_glAttachShader, GL_INVALID_VALUE, "%u / %u is not a program / shader", program, shader);
+	else
+		programObject->attachedShaders++;
+}
+
+static void CODEGEN_FUNCPTR null_glBeginQuery(GLenum /*target*/, GLuint id) {
+	called(NULLGL_glBeginQuery);
+	if (findObject(id, OBJECT_QUERY) == nullptr)
+		fail(NULLGL_glBeginQuery, GL_INVALID_OPERATION, "%u is not a query", id);
+	else if (s_state.activeQueries++ > 0)
+		fail(NULLGL_glBeginQuery, GL_INVALID_OPERATION, "a query is already active");
+}
+
+static void CODEGEN_FUNCPTR null_glBindAttribLocation(GLuint program, GLuint index, const GLchar* name) {
+	called(NULLGL_glBindAttribLocation);
+	NullObject* programObject = findObject(program, OBJECT_PROGRAM);
+	if (programObject == nullptr)
+		fail(NULLGL_glBindAttribLocation, GL_INVALID_VALUE, "%u is not a program", program);
+	else
+		programObject->attributes[name] = (GLint)index;
+}
+
+static void CODEGEN_FUNCPTR null_glBindBuffer(GLenum target, GLuint buffer) {
+	called(NULLGL_glBindBuffer);
+	if (checkName(NULLGL_glBindBuffer, buffer, OBJECT_BUFFER))
+		s_state.buffers[target] = buffer;
+}
+
+static void CODEGEN_FUNCPTR null_glBindBufferBase(GLenum target, GLuint /*index*/, GLuint buffer) {
+	called(NULLGL_glBindBufferBase);
+	if (checkName(NULLGL_glBindBufferBase, buffer, OBJECT_BUFFER))
+		s_state.buffers[target] = buffer;
+}
+
+static void CODEGEN_FUNCPTR null_glBindBufferRange(GLenum target, GLuint /*index*/, GLuint buffer, GLintptr offset, GLsizeiptr size) {
+	called(NULLGL_glBindBufferRange);
+	if (!checkName(NULLGL_glBindBufferRange, buffer, OBJECT_BUFFER))
+		return;
+	NullObject* object = findObject(buffer, OBJECT_BUFFER);
+	if (object != nullptr && (offset < 0 || size <= 0 || offset + size > object->size))
+		fail(NULLGL_glBindBufferRange, GL_INVALID_VALUE, "range %lld+%lld outside buffer %u", (long long)offset, (long long)size, buffer);
+	else
+		s_state.buffers[target] = buffer;
+}
+
+static void CODEGEN_FUNCPTR null_glBindFramebuffer(GLenum target, GLuint framebuffer) {
+	called(NULLGL_glBindFramebuffer);
+	if (!checkName(NULLGL_glBindFramebuffer, framebuffer, OBJECT_FRAMEBUFFER))
+		return;
+	if (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER)
+		s_state.drawFramebuffer = framebuffer;
+	if (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER)
+		s_state.readFramebuffer = framebuffer;
+}
+
+static void CODEGEN_FUNCPTR null_glBindTexture(GLenum target, GLuint texture) {
+	called(NULLGL_glBindTexture);
+	if (checkName(NULLGL_glBindTexture, texture, OBJECT_TEXTURE))
+		s_state.textures[textureKey(s_state.activeTexture, target)] = texture;
+}
+
+static void CODEGEN_FUNCPTR null_glBindVertexArray(GLuint array) {
+	called(NULLGL_glBindVertexArray);
+	if (checkName(NULLGL_glBindVertexArray, array, OBJECT_VERTEX_ARRAY))
+		s_state.vertexArray = array;
+}
+
+static void CODEGEN_FUNCPTR null_glBlendEquation(GLenum mode) {
+	called(NULLGL_glBlendEquation);
+	s_state.blendEquationRGB = s_state.blendEquationAlpha = mode;
+}
+
+static void CODEGEN_FUNCPTR null_glBlendEquationSeparate(GLenum modeRGB, GLenum modeAlpha) {
+	called(NULLGL_glBlendEquationSeparate);
+	s_state.blendEquationRGB = modeRGB;
+	s_state.blendEquationAlpha = modeAlpha;
+}
+
+static void CODEGEN_FUNCPTR null_glBlendFunc(GLenum sfactor, GLenum dfactor) {
+	called(NULLGL_glBlendFunc);
+	s_state.blendSrcRGB = s_state.blendSrcAlpha = sfactor;
+	s_state.blendDstRGB = s_state.blendDstAlpha = dfactor;
+}
+
+static void CODEGEN_FUNCPTR null_glBlitFramebuffer(GLint /*srcX0*/, GLint /*srcY0*/, GLint /*srcX1*/, GLint /*srcY1*/,
+												  GLint /*dstX0*/, GLint /*dstY0*/, GLint /*dstX1*/, GLint /*dstY1*/, GLbitfield /*mask*/, GLenum /*filter*/) {
+	called(NULLGL_glBlitFramebuffer);
+	if (s_state.readFramebuffer == s_state.drawFramebuffer)
+		fail(NULLGL_glBlitFramebuffer, GL_INVALID_OPERATION, "read and draw framebuffers are both %u", s_state.readFramebuffer);
+}
+
+static void CODEGEN_FUNCPTR null_glBufferData(GLenum target, GLsizeiptr size, const GLvoid* /*data*/, GLenum /*usage*/) {
+	called(NULLGL_glBufferData);
+	if (size < 0) {
+		fail(NULLGL_glBufferData, GL_INVALID_VALUE, "negative size");
+		return;
+	}
+	if (NullObject* buffer = boundBuffer(NULLGL_glBufferData, target)) {
+		buffer->size = size;
+		buffer->storage.clear();
+	}
+}
+
+static void CODEGEN_FUNCPTR null_glBufferStorage(GLenum target, GLsizeiptr size, const void* /*data*/, GLbitfield /*flags*/) {
+	called(NULLGL_glBufferStorage);
+	if (size <= 0) {
+		fail(NULLGL_glBufferStorage, GL_INVALID_VALUE, "size must be positive");
+		return;
+	}
+	if (NullObject* buffer = boundBuffer(NULLGL_glBufferStorage, target)) {
+		buffer->size = size;
+		buffer->storage.clear();
+	}
+}
+
+static void CODEGEN_FUNCPTR null_glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* /*data*/) {
+	called(NULLGL_glBufferSubData);
+	NullObject* buffer = boundBuffer(NULLGL_glBufferSubData, target);
+	if (buffer != nullptr && (offset < 0 || size < 0 || offset + size > buffer->size))
+		fail(NULLGL_glBufferSubData, GL_INVALID_VALUE, "range %lld+%lld outside a %lld byte buffer",
+			(long long)offset, (long long)size, (long long)buffer->size);
+}
+
+static GLenum CODEGEN_FUNCPTR null_glCheckFramebufferStatus(GLenum /*target*/) {
+	called(NULLGL_glCheckFramebufferStatus);
+	return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static void CODEGEN_FUNCPTR null_glClear(GLbitfield /*mask*/) {
+	called(NULLGL_glClear);
+}
+
+static void CODEGEN_FUNCPTR null_glClearBufferfi(GLenum /*buffer*/, GLint /*drawbuffer*/, GLfloat /*depth*/, GLint /*stencil*/) {
+	called(NULLGL_glClearBufferfi);
+}
+
+static void CODEGEN_FUNCPTR null_glClearBufferfv(GLenum /*buffer*/, GLint /*drawbuffer*/, const GLfloat* /*value*/) {
+	called(NULLGL_glClearBufferfv);
+}
+
+static void CODEGEN_FUNCPTR null_glClearColor(GLfloat red, GLfloat green, GLfloat blue, GLfloat alpha) {
+	called(NULLGL_glClearColor);
+	s_state.clearColour[0] = red;
+	s_state.clearColour[1] = green;
+	s_state.clearColour[2] = blue;
+	s_state.clearColour[3] = alpha;
+}
+
+static GLenum CODEGEN_FUNCPTR null_glClientWaitSync(GLsync sync, GLbitfield /*flags*/, GLuint64 /*timeout*/) {
+	called(NULLGL_glClientWaitSync);
+	if (s_state.syncs.count((size_t)sync) == 0) {
+		fail(NULLGL_glClientWaitSync, GL_INVALID_VALUE, "not a sync object");
+		return GL_WAIT_FAILED;
+	}
+	return GL_ALREADY_SIGNALED;
+}
+
+static void CODEGEN_FUNCPTR null_glColorMask(GLboolean /*red*/, GLboolean /*green*/, GLboolean /*blue*/, GLboolean /*alpha*/) {
+	called(NULLGL_glColorMask);
+}
+
+static void CODEGEN_FUNCPTR null_glCompileShader(GLuint shader) {
+	called(NULLGL_glCompileShader);
+	checkName(NULLGL_glCompileShader, shader, OBJECT_SHADER);
+}
+
+static GLuint CODEGEN_FUNCPTR null_glCreateProgram() {
+	called(NULLGL_glCreateProgram);
+	GLuint name = 0;
+	genObjects(NULLGL_glCreateProgram, 1, &name, OBJECT_PROGRAM);
+	return name;
+}
+
+static GLuint CODEGEN_FUNCPTR null_glCreateShader(GLenum type) {
+	called(NULLGL_glCreateShader);
+	GLuint name = 0;
+	genObjects(NULLGL_glCreateShader, 1, &name, OBJECT_SHADER);
+	s_state.objects[name].shaderType = type;
+	return name;
+}
+
+static void CODEGEN_FUNCPTR null_glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+	called(NULLGL_glDeleteBuffers);
+	deleteObjects(NULLGL_glDeleteBuffers, n, buffers, OBJECT_BUFFER);
+}
+
+static void CODEGEN_FUNCPTR null_glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+	called(NULLGL_glDeleteFramebuffers);
+	deleteObjects(NULLGL_glDeleteFramebuffers, n, framebuffers, OBJECT_FRAMEBUFFER);
+}
+
+static void CODEGEN_FUNCPTR null_glDeleteProgram(GLuint program) {
+	called(NULLGL_glDeleteProgram);
+	deleteObjects(NULLGL_glDeleteProgram, 1, &program, OBJECT_PROGRAM);
+	if (s_state.program == program)
+		s_state.program = 0;
+}
+
+static void CODEGEN_FUNCPTR null_glDeleteQueries(GLsizei n, const GLuint* ids) {
+	called(NULLGL_glDeleteQueries);
+	deleteObjects(NULLGL_glDeleteQueries, n, ids, OBJECT_QUERY);
+}
+
+static void CODEGEN_FUNCPTR null_glDeleteShader(GLuint shader) {
+	called(NULLGL_glDeleteShader);
+	deleteObjects(NULLGL_glDeleteShader, 1, &shader, OBJECT_SHADER);
+}
+
+static void CODEGEN_FUNCPTR null_glDeleteSync(GLsync sync) {
+	called(NULLGL_glDeleteSync);
+	if (sync != nullptr && s_state.syncs.erase((size_t)sync) == 0)
+		fail(NULLGL_glDeleteSync, GL_INVALID_VALUE, "not a sync object");
+}
+
+static void CODEGEN_FUNCPTR null_glDeleteTextures(GLsizei n, const GLuint* textures) {
+	called(NULLGL_glDeleteTextures);
+	deleteObjects(NULLGL_glDeleteTextures, n, textures, OBJECT_TEXTURE);
+}
+
+static void CODEGEN_FUNCPTR null_glDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+	called(NULLGL_glDeleteVertexArrays);
+	deleteObjects(NULLGL_glDeleteVertexArrays, n, arrays, OBJECT_VERTEX_ARRAY);
+}
+
+static void CODEGEN_FUNCPTR null_glDepthFunc(GLenum func) {
+	called(NULLGL_glDepthFunc);
+	s_state.depthFunc = func;
+}
+
+static void CODEGEN_FUNCPTR null_glDepthMask(GLboolean flag) {
+	called(NULLGL_glDepthMask);
+	s_state.depthMask = flag;
+}
+
+static void CODEGEN_FUNCPTR null_glDetachShader(GLuint program, GLuint shader) {
+	called(NULLGL_glDetachShader);
+	NullObject* programObject = findObject(program, OBJECT_PROGRAM);
+	if (programObject == nullptr || programObject->attachedShaders == 0)
+		fail(NULLGL_glDetachShader, GL_INVALID_OPERATION, "shader %u is not attached to %u", shader, program);
+	else
+		programObject->attachedShaders--;
+}
+
+static void CODEGEN_FUNCPTR null_glDisable(GLenum cap) {
+	called(NULLGL_glDisable);
+	s_state.enabled.erase(cap);
+}
+
+static void CODEGEN_FUNCPTR null_glDrawArrays(GLenum /*mode*/, GLint /*first*/, GLsizei count) {
+	called(NULLGL_glDrawArrays);
+	if (checkDraw(NULLGL_glDrawArrays, count))
+		s_state.drawCalls++;
+}
+
+static void CODEGEN_FUNCPTR null_glDrawBuffer(GLenum /*mode*/) {
+	called(NULLGL_glDrawBuffer);
+}
+
+static void CODEGEN_FUNCPTR null_glDrawBuffers(GLsizei n, const GLenum* /*bufs*/) {
+	called(NULLGL_glDrawBuffers);
+	if (n < 0 || n > 8)
+		fail(NULLGL_glDrawBuffers, GL_INVALID_VALUE, "%d draw buffers", n);
+}
+
+static void CODEGEN_FUNCPTR null_glDrawElements(GLenum /*mode*/, GLsizei count, GLenum /*type*/, const GLvoid* /*indices*/) {
+	called(NULLGL_glDrawElements);
+	if (checkDraw(NULLGL_glDrawElements, count))
+		s_state.drawCalls++;
+}
+
+static void CODEGEN_FUNCPTR null_glDrawElementsBaseVertex(GLenum /*mode*/, GLsizei count, GLenum /*type*/, const GLvoid* /*indices*/, GLint /*basevertex*/) {
+	called(NULLGL_glDrawElementsBaseVertex);
+	if (checkDraw(NULLGL_glDrawElementsBaseVertex, count))
+		s_state.drawCalls++;
+}
+
+static void CODEGEN_FUNCPTR null_glEnable(GLenum cap) {
+	called(NULLGL_glEnable);
+	s_state.enabled.insert(cap);
+}
+
+static void CODEGEN_FUNCPTR null_glEnableVertexAttribArray(GLuint /*index*/) {
+	called(NULLGL_glEnableVertexAttribArray);
+	if (s_state.vertexArray == 0)
+		fail(NULLGL_glEnableVertexAttribArray, GL_INVALID_OPERATION, "no vertex array bound");
+}
+
+static void CODEGEN_FUNCPTR null_glEndQuery(GLenum /*target*/) {
+	called(NULLGL_glEndQuery);
+	if (s_state.activeQueries == 0)
+		fail(NULLGL_glEndQuery, GL_INVALID_OPERATION, "no query is active");
+	else
+		s_state.activeQueries--;
+}
+
+static GLsync CODEGEN_FUNCPTR null_glFenceSync(GLenum /*condition*/, GLbitfield /*flags*/) {
+	called(NULLGL_glFenceSync);
+	size_t sync = s_state.nextSync++;
+	s_state.syncs.insert(sync);
+	return (GLsync)sync;
+}
+
+static void CODEGEN_FUNCPTR null_glFramebufferTexture(GLenum target, GLenum /*attachment*/, GLuint texture, GLint /*level*/) {
+	called(NULLGL_glFramebufferTexture);
+	if (checkFramebufferTarget(NULLGL_glFramebufferTexture, target))
+		checkName(NULLGL_glFramebufferTexture, texture, OBJECT_TEXTURE);
+}
+
+static void CODEGEN_FUNCPTR null_glFramebufferTexture2D(GLenum target, GLenum /*attachment*/, GLenum /*textarget*/, GLuint texture, GLint /*level*/) {
+	called(NULLGL_glFramebufferTexture2D);
+	if (checkFramebufferTarget(NULLGL_glFramebufferTexture2D, target))
+		checkName(NULLGL_glFramebufferTexture2D, texture, OBJECT_TEXTURE);
+}
+
+static void CODEGEN_FUNCPTR null_glFramebufferTextureLayer(GLenum target, GLenum /*attachment*/, GLuint texture, GLint /*level*/, GLint /*layer*/) {
+	called(NULLGL_glFramebufferTextureLayer);
+	if (checkFramebufferTarget(NULLGL_glFramebufferTextureLayer, target))
+		checkName(NULLGL_glFramebufferTextureLayer, texture, OBJECT_TEXTURE);
+}
+
+static void CODEGEN_FUNCPTR null_glGenBuffers(GLsizei n, GLuint* buffers) {
+	called(NULLGL_glGenBuffers);
+	genObjects(NULLGL_glGenBuffers, n, buffers, OBJECT_BUFFER);
+}
+
+static void CODEGEN_FUNCPTR null_glGenFramebuffers(GLsizei n, GLuint* framebuffers) {
+	called(NULLGL_glGenFramebuffers);
+	genObjects(NULLGL_glGenFramebuffers, n, framebuffers, OBJECT_FRAMEBUFFER);
+}
+
+static void CODEGEN_FUNCPTR null_glGenQueries(GLsizei n, GLuint* ids) {
+	called(NULLGL_glGenQueries);
+	genObjects(NULLGL_glGenQueries, n, ids, OBJECT_QUERY);
+}
+
+static void CODEGEN_FUNCPTR null_glGenTextures(GLsizei n, GLuint* textures) {
+	called(NULLGL_glGenTextures);
+	genObjects(NULLGL_glGenTextures, n, textures, OBJECT_TEXTURE);
+}
+
+static void CODEGEN_FUNCPTR null_glGenVertexArrays(GLsizei n, GLuint* arrays) {
+	called(NULLGL_glGenVertexArrays);
+	genObjects(NULLGL_glGenVertexArrays, n, arrays, OBJECT_VERTEX_ARRAY);
+}
+
+static void CODEGEN_FUNCPTR null_glGenerateMipmap(GLenum target) {
+	called(NULLGL_glGenerateMipmap);
+	checkBoundTexture(NULLGL_glGenerateMipmap, target);
+}
+
+static GLint CODEGEN_FUNCPTR null_glGetAttribLocation(GLuint program, const GLchar* name) {
+	called(NULLGL_glGetAttribLocation);
+	NullObject* programObject = findObject(program, OBJECT_PROGRAM);
+	if (programObject == nullptr || !programObject->linked) {
+		fail(NULLGL_glGetAttribLocation, GL_INVALID_OPERATION, "%u is not a linked program", program);
+		return -1;
+	}
+	auto inserted = programObject->attributes.insert(std::make_pair(std::string(name), (GLint)programObject->attributes.size()));
+	return inserted.first->second;
+}
+
+static void CODEGEN_FUNCPTR null_glGetBooleanv(GLenum pname, GLboolean* data) {
+	called(NULLGL_glGetBooleanv);
+	GLint64 values[4];
+	unsigned int count = getIntegers(pname, values);
+	for (unsigned int i = 0; i < count; i++)
+		data[i] = values[i] != 0 ? GL_TRUE : GL_FALSE;
+}
+
+static GLenum CODEGEN_FUNCPTR null_glGetError() {
+	called(NULLGL_glGetError);
+	GLenum error = s_state.error;
+	s_state.error = GL_NO_ERROR;
+	return error;
+}
+
+static void CODEGEN_FUNCPTR null_glGetFloatv(GLenum pname, GLfloat* data) {
+	called(NULLGL_glGetFloatv);
+	if (pname == GL_COLOR_CLEAR_VALUE) {
+		memcpy(data, s_state.clearColour, sizeof(s_state.clearColour));
+		return;
+	}
+	GLint64 values[4];
+	unsigned int count = getIntegers(pname, values);
+	for (unsigned int i = 0; i < count; i++)
+		data[i] = (GLfloat)values[i];
+}
+
+static void CODEGEN_FUNCPTR null_glGetInteger64v(GLenum pname, GLint64* data) {
+	called(NULLGL_glGetInteger64v);
+	getIntegers(pname, data);
+}
+
+static void CODEGEN_FUNCPTR null_glGetIntegerv(GLenum pname, GLint* data) {
+	called(NULLGL_glGetIntegerv);
+	GLint64 values[4];
+	unsigned int count = getIntegers(pname, values);
+	for (unsigned int i = 0; i < count; i++)
+		data[i] = (GLint)values[i];
+}
+
+static void CODEGEN_FUNCPTR null_glGetProgramInfoLog(GLuint /*program*/, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+	called(NULLGL_glGetProgramInfoLog);
+	if (length != nullptr) *length = 0;
+	if (infoLog != nullptr && bufSize > 0) infoLog[0] = 0;
+}
+
+static void CODEGEN_FUNCPTR null_glGetProgramiv(GLuint program, GLenum pname, GLint* params) {
+	called(NULLGL_glGetProgramiv);
+	NullObject* programObject = findObject(program, OBJECT_PROGRAM);
+	if (programObject == nullptr) {
+		fail(NULLGL_glGetProgramiv, GL_INVALID_VALUE, "%u is not a program", program);
+		return;
+	}
+	switch (pname) {
+	case GL_LINK_STATUS:		*params = programObject->linked ? GL_TRUE : GL_FALSE; break;
+	case GL_ATTACHED_SHADERS:	*params = (GLint)programObject->attachedShaders; break;
+	default:					*params = 0; break;
+	}
+}
+
+static void CODEGEN_FUNCPTR null_glGetQueryObjectiv(GLuint /*id*/, GLenum pname, GLint* params) {
+	called(NULLGL_glGetQueryObjectiv);
+	*params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void CODEGEN_FUNCPTR null_glGetQueryObjectui64v(GLuint /*id*/, GLenum pname, GLuint64* params) {
+	called(NULLGL_glGetQueryObjectui64v);
+	*params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void CODEGEN_FUNCPTR null_glGetQueryObjectuiv(GLuint /*id*/, GLenum pname, GLuint* params) {
+	called(NULLGL_glGetQueryObjectuiv);
+	*params = pname == GL_QUERY_RESULT_AVAILABLE ? GL_TRUE : 0;
+}
+
+static void CODEGEN_FUNCPTR null_glGetShaderInfoLog(GLuint /*shader*/, GLsizei bufSize, GLsizei* length, GLchar* infoLog) {
+	called(NULLGL_glGetShaderInfoLog);
+	if (length != nullptr) *length = 0;
+	if (infoLog != nullptr && bufSize > 0) infoLog[0] = 0;
+}
+
+static void CODEGEN_FUNCPTR null_glGetShaderiv(GLuint shader, GLenum pname, GLint* params) {
+	called(NULLGL_glGetShaderiv);
+	NullObject* shaderObject = findObject(shader, OBJECT_SHADER);
+	if (shaderObject == nullptr) {
+		fail(NULLGL_glGetShaderiv, GL_INVALID_VALUE, "%u is not a shader", shader);
+		return;
+	}
+	switch (pname) {
+	case GL_COMPILE_STATUS:	*params = GL_TRUE; break;
+	case GL_SHADER_TYPE:	*params = (GLint)shaderObject->shaderType; break;
+	default:				*params = 0; break;
+	}
+}
+
+static const GLubyte* CODEGEN_FUNCPTR null_glGetString(GLenum name) {
+	called(NULLGL_glGetString);
+	switch (name) {
+	case GL_VENDOR:						return (const GLubyte*)"aie";
+	case GL_RENDERER:					return (const GLubyte*)"NullGL";
+	case GL_VERSION:					return (const GLubyte*)"4.6.0 NullGL";
+	case GL_SHADING_LANGUAGE_VERSION:	return (const GLubyte*)"4.60 NullGL";
+	default:
+		fail(NULLGL_glGetString, GL_INVALID_ENUM, "unknown name 0x%04X", name);
+		return nullptr;
+	}
+}
+
+static const GLubyte* CODEGEN_FUNCPTR null_glGetStringi(GLenum name, GLuint index) {
+	called(NULLGL_glGetStringi);
+	if (name != GL_EXTENSIONS) {
+		fail(NULLGL_glGetStringi, GL_INVALID_ENUM, "unknown name 0x%04X", name);
+		return nullptr;
+	}
+	if (index >= EXTENSION_COUNT) {
+		fail(NULLGL_glGetStringi, GL_INVALID_VALUE, "index %u out of range", index);
+		return nullptr;
+	}
+	return (const GLubyte*)extensions[index];
+}
+
+static GLuint CODEGEN_FUNCPTR null_glGetUniformBlockIndex(GLuint program, const GLchar* uniformBlockName) {
+	called(NULLGL_glGetUniformBlockIndex);
+	NullObject* programObject = findObject(program, OBJECT_PROGRAM);
+	if (programObject == nullptr || !programObject->linked) {
+		fail(NULLGL_glGetUniformBlockIndex, GL_INVALID_OPERATION, "%u is not a linked program", program);
+		return GL_INVALID_INDEX;
+	}
+	auto inserted = programObject->blocks.insert(std::make_pair(std::string(uniformBlockName), (GLuint)programObject->blocks.size()));
+	return inserted.first->second;
+}
+
+static GLint CODEGEN_FUNCPTR null_glGetUniformLocation(GLuint program, const GLchar* name) {
+	called(NULLGL_glGetUniformLocation);
+	NullObject* programObject = findObject(program, OBJECT_PROGRAM);
+	if (programObject == nullptr || !programObject->linked) {
+		fail(NULLGL_glGetUniformLocation, GL_INVALID_OPERATION, "%u is not a linked program", program);
+		return -1;
+	}
+	auto inserted = programObject->uniforms.insert(std::make_pair(std::string(name), (GLint)programObject->uniforms.size()));
+	return inserted.first->second;
+}
+
+static GLboolean CODEGEN_FUNCPTR null_glIsEnabled(GLenum cap) {
+	called(NULLGL_glIsEnabled);
+	return s_state.enabled.count(cap) != 0 ? GL_TRUE : GL_FALSE;
+}
+
+static void CODEGEN_FUNCPTR null_glLinkProgram(GLuint program) {
+	called(NULLGL_glLinkProgram);
+	NullObject* programObject = findObject(program, OBJECT_PROGRAM);
+	if (programObject == nullptr)
+		fail(NULLGL_glLinkProgram, GL_INVALID_VALUE, "%u is not a program", program);
+	else
+		programObject->linked = programObject->attachedShaders > 0;
+}
+
+static void* CODEGEN_FUNCPTR null_glMapBufferRange(GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield /*access*/) {
+	called(NULLGL_glMapBufferRange);
+	NullObject* buffer = boundBuffer(NULLGL_glMapBufferRange, target);
+	if (buffer == nullptr)
+		return nullptr;
+	if (offset < 0 || length <= 0 || offset + length > buffer->size) {
+		fail(NULLGL_glMapBufferRange, GL_INVALID_VALUE, "range %lld+%lld outside a %lld byte buffer",
+			(long long)offset, (long long)length, (long long)buffer->size);
+		return nullptr;
+	}
+	if (buffer->mapped) {
+		fail(NULLGL_glMapBufferRange, GL_INVALID_OPERATION, "buffer is already mapped");
+		return nullptr;
+	}
+	if (buffer->storage.size() != (size_t)buffer->size)
+		buffer->storage.resize((size_t)buffer->size);
+	buffer->mapped = true;
+	return buffer->storage.data() + offset;
+}
+
+static void CODEGEN_FUNCPTR null_glMemoryBarrier(GLbitfield /*barriers*/) {
+	called(NULLGL_glMemoryBarrier);
+}
+
+static void CODEGEN_FUNCPTR null_glMultiDrawElementsIndirect(GLenum /*mode*/, GLenum /*type*/, const void* /*indirect*/, GLsizei drawcount, GLsizei /*stride*/) {
+	called(NULLGL_glMultiDrawElementsIndirect);
+	if (!checkDraw(NULLGL_glMultiDrawElementsIndirect, drawcount))
+		return;
+	if (s_state.buffers[GL_DRAW_INDIRECT_BUFFER] == 0)
+		fail(NULLGL_glMultiDrawElementsIndirect, GL_INVALID_OPERATION, "no draw indirect buffer bound");
+	else
+		s_state.drawCalls += (unsigned int)drawcount;
+}
+
+static void CODEGEN_FUNCPTR null_glPolygonOffset(GLfloat /*factor*/, GLfloat /*units*/) {
+	called(NULLGL_glPolygonOffset);
+}
+
+static void CODEGEN_FUNCPTR null_glQueryCounter(GLuint id, GLenum /*target*/) {
+	called(NULLGL_glQueryCounter);
+	if (findObject(id, OBJECT_QUERY) == nullptr)
+		fail(NULLGL_glQueryCounter, GL_INVALID_OPERATION, "%u is not a query", id);
+}
+
+static void CODEGEN_FUNCPTR null_glReadBuffer(GLenum /*src*/) {
+	called(NULLGL_glReadBuffer);
+}
+
+static void CODEGEN_FUNCPTR null_glScissor(GLint x, GLint y, GLsizei width, GLsizei height) {
+	called(NULLGL_glScissor);
+	s_state.scissor[0] = x;
+	s_state.scissor[1] = y;
+	s_state.scissor[2] = width;
+	s_state.scissor[3] = height;
+}
+
+static void CODEGEN_FUNCPTR null_glShaderSource(GLuint shader, GLsizei /*count*/, const GLchar* const* /*string*/, const GLint* /*length*/) {
+	called(NULLGL_glShaderSource);
+	checkName(NULLGL_glShaderSource, shader, OBJECT_SHADER);
+}
+
+static void CODEGEN_FUNCPTR null_glTexImage2D(GLenum target, GLint /*level*/, GLint /*internalformat*/, GLsizei width, GLsizei height,
+											 GLint /*border*/, GLenum /*format*/, GLenum /*type*/, const GLvoid* /*pixels*/) {
+	called(NULLGL_glTexImage2D);
+	if (width < 0 || height < 0 || width > 16384 || height > 16384)
+		fail(NULLGL_glTexImage2D, GL_INVALID_VALUE, "size %dx%d", width, height);
+	else
+		checkBoundTexture(NULLGL_glTexImage2D, target);
+}
+
+static void CODEGEN_FUNCPTR null_glTexParameterfv(GLenum target, GLenum /*pname*/, const GLfloat* /*params*/) {
+	called(NULLGL_glTexParameterfv);
+	checkBoundTexture(NULLGL_glTexParameterfv, target);
+}
+
+static void CODEGEN_FUNCPTR null_glTexParameteri(GLenum target, GLenum /*pname*/, GLint /*param*/) {
+	called(NULLGL_glTexParameteri);
+	checkBoundTexture(NULLGL_glTexParameteri, target);
+}
+
+static void CODEGEN_FUNCPTR null_glTexStorage2D(GLenum target, GLsizei levels, GLenum /*internalformat*/, GLsizei width, GLsizei height) {
+	called(NULLGL_glTexStorage2D);
+	if (levels < 1 || width < 1 || height < 1)
+		fail(NULLGL_glTexStorage2D, GL_INVALID_VALUE, "%d levels of %dx%d", levels, width, height);
+	else
+		checkBoundTexture(NULLGL_glTexStorage2D, target);
+}
+
+static void CODEGEN_FUNCPTR null_glTexStorage3D(GLenum target, GLsizei levels, GLenum /*internalformat*/, GLsizei width, GLsizei height, GLsizei depth) {
+	called(NULLGL_glTexStorage3D);
+	if (levels < 1 || width < 1 || height < 1 || depth < 1)
+		fail(NULLGL_glTexStorage3D, GL_INVALID_VALUE, "%d levels of %dx%dx%d", levels, width, height, depth);
+	else
+		checkBoundTexture(NULLGL_glTexStorage3D, target);
+}
+
+static void CODEGEN_FUNCPTR null_glUniform1f(GLint location, GLfloat /*v0*/) {
+	called(NULLGL_glUniform1f);
+	checkUniform(NULLGL_glUniform1f, location, 1);
+}
+
+static void CODEGEN_FUNCPTR null_glUniform1fv(GLint location, GLsizei count, const GLfloat* /*value*/) {
+	called(NULLGL_glUniform1fv);
+	checkUniform(NULLGL_glUniform1fv, location, count);
+}
+
+static void CODEGEN_FUNCPTR null_glUniform1i(GLint location, GLint /*v0*/) {
+	called(NULLGL_glUniform1i);
+	checkUniform(NULLGL_glUniform1i, location, 1);
+}
+
+static void CODEGEN_FUNCPTR null_glUniform1iv(GLint location, GLsizei count, const GLint* /*value*/) {
+	called(NULLGL_glUniform1iv);
+	checkUniform(NULLGL_glUniform1iv, location, count);
+}
+
+static void CODEGEN_FUNCPTR null_glUniform2f(GLint location, GLfloat /*v0*/, GLfloat /*v1*/) {
+	called(NULLGL_glUniform2f);
+	checkUniform(NULLGL_glUniform2f, location, 1);
+}
+
+static void CODEGEN_FUNCPTR null_glUniform2fv(GLint location, GLsizei count, const GLfloat* /*value*/) {
+	called(NULLGL_glUniform2fv);
+	checkUniform(NULLGL_glUniform2fv, location, count);
+}
+
+static void CODEGEN_FUNCPTR null_glUniform3f(GLint location, GLfloat /*v0*/, GLfloat /*v1*/, GLfloat /*v2*/) {
+	called(NULLGL_glUniform3f);
+	checkUniform(NULLGL_glUniform3f, location, 1);
+}
+
+static void CODEGEN_FUNCPTR null_glUniform3fv(GLint location, GLsizei count, const GLfloat* /*value*/) {
+	called(NULLGL_glUniform3fv);
+	checkUniform(NULLGL_glUniform3fv, location, count);
+}
+
+static void CODEGEN_FUNCPTR null_glUniform4f(GLint location, GLfloat /*v0*/, GLfloat /*v1*/, GLfloat /*v2*/, GLfloat /*v3*/) {
+	called(NULLGL_glUniform4f);
+	checkUniform(NULLGL_glUniform4f, location, 1);
+}
+
+static void CODEGEN_FUNCPTR null_glUniform4fv(GLint location, GLsizei count, const GLfloat* /*value*/) {
+	called(NULLGL_glUniform4fv);
+	checkUniform(NULLGL_glUniform4fv, location, count);
+}
+
+static void CODEGEN_FUNCPTR null_glUniformBlockBinding(GLuint program, GLuint uniformBlockIndex, GLuint /*uniformBlockBinding*/) {
+	called(NULLGL_glUniformBlockBinding);
+	NullObject* programObject = findObject(program, OBJECT_PROGRAM);
+	if (programObject == nullptr || uniformBlockIndex >= programObject->blocks.size())
+		fail(NULLGL_glUniformBlockBinding, GL_INVALID_VALUE, "block %u is not in program %u", uniformBlockIndex, program);
+}
+
+static void CODEGEN_FUNCPTR null_glUniformMatrix2fv(GLint location, GLsizei count, GLboolean /*transpose*/, const GLfloat* /*value*/) {
+	called(NULLGL_glUniformMatrix2fv);
+	checkUniform(NULLGL_glUniformMatrix2fv, location, count);
+}
+
+static void CODEGEN_FUNCPTR null_glUniformMatrix3fv(GLint location, GLsizei count, GLboolean /*transpose*/, const GLfloat* /*value*/) {
+	called(NULLGL_glUniformMatrix3fv);
+	checkUniform(NULLGL_glUniformMatrix3fv, location, count);
+}
+
+static void CODEGEN_FUNCPTR null_glUniformMatrix4fv(GLint location, GLsizei count, GLboolean /*transpose*/, const GLfloat* /*value*/) {
+	called(NULLGL_glUniformMatrix4fv);
+	checkUniform(NULLGL_glUniformMatrix4fv, location, count);
+}
+
+static GLboolean CODEGEN_FUNCPTR null_glUnmapBuffer(GLenum target) {
+	called(NULLGL_glUnmapBuffer);
+	NullObject* buffer = boundBuffer(NULLGL_glUnmapBuffer, target);
+	if (buffer == nullptr)
+		return GL_FALSE;
+	if (!buffer->mapped) {
+		fail(NULLGL_glUnmapBuffer, GL_INVALID_OPERATION, "buffer is not mapped");
+		return GL_FALSE;
+	}
+	buffer->mapped = false;
+	return GL_TRUE;
+}
+
+static void CODEGEN_FUNCPTR null_glUseProgram(GLuint program) {
+	called(NULLGL_glUseProgram);
+	if (!checkName(NULLGL_glUseProgram, program, OBJECT_PROGRAM))
+		return;
+	if (program != 0 && !findObject(program, OBJECT_PROGRAM)->linked)
+		fail(NULLGL_glUseProgram, GL_INVALID_OPERATION, "program %u is not linked", program);
+	else
+		s_state.program = program;
+}
+
+static void CODEGEN_FUNCPTR null_glVertexAttribPointer(GLuint /*index*/, GLint size, GLenum /*type*/, GLboolean /*normalized*/, GLsizei stride, const GLvoid* /*pointer*/) {
+	called(NULLGL_glVertexAttribPointer);
+	if (s_state.vertexArray == 0)
+		fail(NULLGL_glVertexAttribPointer, GL_INVALID_OPERATION, "no vertex array bound");
+	else if (s_state.buffers[GL_ARRAY_BUFFER] == 0)
+		fail(NULLGL_glVertexAttribPointer, GL_INVALID_OPERATION, "no array buffer bound");
+	else if (size < 1 || size > 4 || stride < 0)
+		fail(NULLGL_glVertexAttribPointer, GL_INVALID_VALUE, "size %d, stride %d", size, stride);
+}
+
+static void CODEGEN_FUNCPTR null_glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+	called(NULLGL_glViewport);
+	if (width < 0 || height < 0) {
+		fail(NULLGL_glViewport, GL_INVALID_VALUE, "size %dx%d", width, height);
+		return;
+	}
+	s_state.viewport[0] = x;
+	s_state.viewport[1] = y;
+	s_state.viewport[2] = width;
+	s_state.viewport[3] = height;
+}
+
+static void* const nullFunctions[NULLGL_FUNCTION_COUNT] = {
+#define NULL_GL_POINTER(name) (void*)null_##name,
+	NULL_GL_FUNCTIONS(NULL_GL_POINTER)
+#undef NULL_GL_POINTER
+};
+
+static int findFunction(const char* name) {
+	for (unsigned int i = 0; i < NULLGL_FUNCTION_COUNT; i++) {
+		if (strcmp(functionNames[i], name) == 0)
+			return (int)i;
+	}
+	return -1;
+}
+
+bool NullGL::install() {
+	if (s_state.installed)
+		return false;
+
+	// a fresh context: no objects, default state, no counts
+	s_state = NullGLState();
+	s_state.installed = true;
+
+	// assigned directly, so the compiler checks every signature against gl_core_4_4.h
+#define NULL_GL_INSTALL(name) s_state.driverFunctions[NULLGL_##name] = (void*)_ptrc_##name; _ptrc_##name = null_##name;
+	NULL_GL_FUNCTIONS(NULL_GL_INSTALL)
+#undef NULL_GL_INSTALL
+	return true;
+}
+
+void NullGL::uninstall() {
+	if (!s_state.installed)
+		return;
+
+#define NULL_GL_RESTORE(name) _ptrc_##name = (decltype(_ptrc_##name))s_state.driverFunctions[NULLGL_##name];
+	NULL_GL_FUNCTIONS(NULL_GL_RESTORE)
+#undef NULL_GL_RESTORE
+	s_state.installed = false;
+}
+
+bool NullGL::isInstalled() {
+	return s_state.installed;
+}
+
+void* NullGL::getProcAddress(const char* name) {
+	// like a driver without the function: a stub can't stand in for an arbitrary signature
+	// (with __stdcall the callee pops the arguments), so a call faults where it is made
+	int function = findFunction(name);
+	return function >= 0 ? nullFunctions[function] : nullptr;
+}
+
+unsigned int NullGL::getCallCount(const char* name) {
+	int function = findFunction(name);
+	return function >= 0 ? s_state.calls[function] : 0;
+}
+
+unsigned int NullGL::getTotalCallCount() {
+	return s_state.totalCalls;
+}
+
+unsigned int NullGL::getDrawCallCount() {
+	return s_state.drawCalls;
+}
+
+unsigned int NullGL::getErrorCount() {
+	return s_state.errorCount;
+}
+
+const char* NullGL::getLastError() {
+	return s_state.lastError.c_str();
+}
+
+void NullGL::resetCounts() {
+	memset(s_state.calls, 0, sizeof(s_state.calls));
+	s_state.totalCalls = 0;
+	s_state.drawCalls = 0;
+	s_state.errorCount = 0;
+}
+
+void NullGL::setRecording(bool recording) {
+	s_state.recording = recording;
+}
+
+const std::vector<const char*>& NullGL::getRecordedCalls() {
+	return s_state.recordedCalls;
+}
+
+void NullGL::clearRecordedCalls() {
+	s_state.recordedCalls.clear();
+}
+
+} // namespace aie
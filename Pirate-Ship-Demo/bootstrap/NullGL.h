@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+
+namespace aie {
+
+// a GL backend that does nothing, for measuring the CPU side of rendering apart from the
+// driver's cost, and for running where there is no GPU or context
+// installing it points the gl_core_4_4 entry points at functions that check their
+// arguments against the objects and bindings made so far, count the call and give back
+// plausible results (shaders compile, framebuffers are complete, mapped buffers are real
+// memory), but never draw anything. other loaders reach the same functions through
+// getProcAddress(), e.g. gladLoadGLLoader((GLADloadproc)NullGL::getProcAddress)
+// like a context, it must only be called from the thread it was installed on
+// (see Application::setGLBackend)
+class NullGL {
+public:
+
+	// swaps the gl_core_4_4 entry points for the null ones; false if already installed
+	static bool install();
+
+	// puts back the entry points that were there before install()
+	static void uninstall();
+
+	static bool isInstalled();
+
+	// the null function for an entry point, or nullptr for one the engine does not use,
+	// as a driver without it would give (the gl_core_4_4 pointers for those stay null too)
+	static void* getProcAddress(const char* name);
+
+	// calls made since install() or the last resetCounts(); 0 for an unknown name
+	static unsigned int getCallCount(const char* name);
+	static unsigned int getTotalCallCount();
+	static unsigned int getDrawCallCount();
+
+	// calls that failed validation; each also sets the error glGetError() reports and
+	// the first failure of each function is printed
+	static unsigned int getErrorCount();
+	static const char* getLastError();
+
+	static void resetCounts();
+
+	// while recording, the name of every call made is kept in order
+	static void setRecording(bool recording);
+	static const std::vector<const char*>& getRecordedCalls();
+	static void clearRecordedCalls();
+};
+
+} // namespace aie
@@ -0,0 +1,625 @@
+#include "Profiler.h"
+
+#ifdef AIE_PROFILER
+
+#include "gl_core_4_4.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+#include <imgui.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace aie {
+
+// scopes nested deeper are still balanced but not recorded
+static const unsigned int MAX_DEPTH = 64;
+
+// frame boundaries kept, for writing the latest frames
+static const unsigned int FRAME_MARKS = 1024;
+
+// counter samples kept, a handful each frame
+static const unsigned int COUNTER_SAMPLES = 16384;
+
+// GPU scopes kept for traces, already moved onto the CPU timeline
+static const unsigned int GPU_RECORDS = 8192;
+
+// how often the GPU clock is matched against the CPU's, in seconds
+static const double GPU_CLOCK_SYNC_INTERVAL = 1.0;
+
+// a thread's recent scopes
+// only the owning thread writes; any thread can read, checking afterwards that the
+// records it copied were not overwritten meanwhile, so neither side waits on the other
+struct ThreadBuffer {
+	std::string							name;
+	unsigned int						id;
+	std::atomic<unsigned long long>		written;	// records ever written, the ring holds the latest
+	Profiler::Record					records[Profiler::RING_RECORDS];
+
+	// open scopes, only touched by the owning thread
+	const char*							openNames[MAX_DEPTH];
+	unsigned long long					openStarts[MAX_DEPTH];
+	unsigned int						depth;
+};
+
+struct GpuRange {
+	const char*		name;
+	unsigned int	depth;
+	GLuint			startQuery;
+	GLuint			endQuery;
+};
+
+struct GpuFrame {
+	std::vector<GpuRange> ranges;
+	GLuint			lastQuery = 0;	// issued last, so available last
+	bool			pending = false;
+};
+
+struct FrameMark {
+	unsigned int		number;
+	unsigned long long	start;
+	unsigned long long	end;
+};
+
+struct CounterSample {
+	const char*			name;
+	unsigned long long	time;
+	double				value;
+};
+
+// a scope in the ImGui tree, merged with its siblings of the same name
+struct ViewNode {
+	const char*		name;
+	double			time;	// milliseconds
+	unsigned int	calls;
+	std::vector<unsigned int> children;
+};
+
+struct ProfilerState {
+	std::mutex			threadsMutex;	// only taken to add a thread, and to list them
+	std::vector<ThreadBuffer*> threads;
+
+	std::mutex			namesMutex;
+	std::unordered_set<std::string> names;
+
+	// the timestamp counter's rate, refined as frames go by
+	unsigned long long	clockStartTicks = 0;
+	std::chrono::steady_clock::time_point clockStartTime;
+	double				ticksPerSecond = 0;
+
+	unsigned int		frameNumber = 0;
+	unsigned long long	frameStart = 0;
+	bool				inFrame = false;
+	FrameMark			frames[FRAME_MARKS] = {};
+	unsigned int		frameCount = 0;
+
+	CounterSample		counters[COUNTER_SAMPLES] = {};
+	unsigned long long	counterCount = 0;
+
+	std::vector<GLuint>	queries;		// two per scope per frame in flight
+	GpuFrame			gpuFrames[Profiler::GPU_FRAME_LATENCY];
+	unsigned int		gpuSlot = 0;
+	std::vector<unsigned int> gpuOpen;	// range of each open GPU scope, or ~0u without queries
+	Profiler::Record	gpuRecords[GPU_RECORDS] = {};
+	unsigned long long	gpuWritten = 0;
+	std::vector<Profiler::Record> lastGpuFrame;
+
+	// a GPU timestamp and the CPU ticks at the same moment
+	long long			gpuSyncNanoseconds = 0;
+	unsigned long long	gpuSyncTicks = 0;
+	bool				gpuSynced = false;
+
+	bool				paused = false;
+	std::vector<ViewNode> cpuView;
+	std::vector<ViewNode> gpuView;
+	std::vector<std::pair<std::string, double>> threadView;	// other threads' busy time
+
+	~ProfilerState() {
+		for (ThreadBuffer* buffer : threads)
+			delete buffer;
+	}
+};
+
+static ProfilerState s_profiler;
+static thread_local ThreadBuffer* t_buffer = nullptr;
+
+static unsigned long long readTicks() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return (unsigned long long)std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// a first estimate of the counter's rate, from a short spin
+static void calibrateClock() {
+	static std::once_flag calibrated;
+	std::call_once(calibrated, []() {
+		s_profiler.clockStartTime = std::chrono::steady_clock::now();
+		s_profiler.clockStartTicks = readTicks();
+		std::chrono::steady_clock::time_point time;
+		do {
+			time = std::chrono::steady_clock::now();
+		} while (time - s_profiler.clockStartTime < std::chrono::milliseconds(10));
+		double seconds = std::chrono::duration<double>(time - s_profiler.clockStartTime).count();
+		s_profiler.ticksPerSecond = (readTicks() - s_profiler.clockStartTicks) / seconds;
+	});
+}
+
+// later estimates average over everything since the first
+static void refineClock() {
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - s_profiler.clockStartTime).count();
+	if (seconds > 1.0)
+		s_profiler.ticksPerSecond = (readTicks() - s_profiler.clockStartTicks) / seconds;
+}
+
+static ThreadBuffer& threadBuffer() {
+	if (t_buffer == nullptr) {
+		calibrateClock();
+		ThreadBuffer* buffer = new ThreadBuffer();
+		buffer->written = 0;
+		buffer->depth = 0;
+
+		std::lock_guard<std::mutex> lock(s_profiler.threadsMutex);
+		buffer->id = (unsigned int)s_profiler.threads.size();
+		buffer->name = "Thread " + std::to_string(buffer->id);
+		s_profiler.threads.push_back(buffer);
+		t_buffer = buffer;
+	}
+	return *t_buffer;
+}
+
+static void write(ThreadBuffer& buffer, const Profiler::Record& record) {
+	unsigned long long index = buffer.written.load(std::memory_order_relaxed);
+	buffer.records[index & (Profiler::RING_RECORDS - 1)] = record;
+	buffer.written.store(index + 1, std::memory_order_release);
+}
+
+// copies the records that ended at or after `from`, oldest first
+// records end in the order they are written, so the search stops at the first older one
+static void collect(ThreadBuffer& buffer, unsigned long long from, std::vector<Profiler::Record>& out) {
+	unsigned long long written = buffer.written.load(std::memory_order_acquire);
+	unsigned long long oldest = written > Profiler::RING_RECORDS ? written - Profiler::RING_RECORDS : 0;
+
+	size_t first = out.size();
+	unsigned long long index = written;
+	while (index > oldest) {
+		const Profiler::Record& record = buffer.records[(index - 1) & (Profiler::RING_RECORDS - 1)];
+		if (record.end < from)
+			break;
+		out.push_back(record);
+		index--;
+	}
+
+	// the owning thread may have lapped the oldest records while they were copied
+	unsigned long long after = buffer.written.load(std::memory_order_acquire);
+	if (after > Profiler::RING_RECORDS && after - Profiler::RING_RECORDS > index) {
+		size_t overwritten = (size_t)std::min<unsigned long long>(after - Profiler::RING_RECORDS - index, out.size() - first);
+		out.resize(out.size() - overwritten);
+	}
+	std::reverse(out.begin() + first, out.end());
+}
+
+unsigned long long Profiler::now() {
+	return readTicks();
+}
+
+double Profiler::getTicksPerSecond() {
+	calibrateClock();
+	return s_profiler.ticksPerSecond;
+}
+
+double Profiler::toMilliseconds(unsigned long long ticks) {
+	return ticks * 1000.0 / getTicksPerSecond();
+}
+
+void Profiler::begin(const char* name) {
+	ThreadBuffer& buffer = threadBuffer();
+	if (buffer.depth < MAX_DEPTH) {
+		buffer.openNames[buffer.depth] = name;
+		buffer.openStarts[buffer.depth] = readTicks();
+	}
+	buffer.depth++;
+}
+
+void Profiler::end() {
+	ThreadBuffer& buffer = threadBuffer();
+	if (buffer.depth == 0)
+		return;
+	buffer.depth--;
+	if (buffer.depth < MAX_DEPTH) {
+		Record record = { buffer.openNames[buffer.depth], buffer.openStarts[buffer.depth], readTicks(), buffer.depth };
+		write(buffer, record);
+	}
+}
+
+void Profiler::record(const char* name, unsigned long long start, unsigned long long end) {
+	ThreadBuffer& buffer = threadBuffer();
+	Record record = { name, start, end, buffer.depth };
+	write(buffer, record);
+}
+
+void Profiler::counter(const char* name, double value) {
+	CounterSample sample = { name, readTicks(), value };
+	s_profiler.counters[s_profiler.counterCount++ % COUNTER_SAMPLES] = sample;
+}
+
+void Profiler::beginGpu(const char* name) {
+	begin(name);
+	if (glPushDebugGroup != nullptr)
+		glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+
+	GpuFrame& frame = s_profiler.gpuFrames[s_profiler.gpuSlot];
+	if (s_profiler.queries.empty() || !s_profiler.inFrame || frame.ranges.size() >= MAX_GPU_SCOPES) {
+		s_profiler.gpuOpen.push_back(~0u); // keeps begin / end balanced
+		return;
+	}
+
+	unsigned int base = (s_profiler.gpuSlot * MAX_GPU_SCOPES + (unsigned int)frame.ranges.size()) * 2;
+	GpuRange range = { name, (unsigned int)s_profiler.gpuOpen.size(), s_profiler.queries[base], s_profiler.queries[base + 1] };
+	glQueryCounter(range.startQuery, GL_TIMESTAMP);
+	s_profiler.gpuOpen.push_back((unsigned int)frame.ranges.size());
+	frame.ranges.push_back(range);
+}
+
+void Profiler::endGpu() {
+	if (!s_profiler.gpuOpen.empty()) {
+		unsigned int range = s_profiler.gpuOpen.back();
+		s_profiler.gpuOpen.pop_back();
+		if (range != ~0u) {
+			GpuFrame& frame = s_profiler.gpuFrames[s_profiler.gpuSlot];
+			glQueryCounter(frame.ranges[range].endQuery, GL_TIMESTAMP);
+			frame.lastQuery = frame.ranges[range].endQuery;
+		}
+	}
+
+	if (glPopDebugGroup != nullptr)
+		glPopDebugGroup();
+	end();
+}
+
+const char* Profiler::intern(const std::string& name) {
+	std::lock_guard<std::mutex> lock(s_profiler.namesMutex);
+	return s_profiler.names.insert(name).first->c_str();
+}
+
+void Profiler::setThreadName(const char* name) {
+	ThreadBuffer& buffer = threadBuffer();
+	std::lock_guard<std::mutex> lock(s_profiler.threadsMutex);
+	buffer.name = name;
+}
+
+// moves a GPU timestamp onto the CPU timeline
+static unsigned long long gpuToTicks(GLuint64 nanoseconds) {
+	double ticks = (double)s_profiler.gpuSyncTicks +
+		((double)nanoseconds - (double)s_profiler.gpuSyncNanoseconds) * s_profiler.ticksPerSecond / 1e9;
+	return ticks > 0 ? (unsigned long long)ticks : 0;
+}
+
+// collects a frame's GPU times, unless the GPU has not finished it yet, in which case
+// they are dropped rather than waited for
+static void resolveGpuFrame(GpuFrame& frame) {
+	if (!frame.pending || frame.ranges.empty()) {
+		frame.pending = false;
+		return;
+	}
+
+	GLint available = 0;
+	glGetQueryObjectiv(frame.lastQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+	if (available) {
+		s_profiler.lastGpuFrame.clear();
+		for (const GpuRange& range : frame.ranges) {
+			GLuint64 start = 0, end = 0;
+			glGetQueryObjectui64v(range.startQuery, GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(range.endQuery, GL_QUERY_RESULT, &end);
+
+			Profiler::Record record = { range.name, gpuToTicks(start), gpuToTicks(end), range.depth };
+			s_profiler.gpuRecords[s_profiler.gpuWritten++ % GPU_RECORDS] = record;
+			s_profiler.lastGpuFrame.push_back(record);
+		}
+	}
+	frame.pending = false;
+}
+
+void Profiler::beginFrame() {
+	calibrateClock();
+	s_profiler.frameStart = readTicks();
+	s_profiler.inFrame = true;
+
+	// queries are made once there is a context to make them with
+	if (s_profiler.queries.empty() && glGenQueries != nullptr) {
+		s_profiler.queries.resize(GPU_FRAME_LATENCY * MAX_GPU_SCOPES * 2);
+		glGenQueries((GLsizei)s_profiler.queries.size(), s_profiler.queries.data());
+	}
+	if (s_profiler.queries.empty())
+		return;
+
+	// the GPU clock is read now and then, as reading it waits for the commands before it
+	if (!s_profiler.gpuSynced || (s_profiler.frameStart - s_profiler.gpuSyncTicks) > GPU_CLOCK_SYNC_INTERVAL * s_profiler.ticksPerSecond) {
+		GLint64 gpuTime = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+		s_profiler.gpuSyncTicks = readTicks();
+		s_profiler.gpuSyncNanoseconds = gpuTime;
+		s_profiler.gpuSynced = true;
+	}
+
+	// the oldest frame's queries are reused now, so collect its results first
+	s_profiler.gpuSlot = (s_profiler.gpuSlot + 1) % GPU_FRAME_LATENCY;
+	GpuFrame& frame = s_profiler.gpuFrames[s_profiler.gpuSlot];
+	resolveGpuFrame(frame);
+	frame.ranges.clear();
+	s_profiler.gpuOpen.clear();
+}
+
+void Profiler::endFrame() {
+	FrameMark mark = { s_profiler.frameNumber, s_profiler.frameStart, readTicks() };
+	s_profiler.frames[s_profiler.frameCount % FRAME_MARKS] = mark;
+	s_profiler.frameCount++;
+	s_profiler.frameNumber++;
+	s_profiler.inFrame = false;
+
+	if (!s_profiler.queries.empty())
+		s_profiler.gpuFrames[s_profiler.gpuSlot].pending = true;
+
+	refineClock();
+}
+
+unsigned int Profiler::getFrameNumber() {
+	return s_profiler.frameNumber;
+}
+
+void Profiler::shutdownGpu() {
+	if (!s_profiler.queries.empty())
+		glDeleteQueries((GLsizei)s_profiler.queries.size(), s_profiler.queries.data());
+	s_profiler.queries.clear();
+	for (GpuFrame& frame : s_profiler.gpuFrames) {
+		frame.ranges.clear();
+		frame.pending = false;
+	}
+	s_profiler.gpuOpen.clear();
+	s_profiler.gpuSynced = false;
+}
+
+// names are written as JSON strings
+static void writeString(FILE* file, const char* text) {
+	fputc('"', file);
+	for (; *text != 0; text++) {
+		if (*text == '"' || *text == '\\')
+			fputc('\\', file);
+		if ((unsigned char)*text >= 0x20)
+			fputc(*text, file);
+	}
+	fputc('"', file);
+}
+
+bool Profiler::writeTrace(const char* filename, unsigned int frames) {
+	unsigned long long from = 0;
+	if (frames > 0 && s_profiler.frameCount > 0) {
+		unsigned int count = std::min(std::min(frames, s_profiler.frameCount), FRAME_MARKS);
+		from = s_profiler.frames[(s_profiler.frameCount - count) % FRAME_MARKS].start;
+	}
+	return writeTraceSince(filename, from);
+}
+
+bool Profiler::writeTraceSince(const char* filename, unsigned long long from) {
+	calibrateClock();
+
+	FILE* file = nullptr;
+	fopen_s(&file, filename, "w");
+	if (file == nullptr) {
+		printf("Failed to write profiler trace: %s\n", filename);
+		return false;
+	}
+
+	// microseconds since the profiler started, as Chrome expects
+	double scale = 1e6 / s_profiler.ticksPerSecond;
+	auto timestamp = [scale](unsigned long long ticks) {
+		return ticks > s_profiler.clockStartTicks ? (ticks - s_profiler.clockStartTicks) * scale : 0.0;
+	};
+	auto writeEvent = [file, &timestamp, scale](const Record& record, unsigned int thread) {
+		fprintf(file, ",\n{ \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f, \"name\": ",
+			thread, timestamp(record.start), record.end > record.start ? (record.end - record.start) * scale : 0.0);
+		writeString(file, record.name);
+		fprintf(file, " }");
+	};
+	auto writeThreadName = [file](unsigned int thread, const char* name, unsigned int sortIndex) {
+		fprintf(file, ",\n{ \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"name\": \"thread_name\", \"args\": { \"name\": ", thread);
+		writeString(file, name);
+		fprintf(file, " } },\n{ \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"name\": \"thread_sort_index\", \"args\": { \"sort_index\": %u } }",
+			thread, sortIndex);
+	};
+
+	fprintf(file, "{ \"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+	fprintf(file, "{ \"ph\": \"M\", \"pid\": 1, \"name\": \"process_name\", \"args\": { \"name\": \"aie\" } }");
+
+	// frames and the GPU get tracks of their own after the threads'
+	std::vector<ThreadBuffer*> threads;
+	{
+		std::lock_guard<std::mutex> lock(s_profiler.threadsMutex);
+		threads = s_profiler.threads;
+		for (ThreadBuffer* buffer : threads)
+			writeThreadName(buffer->id, buffer->name.c_str(), buffer->id + 2);
+	}
+	const unsigned int frameTrack = 1000, gpuTrack = 1001;
+	writeThreadName(frameTrack, "Frames", 0);
+	writeThreadName(gpuTrack, "GPU", 1);
+
+	std::vector<Record> records;
+	for (ThreadBuffer* buffer : threads) {
+		records.clear();
+		collect(*buffer, from, records);
+		for (const Record& record : records) {
+			if (record.start >= from)
+				writeEvent(record, buffer->id);
+		}
+	}
+
+	unsigned int markCount = std::min(s_profiler.frameCount, FRAME_MARKS);
+	for (unsigned int i = s_profiler.frameCount - markCount; i < s_profiler.frameCount; i++) {
+		const FrameMark& mark = s_profiler.frames[i % FRAME_MARKS];
+		if (mark.start < from)
+			continue;
+		char name[32];
+		snprintf(name, sizeof(name), "Frame %u", mark.number);
+		Record record = { name, mark.start, mark.end, 0 };
+		writeEvent(record, frameTrack);
+	}
+
+	unsigned long long gpuCount = std::min<unsigned long long>(s_profiler.gpuWritten, GPU_RECORDS);
+	for (unsigned long long i = s_profiler.gpuWritten - gpuCount; i < s_profiler.gpuWritten; i++) {
+		const Record& record = s_profiler.gpuRecords[i % GPU_RECORDS];
+		if (record.start >= from)
+			writeEvent(record, gpuTrack);
+	}
+
+	unsigned long long counterCount = std::min<unsigned long long>(s_profiler.counterCount, COUNTER_SAMPLES);
+	for (unsigned long long i = s_profiler.counterCount - counterCount; i < s_profiler.counterCount; i++) {
+		const CounterSample& sample = s_profiler.counters[i % COUNTER_SAMPLES];
+		if (sample.time < from)
+			continue;
+		fprintf(file, ",\n{ \"ph\": \"C\", \"pid\": 1, \"ts\": %.3f, \"name\": ", timestamp(sample.time));
+		writeString(file, sample.name);
+		fprintf(file, ", \"args\": { \"value\": %g } }", sample.value);
+	}
+	fprintf(file, "\n] }\n");
+
+	bool written = ferror(file) == 0;
+	fclose(file);
+	if (written)
+		printf("Profiler trace written to %s\n", filename);
+	return written;
+}
+
+// merges scopes (sorted by start) into a tree of totals by name under nodes[0]
+static void buildView(std::vector<Profiler::Record>& records, std::vector<ViewNode>& nodes) {
+	std::sort(records.begin(), records.end(), [](const Profiler::Record& a, const Profiler::Record& b) {
+		return a.start != b.start ? a.start < b.start : a.depth < b.depth;
+	});
+
+	nodes.clear();
+	nodes.push_back({ "", 0.0, 0, {} });
+	if (records.empty())
+		return;
+
+	unsigned int baseDepth = ~0u;
+	for (const Profiler::Record& record : records)
+		baseDepth = std::min(baseDepth, record.depth);
+
+	// path[d + 1] is the node of the open scope at depth d
+	std::vector<unsigned int> path(1, 0);
+	for (const Profiler::Record& record : records) {
+		size_t depth = record.depth - baseDepth;
+		if (path.size() > depth + 1)
+			path.resize(depth + 1);
+
+		unsigned int parent = path.back();
+		unsigned int child = ~0u;
+		for (unsigned int index : nodes[parent].children) {
+			if (strcmp(nodes[index].name, record.name) == 0) {
+				child = index;
+				break;
+			}
+		}
+		if (child == ~0u) {
+			child = (unsigned int)nodes.size();
+			nodes.push_back({ record.name, 0.0, 0, {} });
+			nodes[parent].children.push_back(child);
+		}
+		nodes[child].time += Profiler::toMilliseconds(record.end - record.start);
+		nodes[child].calls++;
+		path.push_back(child);
+	}
+}
+
+static void drawView(const std::vector<ViewNode>& nodes, unsigned int index) {
+	for (unsigned int child : nodes[index].children) {
+		const ViewNode& node = nodes[child];
+		ImGuiTreeNodeFlags flags = ImGuiTreeNodeFlags_DefaultOpen | (node.children.empty() ? ImGuiTreeNodeFlags_Leaf : 0);
+		bool open = node.calls > 1 ?
+			ImGui::TreeNodeEx((void*)(size_t)child, flags, "%-28s %8.3f ms  x%u", node.name, node.time, node.calls) :
+			ImGui::TreeNodeEx((void*)(size_t)child, flags, "%-28s %8.3f ms", node.name, node.time);
+		if (open) {
+			drawView(nodes, child);
+			ImGui::TreePop();
+		}
+	}
+}
+
+// rebuilds the trees from the last completed frame
+static void refreshView() {
+	if (s_profiler.frameCount == 0)
+		return;
+	const FrameMark& frame = s_profiler.frames[(s_profiler.frameCount - 1) % FRAME_MARKS];
+
+	std::vector<Profiler::Record> records;
+	collect(threadBuffer(), frame.start, records);
+	records.erase(std::remove_if(records.begin(), records.end(), [&frame](const Profiler::Record& record) {
+		return record.start < frame.start || record.end > frame.end;
+	}), records.end());
+	buildView(records, s_profiler.cpuView);
+
+	records = s_profiler.lastGpuFrame;
+	buildView(records, s_profiler.gpuView);
+
+	// other threads only show how much of the frame they were busy for
+	std::vector<ThreadBuffer*> threads;
+	{
+		std::lock_guard<std::mutex> lock(s_profiler.threadsMutex);
+		threads = s_profiler.threads;
+		s_profiler.threadView.clear();
+		for (ThreadBuffer* buffer : threads) {
+			if (buffer != t_buffer)
+				s_profiler.threadView.push_back(std::make_pair(buffer->name, 0.0));
+		}
+	}
+	unsigned int view = 0;
+	for (ThreadBuffer* buffer : threads) {
+		if (buffer == t_buffer)
+			continue;
+		records.clear();
+		collect(*buffer, frame.start, records);
+		double busy = 0;
+		for (const Profiler::Record& record : records) {
+			if (record.depth == 0 && record.start < frame.end)
+				busy += Profiler::toMilliseconds(std::min(record.end, frame.end) - std::max(record.start, frame.start));
+		}
+		s_profiler.threadView[view++].second = busy;
+	}
+}
+
+void Profiler::drawImGui() {
+	ImGui::Checkbox("Pause", &s_profiler.paused);
+	ImGui::SameLine();
+	if (ImGui::Button("Save Trace"))
+		writeTrace("profile_trace.json");
+
+	if (!s_profiler.paused)
+		refreshView();
+
+	ImGui::PushID("CPU");
+	ImGui::Text("CPU");
+	drawView(s_profiler.cpuView, 0);
+	ImGui::PopID();
+
+	ImGui::PushID("GPU");
+	ImGui::Text("GPU (%u frames behind)", GPU_FRAME_LATENCY - 1);
+	drawView(s_profiler.gpuView, 0);
+	ImGui::PopID();
+
+	for (auto& thread : s_profiler.threadView)
+		ImGui::Text("%-12s %8.3f ms busy", thread.first.c_str(), thread.second);
+}
+
+} // namespace aie
+
+#endif
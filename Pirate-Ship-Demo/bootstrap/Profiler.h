@@ -0,0 +1,111 @@
+#pragma once
+
+// the profiler is compiled in unless AIE_NO_PROFILER is defined, which must then be
+// defined for every project that links bootstrap so they agree; compiled out, the
+// scopes below are empty statements
+#ifndef AIE_NO_PROFILER
+#define AIE_PROFILER
+#endif
+
+#ifdef AIE_PROFILER
+
+#include <string>
+
+namespace aie {
+
+// a hierarchical CPU and GPU frame profiler
+// scopes are timed with the CPU's timestamp counter and written, as they close, to a ring
+// buffer owned by the thread, so recording never takes a lock and any thread can profile.
+// GPU scopes also time the GL commands issued inside them with timestamp queries, read
+// back a few frames later so the pipeline never stalls, and mark them as KHR_debug groups
+// for graphics debuggers. the recent history can be written as a Chrome trace, for
+// chrome://tracing or Perfetto.
+class Profiler {
+public:
+
+	// a closed scope, in timestamp counter ticks (or nanoseconds for the GPU)
+	struct Record {
+		const char*			name;
+		unsigned long long	start;
+		unsigned long long	end;
+		unsigned int		depth;		// scopes open on the thread when it began
+	};
+
+	static const unsigned int RING_RECORDS = 32768;		// per thread
+	static const unsigned int GPU_FRAME_LATENCY = 4;	// frames of queries in flight
+	static const unsigned int MAX_GPU_SCOPES = 128;		// per frame, later ones are CPU only
+
+	// the timestamp counter, and its rate measured against the system clock
+	static unsigned long long now();
+	static double getTicksPerSecond();
+	static double toMilliseconds(unsigned long long ticks);
+
+	// scopes must be closed in the reverse order they were opened, on the same thread
+	// names must outlive the profiler (literals, or intern())
+	static void begin(const char* name);
+	static void end();
+
+	// records a range timed by the caller as closed at the current depth
+	static void record(const char* name, unsigned long long start, unsigned long long end);
+
+	// a sample of a value that changes over time, drawn as a graph in traces
+	// from the thread that owns the GL context; names must outlive the profiler
+	static void counter(const char* name, double value);
+
+	// GPU scopes may only be used on the thread that owns the GL context
+	static void beginGpu(const char* name);
+	static void endGpu();
+
+	// a copy of the name that lives as long as the profiler
+	static const char* intern(const std::string& name);
+
+	// the name the thread has in traces
+	static void setThreadName(const char* name);
+
+	// frame boundaries, from the thread that owns the GL context
+	static void beginFrame();
+	static void endFrame();
+	static unsigned int getFrameNumber();
+
+	// releases the GPU queries, before the context is destroyed
+	static void shutdownGpu();
+
+	// writes the recorded history of every thread and the GPU as a Chrome trace;
+	// with a frame count, only the scopes of that many latest frames
+	static bool writeTrace(const char* filename, unsigned int frames = 0);
+
+	// the same, for the scopes that began at or after a timestamp
+	static bool writeTraceSince(const char* filename, unsigned long long since);
+
+	// a tree of the last frame's scopes on this thread and the GPU, and a button to save a trace
+	static void drawImGui();
+};
+
+class ProfileScope {
+public:
+	ProfileScope(const char* name) { Profiler::begin(name); }
+	~ProfileScope() { Profiler::end(); }
+};
+
+class ProfileGpuScope {
+public:
+	ProfileGpuScope(const char* name) { Profiler::beginGpu(name); }
+	~ProfileGpuScope() { Profiler::endGpu(); }
+};
+
+} // namespace aie
+
+#define AIE_PROFILE_JOIN2(a, b) a##b
+#define AIE_PROFILE_JOIN(a, b) AIE_PROFILE_JOIN2(a, b)
+
+// times the rest of the enclosing scope
+#define PROFILE_SCOPE(name) aie::ProfileScope AIE_PROFILE_JOIN(profileScope, __LINE__)(name)
+// times the rest of the enclosing scope on the CPU and the GPU
+#define PROFILE_GPU_SCOPE(name) aie::ProfileGpuScope AIE_PROFILE_JOIN(profileScope, __LINE__)(name)
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+
+#endif
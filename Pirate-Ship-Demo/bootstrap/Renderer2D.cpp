@@ -1,8 +1,8 @@
 #include "gl_core_4_4.h"
-#include <GLFW/glfw3.h>
 #include "Renderer2D.h"
 #include "Texture.h"
 #include "Font.h"
+#include "GLStats.h"
 #include <glm/ext.hpp>
 #include <stb_truetype.h>
 
@@ -151,13 +151,14 @@ void Renderer2D::begin() {
 	m_currentVertex = 0;
 	m_currentTexture = 0;
 
-	int width = 0, height = 0;
-	auto window = glfwGetCurrentContext();
-	glfwGetWindowSize(window, &width, &height);
+	// the viewport follows the window size (see Application::createWindow), and unlike
+	// the current context's window it is there under the null GL backend too
+	int viewport[4] = {};
+	glGetIntegerv(GL_VIEWPORT, viewport);
 	
 	glUseProgram(m_shader);
 
-	auto projection = glm::ortho(m_cameraX, m_cameraX + (float)width, m_cameraY, m_cameraY + (float)height, 1.0f, -101.0f);
+	auto projection = glm::ortho(m_cameraX, m_cameraX + (float)viewport[2], m_cameraY, m_cameraY + (float)viewport[3], 1.0f, -101.0f);
 	glUniformMatrix4fv(glGetUniformLocation(m_shader, "projectionMatrix"), 1, false, &projection[0][0]);
 
 	glEnable(GL_BLEND);
@@ -560,8 +561,9 @@ void Renderer2D::drawText(Font * font, const char* text, float xPos, float yPos,
 	m_fontTexture[m_currentTexture - 1] = 1;
 
 	// font renders top to bottom, so we need to invert it
-	int w = 0, h = 0;
-	glfwGetWindowSize(glfwGetCurrentContext(), &w, &h);
+	int viewport[4] = {};
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	int h = viewport[3];
 
 	yPos = h - yPos;
 
@@ -643,6 +645,7 @@ bool Renderer2D::shouldFlush(int additionalVertices, int additionalIndices) {
 }
 
 void Renderer2D::flushBatch() {
+	GL_STATS_SECTION("Renderer2D::flushBatch");
 
 	// dont render anything
 	if (m_currentVertex == 0 || m_currentIndex == 0 || m_renderBegun == false)
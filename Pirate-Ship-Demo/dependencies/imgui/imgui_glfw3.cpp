@@ -9,6 +9,7 @@
 
 // GL_CORE/GLFW
 #include "gl_core_4_4.h"
+#include "GLStats.h"
 #include <GLFW/glfw3.h>
 
 #ifdef _WIN32
@@ -35,6 +36,8 @@ static unsigned int g_VboHandle = 0, g_VaoHandle = 0, g_ElementsHandle = 0;
 // If text or lines are blurry when integrating ImGui in your engine:
 // - in your Render function, try translating your projection matrix by (0.5f,0.5f) or (0.375f,0.375f)
 void ImGui_RenderDrawLists(ImDrawData* draw_data) {
+    GL_STATS_SECTION("ImGui_RenderDrawLists");
+
     // Backup GL state
     GLint last_program; glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
     GLint last_texture; glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);